@@ -0,0 +1,58 @@
+#ifndef ANSWER_CACHE_H
+#define ANSWER_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "answer_table.h"
+
+// ===================
+// 视觉问答缓存
+// ===================
+// 以（图像感知哈希，问题）为键缓存AI回答。图像哈希为9x8亮度缩略图的dHash
+// （每行相邻像素比较，共64位），与缓存条目的汉明距离不超过阈值即视为同一画面，
+// 直接返回缓存的回答，省去一次数秒的HTTPS往返。条目保存问题全文，命中时逐字比较。
+// 条目固定大小，整体一次分配在PSRAM中，满了淘汰最久未使用的条目（表逻辑见answer_table.h）；
+// 可选挂接LittleFS文件：每次写入只追加一条记录，记录累积到表容量两倍时重写压缩，
+// 重启后自动加载。
+// 内部带互斥锁，可在多个任务中使用。
+
+#define ANSWER_CACHE_ENTRIES   32
+#define ANSWER_HASH_WIDTH      9
+#define ANSWER_HASH_HEIGHT     8
+
+struct AnswerCacheStats {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t stores;
+  uint32_t evictions;
+  uint8_t entries;
+  uint8_t maxDistance;
+};
+
+// 分配缓存（优先PSRAM），maxDistance为命中允许的最大汉明距离（0~64）
+bool answerCacheBegin(uint8_t maxDistance);
+
+bool answerCacheEnabled();
+
+void answerCacheSetMaxDistance(uint8_t maxDistance);
+
+// 9x8亮度缩略图的dHash
+uint64_t answerCacheHashThumb(const uint8_t* thumb);
+
+// 查找最接近的条目；命中时把回答复制到answer并返回true
+bool answerCacheLookup(uint64_t imageHash, const char* question,
+                       char* answer, size_t answerSize, uint8_t* distance);
+
+// 问题或回答超过ANSWER_CACHE_QUESTION_MAX/ANSWER_CACHE_TEXT_MAX时不缓存
+void answerCacheStore(uint64_t imageHash, const char* question, const char* answer);
+
+// 挂接LittleFS持久化文件：清空内存表后加载文件内容，之后每次写入追加到文件；path为NULL时取消
+bool answerCacheAttachStorage(const char* path);
+
+void answerCacheClear();
+
+void getAnswerCacheStats(AnswerCacheStats* stats);
+
+void printAnswerCacheStats();
+
+#endif // ANSWER_CACHE_H
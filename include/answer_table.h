@@ -0,0 +1,63 @@
+#ifndef ANSWER_TABLE_H
+#define ANSWER_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===================
+// 回答缓存表
+// ===================
+// answer_cache的表逻辑：固定大小的条目数组，以（图像哈希，问题）为键。
+// 问题先比较64位FNV-1a哈希，哈希相同再比较保存的问题全文，不同问题不会因哈希碰撞共用回答；
+// 图像哈希的汉明距离不超过maxDistance视为同一画面。满了淘汰最久未使用的条目。
+// 持久化为追加式日志：每条记录是图像哈希、问题和回答，加载时按顺序重放，同一键的新记录覆盖旧记录。
+// 读写通过回调进行，不依赖文件系统。不加锁、不依赖Arduino，由调用者串行化。
+
+#define ANSWER_CACHE_TEXT_MAX      512   // 含结尾'\0'，更长的回答不缓存
+#define ANSWER_CACHE_QUESTION_MAX  256   // 含结尾'\0'，更长的问题不缓存
+
+struct AnswerEntry {
+  uint64_t imageHash;
+  uint64_t questionHash;                // 问题的FNV-1a，比较全文之前的快速筛选
+  uint32_t lastUsed;                    // 0表示空条目
+  char question[ANSWER_CACHE_QUESTION_MAX];
+  char text[ANSWER_CACHE_TEXT_MAX];
+};
+
+struct AnswerTable {
+  AnswerEntry* entries;                 // 由调用者分配（设备上在PSRAM中）
+  uint8_t capacity;
+  uint8_t count;                        // 非空条目数
+  uint8_t maxDistance;                  // 命中允许的最大汉明距离（0~64）
+  uint32_t useCounter;
+};
+
+// 日志读写回调，返回实际读写的字节数
+typedef size_t (*AnswerReadFn)(void* ctx, void* data, size_t length);
+typedef size_t (*AnswerWriteFn)(void* ctx, const void* data, size_t length);
+
+void answerTableInit(AnswerTable* t, AnswerEntry* entries, uint8_t capacity, uint8_t maxDistance);
+
+void answerTableClear(AnswerTable* t);
+
+void answerTableSetMaxDistance(AnswerTable* t, uint8_t maxDistance);
+
+uint64_t answerQuestionHash(const char* question);
+
+// 同一问题中图像哈希最接近且距离不超过阈值的条目：命中时标记为最近使用并返回下标，否则返回-1
+int answerTableLookup(AnswerTable* t, uint64_t imageHash, const char* question, uint8_t* distance);
+
+// 写入：同一问题、同一画面已有条目时覆盖，否则用空条目或淘汰最久未使用的。
+// 返回写入的下标；问题或回答太长时不写入，返回-1。evicted输出是否淘汰了一个条目
+int answerTableStore(AnswerTable* t, uint64_t imageHash, const char* question, const char* answer,
+                     bool* evicted);
+
+// 写一条日志记录：图像哈希、问题长度和问题、回答长度和回答（长度为uint16_t）
+bool answerRecordWrite(uint64_t imageHash, const char* question, const char* answer,
+                       AnswerWriteFn write, void* ctx);
+
+// 清空表后按顺序重放日志，records输出完整读出的记录数。
+// 末尾有残缺记录（写入时掉电）或长度不合法时停在该处并返回false
+bool answerTableReplay(AnswerTable* t, AnswerReadFn read, void* ctx, uint32_t* records);
+
+#endif // ANSWER_TABLE_H
@@ -0,0 +1,57 @@
+#ifndef API_CONNECTION_H
+#define API_CONNECTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===================
+// 接口长连接管理
+// ===================
+// 所有DashScope请求共用一个HTTPClient和一个连接（https用WiFiClientSecure，http用WiFiClient），
+// 以HTTP/1.1 keep-alive保持连接，后续请求省去TCP+TLS握手（数百毫秒）和每次握手的堆峰值。
+// 连接空闲超过API_IDLE_TIMEOUT_MS时在服务器关闭之前主动断开，下次请求重新握手；
+// 复用的连接在发送阶段失败（服务器已关闭）时重新连接，由调用者重发一次。
+// 不做TLS会话恢复：ESP32核心的WiFiClientSecure在stop()时释放mbedTLS上下文，也没有保存和恢复
+// 会话的接口，空闲断开和服务器关闭后的重连都是完整握手，只靠keep-alive减少握手次数。
+// 地址改变（如指向本地模拟服务器）时自动换连接。TLS不校验证书，与HTTPClient默认行为一致，
+// 本地自签名证书的模拟服务器也可直接使用。
+// apiConnectionBegin()与apiConnectionEnd()之间独占连接（带互斥锁），可在多个任务中使用；
+// 互斥锁由apiConnectionInit()在setup()中、任何任务启动之前创建，未初始化时请求直接失败。
+// 保持连接会一直占用TLS缓冲区（约40KB），不再需要时调用apiConnectionClose()释放。
+
+class HTTPClient;
+
+#define API_IDLE_TIMEOUT_MS 20000
+
+struct ApiConnectionStats {
+  uint32_t requests;
+  uint32_t handshakes;        // 新建连接（TCP + TLS）次数
+  uint32_t reused;            // 复用已有连接的请求数
+  uint32_t staleRetries;      // 复用的连接已被服务器关闭、重连重发的次数
+  uint32_t idleCloses;        // 空闲超时主动断开的次数
+  uint32_t connectFailures;
+  uint32_t lastHandshakeMs;
+  uint32_t totalHandshakeMs;
+};
+
+// 创建连接互斥锁，在setup()中调用一次（重复调用无害）
+bool apiConnectionInit();
+
+// 取得共享连接并绑定到url，返回已begin的HTTPClient（失败返回NULL，不持有锁）。
+// reused输出本次是否复用了已有连接；每次都需要重新添加请求头
+HTTPClient* apiConnectionBegin(const char* url, bool* reused);
+
+// 发送失败是否应重连后重发：复用的连接在发送请求阶段出错
+bool apiConnectionShouldRetry(int httpCode, bool reused);
+
+// 结束本次请求并释放锁；服务器允许时连接保持打开
+void apiConnectionEnd();
+
+// 断开连接，释放TLS缓冲区
+void apiConnectionClose();
+
+void getApiConnectionStats(ApiConnectionStats* stats);
+
+void printApiConnectionStats();
+
+#endif // API_CONNECTION_H
@@ -0,0 +1,48 @@
+#ifndef API_LATENCY_H
+#define API_LATENCY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "latency_histogram.h"
+
+// ===================
+// 接口请求分阶段耗时
+// ===================
+// 每个视觉请求按阶段用esp_timer（微秒）计时，各阶段分别累计到延迟直方图，
+// 串口输出每个阶段的次数、最小/平均/p95/最大值，用于判断一次请求的数秒花在哪里。
+// 复用连接的请求没有DNS和握手阶段，这些阶段的次数少于请求数。
+// https时TCP连接在WiFiClientSecure内部与TLS握手一起完成，无法单独计时，计入TLS阶段；
+// CONNECT阶段只统计http（本地模拟服务器）的TCP连接。
+// 可在多个任务中记录（带互斥锁）；锁由apiLatencyInit()在setup()中创建，之前的记录被忽略。
+
+enum ApiPhase : uint8_t {
+  API_PHASE_DNS = 0,
+  API_PHASE_CONNECT,       // TCP连接（http）
+  API_PHASE_TLS,           // TCP连接 + TLS握手（https）
+  API_PHASE_UPLOAD,        // 发送请求头到请求体最后一个字节交给协议栈
+  API_PHASE_FIRST_BYTE,    // 请求发完到响应头解析完
+  API_PHASE_DOWNLOAD,      // 等待和读取响应体
+  API_PHASE_PARSE,         // JSON/SSE解析（与下载交替进行，扣除读取时间）
+  API_PHASE_DISPLAY,       // 刷新屏幕
+  API_PHASE_TOTAL,         // 整个请求（含排队等配额）
+  API_PHASE_COUNT
+};
+
+// 创建互斥锁，在setup()中、任何请求任务启动之前调用一次（重复调用无害）
+bool apiLatencyInit();
+
+// 记录一个阶段的耗时
+void apiLatencyRecord(ApiPhase phase, uint32_t us);
+
+// 记录从startUs（esp_timer_get_time()）到现在的耗时，返回现在的时间，便于接着计时下一阶段
+int64_t apiLatencyRecordSince(ApiPhase phase, int64_t startUs);
+
+const char* apiPhaseName(ApiPhase phase);
+
+void getApiLatencyHistogram(ApiPhase phase, LatencyHistogram* histogram);
+
+void resetApiLatencyStats();
+
+void printApiLatencyStats();
+
+#endif // API_LATENCY_H
@@ -0,0 +1,47 @@
+#ifndef BASE64_STREAM_H
+#define BASE64_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===================
+// 查表Base64编码器
+// ===================
+// base64EncodeTo() 一次性编码到调用者预先分配好的缓冲区，
+// 大小用 base64EncodedLength() 计算（4 * ceil(n / 3)），编码过程不再分配内存。
+// Base64Stream 支持分块输入：输入任意长度的片段，凑满3字节的整组后编码，
+// 输出先写入内部缓冲区，攒满后交给sink回调（例如直接写入网络连接）。
+
+#define BASE64_STREAM_CHUNK 512  // 内部输出缓冲区大小，必须是4的倍数
+
+// 输出回调：返回false表示写入失败，编码随即中止
+typedef bool (*Base64Sink)(const char* data, size_t length, void* ctx);
+
+struct Base64Stream {
+  Base64Sink sink;
+  void* ctx;
+  uint8_t pending[3];   // 不足一组的剩余输入
+  uint8_t pendingLength;
+  bool failed;
+  size_t used;          // out中待输出的字符数
+  size_t total;         // 已交给sink的字符总数
+  char out[BASE64_STREAM_CHUNK];
+};
+
+// 编码后的长度（含'='填充，不含结尾的'\0'）
+static inline size_t base64EncodedLength(size_t length) {
+  return (length + 2) / 3 * 4;
+}
+
+// 编码到out，返回写入的字符数；out至少要有 base64EncodedLength(length) 字节，不写结尾'\0'
+size_t base64EncodeTo(const uint8_t* data, size_t length, char* out);
+
+void base64StreamBegin(Base64Stream* st, Base64Sink sink, void* ctx);
+
+// 输入一段数据，可多次调用
+bool base64StreamWrite(Base64Stream* st, const uint8_t* data, size_t length);
+
+// 编码剩余字节并补齐'='，把缓冲区剩余内容交给sink
+bool base64StreamEnd(Base64Stream* st);
+
+#endif // BASE64_STREAM_H
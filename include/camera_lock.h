@@ -0,0 +1,39 @@
+#ifndef CAMERA_LOCK_H
+#define CAMERA_LOCK_H
+
+#include <stdint.h>
+
+// ===================
+// 摄像头驱动锁与后台取帧者登记
+// ===================
+// 驱动的初始化、释放和故障恢复都在cameraLock()下进行（递归锁，同一任务可以重入）。
+// 实时预览、流水线和录帧的任务会一直持有驱动的帧缓冲（队列里一个、处理中一个），
+// 它们在启动任务之前登记、任务全部退出之后注销；有登记的取帧者时不能释放或重建驱动，
+// 否则esp_camera_deinit()会释放它们手中的帧缓冲。
+// 锁由startCameraInit()创建，早于任何取帧的任务；创建之前加锁和登记都直接放行。
+
+enum CameraUser : uint8_t {
+  CAMERA_USER_LIVE_VIEW = 1 << 0,
+  CAMERA_USER_PIPELINE  = 1 << 1,
+  CAMERA_USER_RECORDER  = 1 << 2
+};
+
+// 创建锁（重复调用无害）
+bool cameraLockInit();
+
+void cameraLock();
+void cameraUnlock();
+
+// 登记后台取帧者；同一取帧者已登记时返回false
+bool cameraUserBegin(CameraUser user);
+
+// 任务全部退出、帧缓冲都已归还后注销
+void cameraUserEnd(CameraUser user);
+
+// 当前登记的取帧者（CameraUser按位或），0表示没有
+uint8_t cameraUsers();
+
+// 取帧者名称，有多个时返回最低位的那个，用于日志
+const char* cameraUserName(uint8_t users);
+
+#endif // CAMERA_LOCK_H
@@ -0,0 +1,53 @@
+#ifndef CAMERA_MODE_H
+#define CAMERA_MODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===================
+// 摄像头模式管理
+// ===================
+// 按用途预设几组摄像头配置（分辨率、像素格式、JPEG质量、取帧方式、曝光），
+// 只有请求的模式与当前模式不同时才切换：
+//   只改传感器参数时直接写寄存器，不重新初始化驱动；
+//   像素格式、取帧方式变化或分辨率超出帧缓冲时才重新初始化驱动。
+// 离开一个模式时保存传感器状态，下次进入时恢复（运行中调整过的质量/分辨率不会丢），
+// 只写入与当前值不同的寄存器。
+// 切换分辨率后按帧尺寸丢弃旧分辨率的缓冲帧，不再固定延时等待。
+// 切换在摄像头驱动锁（camera_lock.h）下进行；有后台取帧者运行时拒绝切换到其他模式，
+// 它们要切换模式应在同一次加锁中先切换再登记。
+
+enum CameraMode : uint8_t {
+  CAMERA_MODE_ANALYZE = 0,    // AI分析：VGA JPEG（无PSRAM时QVGA）
+  CAMERA_MODE_PREVIEW,        // OLED预览：QQVGA JPEG
+  CAMERA_MODE_PREVIEW_GRAY,   // OLED预览：QQVGA灰度直出
+  CAMERA_MODE_LOW_LIGHT,      // 弱光：QVGA，提高曝光和增益上限
+  CAMERA_MODE_COUNT
+};
+
+struct CameraModeStats {
+  uint32_t requests;          // setCameraMode调用次数
+  uint32_t switches;          // 实际切换次数
+  uint32_t reinits;           // 其中需要重新初始化驱动的次数
+  uint32_t refused;           // 有后台取帧者运行、被拒绝的切换
+  uint32_t framesDiscarded;   // 切换后丢弃的旧帧
+  uint32_t switchMs;          // 切换累计耗时
+  uint32_t lastSwitchMs;
+  uint32_t maxSwitchMs;
+};
+
+// 驱动重新初始化后调用：当前模式设为分析模式，清空各模式缓存的传感器状态
+void cameraModeReset();
+
+// 切换到指定模式；已经是该模式时直接返回true，有后台取帧者运行或切换失败时返回false
+bool setCameraMode(CameraMode mode);
+
+CameraMode getCameraMode();
+
+const char* cameraModeName(CameraMode mode);
+
+void getCameraModeStats(CameraModeStats* stats);
+
+void printCameraModeStats();
+
+#endif // CAMERA_MODE_H
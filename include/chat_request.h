@@ -0,0 +1,77 @@
+#ifndef CHAT_REQUEST_H
+#define CHAT_REQUEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===================
+// 对话接口请求模板
+// ===================
+// 请求体由若干片段组成：预先转义好的固定JSON片段（模型、角色、内容类型等，编译期确定长度）、
+// 需要转义的文本（问题、模型名、URL，长度按JSON转义规则预先计算）、
+// 原样输出的数据和需要Base64编码的图像。总长度在发送前算出（用作Content-Length），
+// 读取时逐段生成直接写入连接，不构建JSON文档树，也不在内存中拼接请求体。
+// 输出与ArduinoJson序列化相同的文档一致，只是其他控制字符按JSON规范写成\u00XX（ArduinoJson 6原样输出）。
+// 片段只保存指针，发送完成前文本和图像必须保持有效。不依赖Arduino。
+
+#define CHAT_REQUEST_PARTS_MAX 12
+
+enum ChatPartType : uint8_t {
+  CHAT_PART_LITERAL = 0,   // 原样输出（已是合法JSON片段）
+  CHAT_PART_STRING,        // 加引号并转义为JSON字符串
+  CHAT_PART_RAW,           // 原样输出的数据（如已编码的Base64）
+  CHAT_PART_BASE64         // 编码为Base64输出
+};
+
+struct ChatPart {
+  ChatPartType type;
+  const uint8_t* data;
+  size_t length;           // 输入字节数
+  size_t size;             // 输出字节数
+};
+
+struct ChatRequest {
+  ChatPart parts[CHAT_REQUEST_PARTS_MAX];
+  uint8_t count;
+  bool overflow;           // 片段数超过CHAT_REQUEST_PARTS_MAX
+  size_t total;
+  // 读取位置
+  size_t position;
+  uint8_t part;
+  size_t offset;           // 当前片段内已输出的字节
+  size_t source;           // CHAT_PART_STRING已转义到的输入位置
+  char pending[6];         // 转义序列中还没输出的部分
+  uint8_t pendingLength;
+  uint8_t pendingPosition;
+};
+
+// 转义为JSON字符串后的长度（含两端引号）
+size_t jsonStringLength(const char* text, size_t length);
+
+void chatRequestBegin(ChatRequest* r);
+
+void chatRequestLiteral(ChatRequest* r, const char* json, size_t length);
+void chatRequestString(ChatRequest* r, const char* text);
+void chatRequestRaw(ChatRequest* r, const uint8_t* data, size_t length);
+void chatRequestBase64(ChatRequest* r, const uint8_t* data, size_t length);
+
+// 视觉请求：图像以data URL内嵌；encoded为true时image已是Base64
+bool chatRequestVisionImage(ChatRequest* r, const char* model, bool stream, const uint8_t* image,
+                            size_t imageLength, bool encoded, const char* question);
+
+// 视觉请求：图像URL，带中文回答的系统提示
+bool chatRequestVisionUrl(ChatRequest* r, const char* model, const char* imageUrl, const char* question);
+
+// 纯文本请求
+bool chatRequestText(ChatRequest* r, const char* model, const char* text);
+
+// 请求体总字节数（Content-Length）
+size_t chatRequestLength(const ChatRequest* r);
+
+// 生成接下来最多length字节，返回写入的字节数，读完时返回0
+size_t chatRequestRead(ChatRequest* r, uint8_t* out, size_t length);
+
+// 回到开头，重发请求时使用
+void chatRequestRewind(ChatRequest* r);
+
+#endif // CHAT_REQUEST_H
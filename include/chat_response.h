@@ -0,0 +1,69 @@
+#ifndef CHAT_RESPONSE_H
+#define CHAT_RESPONSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <ArduinoJson.h>
+
+// ===================
+// 对话接口响应解析
+// ===================
+// 用ArduinoJson的过滤器只保留choices[0].message.content、finish_reason和usage，
+// 其余字段（id、model、logprobs等）边读边丢弃，文档大小只取决于回答长度，与响应大小无关。
+// 输入可以是任何ArduinoJson支持的读取源（Stream、字符串、自定义读取器），
+// 直接从HTTP连接读取时不需要先用getString()缓存整个响应。不依赖Arduino。
+
+// 回答最大长度，超出时解析返回NoMemory而不是静默截断
+#define CHAT_ANSWER_MAX       4096
+#define CHAT_RESPONSE_DOC_SIZE (CHAT_ANSWER_MAX + 512)
+
+struct ChatResponse {
+  const char* content;        // 指向文档内部，文档释放后失效
+  const char* finishReason;   // "stop"、"length"等，没有时为NULL
+  uint32_t promptTokens;
+  uint32_t completionTokens;
+  uint32_t totalTokens;
+};
+
+// 只保留需要字段的过滤器
+void chatResponseFilter(JsonDocument& filter);
+
+// 从已解析的文档取出字段；缺少choices[0].message.content时返回false
+bool chatResponseRead(const JsonDocument& doc, ChatResponse* response);
+
+// 从input解析响应；回答超过文档容量时返回NoMemory。
+// 成功时response->content为NULL表示响应中没有回答（格式不符）
+template <typename TInput>
+DeserializationError chatResponseParse(JsonDocument& doc, TInput& input, ChatResponse* response) {
+  StaticJsonDocument<256> filter;
+  chatResponseFilter(filter);
+  DeserializationError error = deserializeJson(doc, input, DeserializationOption::Filter(filter));
+  if (!error && doc.overflowed()) error = DeserializationError::NoMemory;
+  if (error) return error;
+  chatResponseRead(doc, response);
+  return error;
+}
+
+// ---- 流式响应（"stream": true）的单个SSE事件 ----
+// 每个事件是一个chat.completion.chunk，只保留choices[0].delta.content、finish_reason和usage
+// （请求了stream_options.include_usage时最后一个事件choices为空、只带usage）。
+// 过滤后的文档大小取决于事件长度：content反转义后不长于原文，加上固定的键和节点。
+// 按SSE_EVENT_MAX分配一次即可容纳解析器交出的任何事件。
+
+#define CHAT_DELTA_DOC_SIZE(eventLength) \
+  (JSON_OBJECT_SIZE(2) * 2 + JSON_ARRAY_SIZE(1) + JSON_OBJECT_SIZE(1) + JSON_OBJECT_SIZE(3) + 128 + (eventLength))
+
+struct ChatDelta {
+  const char* content;        // 本段文字，没有时为NULL；指向文档内部
+  const char* finishReason;
+  uint32_t promptTokens;      // 只有带usage的事件才非0
+  uint32_t completionTokens;
+  uint32_t totalTokens;
+};
+
+void chatDeltaFilter(JsonDocument& filter);
+
+// 解析一个事件的data；文档容量不足时返回NoMemory，不会静默丢掉文字
+DeserializationError chatDeltaParse(JsonDocument& doc, const char* data, size_t length, ChatDelta* delta);
+
+#endif // CHAT_RESPONSE_H
@@ -0,0 +1,48 @@
+#ifndef DITHER_H
+#define DITHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===================
+// 单色抖动引擎
+// ===================
+// 逐行把灰度转换为1位单色，输出为XBM格式的行（每字节低位在左）。
+// 有序抖动（Bayer）速度最快；误差扩散（Floyd-Steinberg/Atkinson）质量更好，
+// 误差缓冲区只保留3行目标宽度，与图像高度无关。
+// threshold为二值化中点：有序抖动时平移阈值矩阵，误差扩散时作为比较阈值。
+
+#define DITHER_MAX_WIDTH 128
+
+enum DitherMode : uint8_t {
+  DITHER_THRESHOLD = 0,    // 单一阈值
+  DITHER_BAYER4,           // 4x4 有序抖动
+  DITHER_BAYER8,           // 8x8 有序抖动
+  DITHER_FLOYD_STEINBERG,  // 误差扩散 7/3/5/1
+  DITHER_ATKINSON,         // 误差扩散 6 x 1/8，对比度更高
+  DITHER_MODE_COUNT
+};
+
+struct Ditherer {
+  DitherMode mode;
+  uint16_t width;
+  uint8_t threshold;
+  uint16_t row;
+  uint8_t thresholds[8][DITHER_MAX_WIDTH];  // 有序抖动：按行展开的阈值
+  int16_t errors[3][DITHER_MAX_WIDTH + 4];  // 误差扩散：当前行和后两行（两侧各留2个像素）
+  uint8_t levels[DITHER_MAX_WIDTH];         // 当前行逐像素结果 0/1，最后统一打包
+};
+
+const char* ditherModeName(DitherMode mode);
+
+// 开始一帧；宽度超过DITHER_MAX_WIDTH时返回false
+bool ditherBegin(Ditherer* d, DitherMode mode, uint16_t width, uint8_t threshold);
+
+// 处理一行灰度像素，写入 (width + 7) / 8 字节
+void ditherRow(Ditherer* d, const uint8_t* gray, uint8_t* monoRow);
+
+// 处理整幅图像
+bool ditherImage(DitherMode mode, const uint8_t* gray, uint8_t* mono,
+                 uint16_t width, uint16_t height, uint8_t threshold);
+
+#endif // DITHER_H
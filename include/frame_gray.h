@@ -0,0 +1,34 @@
+#ifndef FRAME_GRAY_H
+#define FRAME_GRAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_camera.h"
+#include "luma_stats.h"
+
+// ===================
+// 相机帧转灰度
+// ===================
+// 按帧格式分派：JPEG流式解码（源图足够大时只取DC系数），灰度/YUV422直接对亮度平面做区域平均，
+// 缩放结果写入调用者的缓冲区（stride为目标缓冲区的行字节数）。预览、场景检测、回答缓存哈希都走这里。
+// 缩放器和JPEG解码器上下文都是静态的，不可重入，多个任务调用时由调用者加锁（见camera.cpp的decodeLock）。
+// 只用到esp_camera的帧类型，不依赖Arduino，主机上用camera_fb_t的替身即可编译运行。
+
+// JPEG解码并缩放为灰度图，按行流式处理，不持有整帧解码图像
+bool jpegToGrayscale(const uint8_t* jpegData, size_t jpegSize,
+                     uint8_t* grayBuffer, uint16_t targetWidth, uint16_t targetHeight,
+                     uint16_t stride);
+
+// 从亮度平面直接区域平均缩放；pixelStep为1时是灰度平面，为2时是YUYV排列的YUV422
+bool lumaToGrayscale(const uint8_t* luma, uint16_t srcWidth, uint16_t srcHeight, uint8_t pixelStep,
+                     uint8_t* grayBuffer, uint16_t targetWidth, uint16_t targetHeight,
+                     uint16_t stride);
+
+// 按帧格式转换；不支持的格式返回false
+bool frameToGrayscale(const camera_fb_t* fb, uint8_t* grayBuffer,
+                      uint16_t targetWidth, uint16_t targetHeight, uint16_t stride);
+
+// 整帧亮度统计：灰度/YUV直接统计亮度平面，JPEG统计DC系数（每个8x8块一个值）
+bool frameLumaStats(const camera_fb_t* fb, LumaStats* stats);
+
+#endif // FRAME_GRAY_H
@@ -0,0 +1,44 @@
+#ifndef FRAME_RECORDER_H
+#define FRAME_RECORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "frame_ring.h"
+
+// ===================
+// 后台录帧（事件前画面）
+// ===================
+// 后台任务按固定间隔取JPEG帧复制进PSRAM环形存储（frame_ring），立即归还驱动帧缓冲。
+// 事件（运动、声音、按键）发生时直接取事件前若干毫秒的帧上传，没有拍照延迟。
+// 取出的帧被固定，上传期间录帧继续进行，用完必须调用frameRecorderRelease()。
+// 录帧运行期间它是摄像头的唯一取帧者，其他功能应从这里取帧；流水线或实时预览运行时拒绝启动，
+// 录帧运行时它们也不能启动。
+
+struct FrameRecorderStats {
+  FrameRingStats ring;
+  uint8_t frames;             // 当前保存的帧数
+  uint8_t capacity;
+  uint32_t arenaBytes;
+  uint32_t spanMs;            // 最旧帧到最新帧的时间跨度
+  uint32_t captureFailures;
+  uint32_t copyUs;            // 最近一帧复制进环形存储的耗时
+};
+
+// 分配arena（优先PSRAM，重复启动时复用）并启动录帧任务；上次取出的帧还未释放时拒绝启动
+bool startFrameRecorder(uint32_t arenaBytes, uint8_t maxFrames, uint32_t intervalMs);
+
+void stopFrameRecorder();
+
+bool frameRecorderRunning();
+
+// 取最新帧 / 最接近offsetMs之前的帧，取到的帧被固定
+bool frameRecorderAcquireLatest(FrameRef* ref);
+bool frameRecorderAcquireAt(uint32_t offsetMs, FrameRef* ref);
+
+void frameRecorderRelease(const FrameRef* ref);
+
+void getFrameRecorderStats(FrameRecorderStats* stats);
+
+void printFrameRecorderStats();
+
+#endif // FRAME_RECORDER_H
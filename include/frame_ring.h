@@ -0,0 +1,73 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===================
+// 最近帧环形存储
+// ===================
+// 在一块连续内存（arena，通常在PSRAM）里按先进先出存放变长的JPEG帧，
+// 每帧连续存放（放不下尾部剩余空间时绕回开头），可直接从arena上传，不逐帧分配内存。
+// 空间或槽位不够时淘汰最旧的帧；被固定（pin）的帧不会被淘汰，此时新帧被丢弃。
+// 按序号取最新帧和按时间偏移取帧都是O(1)（按平均帧间隔估算位置，再向两侧微调）。
+// 不带锁，不依赖Arduino，时间由调用者传入。
+
+#define FRAME_RING_MAX_SLOTS 64
+
+struct FrameSlot {
+  uint32_t offset;
+  uint32_t length;
+  uint32_t timestampMs;
+  uint32_t sequence;
+  uint8_t pins;
+};
+
+struct FrameRingStats {
+  uint32_t stored;
+  uint32_t evicted;
+  uint32_t droppedPinned;     // 需要淘汰的最旧帧被固定，新帧丢弃
+  uint32_t droppedTooLarge;   // 单帧超过arena大小
+  uint32_t bytesUsed;         // 当前帧数据总字节
+  uint32_t peakBytesUsed;
+};
+
+struct FrameRing {
+  uint8_t* arena;
+  uint32_t arenaSize;
+  uint8_t capacity;           // 最多保存的帧数（<= FRAME_RING_MAX_SLOTS）
+  uint8_t head;               // 最旧帧的槽位
+  uint8_t count;
+  uint32_t nextSequence;
+  FrameSlot slots[FRAME_RING_MAX_SLOTS];
+  FrameRingStats stats;
+};
+
+// 取出的帧：data指向arena，固定期间保持有效
+struct FrameRef {
+  const uint8_t* data;
+  size_t length;
+  uint32_t timestampMs;
+  uint32_t sequence;
+  uint8_t slot;
+};
+
+void frameRingInit(FrameRing* ring, uint8_t* arena, uint32_t arenaSize, uint8_t capacity);
+
+// 复制一帧进环形存储，返回false表示被丢弃
+bool frameRingPush(FrameRing* ring, const uint8_t* data, size_t length, uint32_t timestampMs);
+
+// 第back新的帧（0为最新）
+bool frameRingPeek(const FrameRing* ring, uint8_t back, FrameRef* ref);
+
+// 时间戳最接近 nowMs - offsetMs 的帧
+bool frameRingFindAt(const FrameRing* ring, uint32_t nowMs, uint32_t offsetMs, FrameRef* ref);
+
+// 固定/释放取出的帧；固定期间该帧不会被覆盖
+void frameRingPin(FrameRing* ring, const FrameRef* ref);
+void frameRingUnpin(FrameRing* ring, const FrameRef* ref);
+
+// 当前被固定的帧数；不为0时不能重新初始化arena
+uint8_t frameRingPinnedCount(const FrameRing* ring);
+
+#endif // FRAME_RING_H
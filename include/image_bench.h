@@ -0,0 +1,71 @@
+#ifndef IMAGE_BENCH_H
+#define IMAGE_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dither.h"
+
+// ===================
+// 图像流水线基准语料与黄金输出
+// ===================
+// 一组确定性的合成原始帧（灰度/YUYV，按固定公式生成，不需要图片文件），
+// 按预览流水线的各阶段逐步处理：缩放 -> 亮度阈值 -> 抖动 -> 打包成SSD1306页格式。
+// 每个用例为每种抖动算法记录页缓冲区的FNV-1a校验值，另记录原始帧Base64编码的校验值，
+// 优化某一阶段后输出与黄金值不一致即说明行为改变。
+// 各阶段分开调用，便于调用者逐段计时。不依赖Arduino；主机上由test/host/bench_image_pipeline
+// 运行，输出另与test/host/golden/中的PBM逐像素比较。
+
+#define IMAGE_BENCH_DISPLAY_WIDTH  128
+#define IMAGE_BENCH_DISPLAY_HEIGHT 32
+
+enum ImageBenchPattern : uint8_t {
+  IMAGE_PATTERN_GRADIENT = 0,  // 对角渐变
+  IMAGE_PATTERN_BLOCKS,        // 明暗方块叠加伪随机噪声
+  IMAGE_PATTERN_RINGS,         // 同心圆环
+  IMAGE_PATTERN_DARK           // 低照度：集中在暗部的噪声
+};
+
+struct ImageBenchCase {
+  const char* name;
+  ImageBenchPattern pattern;
+  uint16_t width;
+  uint16_t height;
+  uint8_t pixelStep;         // 1为灰度，2为YUYV（亮度在偶数字节）
+  uint16_t dstWidth;         // 缩放后的预览尺寸（不超过屏幕）
+  uint16_t dstHeight;
+  uint32_t pagesChecksum[DITHER_MODE_COUNT];
+  uint32_t base64Checksum;
+};
+
+// 一次处理的中间结果，全部为静态大小
+struct ImageBenchBuffers {
+  uint8_t gray[IMAGE_BENCH_DISPLAY_WIDTH * IMAGE_BENCH_DISPLAY_HEIGHT];
+  uint8_t mono[IMAGE_BENCH_DISPLAY_WIDTH * IMAGE_BENCH_DISPLAY_HEIGHT / 8];
+  uint8_t pages[IMAGE_BENCH_DISPLAY_WIDTH * IMAGE_BENCH_DISPLAY_HEIGHT / 8];
+};
+
+extern const ImageBenchCase imageBenchCases[];
+extern const uint8_t imageBenchCaseCount;
+
+// 原始帧字节数（width * height * pixelStep）
+size_t imageBenchFrameSize(const ImageBenchCase* c);
+
+// 生成用例的原始帧
+void imageBenchFill(const ImageBenchCase* c, uint8_t* frame);
+
+// 阶段1：缩放到预览尺寸，在屏幕缓冲区中居中，边框填黑；失败返回false
+bool imageBenchScale(const ImageBenchCase* c, const uint8_t* frame, ImageBenchBuffers* b);
+
+// 阶段2：按缩放后画面的亮度分布计算抖动阈值
+uint8_t imageBenchThreshold(const ImageBenchCase* c, const ImageBenchBuffers* b, DitherMode mode);
+
+// 阶段3：抖动整个屏幕缓冲区
+bool imageBenchDither(ImageBenchBuffers* b, DitherMode mode, uint8_t threshold);
+
+// 阶段4：打包为页格式（与显示缓冲区相同的布局）
+void imageBenchPack(ImageBenchBuffers* b);
+
+// FNV-1a 32位校验
+uint32_t imageBenchChecksum(const uint8_t* data, size_t length);
+
+#endif // IMAGE_BENCH_H
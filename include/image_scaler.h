@@ -0,0 +1,43 @@
+#ifndef IMAGE_SCALER_H
+#define IMAGE_SCALER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===================
+// 定点区域平均缩放器
+// ===================
+// 按行流式输入源图像，每个目标像素取其覆盖的所有源像素的面积加权平均
+// （部分覆盖的边缘像素按覆盖比例计权），只支持缩小。
+// 状态只有两行目标宽度的累加器，可直接接在JPEG解码器或灰度帧之后。
+
+#define AREA_SCALER_MAX_WIDTH 128
+
+struct AreaScaler {
+  uint16_t srcWidth;
+  uint16_t srcHeight;
+  uint16_t dstWidth;
+  uint16_t dstHeight;
+  uint8_t* dst;
+  uint16_t dstStride;
+  uint16_t dstRow;
+  uint32_t rowEnd;       // 已输入源行的结束位置（源行长dstHeight，目标行长srcHeight）
+  uint32_t rowBoundary;  // 当前目标行的结束位置
+  uint64_t reciprocal;   // 2^32 / (srcWidth * srcHeight)，用乘法代替除法
+  uint32_t hsum[AREA_SCALER_MAX_WIDTH];
+  uint32_t acc[AREA_SCALER_MAX_WIDTH];
+};
+
+// 初始化缩放器；目标尺寸大于源尺寸或超过最大宽度时返回false
+bool areaScalerBegin(AreaScaler* s, uint16_t srcWidth, uint16_t srcHeight,
+                     uint8_t* dst, uint16_t dstWidth, uint16_t dstHeight, uint16_t dstStride);
+
+// 输入一行源像素，pixelStep为相邻像素的字节间隔（灰度为1，YUV422取亮度为2）
+void areaScalerPushRow(AreaScaler* s, const uint8_t* row, uint8_t pixelStep);
+
+// 缩放整幅灰度图像：缩小时区域平均；任一方向放大或目标宽度超过AREA_SCALER_MAX_WIDTH时
+// 区域平均不适用，改取最近邻。尺寸为0时不写入并返回false
+bool scaleGrayscaleImage(const uint8_t* srcImage, uint16_t srcWidth, uint16_t srcHeight,
+                         uint8_t* dstImage, uint16_t dstWidth, uint16_t dstHeight);
+
+#endif // IMAGE_SCALER_H
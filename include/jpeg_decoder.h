@@ -0,0 +1,61 @@
+#ifndef JPEG_DECODER_H
+#define JPEG_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===================
+// 流式JPEG亮度解码器
+// ===================
+// 只支持基线Huffman JPEG（OV2640/OV3660等摄像头输出的格式），
+// 只输出Y分量，色度块只做Huffman跳过，不做IDCT。
+// 解码时可直接缩放：
+//   JPEG_SCALE_1_1 - 完整8x8整数IDCT，输出原始分辨率
+//   JPEG_SCALE_1_8 - 只取DC系数，每个8x8块输出一个像素
+// 解码结果按行通过回调输出，内部只保留一个MCU行的条带缓冲区，
+// 不会持有整帧解码图像。解码器使用内部静态上下文，不可重入。
+// 另外提供MCU级裁剪（jpegCropMcu），与解码共用上下文。
+
+enum JpegScale : uint8_t {
+  JPEG_SCALE_1_1 = 0,
+  JPEG_SCALE_1_8 = 3
+};
+
+struct JpegInfo {
+  uint16_t width;
+  uint16_t height;
+  uint8_t components;
+  uint8_t mcuWidth;   // MCU宽度（像素），4:2:2为16
+  uint8_t mcuHeight;  // MCU高度（像素），4:2:0为16
+};
+
+struct JpegRect {
+  uint16_t x;
+  uint16_t y;
+  uint16_t width;
+  uint16_t height;
+};
+
+// 每输出一行亮度像素调用一次，y从0递增
+typedef void (*JpegRowCallback)(const uint8_t* row, uint16_t width, uint16_t y, void* ctx);
+
+// 只解析文件头，获取尺寸信息
+bool jpegGetInfo(const uint8_t* data, size_t len, JpegInfo* info);
+
+// 选择满足最小输出尺寸的最小解码代价缩放比例
+JpegScale jpegPickScale(const JpegInfo& info, uint16_t minWidth, uint16_t minHeight);
+
+// 缩放后的输出尺寸
+uint16_t jpegScaledSize(uint16_t size, JpegScale scale);
+
+// 解码亮度分量，按行回调输出
+bool jpegDecodeLuma(const uint8_t* data, size_t len, JpegScale scale,
+                    JpegRowCallback onRow, void* ctx);
+
+// MCU级无损裁剪：不解码像素，只重新组织熵编码数据，颜色和画质不变。
+// rect向外对齐到MCU边界并限制在图像内，返回时为实际裁剪区域。
+// out容量不足或原码表缺少需要的符号时返回false（out容量取原图大小即可）。
+bool jpegCropMcu(const uint8_t* data, size_t len, JpegRect* rect,
+                 uint8_t* out, size_t capacity, size_t* outLen);
+
+#endif // JPEG_DECODER_H
@@ -0,0 +1,33 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===================
+// 延迟直方图
+// ===================
+// 以微秒记录耗时，按对数分桶：每个2的幂区间再分4档，相对误差不超过25%，
+// 1微秒到约268秒共112个桶，占用固定内存，记录和查询都与样本数无关。
+// 最小、最大和平均值是精确值，百分位取所在桶的上界（不超过最大值）。不依赖Arduino。
+
+#define LATENCY_BUCKETS 112
+
+struct LatencyHistogram {
+  uint32_t count;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t totalUs;
+  uint16_t buckets[LATENCY_BUCKETS];   // 计数到65535后不再增加
+};
+
+void latencyHistogramReset(LatencyHistogram* h);
+
+void latencyHistogramRecord(LatencyHistogram* h, uint32_t us);
+
+uint32_t latencyHistogramAverage(const LatencyHistogram* h);
+
+// 第percent百分位（1~100），没有样本时返回0
+uint32_t latencyHistogramPercentile(const LatencyHistogram* h, uint8_t percent);
+
+#endif // LATENCY_HISTOGRAM_H
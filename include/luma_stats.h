@@ -0,0 +1,53 @@
+#ifndef LUMA_STATS_H
+#define LUMA_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===================
+// 亮度统计
+// ===================
+// 一次遍历像素累计256级直方图，均值、百分位、对比度都从直方图得出（256步，与图像大小无关）。
+// 输入可以是灰度平面、YUYV的亮度（步长2），也可以按行喂入JPEG的DC解码结果。
+// 结果用于抖动的二值化阈值和传感器曝光补偿。不依赖Arduino。
+
+struct LumaStats {
+  uint32_t histogram[256];
+  uint32_t count;
+  uint8_t mean;
+  uint8_t min;
+  uint8_t max;
+  uint8_t p5;
+  uint8_t median;
+  uint8_t p95;
+  uint8_t contrast;           // p95 - p5
+  uint8_t clippedLowPercent;  // <= 8 的像素占比
+  uint8_t clippedHighPercent; // >= 247 的像素占比
+};
+
+void lumaStatsBegin(LumaStats* stats);
+
+// 累计一行；step为相邻像素的字节间隔（灰度1，YUYV为2）
+void lumaStatsAddRow(LumaStats* stats, const uint8_t* row, uint16_t width, uint8_t step);
+
+// 由直方图计算均值、百分位和对比度
+void lumaStatsFinish(LumaStats* stats);
+
+// 整幅图像：Begin + 逐行Add + Finish
+void lumaStatsCompute(LumaStats* stats, const uint8_t* pixels, uint16_t width, uint16_t height,
+                      uint16_t stride, uint8_t step);
+
+// 直方图中累计占比达到percent的亮度
+uint8_t lumaPercentile(const LumaStats* stats, uint8_t percent);
+
+// Otsu阈值：使两类方差最大的分割点，用于单一阈值二值化
+uint8_t lumaOtsuThreshold(const LumaStats* stats);
+
+// 抖动中点：取p5和p95的中点，画面偏暗或偏亮时也能保留层次
+uint8_t lumaDitherThreshold(const LumaStats* stats);
+
+// 曝光建议：返回-1（减曝光）、0、+1（加曝光）。
+// 均值偏离target超过tolerance，或高光/暗部裁剪过多时给出调整方向
+int8_t lumaExposureStep(const LumaStats* stats, uint8_t target, uint8_t tolerance);
+
+#endif // LUMA_STATS_H
@@ -0,0 +1,21 @@
+#ifndef MONO_BLIT_H
+#define MONO_BLIT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===================
+// 单色图像直写显示缓冲区
+// ===================
+// 把XBM格式的单色图像（按行存储，每字节低位在左）直接转换为SSD1306的
+// 页格式（vertical top LSB：每字节为一列8个像素，低位在上），
+// 写入u8g2.getBufferPtr()，省去drawXBM逐段画线的开销。
+// 完整的8x8块走位转置快速路径，宽高不是8的倍数时边缘逐像素处理。
+
+// 把 width x height 的XBM图像写到页缓冲区左上角，超出缓冲区的部分被裁掉。
+// bufferWidth为缓冲区宽度（像素），bufferPages为页数（高度/8）。
+// 被图像覆盖的像素会被完全改写，其余部分保持不变。
+void monoBlitToPages(const uint8_t* xbm, uint16_t width, uint16_t height,
+                     uint8_t* pages, uint16_t bufferWidth, uint8_t bufferPages);
+
+#endif // MONO_BLIT_H
@@ -0,0 +1,53 @@
+#ifndef QUALITY_CONTROLLER_H
+#define QUALITY_CONTROLLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===================
+// 自适应JPEG画质控制
+// ===================
+// 闭环调整JPEG质量和分辨率，使上传的帧大小接近目标字节数。
+// 目标字节数 = 实测上行速率 x 延迟预算 x 3/4（Base64膨胀4/3）。
+// 帧偏大先降质量，质量已到下限再降一级分辨率；帧偏小先提质量，质量已到上限再升分辨率。
+// 分辨率切换代价大（传感器要重新稳定），两次切换之间至少间隔若干帧。
+// 分辨率用级别表示（0最小），由调用者映射到具体的framesize。不依赖Arduino。
+
+struct QualityControllerConfig {
+  uint32_t latencyBudgetMs;     // 上传允许占用的时间
+  uint32_t initialTargetBytes;  // 还没有上行速率数据时的目标
+  uint32_t minTargetBytes;
+  uint32_t maxTargetBytes;
+  uint8_t bestQuality;          // JPEG质量数值越小越好
+  uint8_t worstQuality;
+  uint8_t sizeLevels;           // 分辨率级别数
+  uint8_t sizeChangeInterval;   // 两次分辨率切换之间的最少帧数
+};
+
+struct QualityController {
+  QualityControllerConfig config;
+  uint8_t quality;
+  uint8_t sizeLevel;
+  uint32_t throughput;          // 上行速率，字节/秒（滑动平均），0表示未知
+  uint32_t targetBytes;
+  uint32_t lastFrameBytes;
+  uint8_t framesSinceSizeChange;
+  uint32_t frames;
+  uint32_t qualityChanges;
+  uint32_t sizeChanges;
+};
+
+// 默认：质量10~40，目标8KB~60KB，初始30KB，分辨率切换间隔5帧
+void qualityControllerDefaultConfig(QualityControllerConfig* config, uint32_t latencyBudgetMs,
+                                    uint8_t sizeLevels);
+
+void qualityControllerInit(QualityController* qc, const QualityControllerConfig* config,
+                           uint8_t quality, uint8_t sizeLevel);
+
+// 报告一次上传：发送的字节数和耗时，用于估计上行速率并更新目标
+void qualityControllerReportUpload(QualityController* qc, size_t bytesSent, uint32_t elapsedMs);
+
+// 报告刚上传的帧大小，计算下一帧的质量和分辨率级别；有变化时返回true
+bool qualityControllerUpdate(QualityController* qc, size_t frameBytes);
+
+#endif // QUALITY_CONTROLLER_H
@@ -0,0 +1,62 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===================
+// 接口配额限流
+// ===================
+// 两个令牌桶分别对应每分钟请求数和每分钟token数，按毫秒连续补充，
+// 桶容量为10秒的配额（至少一个请求），短时突发不会一下用掉整分钟的额度。
+// 单个请求的token数超过桶容量时，桶满即放行并记为欠额，之后按速率还清。
+// 请求前先估算token数，收到用量后按实际值校正。
+// 服务器按60秒滑动窗口计数时，一分钟内最多放行速率加桶容量（配额的7/6），
+// 要完全避免429应设为账户配额的5/6（见test/host/test_rate_limiter.cpp的模拟）。
+// 服务器返回429时暂停全部请求到Retry-After之后，重试间隔为带随机抖动的指数退避。
+// 不加锁、不依赖Arduino，时间和随机数由调用者传入。
+
+struct TokenBucket {
+  uint32_t ratePerMinute;   // 0表示不限
+  int64_t level;            // 剩余配额 x 60000，补充速率为每毫秒ratePerMinute
+  int64_t capacity;
+  uint32_t lastMs;
+};
+
+struct RateLimiterStats {
+  uint32_t granted;
+  uint32_t delayed;         // 需要等待才放行的请求次数
+  uint32_t totalDelayMs;
+  uint32_t maxDelayMs;
+  uint32_t throttled;       // 收到429的次数
+  uint32_t retries;
+};
+
+struct RateLimiter {
+  TokenBucket requests;
+  TokenBucket tokens;
+  uint32_t pausedUntilMs;
+  bool paused;
+  RateLimiterStats stats;
+};
+
+// requestsPerMinute / tokensPerMinute为0表示该项不限
+void rateLimiterInit(RateLimiter* limiter, uint32_t requestsPerMinute, uint32_t tokensPerMinute, uint32_t nowMs);
+
+// 申请一个估计消耗tokens的请求：可以立即发送时扣除配额并返回0，否则返回需要等待的毫秒数（不扣除）
+uint32_t rateLimiterAcquire(RateLimiter* limiter, uint32_t nowMs, uint32_t tokens);
+
+// 记录等待时间（调用者等待后再次申请成功时调用）
+void rateLimiterRecordDelay(RateLimiter* limiter, uint32_t delayMs);
+
+// 按实际用量校正token桶
+void rateLimiterSettle(RateLimiter* limiter, uint32_t nowMs, uint32_t estimatedTokens, uint32_t actualTokens);
+
+// 收到429：暂停所有请求pauseMs
+void rateLimiterPause(RateLimiter* limiter, uint32_t nowMs, uint32_t pauseMs);
+
+// 第attempt次重试（从0开始）前的等待时间：
+// 有Retry-After时取其值加少量抖动，否则在[0, min(baseMs * 2^attempt, maxMs)]中随机取值
+uint32_t retryBackoffMs(uint8_t attempt, uint32_t retryAfterMs, uint32_t baseMs, uint32_t maxMs, uint32_t random);
+
+#endif // RATE_LIMITER_H
@@ -0,0 +1,84 @@
+#ifndef REQUEST_QUEUE_H
+#define REQUEST_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===================
+// 有界优先级请求队列
+// ===================
+// 固定数量的槽位，每个请求占一个槽位直到处理完成（槽位号用于调用者保存请求内容）。
+// 与已有请求相同的请求可以合并到其槽位，只分配新的id，不占用新槽位。
+// 出队时优先级高的先出，同优先级先进先出；超过截止时间的请求单独取出，由调用者通知失败。
+// 队列满时拒绝新请求。同时统计排队等待时间和处理时间，用于按实际请求速率确定队列大小。
+// 不加锁、不依赖Arduino，时间由调用者传入。
+
+#define REQUEST_QUEUE_MAX 16
+
+enum RequestSlotState : uint8_t {
+  REQUEST_SLOT_FREE = 0,
+  REQUEST_SLOT_QUEUED,
+  REQUEST_SLOT_ACTIVE       // 已出队，正在处理
+};
+
+struct RequestSlot {
+  RequestSlotState state;
+  uint8_t priority;
+  uint32_t id;
+  uint32_t sequence;
+  uint32_t enqueuedMs;
+  uint32_t startedMs;
+  uint32_t deadlineMs;      // 0表示没有截止时间
+};
+
+struct RequestQueueStats {
+  uint32_t submitted;
+  uint32_t rejected;        // 队列满
+  uint32_t coalesced;       // 合并到已有请求、不占槽位的请求
+  uint32_t served;
+  uint32_t cancelled;
+  uint32_t expired;
+  uint8_t depth;            // 当前排队数（不含处理中）
+  uint8_t peakDepth;
+  uint32_t totalWaitMs;
+  uint32_t maxWaitMs;
+  uint32_t totalServiceMs;
+  uint32_t maxServiceMs;
+};
+
+struct RequestQueue {
+  RequestSlot slots[REQUEST_QUEUE_MAX];
+  uint8_t capacity;
+  uint32_t nextId;
+  uint32_t nextSequence;
+  RequestQueueStats stats;
+};
+
+void requestQueueInit(RequestQueue* q, uint8_t capacity);
+
+// 入队；timeoutMs为0表示不限时。返回槽位号，队列满时返回-1
+int requestQueuePush(RequestQueue* q, uint8_t priority, uint32_t nowMs, uint32_t timeoutMs, uint32_t* id);
+
+// 把一个相同的请求合并到排队中或处理中的槽位，返回新请求的id（槽位无效时返回0）。
+// 排队中的槽位取两者中较高的优先级和较晚的截止时间（任一不限时则不限时）
+uint32_t requestQueueJoin(RequestQueue* q, int slot, uint8_t priority, uint32_t nowMs, uint32_t timeoutMs);
+
+// 取出一个已过截止时间的请求（槽位被释放），没有时返回-1
+int requestQueuePopExpired(RequestQueue* q, uint32_t nowMs);
+
+// 排队中最早的截止时间距nowMs还有多少毫秒（已过期为0），没有限时的请求时返回false
+bool requestQueueNextDeadline(const RequestQueue* q, uint32_t nowMs, uint32_t* waitMs);
+
+// 取出优先级最高的请求，槽位变为处理中；队列空时返回-1
+int requestQueuePop(RequestQueue* q, uint32_t nowMs);
+
+// 处理完成，记录处理时间并释放槽位
+void requestQueueFinish(RequestQueue* q, int slot, uint32_t nowMs);
+
+// 取消排队中的请求（槽位被释放），返回槽位号；不在队列中（不存在或正在处理）时返回-1
+int requestQueueCancel(RequestQueue* q, uint32_t id);
+
+// 按id查找槽位（排队中或处理中），找不到返回-1
+int requestQueueFind(const RequestQueue* q, uint32_t id);
+
+#endif // REQUEST_QUEUE_H
@@ -0,0 +1,52 @@
+#ifndef SCENE_GATE_H
+#define SCENE_GATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===================
+// 场景变化检测
+// ===================
+// 在32x24的亮度缩略图上与滚动背景逐块比较（4x4块的绝对差之和），
+// 变化块占比超过阈值且已过冷却时间时才放行，用于跳过画面没有变化的AI请求。
+// 背景只在画面未变化时按指数滑动平均更新（吸收缓慢的光照变化），
+// 放行时直接替换为当前画面；冷却期间发生的变化会保留到冷却结束后再触发。
+// 不依赖Arduino，时间由调用者传入。
+
+#define SCENE_THUMB_WIDTH  32
+#define SCENE_THUMB_HEIGHT 24
+#define SCENE_BLOCK_SIZE   4
+#define SCENE_BLOCK_COUNT  ((SCENE_THUMB_WIDTH / SCENE_BLOCK_SIZE) * (SCENE_THUMB_HEIGHT / SCENE_BLOCK_SIZE))
+
+struct SceneGateConfig {
+  uint8_t pixelThreshold;       // 块内平均每像素亮度差超过此值算作变化块
+  uint8_t changedPercent;       // 变化块占比（%）达到此值判定场景变化
+  uint32_t cooldownMs;          // 两次放行之间的最短间隔
+  uint8_t backgroundShift;      // 背景更新速率 1/2^n
+  bool compensateBrightness;    // 比较前扣除整体亮度差（自动曝光波动）
+};
+
+struct SceneGate {
+  SceneGateConfig config;
+  bool hasBackground;
+  uint32_t lastTriggerMs;
+  uint16_t background[SCENE_THUMB_WIDTH * SCENE_THUMB_HEIGHT];  // 8.8定点
+  uint8_t lastScore;            // 最近一帧的变化块占比（%）
+  uint32_t frames;
+  uint32_t triggers;
+  uint32_t unchanged;           // 画面未变化被跳过的帧
+  uint32_t cooling;             // 画面有变化但处于冷却期被跳过的帧
+};
+
+// 默认：每像素12级、5%的块（48块中3块）、冷却3秒、背景速率1/8、补偿整体亮度
+void sceneGateDefaultConfig(SceneGateConfig* config);
+
+void sceneGateInit(SceneGate* gate, const SceneGateConfig* config);
+
+// 计算缩略图相对背景的变化块占比（%），不修改状态
+uint8_t sceneGateScore(const SceneGate* gate, const uint8_t* thumb);
+
+// 输入一帧缩略图（SCENE_THUMB_WIDTH x SCENE_THUMB_HEIGHT），返回true表示应当放行
+bool sceneGateUpdate(SceneGate* gate, const uint8_t* thumb, uint32_t nowMs);
+
+#endif // SCENE_GATE_H
@@ -0,0 +1,52 @@
+#ifndef SSE_STREAM_H
+#define SSE_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===================
+// 流式响应解析（HTTP分块传输 + Server-Sent Events）
+// ===================
+// 按收到的顺序逐段输入，不缓存完整响应：
+//   ChunkDecoder 去掉Transfer-Encoding: chunked的分块头，原地输出有效载荷；
+//   SseParser    按行解析事件流，把一个事件的data字段（多行以'\n'连接）交给回调。
+// 两者都是状态机，输入可以在任意位置被切开。不依赖Arduino。
+
+// ---- 分块传输解码 ----
+
+struct ChunkDecoder {
+  uint8_t state;
+  uint32_t remaining;     // 当前分块剩余的载荷字节
+  bool done;              // 已收到结束分块（长度0）和结尾空行
+  bool error;             // 分块头格式错误
+};
+
+void chunkDecoderInit(ChunkDecoder* d);
+
+// 解码data中的len字节，载荷原地写回data开头，返回载荷字节数
+size_t chunkDecoderFeed(ChunkDecoder* d, uint8_t* data, size_t len);
+
+// ---- SSE事件解析 ----
+
+#define SSE_EVENT_MAX 2048    // 单个事件data的最大长度，超出的事件被丢弃
+
+typedef void (*SseEventCallback)(const char* data, size_t length, void* ctx);
+
+struct SseParser {
+  char data[SSE_EVENT_MAX];
+  size_t length;          // 已确认的data长度
+  size_t lineLength;      // 当前行的长度，当前行暂存在data[length]之后
+  bool overflow;          // 当前事件超长
+  bool skipLf;            // 上一个字符是'\r'，紧跟的'\n'不再算一行
+  uint32_t events;
+  uint32_t dropped;
+  SseEventCallback onEvent;
+  void* ctx;
+};
+
+void sseParserInit(SseParser* p, SseEventCallback onEvent, void* ctx);
+
+// 输入一段事件流；每遇到空行分发一个事件（data以'\0'结尾）
+void sseParserFeed(SseParser* p, const char* data, size_t len);
+
+#endif // SSE_STREAM_H
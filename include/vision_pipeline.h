@@ -0,0 +1,82 @@
+#ifndef VISION_PIPELINE_H
+#define VISION_PIPELINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===================
+// 拍照 -> 编码上传 -> 结果 流水线
+// ===================
+// 三个FreeRTOS任务通过有界队列串联：
+//   拍照任务（核心1）：按间隔取帧，帧队列满时用新帧替换队列中的旧帧并归还旧帧，
+//                      保证上传的总是最新画面；
+//   上传任务（核心0，与WiFi协议栈同核）：边Base64编码边上传，发送完成后归还帧缓冲区；
+//   结果任务（核心1）：在自己的任务里调用结果回调，屏幕只应在回调里操作。
+// 网络往返期间摄像头继续出帧，吞吐取决于最慢的一级而不是三级耗时之和。
+// 需要先调用initCamera()，并在PSRAM下使用双帧缓冲（fb_count = 2）。运行期间独占摄像头：
+// 录帧或实时预览运行时拒绝启动。
+// 配置了场景检测时，拍照任务只把画面有变化的帧送去上传。
+// 回答缓存已启用（answerCacheBegin）时，拍照任务计算帧哈希，命中缓存的帧不再上传。
+
+struct SceneGate;
+
+struct VisionResult {
+  uint32_t frameId;
+  bool ok;
+  bool cached;            // 回答来自缓存
+  const char* text;       // 分析结果或错误信息，回调返回后失效
+  uint32_t latencyMs;     // 拍照到结果的总耗时
+  uint32_t uploadMs;      // 上传和等待响应的耗时
+  size_t imageBytes;
+};
+
+typedef void (*VisionResultCallback)(const VisionResult* result, void* ctx);
+
+struct VisionPipelineConfig {
+  const char* question;
+  uint32_t captureIntervalMs;   // 两次取帧的最小间隔
+  uint8_t frameQueueDepth;      // 等待上传的帧数，受帧缓冲数量限制，通常为1
+  uint8_t resultQueueDepth;
+  SceneGate* gate;              // 场景变化检测，NULL表示每帧都上传；运行期间由拍照任务独占
+  VisionResultCallback onResult;
+  void* ctx;
+};
+
+struct VisionStageStats {
+  uint32_t count;
+  uint32_t totalMs;
+  uint32_t maxMs;
+};
+
+struct VisionPipelineStats {
+  VisionStageStats capture;
+  VisionStageStats upload;
+  VisionStageStats result;
+  uint32_t framesDropped;       // 被新帧替换、没有上传的帧
+  uint32_t framesUnchanged;     // 场景未变化、没有上传的帧
+  uint32_t cacheHits;           // 命中回答缓存、没有上传的帧
+  uint32_t captureFailures;
+  uint32_t uploadFailures;
+  uint8_t frameQueued;          // 当前队列深度
+  uint8_t resultQueued;
+  uint8_t frameQueuePeak;       // 队列深度峰值
+  uint8_t resultQueuePeak;
+  uint32_t runningMs;
+};
+
+// 默认配置：间隔200ms，帧队列1，结果队列4，不做场景检测
+void visionPipelineDefaultConfig(VisionPipelineConfig* config, const char* question,
+                                 VisionResultCallback onResult, void* ctx);
+
+bool startVisionPipeline(const VisionPipelineConfig* config);
+
+// 停止并等待三个任务退出（上传中的请求会先完成），未处理的帧和结果被丢弃
+void stopVisionPipeline();
+
+bool visionPipelineRunning();
+
+void getVisionPipelineStats(VisionPipelineStats* stats);
+
+void printVisionPipelineStats();
+
+#endif // VISION_PIPELINE_H
@@ -0,0 +1,76 @@
+#ifndef VISION_REQUESTS_H
+#define VISION_REQUESTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "request_queue.h"
+
+// ===================
+// 异步视觉请求
+// ===================
+// 调用者提交请求后立即返回，网络工作任务（核心0，与WiFi协议栈同核）按优先级逐个发送，
+// 完成后通过回调返回结果，拍照、显示和音频不再被数秒的HTTPS往返阻塞。
+// 请求可以是JPEG缓冲区（不复制，回调之前必须保持有效）或图像URL；问题、URL和模型名入队时复制。
+// 每个请求的回调恰好调用一次：完成、失败、取消或排队超时。
+// 回调一般在工作任务中执行，应尽快返回；取消排队中的请求时回调在调用取消的任务中执行，
+// 排队超时的回调在单独的超时任务中按时执行（不等正在发送的请求结束）。
+// 同一图像缓冲区（或同一URL）、同样的问题和模型的请求在排队或发送期间合并为一次发送，
+// 每个调用者各有自己的id和回调，收到同一个结果；取消只影响调用者自己，最后一个取消时请求才被取消。
+// 与vision_pipeline共用长连接（api_connection），两者可以同时运行，请求依次发送。
+
+#define VISION_REQUEST_QUESTION_MAX 256
+#define VISION_REQUEST_URL_MAX      256
+#define VISION_REQUEST_MODEL_MAX    32
+#define VISION_REQUEST_SUBSCRIBERS_MAX 4   // 一个请求最多合并的调用者数，超出时单独排队
+
+enum VisionRequestStatus : uint8_t {
+  VISION_REQUEST_OK = 0,
+  VISION_REQUEST_FAILED,       // 网络或接口错误，text为错误信息
+  VISION_REQUEST_CANCELLED,
+  VISION_REQUEST_EXPIRED       // 超过timeoutMs仍未开始处理
+};
+
+struct VisionRequestResult {
+  uint32_t id;
+  VisionRequestStatus status;
+  const char* text;            // 分析结果或错误信息，回调返回后失效；取消和超时时为空字符串
+  uint32_t waitMs;             // 排队时间
+  uint32_t serviceMs;          // 发送到收到结果的时间
+};
+
+typedef void (*VisionRequestCallback)(const VisionRequestResult* result, void* ctx);
+
+struct VisionRequest {
+  const uint8_t* image;        // JPEG，与imageUrl二选一
+  size_t imageLength;
+  const char* imageUrl;
+  const char* question;
+  const char* model;           // NULL为默认模型
+  uint8_t priority;            // 越大越先处理
+  uint32_t timeoutMs;          // 排队超过此时间仍未开始处理则放弃，0为不限
+  VisionRequestCallback onDone;
+  void* ctx;
+};
+
+// 清零并填入默认值（优先级0，不限时）
+void visionRequestInit(VisionRequest* request);
+
+// 分配队列（优先PSRAM）并启动工作任务，capacity最大REQUEST_QUEUE_MAX
+bool startVisionRequestWorker(uint8_t capacity);
+
+// 停止工作任务（正在发送的请求先完成），排队中的请求以取消结束
+void stopVisionRequestWorker();
+
+bool visionRequestWorkerRunning();
+
+// 提交请求，返回请求id；队列满、参数无效或工作任务未启动时返回0
+uint32_t submitVisionRequest(const VisionRequest* request);
+
+// 取消请求：排队中的立即结束；正在发送的等发送完成后以取消结束，结果被丢弃
+bool cancelVisionRequest(uint32_t id);
+
+void getVisionRequestStats(RequestQueueStats* stats);
+
+void printVisionRequestStats();
+
+#endif // VISION_REQUESTS_H
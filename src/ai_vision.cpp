@@ -2,6 +2,15 @@
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
+#include <esp_timer.h>
+#include "chat_request.h"
+#include "api_connection.h"
+#include "sse_stream.h"
+#include "chat_response.h"
+#include "rate_limiter.h"
+#include "api_latency.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 // ===========================================
 // 重要提醒：使用前请设置您的API密钥！
@@ -17,206 +26,746 @@ const char* DASHSCOPE_API_KEY = "sk-deef87410c114822b24f54cc0ffeb406"; // ⚠️
 
 // 外部函数声明
 void showStaticMessage(const char* message);
+void showStreamingText(const char* text);
 
+// 流式回答：每收到一段文本调用一次，token在回调返回后失效
+typedef void (*VisionTokenCallback)(const char* token, void* ctx);
 
-String resolveImage(const String& imageBase64, const String& question) {
+
+#define VISION_DEFAULT_MODEL "qwen-vl-max"
+
+// 接口地址，所有请求（图像、图像URL、连接测试）都发往这里。
+// 测试时可指向局域网内兼容/compatible-mode/v1/chat/completions的模拟服务器（http://...，
+// 见test/host/mock_dashscope.py），不需要外网和额度
+static const char* visionApiUrl = DASHSCOPE_API_URL;
+
+void setVisionApiUrl(const char* url) {
+  visionApiUrl = url ? url : DASHSCOPE_API_URL;
+}
+
+// 请求体：按HTTPClient的读取从请求模板（chat_request）边生成边发送，
+// 不构建JSON文档，也不在内存中拼出完整请求。长度在发送前已知，用作Content-Length
+class VisionRequestBody : public Stream {
+public:
+  explicit VisionRequestBody(ChatRequest* request) : _request(request) {
+    chatRequestRewind(_request);
+  }
+
+  size_t size() const { return chatRequestLength(_request); }
+
+  // 回到开头，重发请求时使用
+  void rewind() {
+    chatRequestRewind(_request);
+    _firstReadMs = 0;
+    _lastReadMs = 0;
+    _lastReadUs = 0;
+  }
+
+  int available() override {
+    return (int)(chatRequestLength(_request) - _request->position);
+  }
+
+  int read() override {
+    uint8_t c;
+    return produce(&c, 1) ? c : -1;
+  }
+
+  int peek() override {
+    ChatRequest saved = *_request;
+    uint8_t c;
+    int result = chatRequestRead(_request, &c, 1) ? c : -1;
+    *_request = saved;
+    return result;
+  }
+
+  size_t readBytes(char* buffer, size_t length) override {
+    return produce((uint8_t*)buffer, length);
+  }
+
+  // 第一次被读取到最后一个字节被读走的时间，约等于请求体的上行耗时（不含服务器处理）
+  uint32_t sendMs() const {
+    return _firstReadMs ? _lastReadMs - _firstReadMs : 0;
+  }
+
+  // 最后一个字节被读走的时刻（esp_timer微秒），没有读完时为0
+  int64_t lastReadUs() const {
+    return _lastReadUs;
+  }
+
+  size_t write(uint8_t) override {
+    return 0;
+  }
+
+private:
+  size_t produce(uint8_t* out, size_t length) {
+    if (_firstReadMs == 0) _firstReadMs = millis();
+    size_t written = chatRequestRead(_request, out, length);
+    if (_request->position >= chatRequestLength(_request) && _lastReadUs == 0) {
+      _lastReadMs = millis();
+      _lastReadUs = esp_timer_get_time();
+    }
+    return written;
+  }
+
+  ChatRequest* _request;
+  uint32_t _firstReadMs = 0;
+  uint32_t _lastReadMs = 0;
+  int64_t _lastReadUs = 0;
+};
+
+// "Bearer "加密钥，只在第一次使用时拼接
+static const String& authorizationHeader() {
+  static String header = "Bearer " + String(DASHSCOPE_API_KEY);
+  return header;
+}
+
+// 状态提示：showStatus为false时只输出串口，不操作屏幕（供后台任务调用）
+static void visionStatus(bool showStatus, const char* message) {
+  if (showStatus) showStaticMessage(message);
+}
+
+// HTTP响应体：按Content-Length或分块传输从连接读取，不经过getString()缓存。
+// 可直接交给ArduinoJson解析；两次收到数据之间超过idleTimeoutMs视为超时
+#define HTTP_BODY_TIMEOUT_MS 10000
+
+// 需要在发送前登记：HttpBodyStream据此判断是否为分块传输，429时读取重试等待时间
+static const char* bodyHeaders[] = {"Transfer-Encoding", "Retry-After"};
+#define BODY_HEADER_COUNT 2
+
+class HttpBodyStream : public Stream {
+public:
+  HttpBodyStream(HTTPClient& http, uint32_t idleTimeoutMs)
+    : _client(http.getStreamPtr()), _remaining(http.getSize()), _idleTimeoutMs(idleTimeoutMs) {
+    _chunked = http.header("Transfer-Encoding").equalsIgnoreCase("chunked");
+    chunkDecoderInit(&_decoder);
+  }
+
+  int available() override {
+    return (int)(_length - _position);
+  }
+
+  int read() override {
+    return fill() ? _buffer[_position++] : -1;
+  }
+
+  int peek() override {
+    return fill() ? _buffer[_position] : -1;
+  }
+
+  size_t readBytes(char* out, size_t length) override {
+    size_t n = 0;
+    while (n < length) {
+      size_t k = readSome(out + n, length - n);
+      if (k == 0) break;
+      n += k;
+    }
+    return n;
+  }
+
+  // 读取已到达的数据（没有时等待），返回0表示结束、出错或超时
+  size_t readSome(char* out, size_t length) {
+    if (!fill()) return 0;
+    size_t n = min(length, _length - _position);
+    memcpy(out, _buffer + _position, n);
+    _position += n;
+    return n;
+  }
+
+  size_t write(uint8_t) override {
+    return 0;
+  }
+
+  void setIdleTimeout(uint32_t ms) {
+    _idleTimeoutMs = ms;
+  }
+
+  // 读完剩余内容（如结束分块），响应完整读完后连接才能复用
+  bool drain() {
+    while (fill()) _position = _length;
+    return finished();
+  }
+
+  bool finished() const {
+    return _chunked ? _decoder.done : _remaining == 0;
+  }
+
+  bool timedOut() const {
+    return _timedOut;
+  }
+
+  // 放弃未读完的响应并断开连接。连接已被服务器关闭时getStreamPtr()返回NULL，用构造时保存的连接
+  void abort() {
+    if (_client) _client->stop();
+  }
+
+  // 等待和读取连接数据（含分块解码）的累计时间，其余时间花在调用者的解析上
+  uint32_t readUs() const {
+    return (uint32_t)_readUs;
+  }
+
+private:
+  bool fill() {
+    if (_position < _length) return true;
+    int64_t start = esp_timer_get_time();
+    bool filled = receive();
+    _readUs += esp_timer_get_time() - start;
+    return filled;
+  }
+
+  bool receive() {
+    _position = _length = 0;
+    uint32_t start = millis();
+    while (!finished() && !_decoder.error) {
+      int available = _client ? _client->available() : 0;
+      if (available <= 0) {
+        if (!_client || !_client->connected()) return false;
+        if (millis() - start > _idleTimeoutMs) {
+          _timedOut = true;
+          return false;
+        }
+        delay(2);
+        continue;
+      }
+      size_t want = min((size_t)available, sizeof(_buffer));
+      if (!_chunked && _remaining > 0 && want > (size_t)_remaining) want = _remaining;
+      int n = _client->read(_buffer, want);
+      if (n <= 0) continue;
+      if (_chunked) {
+        _length = chunkDecoderFeed(&_decoder, _buffer, n);
+      } else {
+        _length = n;
+        if (_remaining > 0) _remaining -= n;
+      }
+      if (_length > 0) return true;
+      start = millis();
+    }
+    return false;
+  }
+
+  WiFiClient* _client;
+  int _remaining;           // Content-Length剩余字节，-1为未知（读到连接关闭）
+  uint32_t _idleTimeoutMs;
+  bool _chunked;
+  bool _timedOut = false;
+  int64_t _readUs = 0;
+  ChunkDecoder _decoder;
+  uint8_t _buffer[512];
+  size_t _length = 0;
+  size_t _position = 0;
+};
+
+// 从连接直接解析200响应：过滤后只保留回答、结束原因和用量，内存只取决于回答长度
+static String readVisionAnswer(HTTPClient& http, bool showStatus, uint32_t* usedTokens) {
+  DynamicJsonDocument doc(CHAT_RESPONSE_DOC_SIZE);
+  if (doc.capacity() == 0) {
+    visionStatus(showStatus, "内存不足");
+    return "错误：内存不足";
+  }
+
+  HttpBodyStream body(http, HTTP_BODY_TIMEOUT_MS);
+  ChatResponse answer;
+  int64_t parseStart = esp_timer_get_time();
+  DeserializationError error = chatResponseParse(doc, body, &answer);
+  if (!body.drain()) body.abort();
+  uint32_t elapsedUs = (uint32_t)(esp_timer_get_time() - parseStart);
+  apiLatencyRecord(API_PHASE_DOWNLOAD, body.readUs());
+  apiLatencyRecord(API_PHASE_PARSE, elapsedUs - body.readUs());
+
+  if (error == DeserializationError::NoMemory) {
+    Serial.printf("回答超过 %d 字节\n", CHAT_ANSWER_MAX);
+    visionStatus(showStatus, "回答过长");
+    return "错误：回答过长";
+  }
+  if (error) {
+    Serial.println("JSON解析失败: " + String(error.c_str()));
+    visionStatus(showStatus, body.timedOut() ? "响应超时" : "响应解析失败");
+    return body.timedOut() ? "错误：响应超时" : "错误：响应解析失败";
+  }
+  if (answer.content == NULL) {
+    Serial.println("响应格式错误，缺少choices字段");
+    visionStatus(showStatus, "响应格式错误");
+    return "错误：响应格式错误";
+  }
+
+  if (usedTokens) *usedTokens = answer.totalTokens;
+  Serial.printf("用量: 输入 %lu，输出 %lu，共 %lu tokens，结束原因 %s，文档 %u 字节\n",
+                (unsigned long)answer.promptTokens, (unsigned long)answer.completionTokens,
+                (unsigned long)answer.totalTokens, answer.finishReason ? answer.finishReason : "-",
+                (unsigned)doc.memoryUsage());
+  if (answer.finishReason && strcmp(answer.finishReason, "length") == 0) {
+    Serial.println("回答达到最大长度，已被截断");
+  }
+  String result = answer.content;
+  Serial.println("AI分析结果: " + result);
+  if (showStatus) {
+    int64_t displayStart = esp_timer_get_time();
+    showStaticMessage(result.c_str());
+    apiLatencyRecordSince(API_PHASE_DISPLAY, displayStart);
+  }
+  return result;
+}
+
+// 处理视觉接口的响应，返回分析结果或错误信息
+// usedTokens不为NULL时输出响应中的token用量（没有时不修改）
+static String handleVisionResponse(HTTPClient& http, int httpResponseCode, bool showStatus,
+                                   uint32_t* usedTokens = NULL) {
+  if (httpResponseCode <= 0) {
+    Serial.println("HTTP请求失败: " + http.errorToString(httpResponseCode));
+    visionStatus(showStatus, "网络请求失败");
+    return "错误：网络请求失败";
+  }
+
+  Serial.println("API响应码: " + String(httpResponseCode));
+  if (httpResponseCode == 200) {
+    return readVisionAnswer(http, showStatus, usedTokens);
+  }
+
+  // 错误响应很短，完整读出用于调试
+  String response = http.getString();
+  if (response.length() > 100) {
+    Serial.println("响应前100字符: " + response.substring(0, 100));
+  } else {
+    Serial.println("完整响应: " + response);
+  }
+
+  if (httpResponseCode == 400) {
+    Serial.println("400错误 - 请求格式问题");
+    Serial.println("可能原因：1.API密钥错误 2.图像格式问题 3.请求参数错误");
+    visionStatus(showStatus, "请求格式错误");
+    return "错误：请求格式错误(400)";
+  } else if (httpResponseCode == 401) {
+    Serial.println("401错误 - 认证失败，请检查API密钥");
+    visionStatus(showStatus, "API密钥错误");
+    return "错误：API密钥错误(401)";
+  } else if (httpResponseCode == 429) {
+    Serial.println("429错误 - 请求过于频繁");
+    visionStatus(showStatus, "请求过于频繁");
+    return "错误：请求过于频繁(429)";
+  } else {
+    Serial.println("API请求失败: " + String(httpResponseCode));
+    visionStatus(showStatus, "API请求失败");
+    return "错误：API请求失败(" + String(httpResponseCode) + ")";
+  }
+}
+
+// 流式模式（"stream": true）：服务器以SSE逐段返回delta.content，边收边显示，
+// 第一个字在响应头到达后即可显示，不必等待完整回答，也不缓存原始响应
+#define STREAM_READ_TIMEOUT_MS     30000  // 两段数据之间的最长等待
+#define STREAM_END_WAIT_MS         500    // 收到[DONE]后等待结束分块，以便复用连接
+#define STREAM_DISPLAY_INTERVAL_MS 150    // 屏幕刷新间隔，I2C发送一帧约需25ms
+
+static bool visionStreaming = false;
+
+void setVisionStreaming(bool enabled) {
+  visionStreaming = enabled;
+}
+
+struct VisionStream {
+  VisionTokenCallback onToken;
+  void* ctx;
+  bool showStatus;
+  bool done;
+  uint32_t badEvents;        // 解析失败的事件，其中的文字已经丢失
+  uint32_t totalTokens;      // 最后的usage事件（stream_options.include_usage）中的用量
+  DynamicJsonDocument* doc;  // 按SSE_EVENT_MAX分配，每个事件复用
+  String text;
+  uint32_t startMs;
+  uint32_t firstTokenMs;
+  uint32_t lastDisplayMs;
+  int64_t displayUs;         // 刷新屏幕的累计时间
+};
+
+static void showStreamText(VisionStream* stream) {
+  int64_t start = esp_timer_get_time();
+  showStreamingText(stream->text.c_str());
+  stream->displayUs += esp_timer_get_time() - start;
+}
+
+static void onVisionEvent(const char* data, size_t length, void* ctx) {
+  VisionStream* stream = (VisionStream*)ctx;
+  if (strcmp(data, "[DONE]") == 0) {
+    stream->done = true;
+    return;
+  }
+
+  ChatDelta delta;
+  DeserializationError error = chatDeltaParse(*stream->doc, data, length, &delta);
+  if (error) {
+    stream->badEvents++;
+    Serial.printf("流式数据解析失败: %s（事件 %u 字节）\n", error.c_str(), (unsigned)length);
+    return;
+  }
+  if (delta.totalTokens) stream->totalTokens = delta.totalTokens;
+  const char* token = delta.content;
+  if (token == NULL || *token == '\0') return;
+
+  if (stream->firstTokenMs == 0) {
+    stream->firstTokenMs = millis() - stream->startMs;
+    Serial.printf("首个文字 %lu ms\n", (unsigned long)stream->firstTokenMs);
+  }
+  stream->text += token;
+  if (stream->onToken) stream->onToken(token, stream->ctx);
+  if (stream->showStatus && millis() - stream->lastDisplayMs >= STREAM_DISPLAY_INTERVAL_MS) {
+    showStreamText(stream);
+    stream->lastDisplayMs = millis();
+  }
+}
+
+// 读取SSE响应体直到[DONE]、连接关闭或超时。没有收到[DONE]、或有事件被丢弃/解析失败时
+// 回答不完整，返回错误（已经显示的部分文字不会被当作回答缓存）
+static String readVisionStream(HTTPClient& http, VisionStream* stream) {
+  SseParser* parser = (SseParser*)malloc(sizeof(SseParser));
+  if (!parser) return "错误：内存不足";
+  DynamicJsonDocument doc(CHAT_DELTA_DOC_SIZE(SSE_EVENT_MAX));
+  if (doc.capacity() == 0) {
+    free(parser);
+    return "错误：内存不足";
+  }
+  stream->doc = &doc;
+  sseParserInit(parser, onVisionEvent, stream);
+
+  HttpBodyStream body(http, STREAM_READ_TIMEOUT_MS);
+  char buffer[512];
+  int64_t readStart = esp_timer_get_time();
+  while (true) {
+    // 收到[DONE]后只再等一小段时间，读到结束分块即可复用连接
+    if (stream->done) body.setIdleTimeout(STREAM_END_WAIT_MS);
+    size_t n = body.readSome(buffer, sizeof(buffer));
+    if (n == 0) break;
+    sseParserFeed(parser, buffer, n);
+  }
+  bool timedOut = body.timedOut() && !stream->done;
+  uint32_t elapsedUs = (uint32_t)(esp_timer_get_time() - readStart);
+
+  // 响应没有完整读完时不能复用连接
+  if (!body.finished()) body.abort();
+  Serial.printf("流式响应 %lu 个事件，完成 %lu ms%s\n", (unsigned long)parser->events,
+                (unsigned long)(millis() - stream->startMs), stream->done ? "" : "（未收到结束标记）");
+  uint32_t lostEvents = parser->dropped + stream->badEvents;
+  free(parser);
+  stream->doc = NULL;
+
+  if (stream->text.length() == 0) {
+    visionStatus(stream->showStatus, timedOut ? "响应超时" : "响应解析失败");
+    return timedOut ? "错误：响应超时" : "错误：响应解析失败";
+  }
+  if (!stream->done || lostEvents > 0) {
+    Serial.printf("回答不完整（%lu 个事件丢失）: %s\n", (unsigned long)lostEvents, stream->text.c_str());
+    visionStatus(stream->showStatus, timedOut ? "响应超时" : "回答不完整");
+    return timedOut ? "错误：响应超时" : "错误：回答不完整";
+  }
+  // 解析和显示在读取的间隙进行，解析时间为总时间扣除读取和显示（含token回调）
+  apiLatencyRecord(API_PHASE_DOWNLOAD, body.readUs());
+  apiLatencyRecord(API_PHASE_PARSE, elapsedUs - body.readUs() - (uint32_t)stream->displayUs);
+  Serial.println("AI分析结果: " + stream->text);
+  if (stream->showStatus) {
+    showStreamText(stream);
+    apiLatencyRecord(API_PHASE_DISPLAY, (uint32_t)stream->displayUs);
+  }
+  return stream->text;
+}
+
+// 接口配额：发送前按每分钟请求数和token数限流，429时所有请求一起暂停后重试。
+// token数按最近几次响应的用量估计，收到用量后按实际值校正
+#define DEFAULT_REQUEST_TOKENS 1200   // 还没有用量记录时的估计（一张压缩图像加简短回答）
+#define RETRY_MAX_ATTEMPTS     3      // 429后最多重试的次数
+#define RETRY_BASE_MS          1000
+#define RETRY_MAX_MS           30000
+#define QUOTA_POLL_MS          1000   // 分段等待，其他请求校正用量后可能提前放行
+
+static RateLimiter rateLimiter;
+static SemaphoreHandle_t rateLock = NULL;
+static uint32_t estimatedRequestTokens = DEFAULT_REQUEST_TOKENS;
+
+// 在setup()中、任何请求任务启动之前调用一次：创建锁，限流器默认不限速，只处理429
+bool initVisionRateLimit() {
+  if (rateLock) return true;
+  rateLimiterInit(&rateLimiter, 0, 0, millis());
+  rateLock = xSemaphoreCreateMutex();
+  return rateLock != NULL;
+}
+
+// 未初始化时不限流，请求照常发送
+static bool lockRateLimiter() {
+  if (!rateLock) return false;
+  xSemaphoreTake(rateLock, portMAX_DELAY);
+  return true;
+}
+
+static void unlockRateLimiter() {
+  xSemaphoreGive(rateLock);
+}
+
+// 设置账户配额，0表示该项不限
+void setVisionRateLimit(uint32_t requestsPerMinute, uint32_t tokensPerMinute) {
+  if (!lockRateLimiter()) return;
+  rateLimiterInit(&rateLimiter, requestsPerMinute, tokensPerMinute, millis());
+  unlockRateLimiter();
+  Serial.printf("视觉接口限流: %lu 次/分钟，%lu tokens/分钟\n",
+                (unsigned long)requestsPerMinute, (unsigned long)tokensPerMinute);
+}
+
+// 等待配额，返回本次预扣的token数
+static uint32_t acquireQuota(bool showStatus) {
+  uint32_t start = millis();
+  bool announced = false;
+  while (true) {
+    if (!lockRateLimiter()) return 0;
+    uint32_t estimate = estimatedRequestTokens;
+    uint32_t wait = rateLimiterAcquire(&rateLimiter, millis(), estimate);
+    if (wait == 0) rateLimiterRecordDelay(&rateLimiter, millis() - start);
+    unlockRateLimiter();
+    if (wait == 0) return estimate;
+
+    if (!announced) {
+      Serial.printf("超出配额，等待 %lu ms\n", (unsigned long)wait);
+      visionStatus(showStatus, "等待配额...");
+      announced = true;
+    }
+    delay(wait > QUOTA_POLL_MS ? QUOTA_POLL_MS : wait);
+  }
+}
+
+// 按实际用量校正预扣的token，并更新下次的估计。usedTokens为0表示响应没有用量（错误响应、
+// 连接失败），预扣的token全部退回，估计不变
+static void settleQuota(uint32_t reservedTokens, uint32_t usedTokens) {
+  if (reservedTokens == 0 && usedTokens == 0) return;
+  if (!lockRateLimiter()) return;
+  rateLimiterSettle(&rateLimiter, millis(), reservedTokens, usedTokens);
+  if (usedTokens) estimatedRequestTokens = (estimatedRequestTokens * 3 + usedTokens) / 4;
+  unlockRateLimiter();
+}
+
+void printVisionRateStats() {
+  if (!lockRateLimiter()) return;
+  RateLimiterStats stats = rateLimiter.stats;
+  uint32_t estimate = estimatedRequestTokens;
+  unlockRateLimiter();
+  Serial.printf("视觉接口限流: 放行 %lu，等待 %lu 次（平均 %lu ms，最长 %lu ms）\n",
+                (unsigned long)stats.granted, (unsigned long)stats.delayed,
+                (unsigned long)(stats.delayed ? stats.totalDelayMs / stats.delayed : 0),
+                (unsigned long)stats.maxDelayMs);
+  Serial.printf("  429 %lu 次，重试 %lu 次，每请求估计 %lu tokens\n",
+                (unsigned long)stats.throttled, (unsigned long)stats.retries, (unsigned long)estimate);
+}
+
+// 发送请求体：先等待配额，复用的连接已关闭时重连重发一次，
+// 429时按Retry-After（没有时按带抖动的指数退避）暂停所有请求后重试。
+// 返回响应码，*out为持有共享连接的HTTPClient（连接失败时为NULL），调用者处理完响应后调用apiConnectionEnd()；
+// *reservedTokens为预扣的token数，收到用量后交给settleQuota()
+static int postVisionBody(const char* url, VisionRequestBody& body, bool showStatus,
+                          HTTPClient** out, uint32_t* reservedTokens) {
+  for (uint8_t retry = 0; ; retry++) {
+    *reservedTokens = acquireQuota(showStatus);
+
+    HTTPClient* http = NULL;
+    int httpResponseCode = 0;
+    int64_t sendStart = 0;
+    int64_t headersAt = 0;
+    for (int attempt = 0; attempt < 2; attempt++) {
+      bool reused = false;
+      http = apiConnectionBegin(url, &reused);
+      if (!http) {
+        *out = NULL;
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+      }
+
+      // 设置请求头
+      http->addHeader("Content-Type", "application/json");
+      http->addHeader("Authorization", authorizationHeader());
+      http->addHeader("User-Agent", "ESP32-Client/1.0");
+      http->collectHeaders(bodyHeaders, BODY_HEADER_COUNT);
+
+      sendStart = esp_timer_get_time();
+      httpResponseCode = http->sendRequest("POST", &body, body.size());
+      headersAt = esp_timer_get_time();
+      if (attempt == 0 && apiConnectionShouldRetry(httpResponseCode, reused)) {
+        apiConnectionEnd();
+        body.rewind();
+        continue;
+      }
+      break;
+    }
+    // sendRequest()先发请求头，请求体全部交给协议栈后等待响应头
+    if (httpResponseCode > 0 && body.lastReadUs() != 0) {
+      apiLatencyRecord(API_PHASE_UPLOAD, (uint32_t)(body.lastReadUs() - sendStart));
+      apiLatencyRecord(API_PHASE_FIRST_BYTE, (uint32_t)(headersAt - body.lastReadUs()));
+    }
+    if (httpResponseCode != 429 || retry >= RETRY_MAX_ATTEMPTS) {
+      *out = http;
+      return httpResponseCode;
+    }
+
+    // 被限流的请求没有消耗token；读完错误响应以便复用连接
+    uint32_t retryAfterMs = (uint32_t)http->header("Retry-After").toInt() * 1000;
+    http->getString();
+    apiConnectionEnd();
+    uint32_t wait = retryBackoffMs(retry, retryAfterMs, RETRY_BASE_MS, RETRY_MAX_MS, esp_random());
+    if (lockRateLimiter()) {
+      rateLimiterSettle(&rateLimiter, millis(), *reservedTokens, 0);
+      rateLimiterPause(&rateLimiter, millis(), wait);
+      rateLimiter.stats.retries++;
+      unlockRateLimiter();
+    }
+    Serial.printf("429 请求过于频繁，%lu ms 后第 %u 次重试\n", (unsigned long)wait, (unsigned)(retry + 1));
+    visionStatus(showStatus, "请求过于频繁，稍后重试");
+    body.rewind();
+  }
+}
+
+// 发送视觉请求：Content-Length预先算出，请求体由VisionRequestBody分块生成
+// onToken不为NULL或开启了流式模式时按SSE流式接收。
+// sentBytes/sentMs不为NULL时输出本次请求体的字节数和上行耗时，请求体没有完整发出时都为0
+static String sendVisionRequest(const uint8_t* image, size_t imageLength, bool encoded,
+                                const String& question, const char* model, bool showStatus,
+                                VisionTokenCallback onToken = NULL, void* tokenCtx = NULL,
+                                size_t* sentBytes = NULL, uint32_t* sentMs = NULL) {
+  if (sentBytes) *sentBytes = 0;
+  if (sentMs) *sentMs = 0;
   if (WiFi.status() != WL_CONNECTED) {
     Serial.println("WiFi未连接");
-    showStaticMessage("WiFi未连接");
+    visionStatus(showStatus, "WiFi未连接");
     return "错误：WiFi未连接";
   }
 
   // 检查API密钥
   if (String(DASHSCOPE_API_KEY) == "YOUR_API_KEY_HERE") {
     Serial.println("请设置API密钥");
-    showStaticMessage("API密钥未设置");
+    visionStatus(showStatus, "API密钥未设置");
     return "错误：API密钥未设置";
   }
 
-  // 检查图像大小，如果太大则提示
-  Serial.printf("图像Base64大小: %d 字符\n", imageBase64.length());
-  if (imageBase64.length() > 100000) { // 约75KB原始图像
-    Serial.println("警告：图像可能过大");
-    showStaticMessage("图像较大");
-  }
+  // 请求体由固定JSON片段、模型名、图像和问题组成，发送时逐段生成
+  bool stream = visionStreaming || onToken != NULL;
+  ChatRequest request;
+  chatRequestVisionImage(&request, model, stream, image, imageLength, encoded, question.c_str());
+  VisionRequestBody body(&request);
+  Serial.printf("图像 %u 字节，请求体 %u 字节\n", (unsigned)imageLength, (unsigned)body.size());
 
-  HTTPClient http;
-  http.begin(DASHSCOPE_API_URL);
-  
-  // 设置请求头
-  http.addHeader("Content-Type", "application/json");
-  http.addHeader("Authorization", "Bearer " + String(DASHSCOPE_API_KEY));
-  http.addHeader("User-Agent", "ESP32-Client/1.0");
-
-  // 构建JSON请求体 - 使用更简洁的格式
-  DynamicJsonDocument doc(16384); // 增加缓冲区大小
-  doc["model"] = "qwen-vl-max";
-  
-  JsonArray messages = doc.createNestedArray("messages");
-  
-  // 用户消息
-  JsonObject userMsg = messages.createNestedObject();
-  userMsg["role"] = "user";
-  JsonArray userContent = userMsg.createNestedArray("content");
-  
-  // 图像内容
-  JsonObject imageContent = userContent.createNestedObject();
-  imageContent["type"] = "image_url";
-  JsonObject imageUrl = imageContent.createNestedObject("image_url");
-  imageUrl["url"] = "data:image/jpeg;base64," + imageBase64;
-  
-  // 文本内容
-  JsonObject textContent = userContent.createNestedObject();
-  textContent["type"] = "text";
-  textContent["text"] = question;
-
-  // 序列化JSON
-  String jsonString;
-  serializeJson(doc, jsonString);
-  
-  // 打印请求信息用于调试
-  Serial.printf("请求JSON大小: %d 字节\n", jsonString.length());
-  Serial.println("请求头信息:");
-  Serial.println("Content-Type: application/json");
   Serial.println("Authorization: Bearer " + String(DASHSCOPE_API_KEY).substring(0, 10) + "...");
-  
   Serial.println("发送API请求...");
-  showStaticMessage("分析图像中...");
-  
-  // 发送POST请求
-  int httpResponseCode = http.POST(jsonString);
-  String response = "";
-  
-  if (httpResponseCode > 0) {
-    response = http.getString();
-    Serial.println("API响应码: " + String(httpResponseCode));
-    
-    // 打印部分响应用于调试
-    if (response.length() > 100) {
-      Serial.println("响应前100字符: " + response.substring(0, 100));
-    } else {
-      Serial.println("完整响应: " + response);
-    }
-    
-    if (httpResponseCode == 200) {
-      // 解析响应
-      DynamicJsonDocument responseDoc(8192);
-      DeserializationError error = deserializeJson(responseDoc, response);
-      
-      if (error) {
-        Serial.println("JSON解析失败: " + String(error.c_str()));
-        showStaticMessage("响应解析失败");
-        return "错误：响应解析失败";
-      }
-      
-      if (responseDoc.containsKey("choices") && responseDoc["choices"].size() > 0) {
-        String result = responseDoc["choices"][0]["message"]["content"];
-        Serial.println("AI分析结果: " + result);
-        showStaticMessage(result.c_str());
-        return result;
-      } else {
-        Serial.println("响应格式错误，缺少choices字段");
-        showStaticMessage("响应格式错误");
-        return "错误：响应格式错误";
-      }
-    } else if (httpResponseCode == 400) {
-      Serial.println("400错误 - 请求格式问题");
-      Serial.println("可能原因：1.API密钥错误 2.图像格式问题 3.请求参数错误");
-      showStaticMessage("请求格式错误");
-      return "错误：请求格式错误(400)";
-    } else if (httpResponseCode == 401) {
-      Serial.println("401错误 - 认证失败，请检查API密钥");
-      showStaticMessage("API密钥错误");
-      return "错误：API密钥错误(401)";
-    } else if (httpResponseCode == 429) {
-      Serial.println("429错误 - 请求过于频繁");
-      showStaticMessage("请求过于频繁");
-      return "错误：请求过于频繁(429)";
-    } else {
-      Serial.println("API请求失败: " + String(httpResponseCode));
-      showStaticMessage("API请求失败");
-      return "错误：API请求失败(" + String(httpResponseCode) + ")";
+  visionStatus(showStatus, "分析图像中...");
+
+  uint32_t heapBefore = ESP.getFreeHeap();
+  uint32_t requestStart = millis();
+  int64_t totalStart = esp_timer_get_time();
+  HTTPClient* http = NULL;
+  uint32_t reservedTokens = 0;
+  int httpResponseCode = postVisionBody(visionApiUrl, body, showStatus, &http, &reservedTokens);
+  if (!http) {
+    settleQuota(reservedTokens, 0);
+    visionStatus(showStatus, "网络连接失败");
+    return "错误：网络连接失败";
+  }
+  if (body.available() == 0) {
+    if (sentBytes) *sentBytes = body.size();
+    if (sentMs) *sentMs = body.sendMs();
+    Serial.printf("请求体上行 %lu ms\n", (unsigned long)body.sendMs());
+  }
+  Serial.printf("发送完成，空闲堆 %u -> %u 字节，历史最低 %u 字节\n",
+                (unsigned)heapBefore, (unsigned)ESP.getFreeHeap(), (unsigned)ESP.getMinFreeHeap());
+
+  String result;
+  uint32_t usedTokens = 0;
+  if (stream && httpResponseCode == 200) {
+    VisionStream state = {};
+    state.onToken = onToken;
+    state.ctx = tokenCtx;
+    state.showStatus = showStatus;
+    state.startMs = requestStart;
+    Serial.printf("响应头 %lu ms\n", (unsigned long)(millis() - requestStart));
+    result = readVisionStream(*http, &state);
+    usedTokens = state.totalTokens;
+    if (usedTokens == 0 && !result.startsWith("错误")) {
+      // 服务器不支持include_usage：回答已生成，按预扣的估计结算
+      Serial.println("流式响应没有用量，按估计结算");
+      usedTokens = reservedTokens;
     }
   } else {
-    Serial.println("HTTP请求失败: " + http.errorToString(httpResponseCode));
-    showStaticMessage("网络请求失败");
-    return "错误：网络请求失败";
+    // 错误响应不是事件流，按普通JSON处理
+    result = handleVisionResponse(*http, httpResponseCode, showStatus, &usedTokens);
   }
-  
-  http.end();
-  return response;
+  apiConnectionEnd();
+  apiLatencyRecordSince(API_PHASE_TOTAL, totalStart);
+  settleQuota(reservedTokens, usedTokens);
+  return result;
 }
 
-// 使用图像URL的版本
-String resolveImageFromURL(const String& imageUrl, const String& question) {
+// 分析JPEG图像：边Base64编码边上传，调用方在返回后才能释放图像缓冲区
+String resolveImageJpeg(const uint8_t* jpegData, size_t jpegSize, const String& question, bool showStatus) {
+  return sendVisionRequest(jpegData, jpegSize, false, question, VISION_DEFAULT_MODEL, showStatus);
+}
+
+// 同上，并输出本次请求体的字节数和上行耗时（自适应画质用）；请求体没有发出时都为0
+String resolveImageJpeg(const uint8_t* jpegData, size_t jpegSize, const String& question, bool showStatus,
+                        size_t* sentBytes, uint32_t* sentMs) {
+  return sendVisionRequest(jpegData, jpegSize, false, question, VISION_DEFAULT_MODEL, showStatus,
+                           NULL, NULL, sentBytes, sentMs);
+}
+
+// 流式分析JPEG图像：每收到一段回答调用一次onToken，返回完整回答
+String resolveImageJpegStream(const uint8_t* jpegData, size_t jpegSize, const String& question,
+                              VisionTokenCallback onToken, void* ctx, bool showStatus) {
+  return sendVisionRequest(jpegData, jpegSize, false, question, VISION_DEFAULT_MODEL, showStatus, onToken, ctx);
+}
+
+// 分析已编码好的Base64图像
+String resolveImage(const String& imageBase64, const String& question) {
+  // 检查图像大小，如果太大则提示
+  Serial.printf("图像Base64大小: %d 字符\n", imageBase64.length());
+  if (imageBase64.length() > 100000) { // 约75KB原始图像
+    Serial.println("警告：图像可能过大");
+    showStaticMessage("图像较大");
+  }
+  return sendVisionRequest((const uint8_t*)imageBase64.c_str(), imageBase64.length(), true, question,
+                           VISION_DEFAULT_MODEL, true);
+}
+
+// 按图像URL分析：请求体很小，整体构建后发送
+static String sendVisionUrlRequest(const String& imageUrl, const String& question, const char* model,
+                                   bool showStatus) {
   if (WiFi.status() != WL_CONNECTED) {
     Serial.println("WiFi未连接");
     return "错误：WiFi未连接";
   }
 
-  HTTPClient http;
-  http.begin(DASHSCOPE_API_URL);
-  
-  http.addHeader("Content-Type", "application/json");
-  http.addHeader("Authorization", "Bearer " + String(DASHSCOPE_API_KEY));
-
-  // 构建JSON请求体（使用URL）
-  DynamicJsonDocument doc(4096);
-  doc["model"] = "qwen-vl-max";
-  
-  JsonArray messages = doc.createNestedArray("messages");
-  
-  // 系统消息
-  JsonObject systemMsg = messages.createNestedObject();
-  systemMsg["role"] = "system";
-  JsonArray systemContent = systemMsg.createNestedArray("content");
-  JsonObject systemText = systemContent.createNestedObject();
-  systemText["type"] = "text";
-  systemText["text"] = "You are a helpful assistant that analyzes images in Chinese.";
-  
-  // 用户消息
-  JsonObject userMsg = messages.createNestedObject();
-  userMsg["role"] = "user";
-  JsonArray userContent = userMsg.createNestedArray("content");
-  
-  // 图像URL
-  JsonObject imageContent = userContent.createNestedObject();
-  imageContent["type"] = "image_url";
-  JsonObject imageUrlObj = imageContent.createNestedObject("image_url");
-  imageUrlObj["url"] = imageUrl;
-  
-  // 文本问题
-  JsonObject textContent = userContent.createNestedObject();
-  textContent["type"] = "text";
-  textContent["text"] = question;
+  // 请求体由固定JSON片段（含系统提示）、模型名、图像URL和问题组成
+  ChatRequest request;
+  chatRequestVisionUrl(&request, model, imageUrl.c_str(), question.c_str());
 
-  String jsonString;
-  serializeJson(doc, jsonString);
-  
   Serial.println("发送API请求...");
-  showStaticMessage("分析图像中...");
-  
-  int httpResponseCode = http.POST(jsonString);
-  String response = "";
-  
-  if (httpResponseCode > 0) {
-    response = http.getString();
-    
-    if (httpResponseCode == 200) {
-      DynamicJsonDocument responseDoc(4096);
-      deserializeJson(responseDoc, response);
-      
-      if (responseDoc.containsKey("choices") && responseDoc["choices"].size() > 0) {
-        String result = responseDoc["choices"][0]["message"]["content"];
-        Serial.println("AI分析结果: " + result);
-        showStaticMessage(result.c_str());
-        return result;
-      }
-    }
+  visionStatus(showStatus, "分析图像中...");
+
+  VisionRequestBody body(&request);
+  int64_t totalStart = esp_timer_get_time();
+  HTTPClient* http = NULL;
+  uint32_t reservedTokens = 0;
+  int httpResponseCode = postVisionBody(visionApiUrl, body, showStatus, &http, &reservedTokens);
+  if (!http) {
+    settleQuota(reservedTokens, 0);
+    return "错误：网络连接失败";
   }
-  
-  http.end();
-  return "分析失败";
+  uint32_t usedTokens = 0;
+  String result = handleVisionResponse(*http, httpResponseCode, showStatus, &usedTokens);
+  apiConnectionEnd();
+  apiLatencyRecordSince(API_PHASE_TOTAL, totalStart);
+  settleQuota(reservedTokens, usedTokens);
+  return result;
+}
+
+// 使用图像URL的版本
+String resolveImageFromURL(const String& imageUrl, const String& question) {
+  return sendVisionUrlRequest(imageUrl, question, VISION_DEFAULT_MODEL, true);
+}
+
+// 后台请求：不操作屏幕。imageUrl不为NULL时按URL分析，否则上传JPEG；model为NULL时用默认模型
+String resolveVisionRequest(const uint8_t* jpegData, size_t jpegSize, const char* imageUrl,
+                            const String& question, const char* model) {
+  if (model == NULL || *model == '\0') model = VISION_DEFAULT_MODEL;
+  if (imageUrl != NULL) {
+    return sendVisionUrlRequest(imageUrl, question, model, false);
+  }
+  return sendVisionRequest(jpegData, jpegSize, false, question, model, false);
 }
 
 // 测试API连接（不使用图像，只测试文本）
@@ -233,39 +782,35 @@ bool testAPIConnection() {
     return false;
   }
 
-  HTTPClient http;
-  http.begin(DASHSCOPE_API_URL);
-  
-  http.addHeader("Content-Type", "application/json");
-  http.addHeader("Authorization", "Bearer " + String(DASHSCOPE_API_KEY));
-  http.addHeader("User-Agent", "ESP32-Client/1.0");
-
-  // 构建简单的文本测试请求
-  DynamicJsonDocument doc(2048);
-  doc["model"] = "qwen-max";  // 使用纯文本模型
-  
-  JsonArray messages = doc.createNestedArray("messages");
-  
-  JsonObject userMsg = messages.createNestedObject();
-  userMsg["role"] = "user";
-  userMsg["content"] = "你好，请回复：API测试成功";
-
-  String jsonString;
-  serializeJson(doc, jsonString);
+  // 构建简单的文本测试请求（使用纯文本模型）
+  ChatRequest request;
+  chatRequestText(&request, "qwen-max", "你好，请回复：API测试成功");
+  VisionRequestBody body(&request);
   
   Serial.println("测试API连接...");
   showStaticMessage("测试API连接");
-  
-  int httpResponseCode = http.POST(jsonString);
+
+  bool reused = false;
+  HTTPClient* http = apiConnectionBegin(visionApiUrl, &reused);
+  if (!http) {
+    showStaticMessage("网络请求失败");
+    return false;
+  }
+  http->addHeader("Content-Type", "application/json");
+  http->addHeader("Authorization", authorizationHeader());
+  http->addHeader("User-Agent", "ESP32-Client/1.0");
+
+  int httpResponseCode = http->sendRequest("POST", &body, body.size());
   
   if (httpResponseCode > 0) {
-    String response = http.getString();
+    String response = http->getString();
     Serial.printf("API测试响应码: %d\n", httpResponseCode);
     
     if (httpResponseCode == 200) {
       Serial.println("API连接测试成功");
       showStaticMessage("连接测试成功");
-      http.end();
+      apiConnectionEnd();
+      printApiConnectionStats();
       return true;
     } else {
       Serial.printf("API测试失败: %d\n", httpResponseCode);
@@ -277,6 +822,6 @@ bool testAPIConnection() {
     showStaticMessage("网络请求失败");
   }
   
-  http.end();
+  apiConnectionEnd();
   return false;
 }
\ No newline at end of file
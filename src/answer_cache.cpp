@@ -0,0 +1,231 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "answer_cache.h"
+
+#define ANSWER_FILE_MAGIC   0x33484341  // "ACH3"：记录中保存问题全文
+#define ANSWER_COMPACT_RECORDS (ANSWER_CACHE_ENTRIES * 2)  // 文件中的记录数达到此值时重写
+
+static AnswerTable table;
+static SemaphoreHandle_t cacheLock = NULL;
+static SemaphoreHandle_t fileLock = NULL;     // 串行化文件读写，与cacheLock分开，写闪存时不阻塞查找
+static uint32_t fileRecords = 0;              // 文件中的记录数（含已被覆盖的旧记录）
+static AnswerCacheStats cacheStats;
+static String storagePath;
+static bool storageMounted = false;
+
+bool answerCacheBegin(uint8_t maxDistance) {
+  if (!cacheLock) {
+    cacheLock = xSemaphoreCreateMutex();
+    if (!cacheLock) return false;
+  }
+  if (!fileLock) {
+    fileLock = xSemaphoreCreateMutex();
+    if (!fileLock) return false;
+  }
+  if (!table.entries) {
+    size_t bytes = sizeof(AnswerEntry) * ANSWER_CACHE_ENTRIES;
+    AnswerEntry* entries = (AnswerEntry*)(psramFound() ? ps_calloc(1, bytes) : calloc(1, bytes));
+    if (!entries) {
+      Serial.println("Answer cache allocation failed");
+      return false;
+    }
+    answerTableInit(&table, entries, ANSWER_CACHE_ENTRIES, maxDistance);
+  }
+  answerTableSetMaxDistance(&table, maxDistance);
+  memset(&cacheStats, 0, sizeof(cacheStats));
+  Serial.printf("Answer cache ready: %d entries, %u bytes in %s\n", ANSWER_CACHE_ENTRIES,
+                (unsigned)(sizeof(AnswerEntry) * ANSWER_CACHE_ENTRIES), psramFound() ? "PSRAM" : "DRAM");
+  return true;
+}
+
+bool answerCacheEnabled() {
+  return table.entries != NULL;
+}
+
+void answerCacheSetMaxDistance(uint8_t maxDistance) {
+  if (!table.entries) return;
+  xSemaphoreTake(cacheLock, portMAX_DELAY);
+  answerTableSetMaxDistance(&table, maxDistance);
+  xSemaphoreGive(cacheLock);
+}
+
+uint64_t answerCacheHashThumb(const uint8_t* thumb) {
+  uint64_t hash = 0;
+  int bit = 0;
+  for (int y = 0; y < ANSWER_HASH_HEIGHT; y++) {
+    const uint8_t* row = thumb + y * ANSWER_HASH_WIDTH;
+    for (int x = 0; x < ANSWER_HASH_WIDTH - 1; x++) {
+      if (row[x] < row[x + 1]) hash |= (uint64_t)1 << bit;
+      bit++;
+    }
+  }
+  return hash;
+}
+
+bool answerCacheLookup(uint64_t imageHash, const char* question,
+                       char* answer, size_t answerSize, uint8_t* distance) {
+  if (!table.entries) return false;
+
+  xSemaphoreTake(cacheLock, portMAX_DELAY);
+  int index = answerTableLookup(&table, imageHash, question, distance);
+  if (index >= 0) {
+    strlcpy(answer, table.entries[index].text, answerSize);
+    cacheStats.hits++;
+  } else {
+    cacheStats.misses++;
+  }
+  xSemaphoreGive(cacheLock);
+  return index >= 0;
+}
+
+static bool mountStorage() {
+  if (storageMounted) return true;
+  storageMounted = LittleFS.begin(true);
+  if (!storageMounted) Serial.println("LittleFS mount failed");
+  return storageMounted;
+}
+
+// 文件格式：魔数后接answer_table的日志记录，每次写入只追加一条；加载时按顺序重放。
+// 记录数达到ANSWER_COMPACT_RECORDS时重写为当前条目
+
+static size_t fileRead(void* ctx, void* data, size_t length) {
+  return ((File*)ctx)->read((uint8_t*)data, length);
+}
+
+static size_t fileWrite(void* ctx, const void* data, size_t length) {
+  return ((File*)ctx)->write((const uint8_t*)data, length);
+}
+
+// 调用时需持有fileLock，不能持有cacheLock：逐条在cacheLock下复制出来再写，不长时间占用缓存
+static bool rewriteEntries() {
+  File file = LittleFS.open(storagePath, "w");
+  if (!file) {
+    Serial.println("Answer cache: failed to open " + storagePath);
+    return false;
+  }
+  uint32_t magic = ANSWER_FILE_MAGIC;
+  bool ok = file.write((const uint8_t*)&magic, sizeof(magic)) == sizeof(magic);
+  uint32_t written = 0;
+  static AnswerEntry copy;
+  for (int i = 0; i < ANSWER_CACHE_ENTRIES && ok; i++) {
+    xSemaphoreTake(cacheLock, portMAX_DELAY);
+    copy = table.entries[i];
+    xSemaphoreGive(cacheLock);
+    if (copy.lastUsed == 0) continue;
+    ok = answerRecordWrite(copy.imageHash, copy.question, copy.text, fileWrite, &file);
+    written++;
+  }
+  file.close();
+  fileRecords = written;
+  return ok;
+}
+
+// 调用时需持有fileLock
+static void persistEntry(uint64_t imageHash, const char* question, const char* answer) {
+  if (storagePath.length() == 0) return;
+  if (fileRecords >= ANSWER_COMPACT_RECORDS) {
+    // 新条目已在内存表中，重写时一并写入
+    rewriteEntries();
+    return;
+  }
+  File file = LittleFS.open(storagePath, "a");
+  if (!file) {
+    Serial.println("Answer cache: failed to open " + storagePath);
+    return;
+  }
+  if (answerRecordWrite(imageHash, question, answer, fileWrite, &file)) fileRecords++;
+  file.close();
+}
+
+// 清空内存表后重放文件中的记录。调用时需持有fileLock和cacheLock；
+// 文件末尾有残缺记录（写入时掉电）或格式不对（含旧版只存问题哈希的文件）时返回false，由调用者重写文件
+static bool loadEntries() {
+  answerTableClear(&table);
+  fileRecords = 0;
+  if (!LittleFS.exists(storagePath)) return false;
+  File file = LittleFS.open(storagePath, "r");
+  if (!file) return false;
+
+  uint32_t magic = 0;
+  if (file.read((uint8_t*)&magic, sizeof(magic)) != sizeof(magic) || magic != ANSWER_FILE_MAGIC) {
+    Serial.println("Answer cache: ignoring invalid file " + storagePath);
+    file.close();
+    return false;
+  }
+
+  bool complete = answerTableReplay(&table, fileRead, &file, &fileRecords);
+  file.close();
+  Serial.printf("Answer cache: loaded %d entries (%lu records) from %s\n", table.count,
+                (unsigned long)fileRecords, storagePath.c_str());
+  return complete;
+}
+
+void answerCacheStore(uint64_t imageHash, const char* question, const char* answer) {
+  if (!table.entries) return;
+
+  xSemaphoreTake(cacheLock, portMAX_DELAY);
+  bool evicted = false;
+  bool stored = answerTableStore(&table, imageHash, question, answer, &evicted) >= 0;
+  if (evicted) cacheStats.evictions++;
+  if (stored) cacheStats.stores++;
+  xSemaphoreGive(cacheLock);
+  if (!stored) return;    // 问题或回答太长
+
+  // 文件只追加一条记录，在cacheLock之外进行
+  xSemaphoreTake(fileLock, portMAX_DELAY);
+  persistEntry(imageHash, question, answer);
+  xSemaphoreGive(fileLock);
+}
+
+bool answerCacheAttachStorage(const char* path) {
+  if (!table.entries) return false;
+  if (path && !mountStorage()) return false;
+
+  xSemaphoreTake(fileLock, portMAX_DELAY);
+  if (!path) {
+    storagePath = "";
+    xSemaphoreGive(fileLock);
+    return true;
+  }
+  storagePath = path;
+  xSemaphoreTake(cacheLock, portMAX_DELAY);
+  bool complete = loadEntries();
+  xSemaphoreGive(cacheLock);
+  bool ok = true;
+  if (!complete || fileRecords >= ANSWER_COMPACT_RECORDS) {
+    // 新文件、旧格式或残缺：按当前内容重写，之后才能继续追加
+    ok = rewriteEntries();
+  }
+  xSemaphoreGive(fileLock);
+  return ok;
+}
+
+void answerCacheClear() {
+  if (!table.entries) return;
+  xSemaphoreTake(fileLock, portMAX_DELAY);
+  xSemaphoreTake(cacheLock, portMAX_DELAY);
+  answerTableClear(&table);
+  xSemaphoreGive(cacheLock);
+  if (storagePath.length() > 0) rewriteEntries();
+  xSemaphoreGive(fileLock);
+}
+
+void getAnswerCacheStats(AnswerCacheStats* stats) {
+  *stats = cacheStats;
+  stats->entries = table.count;
+  stats->maxDistance = table.maxDistance;
+}
+
+void printAnswerCacheStats() {
+  AnswerCacheStats stats;
+  getAnswerCacheStats(&stats);
+  uint32_t lookups = stats.hits + stats.misses;
+  Serial.printf("Answer cache: %lu hits, %lu misses (%.1f%% hit rate), %d/%d entries, "
+                "%lu stores, %lu evictions, max distance %d\n",
+                (unsigned long)stats.hits, (unsigned long)stats.misses,
+                lookups ? stats.hits * 100.0f / lookups : 0.0f,
+                stats.entries, ANSWER_CACHE_ENTRIES,
+                (unsigned long)stats.stores, (unsigned long)stats.evictions, stats.maxDistance);
+}
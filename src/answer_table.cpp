@@ -0,0 +1,132 @@
+#include "answer_table.h"
+#include <string.h>
+
+void answerTableInit(AnswerTable* t, AnswerEntry* entries, uint8_t capacity, uint8_t maxDistance) {
+  t->entries = entries;
+  t->capacity = capacity;
+  t->useCounter = 0;
+  answerTableSetMaxDistance(t, maxDistance);
+  answerTableClear(t);
+}
+
+void answerTableClear(AnswerTable* t) {
+  memset(t->entries, 0, sizeof(AnswerEntry) * t->capacity);
+  t->count = 0;
+}
+
+void answerTableSetMaxDistance(AnswerTable* t, uint8_t maxDistance) {
+  t->maxDistance = maxDistance > 64 ? 64 : maxDistance;
+}
+
+// 64位FNV-1a
+uint64_t answerQuestionHash(const char* question) {
+  uint64_t h = 14695981039346656037ull;
+  while (*question) {
+    h ^= (uint8_t)*question++;
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+static inline uint8_t hammingDistance(uint64_t a, uint64_t b) {
+  return (uint8_t)__builtin_popcountll(a ^ b);
+}
+
+static inline bool sameQuestion(const AnswerEntry& e, uint64_t questionHash, const char* question) {
+  return e.lastUsed != 0 && e.questionHash == questionHash && strcmp(e.question, question) == 0;
+}
+
+int answerTableLookup(AnswerTable* t, uint64_t imageHash, const char* question, uint8_t* distance) {
+  uint64_t questionHash = answerQuestionHash(question);
+  int best = -1;
+  uint8_t bestDistance = 65;
+  for (int i = 0; i < t->capacity; i++) {
+    const AnswerEntry& e = t->entries[i];
+    if (!sameQuestion(e, questionHash, question)) continue;
+    uint8_t d = hammingDistance(e.imageHash, imageHash);
+    if (d < bestDistance) {
+      bestDistance = d;
+      best = i;
+    }
+  }
+  if (best < 0 || bestDistance > t->maxDistance) return -1;
+  t->entries[best].lastUsed = ++t->useCounter;
+  if (distance) *distance = bestDistance;
+  return best;
+}
+
+int answerTableStore(AnswerTable* t, uint64_t imageHash, const char* question, const char* answer,
+                     bool* evicted) {
+  if (evicted) *evicted = false;
+  size_t questionLength = strlen(question);
+  size_t answerLength = strlen(answer);
+  if (questionLength >= ANSWER_CACHE_QUESTION_MAX || answerLength >= ANSWER_CACHE_TEXT_MAX) return -1;
+
+  uint64_t questionHash = answerQuestionHash(question);
+  int slot = -1;
+  int lru = 0;
+  for (int i = 0; i < t->capacity; i++) {
+    const AnswerEntry& e = t->entries[i];
+    if (sameQuestion(e, questionHash, question) && hammingDistance(e.imageHash, imageHash) <= t->maxDistance) {
+      slot = i;
+      break;
+    }
+    if (e.lastUsed < t->entries[lru].lastUsed) lru = i;
+  }
+  if (slot < 0) {
+    slot = lru;
+    if (t->entries[slot].lastUsed != 0) {
+      if (evicted) *evicted = true;
+    } else {
+      t->count++;
+    }
+  }
+
+  AnswerEntry& e = t->entries[slot];
+  e.imageHash = imageHash;
+  e.questionHash = questionHash;
+  e.lastUsed = ++t->useCounter;
+  memcpy(e.question, question, questionLength + 1);
+  memcpy(e.text, answer, answerLength + 1);
+  return slot;
+}
+
+static bool writeText(const char* text, AnswerWriteFn write, void* ctx) {
+  uint16_t length = (uint16_t)strlen(text);
+  return write(ctx, &length, sizeof(length)) == sizeof(length) && write(ctx, text, length) == length;
+}
+
+bool answerRecordWrite(uint64_t imageHash, const char* question, const char* answer,
+                       AnswerWriteFn write, void* ctx) {
+  return write(ctx, &imageHash, sizeof(imageHash)) == sizeof(imageHash) &&
+         writeText(question, write, ctx) && writeText(answer, write, ctx);
+}
+
+// 读一段带长度的文本，长度必须小于size
+static bool readText(char* text, size_t size, AnswerReadFn read, void* ctx) {
+  uint16_t length = 0;
+  if (read(ctx, &length, sizeof(length)) != sizeof(length) || length >= size) return false;
+  if (read(ctx, text, length) != length) return false;
+  text[length] = '\0';
+  return true;
+}
+
+bool answerTableReplay(AnswerTable* t, AnswerReadFn read, void* ctx, uint32_t* records) {
+  answerTableClear(t);
+  *records = 0;
+  // 回答最长512字节，放在静态区而不是调用者的栈上；调用者已串行化
+  static char question[ANSWER_CACHE_QUESTION_MAX];
+  static char text[ANSWER_CACHE_TEXT_MAX];
+  while (true) {
+    uint64_t imageHash;
+    size_t n = read(ctx, &imageHash, sizeof(imageHash));
+    if (n == 0) return true;
+    if (n != sizeof(imageHash) ||
+        !readText(question, sizeof(question), read, ctx) ||
+        !readText(text, sizeof(text), read, ctx)) {
+      return false;
+    }
+    answerTableStore(t, imageHash, question, text, NULL);
+    (*records)++;
+  }
+}
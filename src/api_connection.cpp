@@ -0,0 +1,180 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "api_connection.h"
+#include "api_latency.h"
+
+static HTTPClient apiHttp;
+static WiFiClientSecure secureClient;
+static WiFiClient plainClient;
+static SemaphoreHandle_t connectionLock = NULL;
+static ApiConnectionStats connectionStats;
+
+// 当前连接的目标
+static String connectedHost;
+static uint16_t connectedPort = 0;
+static bool connectedSecure = false;
+static uint32_t lastUseMs = 0;
+
+// 解析 scheme://host[:port]/path 中的协议、主机和端口
+static bool parseUrl(const char* url, bool* secure, String* host, uint16_t* port) {
+  String s(url);
+  int schemeEnd = s.indexOf("://");
+  if (schemeEnd < 0) return false;
+  String scheme = s.substring(0, schemeEnd);
+  if (scheme == "https") {
+    *secure = true;
+    *port = 443;
+  } else if (scheme == "http") {
+    *secure = false;
+    *port = 80;
+  } else {
+    return false;
+  }
+
+  int hostStart = schemeEnd + 3;
+  int pathStart = s.indexOf('/', hostStart);
+  String authority = pathStart < 0 ? s.substring(hostStart) : s.substring(hostStart, pathStart);
+  int colon = authority.indexOf(':');
+  if (colon >= 0) {
+    *port = (uint16_t)authority.substring(colon + 1).toInt();
+    authority = authority.substring(0, colon);
+  }
+  *host = authority;
+  return host->length() > 0 && *port != 0;
+}
+
+static WiFiClient& activeClient() {
+  return connectedSecure ? (WiFiClient&)secureClient : plainClient;
+}
+
+static void closeConnection() {
+  secureClient.stop();
+  plainClient.stop();
+}
+
+bool apiConnectionInit() {
+  if (!connectionLock) connectionLock = xSemaphoreCreateMutex();
+  return connectionLock != NULL;
+}
+
+HTTPClient* apiConnectionBegin(const char* url, bool* reused) {
+  bool secure = false;
+  String host;
+  uint16_t port = 0;
+  if (!parseUrl(url, &secure, &host, &port)) {
+    Serial.printf("API connection: invalid URL %s\n", url);
+    return NULL;
+  }
+  if (!connectionLock) {
+    // 在这里惰性创建会与其他任务的首次请求竞争，各自创建出不同的锁
+    Serial.println("API connection: apiConnectionInit() not called");
+    return NULL;
+  }
+  xSemaphoreTake(connectionLock, portMAX_DELAY);
+  connectionStats.requests++;
+
+  // 目标改变时换连接
+  if (secure != connectedSecure || port != connectedPort || host != connectedHost) {
+    closeConnection();
+    connectedSecure = secure;
+    connectedPort = port;
+    connectedHost = host;
+  }
+
+  WiFiClient& client = activeClient();
+  bool alive = client.connected();
+  if (alive && millis() - lastUseMs > API_IDLE_TIMEOUT_MS) {
+    // 服务器可能已经关闭了空闲连接，在上传大请求体之前重新连接
+    client.stop();
+    connectionStats.idleCloses++;
+    alive = false;
+  }
+
+  if (alive) {
+    connectionStats.reused++;
+  } else {
+    if (secure) secureClient.setInsecure();
+    uint32_t start = millis();
+    // 先单独解析域名计时；https按主机名连接（需要SNI），其内部的解析命中lwIP的DNS缓存
+    int64_t phaseStart = esp_timer_get_time();
+    IPAddress address;
+    if (!WiFi.hostByName(host.c_str(), address)) {
+      connectionStats.connectFailures++;
+      Serial.printf("API connection: DNS lookup for %s failed\n", host.c_str());
+      xSemaphoreGive(connectionLock);
+      return NULL;
+    }
+    phaseStart = apiLatencyRecordSince(API_PHASE_DNS, phaseStart);
+    bool connected = secure ? client.connect(host.c_str(), port) : client.connect(address, port);
+    if (connected) apiLatencyRecordSince(secure ? API_PHASE_TLS : API_PHASE_CONNECT, phaseStart);
+    if (!connected) {
+      connectionStats.connectFailures++;
+      Serial.printf("API connection: connect to %s:%u failed\n", host.c_str(), (unsigned)port);
+      xSemaphoreGive(connectionLock);
+      return NULL;
+    }
+    connectionStats.handshakes++;
+    connectionStats.lastHandshakeMs = millis() - start;
+    connectionStats.totalHandshakeMs += connectionStats.lastHandshakeMs;
+    Serial.printf("API connection: %s handshake with %s %lu ms, free heap %u\n",
+                  secure ? "TLS" : "TCP", host.c_str(), (unsigned long)connectionStats.lastHandshakeMs,
+                  (unsigned)ESP.getFreeHeap());
+  }
+  *reused = alive;
+
+  // HTTPClient发现连接已建立时直接复用，不再自己连接
+  apiHttp.begin(client, url);
+  apiHttp.setReuse(true);
+  return &apiHttp;
+}
+
+bool apiConnectionShouldRetry(int httpCode, bool reused) {
+  if (!reused) return false;
+  bool sendFailed = httpCode == HTTPC_ERROR_SEND_HEADER_FAILED ||
+                    httpCode == HTTPC_ERROR_SEND_PAYLOAD_FAILED ||
+                    httpCode == HTTPC_ERROR_NOT_CONNECTED ||
+                    httpCode == HTTPC_ERROR_CONNECTION_LOST;
+  if (sendFailed) {
+    connectionStats.staleRetries++;
+    Serial.println("API connection: reused connection was closed, reconnecting");
+  }
+  return sendFailed;
+}
+
+void apiConnectionEnd() {
+  // 服务器返回Connection: close或响应未读完时HTTPClient会断开，否则保持连接
+  apiHttp.end();
+  lastUseMs = millis();
+  xSemaphoreGive(connectionLock);
+}
+
+void apiConnectionClose() {
+  if (!connectionLock) return;
+  xSemaphoreTake(connectionLock, portMAX_DELAY);
+  closeConnection();
+  connectedHost = "";
+  connectedPort = 0;
+  xSemaphoreGive(connectionLock);
+}
+
+void getApiConnectionStats(ApiConnectionStats* stats) {
+  *stats = connectionStats;
+}
+
+void printApiConnectionStats() {
+  ApiConnectionStats stats;
+  getApiConnectionStats(&stats);
+  Serial.printf("API connection: %lu requests, %lu handshakes (avg %lu ms), %lu reused (%lu%%)\n",
+                (unsigned long)stats.requests, (unsigned long)stats.handshakes,
+                (unsigned long)(stats.handshakes ? stats.totalHandshakeMs / stats.handshakes : 0),
+                (unsigned long)stats.reused,
+                (unsigned long)(stats.requests ? stats.reused * 100 / stats.requests : 0));
+  Serial.printf("  stale retries %lu, idle closes %lu, connect failures %lu\n",
+                (unsigned long)stats.staleRetries, (unsigned long)stats.idleCloses,
+                (unsigned long)stats.connectFailures);
+}
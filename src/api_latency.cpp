@@ -0,0 +1,77 @@
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "api_latency.h"
+
+static LatencyHistogram histograms[API_PHASE_COUNT];
+static SemaphoreHandle_t latencyLock = NULL;
+
+static const char* phaseNames[API_PHASE_COUNT] = {
+  "dns", "tcp connect", "tcp+tls", "upload", "first byte", "download", "parse", "display", "total"
+};
+
+bool apiLatencyInit() {
+  if (!latencyLock) latencyLock = xSemaphoreCreateMutex();
+  return latencyLock != NULL;
+}
+
+// 未初始化时不记录
+static bool lockLatency() {
+  if (!latencyLock) return false;
+  xSemaphoreTake(latencyLock, portMAX_DELAY);
+  return true;
+}
+
+void apiLatencyRecord(ApiPhase phase, uint32_t us) {
+  if (phase >= API_PHASE_COUNT || !lockLatency()) return;
+  latencyHistogramRecord(&histograms[phase], us);
+  xSemaphoreGive(latencyLock);
+}
+
+int64_t apiLatencyRecordSince(ApiPhase phase, int64_t startUs) {
+  int64_t now = esp_timer_get_time();
+  apiLatencyRecord(phase, (uint32_t)(now - startUs));
+  return now;
+}
+
+const char* apiPhaseName(ApiPhase phase) {
+  return phase < API_PHASE_COUNT ? phaseNames[phase] : "?";
+}
+
+void getApiLatencyHistogram(ApiPhase phase, LatencyHistogram* histogram) {
+  if (phase >= API_PHASE_COUNT || !lockLatency()) {
+    latencyHistogramReset(histogram);
+    return;
+  }
+  *histogram = histograms[phase];
+  xSemaphoreGive(latencyLock);
+}
+
+void resetApiLatencyStats() {
+  if (!lockLatency()) return;
+  for (int i = 0; i < API_PHASE_COUNT; i++) latencyHistogramReset(&histograms[i]);
+  xSemaphoreGive(latencyLock);
+}
+
+// 微秒按毫秒输出，保留一位小数
+static String formatMs(uint32_t us) {
+  char text[16];
+  snprintf(text, sizeof(text), "%lu.%lu", (unsigned long)(us / 1000), (unsigned long)(us % 1000 / 100));
+  return String(text);
+}
+
+void printApiLatencyStats() {
+  Serial.println("API latency (ms)     count      min      avg      p95      max");
+  for (int i = 0; i < API_PHASE_COUNT; i++) {
+    LatencyHistogram h;
+    getApiLatencyHistogram((ApiPhase)i, &h);
+    if (h.count == 0) {
+      Serial.printf("  %-16s %7d\n", phaseNames[i], 0);
+      continue;
+    }
+    Serial.printf("  %-16s %7lu %8s %8s %8s %8s\n", phaseNames[i], (unsigned long)h.count,
+                  formatMs(h.minUs).c_str(), formatMs(latencyHistogramAverage(&h)).c_str(),
+                  formatMs(latencyHistogramPercentile(&h, 95)).c_str(), formatMs(h.maxUs).c_str());
+  }
+}
@@ -0,0 +1,124 @@
+#include "base64_stream.h"
+#include <string.h>
+
+static const char kBase64Chars[64] = {
+  'A','B','C','D','E','F','G','H','I','J','K','L','M','N','O','P',
+  'Q','R','S','T','U','V','W','X','Y','Z','a','b','c','d','e','f',
+  'g','h','i','j','k','l','m','n','o','p','q','r','s','t','u','v',
+  'w','x','y','z','0','1','2','3','4','5','6','7','8','9','+','/'
+};
+
+static inline void encodeGroup(const uint8_t* in, char* out) {
+  uint32_t b = ((uint32_t)in[0] << 16) | ((uint32_t)in[1] << 8) | in[2];
+  out[0] = kBase64Chars[b >> 18];
+  out[1] = kBase64Chars[(b >> 12) & 63];
+  out[2] = kBase64Chars[(b >> 6) & 63];
+  out[3] = kBase64Chars[b & 63];
+}
+
+// 编码完整的3字节组，每次循环处理12字节输入、输出16个字符；返回写入的字符数
+static size_t encodeGroups(const uint8_t* data, size_t groups, char* out) {
+  char* p = out;
+  while (groups >= 4) {
+    encodeGroup(data, p);
+    encodeGroup(data + 3, p + 4);
+    encodeGroup(data + 6, p + 8);
+    encodeGroup(data + 9, p + 12);
+    data += 12;
+    p += 16;
+    groups -= 4;
+  }
+  while (groups--) {
+    encodeGroup(data, p);
+    data += 3;
+    p += 4;
+  }
+  return p - out;
+}
+
+// 最后不足3字节的1或2个字节，补'='
+static void encodeTail(const uint8_t* in, size_t length, char* out) {
+  uint32_t b = ((uint32_t)in[0] << 16) | (length > 1 ? ((uint32_t)in[1] << 8) : 0);
+  out[0] = kBase64Chars[b >> 18];
+  out[1] = kBase64Chars[(b >> 12) & 63];
+  out[2] = length > 1 ? kBase64Chars[(b >> 6) & 63] : '=';
+  out[3] = '=';
+}
+
+size_t base64EncodeTo(const uint8_t* data, size_t length, char* out) {
+  size_t groups = length / 3;
+  size_t written = encodeGroups(data, groups, out);
+  size_t rest = length - groups * 3;
+  if (rest) {
+    encodeTail(data + groups * 3, rest, out + written);
+    written += 4;
+  }
+  return written;
+}
+
+void base64StreamBegin(Base64Stream* st, Base64Sink sink, void* ctx) {
+  st->sink = sink;
+  st->ctx = ctx;
+  st->pendingLength = 0;
+  st->failed = false;
+  st->used = 0;
+  st->total = 0;
+}
+
+static bool flushOutput(Base64Stream* st) {
+  if (st->used == 0 || st->failed) return !st->failed;
+  if (!st->sink(st->out, st->used, st->ctx)) {
+    st->failed = true;
+    return false;
+  }
+  st->total += st->used;
+  st->used = 0;
+  return true;
+}
+
+bool base64StreamWrite(Base64Stream* st, const uint8_t* data, size_t length) {
+  if (st->failed) return false;
+
+  // 先补齐上次剩下的不完整分组
+  if (st->pendingLength) {
+    while (st->pendingLength < 3 && length) {
+      st->pending[st->pendingLength++] = *data++;
+      length--;
+    }
+    if (st->pendingLength < 3) return true;
+    if (st->used + 4 > BASE64_STREAM_CHUNK && !flushOutput(st)) return false;
+    encodeGroup(st->pending, st->out + st->used);
+    st->used += 4;
+    st->pendingLength = 0;
+  }
+
+  // 整组按输出缓冲区剩余空间成批编码
+  size_t groups = length / 3;
+  while (groups) {
+    size_t room = (BASE64_STREAM_CHUNK - st->used) / 4;
+    if (room == 0) {
+      if (!flushOutput(st)) return false;
+      continue;
+    }
+    size_t n = groups < room ? groups : room;
+    st->used += encodeGroups(data, n, st->out + st->used);
+    data += n * 3;
+    length -= n * 3;
+    groups -= n;
+  }
+
+  memcpy(st->pending, data, length);
+  st->pendingLength = (uint8_t)length;
+  return true;
+}
+
+bool base64StreamEnd(Base64Stream* st) {
+  if (st->failed) return false;
+  if (st->pendingLength) {
+    if (st->used + 4 > BASE64_STREAM_CHUNK && !flushOutput(st)) return false;
+    encodeTail(st->pending, st->pendingLength, st->out + st->used);
+    st->used += 4;
+    st->pendingLength = 0;
+  }
+  return flushOutput(st);
+}
@@ -1,5 +1,9 @@
 #include <Arduino.h>
 #include "esp_camera.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
 #include <U8g2lib.h>
 
 // ===================
@@ -21,11 +25,31 @@
 //#define CAMERA_MODEL_ESP32S3_CAM_LCD
 
 #include "camera_pins.h"
+#include "jpeg_decoder.h"
+#include "image_scaler.h"
+#include "frame_gray.h"
+#include "dither.h"
+#include "luma_stats.h"
+#include "image_bench.h"
+#include "base64_stream.h"
+#include "scene_gate.h"
+#include "answer_cache.h"
+#include "quality_controller.h"
+#include "camera_mode.h"
+#include "camera_lock.h"
+#include "frame_recorder.h"
 
 // 外部函数声明
-String resolveImage(const String& imageBase64, const String& question);
+String resolveImageJpeg(const uint8_t* jpegData, size_t jpegSize, const String& question, bool showStatus);
+String resolveImageJpeg(const uint8_t* jpegData, size_t jpegSize, const String& question, bool showStatus,
+                        size_t* sentBytes, uint32_t* sentMs);
 void showStaticMessage(const char* message);
 void showTwoLineMessage(const char* line1, const char* line2);
+void showMonoImage(const uint8_t* xbm, uint16_t width, uint16_t height);
+void packMonoImage(const uint8_t* xbm, uint16_t width, uint16_t height);
+void sendDisplayBuffer();
+void lockScreen();
+void unlockScreen();
 
 // 外部显示对象声明
 extern U8G2_SSD1306_128X32_UNIVISION_F_HW_I2C u8g2;
@@ -37,8 +61,8 @@ struct ImageInfo {
   uint8_t* pixels;  // 灰度像素数据 (0-255)
 };
 
-// Simple base64 encode function
-String base64Encode(const uint8_t* data, size_t length) {
+// 逐字符追加的旧版Base64编码，只用于性能对比
+static String base64EncodeByChar(const uint8_t* data, size_t length) {
   const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
   String result = "";
   
@@ -52,14 +76,31 @@ String base64Encode(const uint8_t* data, size_t length) {
   return result;
 }
 
-void initCamera() {
-  showTwoLineMessage("正在初始化摄像头...","");
-  
-  // 先尝试反初始化，防止重复初始化错误
-  esp_camera_deinit();
-  delay(100);
-  
-  camera_config_t config;
+static bool appendToString(const char* data, size_t length, void* ctx) {
+  return ((String*)ctx)->concat(data, length);
+}
+
+static bool writeToSerial(const char* data, size_t length, void* ctx) {
+  Serial.write((const uint8_t*)data, length);
+  return true;
+}
+
+// Base64编码：按编码后长度一次性分配String，再分块查表编码追加
+String base64Encode(const uint8_t* data, size_t length) {
+  String result;
+  if (!result.reserve(base64EncodedLength(length))) {
+    Serial.println("Base64 buffer allocation failed");
+    return result;
+  }
+  Base64Stream stream;
+  base64StreamBegin(&stream, appendToString, &result);
+  base64StreamWrite(&stream, data, length);
+  base64StreamEnd(&stream);
+  return result;
+}
+
+// 摄像头引脚和时钟配置
+static void setCameraPins(camera_config_t& config) {
   config.ledc_channel = LEDC_CHANNEL_0;
   config.ledc_timer = LEDC_TIMER_0;
   config.pin_d0 = Y2_GPIO_NUM;
@@ -79,104 +120,431 @@ void initCamera() {
   config.pin_pwdn = PWDN_GPIO_NUM;
   config.pin_reset = RESET_GPIO_NUM;
   config.xclk_freq_hz = 20000000;
-  
-  // 使用较小的分辨率以减少数据量，便于API传输
-  config.frame_size = FRAMESIZE_VGA;    // 640x480 而不是 UXGA
-  config.pixel_format = PIXFORMAT_JPEG; // for streaming
-  config.grab_mode = CAMERA_GRAB_WHEN_EMPTY;
-  config.fb_location = CAMERA_FB_IN_PSRAM;
-  config.jpeg_quality = 15;  // 稍微降低质量以减少大小 (10-63, 数字越小质量越好)
-  config.fb_count = 1;
-    
-  
-  // if PSRAM IC present, init with UXGA resolution and higher JPEG quality
-  // for larger pre-allocated frame buffer.
-  if(psramFound()){
-    Serial.println("PSRAM found, using optimized settings");
-    config.jpeg_quality = 12;  // 在PSRAM环境下稍微提高质量
-    config.fb_count = 2;
+}
+
+// 设置图像参数以获得更好的压缩比
+static void applySensorSettings(sensor_t* s) {
+  s->set_brightness(s, 0);     // -2 to 2
+  s->set_contrast(s, 0);       // -2 to 2
+  s->set_saturation(s, 0);     // -2 to 2
+  s->set_special_effect(s, 0); // 0 to 6 (0 - No Effect, 1 - Negative, 2 - Grayscale, 3 - Red Tint, 4 - Green Tint, 5 - Blue Tint, 6 - Sepia)
+  s->set_whitebal(s, 1);       // 0 = disable , 1 = enable
+  s->set_awb_gain(s, 1);       // 0 = disable , 1 = enable
+  s->set_wb_mode(s, 0);        // 0 to 4 - if awb_gain enabled (0 - Auto, 1 - Sunny, 2 - Cloudy, 3 - Office, 4 - Home)
+}
+
+// 摄像头驱动配置：有PSRAM时帧缓冲放在PSRAM、双缓冲取最新帧，否则单缓冲并降低质量
+static void buildCameraConfig(camera_config_t& config, pixformat_t format, framesize_t frameSize) {
+  setCameraPins(config);
+  config.frame_size = frameSize;
+  config.pixel_format = format;
+  if (psramFound()) {
     config.grab_mode = CAMERA_GRAB_LATEST;
+    config.fb_location = CAMERA_FB_IN_PSRAM;
+    config.jpeg_quality = 12;
+    config.fb_count = 2;
   } else {
-    Serial.println("PSRAM not found, using basic settings");
-    // Limit the frame size when PSRAM is not available
-    config.frame_size = FRAMESIZE_QVGA; // 320x240 更小的分辨率
+    config.grab_mode = CAMERA_GRAB_WHEN_EMPTY;
     config.fb_location = CAMERA_FB_IN_DRAM;
-    config.jpeg_quality = 20; // 进一步降低质量以适应内存限制
+    config.jpeg_quality = 20;
+    config.fb_count = 1;
   }
+}
 
-  showTwoLineMessage("正在初始化摄像头...","2");
-  
-  // camera init
+// ===================
+// 摄像头初始化状态机
+// ===================
+// 初始化在后台任务中按阶段推进，主循环通过cameraInitPoll()读取阶段并刷新显示，
+// 显示刷新不会拖慢初始化。初始化成功后缓存驱动配置和传感器寄存器状态。
+// 故障后由调用者显式调用recoverCamera()：先只复位传感器并按缓存写回寄存器，驱动和帧缓冲不动；
+// 复位后仍取不到帧才释放并重建驱动。取帧失败时不会自动恢复，
+// 有后台取帧者（实时预览、流水线、录帧）时拒绝恢复，见camera_lock.h。
+
+enum CameraInitPhase : uint8_t {
+  CAMERA_INIT_IDLE,
+  CAMERA_INIT_DRIVER,       // 复位传感器、分配帧缓冲
+  CAMERA_INIT_CONFIGURE,    // 写入传感器设置
+  CAMERA_INIT_FIRST_FRAME,  // 等待第一帧
+  CAMERA_INIT_READY,
+  CAMERA_INIT_FAILED
+};
+
+static const char* cameraInitPhaseNames[] = {"空闲", "驱动", "配置", "首帧", "就绪", "失败"};
+
+#define CAMERA_INIT_TASK_STACK  6144
+
+static volatile CameraInitPhase initPhase = CAMERA_INIT_IDLE;
+static CameraInitPhase shownPhase = CAMERA_INIT_IDLE;
+static TaskHandle_t initTask = NULL;   // 初始化任务运行期间非NULL，由任务退出前清空
+static esp_err_t initError = ESP_OK;
+static uint32_t initStartMs = 0;
+static uint32_t initPhaseMs[CAMERA_INIT_FAILED + 1];
+
+static camera_config_t cachedConfig;
+static bool configCached = false;
+static camera_status_t cachedStatus;
+static bool statusCached = false;
+
+// 按缓存的状态写入传感器设置；force为false时跳过与当前值相同的寄存器。
+// 传感器复位后寄存器回到默认值而s->status不变，此时必须全部写入
+static int writeSensorStatus(sensor_t* s, const camera_status_t& want, bool force) {
+  int writes = 0;
+#define RESTORE(field, setter) \
+  if ((force || s->status.field != want.field) && s->setter != NULL) { s->setter(s, want.field); writes++; }
+  RESTORE(framesize, set_framesize)
+  RESTORE(quality, set_quality)
+  RESTORE(brightness, set_brightness)
+  RESTORE(contrast, set_contrast)
+  RESTORE(saturation, set_saturation)
+  RESTORE(sharpness, set_sharpness)
+  RESTORE(denoise, set_denoise)
+  RESTORE(special_effect, set_special_effect)
+  RESTORE(awb, set_whitebal)
+  RESTORE(awb_gain, set_awb_gain)
+  RESTORE(wb_mode, set_wb_mode)
+  RESTORE(aec, set_exposure_ctrl)
+  RESTORE(aec2, set_aec2)
+  RESTORE(ae_level, set_ae_level)
+  RESTORE(agc, set_gain_ctrl)
+  if ((force || s->status.gainceiling != want.gainceiling) && s->set_gainceiling != NULL) {
+    s->set_gainceiling(s, (gainceiling_t)want.gainceiling);
+    writes++;
+  }
+  RESTORE(bpc, set_bpc)
+  RESTORE(wpc, set_wpc)
+  RESTORE(raw_gma, set_raw_gma)
+  RESTORE(lenc, set_lenc)
+  RESTORE(hmirror, set_hmirror)
+  RESTORE(vflip, set_vflip)
+  RESTORE(dcw, set_dcw)
+#undef RESTORE
+  return writes;
+}
+
+// 按缓存的状态恢复传感器设置，跳过与当前值相同的寄存器写入
+int restoreSensorStatus(sensor_t* s, const camera_status_t& want) {
+  return writeSensorStatus(s, want, false);
+}
+
+// 依次执行各初始化阶段，记录每个阶段结束时距开始的毫秒数
+static bool runCameraInit(const camera_config_t& config) {
+  initStartMs = millis();
+  memset(initPhaseMs, 0, sizeof(initPhaseMs));
+  initError = ESP_OK;
+
+  initPhase = CAMERA_INIT_DRIVER;
+  esp_camera_deinit();  // 防止重复初始化错误
+  initError = esp_camera_init(&config);
+  initPhaseMs[CAMERA_INIT_DRIVER] = millis() - initStartMs;
+  if (initError != ESP_OK) {
+    Serial.printf("Camera init failed with error 0x%x (%s)\n", initError, esp_err_to_name(initError));
+    initPhase = CAMERA_INIT_FAILED;
+    return false;
+  }
+  cachedConfig = config;
+  configCached = true;
+
+  initPhase = CAMERA_INIT_CONFIGURE;
+  sensor_t * s = esp_camera_sensor_get();
+  if (s == NULL) {
+    Serial.println("Failed to get camera sensor");
+    initError = ESP_ERR_NOT_FOUND;
+    initPhase = CAMERA_INIT_FAILED;
+    return false;
+  }
+  if (statusCached) {
+    int writes = restoreSensorStatus(s, cachedStatus);
+    Serial.printf("Camera sensor restored from cache (%d register writes)\n", writes);
+  } else {
+    applySensorSettings(s);
+    cachedStatus = s->status;
+    statusCached = true;
+  }
+  initPhaseMs[CAMERA_INIT_CONFIGURE] = millis() - initStartMs;
+
+  initPhase = CAMERA_INIT_FIRST_FRAME;
+  camera_fb_t * fb = esp_camera_fb_get();
+  if (!fb) {
+    Serial.println("Camera first frame failed");
+    initError = ESP_FAIL;
+    initPhase = CAMERA_INIT_FAILED;
+    return false;
+  }
+  esp_camera_fb_return(fb);
+  initPhaseMs[CAMERA_INIT_FIRST_FRAME] = millis() - initStartMs;
+
+  initPhaseMs[CAMERA_INIT_READY] = initPhaseMs[CAMERA_INIT_FIRST_FRAME];
+  initPhase = CAMERA_INIT_READY;
+  Serial.printf("Camera ready: driver %lu ms, configure %lu ms, first frame %lu ms\n",
+                (unsigned long)initPhaseMs[CAMERA_INIT_DRIVER],
+                (unsigned long)initPhaseMs[CAMERA_INIT_CONFIGURE],
+                (unsigned long)initPhaseMs[CAMERA_INIT_FIRST_FRAME]);
+  return true;
+}
+
+// JPEG解码器上下文、frame_gray的缩放器和抖动器都是静态的，不可重入；
+// 实时预览任务、流水线拍照任务和主循环都会解码，所有解码/缩放/裁剪/抖动都在这把锁下进行。
+// 在startCameraInit中创建（早于任何取帧的任务）
+static SemaphoreHandle_t decodeLock = NULL;
+
+static inline void lockDecoder() {
+  if (decodeLock) xSemaphoreTake(decodeLock, portMAX_DELAY);
+}
+
+static inline void unlockDecoder() {
+  if (decodeLock) xSemaphoreGive(decodeLock);
+}
+
+static void cameraInitTaskMain(void* arg) {
+  cameraLock();
+  if (cameraUsers() == 0) {
+    runCameraInit(cachedConfig);
+  } else {
+    initError = ESP_ERR_INVALID_STATE;  // 启动任务之后有取帧者登记
+    initPhase = CAMERA_INIT_FAILED;
+  }
+  cameraUnlock();
+  initTask = NULL;
+  vTaskDelete(NULL);
+}
+
+// 启动后台初始化并立即返回；之后在主循环中调用cameraInitPoll()
+bool startCameraInit() {
+  if (initTask != NULL) return true;  // 正在初始化
+  if (!decodeLock) {
+    decodeLock = xSemaphoreCreateMutex();
+    if (!decodeLock) return false;
+  }
+  if (!cameraLockInit()) return false;
+  // 初始化先释放驱动，后台取帧者手里的帧缓冲会被一起释放
+  if (cameraUsers() != 0) {
+    Serial.printf("Camera init refused: %s is running\n", cameraUserName(cameraUsers()));
+    return false;
+  }
+
+  // 使用较小的分辨率以减少数据量，便于API传输；没有PSRAM时进一步降到QVGA
+  Serial.println(psramFound() ? "PSRAM found, using optimized settings" : "PSRAM not found, using basic settings");
+  buildCameraConfig(cachedConfig, PIXFORMAT_JPEG, psramFound() ? FRAMESIZE_VGA : FRAMESIZE_QVGA);
+  statusCached = false;
+  cameraModeReset();
+
+  initPhase = CAMERA_INIT_DRIVER;
+  shownPhase = CAMERA_INIT_IDLE;
+  // 句柄直接写入initTask：FreeRTOS在任务可运行之前就写出句柄，任务结束时清空它不会被这里覆盖
+  if (xTaskCreatePinnedToCore(cameraInitTaskMain, "camera_init", CAMERA_INIT_TASK_STACK,
+                              NULL, 2, &initTask, 1) != pdPASS) {
+    Serial.println("Failed to start camera init task");
+    initTask = NULL;
+    initPhase = CAMERA_INIT_FAILED;
+    return false;
+  }
+  return true;
+}
+
+static void showCameraInitError(esp_err_t err) {
+  switch(err) {
+    case ESP_ERR_INVALID_STATE:
+      Serial.println("错误: 摄像头已被初始化或状态无效");
+      showStaticMessage("摄像头状态错误");
+      break;
+    case ESP_ERR_NOT_FOUND:
+      Serial.println("错误: 找不到摄像头硬件");
+      showStaticMessage("摄像头硬件错误");
+      break;
+    case ESP_ERR_NO_MEM:
+      Serial.println("错误: 内存不足");
+      showStaticMessage("内存不足");
+      break;
+    default:
+      Serial.printf("错误: 未知错误代码 0x%x\n", err);
+      showStaticMessage("摄像头初始化失败");
+      break;
+  }
+}
+
+// 阶段变化时刷新显示；初始化结束（就绪或失败）时返回true
+bool cameraInitPoll() {
+  CameraInitPhase phase = initPhase;
+  if (phase != shownPhase) {
+    shownPhase = phase;
+    if (phase == CAMERA_INIT_READY) {
+      showStaticMessage("初始化成功");
+    } else if (phase == CAMERA_INIT_FAILED) {
+      showCameraInitError(initError);
+    } else {
+      showTwoLineMessage("正在初始化摄像头...", cameraInitPhaseNames[phase]);
+    }
+  }
+  return phase == CAMERA_INIT_READY || phase == CAMERA_INIT_FAILED;
+}
+
+bool cameraReady() {
+  return initPhase == CAMERA_INIT_READY;
+}
+
+// 阻塞版本：启动初始化并等待结束
+void initCamera() {
+  if (!startCameraInit()) {
+    cameraInitPoll();
+    return;
+  }
+  while (!cameraInitPoll()) {
+    delay(10);
+  }
+  Serial.printf("Camera initialization process completed in %lu ms\n",
+                (unsigned long)(millis() - initStartMs));
+}
+
+// 最近一次故障恢复的结果
+struct CameraRecovery {
+  bool driverRebuilt;       // 传感器复位后仍取不到帧，释放并重建了驱动
+  int registerWrites;
+  uint32_t resetMs;         // 复位传感器并写回寄存器
+  uint32_t firstFrameMs;    // 到恢复后第一帧
+};
+
+static CameraRecovery lastRecovery;
+
+// 轻量恢复：通过sensor_t复位传感器、按缓存写回像素格式和寄存器，再等一帧。
+// 驱动、DMA和帧缓冲保持不动，调用时不能有任务持有或正在等待帧
+static bool resetSensorFromCache(sensor_t* s) {
+  uint32_t start = millis();
+  if (s->reset == NULL || s->reset(s) != 0) return false;
+  if (s->set_pixformat(s, cachedConfig.pixel_format) != 0) return false;
+  lastRecovery.registerWrites = writeSensorStatus(s, cachedStatus, true);
+  lastRecovery.resetMs = millis() - start;
+
+  camera_fb_t * fb = esp_camera_fb_get();
+  if (!fb) return false;
+  esp_camera_fb_return(fb);
+  lastRecovery.firstFrameMs = millis() - start;
+  return true;
+}
+
+// 故障后用缓存的驱动配置和传感器状态恢复，不经过后台任务。
+// 只能在没有后台取帧者时调用：它们持有的帧缓冲会被复位打断，重建驱动时会被释放
+bool recoverCamera() {
+  if (!configCached || initTask != NULL) return false;
+  cameraLock();
+  if (cameraUsers() != 0) {
+    cameraUnlock();
+    Serial.printf("Camera recovery refused: %s is running\n", cameraUserName(cameraUsers()));
+    return false;
+  }
+
+  uint32_t start = millis();
+  memset(&lastRecovery, 0, sizeof(lastRecovery));
+  sensor_t * s = esp_camera_sensor_get();
+  bool ok = false;
+  if (s != NULL) {
+    cachedStatus = s->status;  // 保留运行中调整过的分辨率和质量
+    statusCached = true;
+    ok = resetSensorFromCache(s);
+  }
+  if (!ok) {
+    Serial.println("Camera sensor reset did not recover, rebuilding driver");
+    lastRecovery.driverRebuilt = true;
+    ok = runCameraInit(cachedConfig);
+    lastRecovery.firstFrameMs = millis() - start;
+  }
+  cameraUnlock();
+  Serial.printf("Camera recovery %s in %lu ms (%s)\n", ok ? "succeeded" : "failed",
+                (unsigned long)(millis() - start),
+                lastRecovery.driverRebuilt ? "driver rebuilt" : "sensor reset");
+  return ok;
+}
+
+// 启动到第一帧的耗时：冷启动（默认设置）和故障恢复（缓存配置）各测一次。
+// 需要在没有后台取帧者时调用
+void benchmarkCameraBoot() {
+  Serial.println("=== Camera boot benchmark ===");
+  uint32_t start = millis();
+  initCamera();
+  if (!cameraReady()) {
+    Serial.println("Camera boot benchmark: init failed");
+    return;
+  }
+  uint32_t coldMs = millis() - start;
+  uint32_t coldDriverMs = initPhaseMs[CAMERA_INIT_DRIVER];
+
+  start = millis();
+  bool ok = recoverCamera();
+  uint32_t warmMs = millis() - start;
+
+  Serial.printf("Cold init: time-to-first-frame %lu ms (driver %lu ms)\n",
+                (unsigned long)coldMs, (unsigned long)coldDriverMs);
+  if (ok && lastRecovery.driverRebuilt) {
+    Serial.printf("Cached re-init (driver rebuilt): time-to-first-frame %lu ms (driver %lu ms, configure %lu ms)\n",
+                  (unsigned long)warmMs, (unsigned long)initPhaseMs[CAMERA_INIT_DRIVER],
+                  (unsigned long)(initPhaseMs[CAMERA_INIT_CONFIGURE] - initPhaseMs[CAMERA_INIT_DRIVER]));
+  } else if (ok) {
+    Serial.printf("Cached re-init (sensor reset): time-to-first-frame %lu ms (reset + %d register writes %lu ms)\n",
+                  (unsigned long)warmMs, lastRecovery.registerWrites, (unsigned long)lastRecovery.resetMs);
+  }
+}
+
+// 预览像素格式：默认使用JPEG帧并解码，灰度模式下直接取传感器输出的亮度平面
+static bool grayscalePreview = false;
+
+void setGrayscalePreview(bool enabled) {
+  grayscalePreview = enabled;
+}
+
+// 预览单色化使用的抖动算法
+static DitherMode previewDither = DITHER_FLOYD_STEINBERG;
+
+void setPreviewDither(DitherMode mode) {
+  if (mode < DITHER_MODE_COUNT) {
+    previewDither = mode;
+  }
+}
+
+// 以指定像素格式和分辨率重新初始化摄像头（由模式管理在cameraLock()下调用）
+// 摄像头驱动的像素格式只能在初始化时确定，运行时无法通过sensor切换
+bool reinitCameraDriver(pixformat_t format, framesize_t frameSize, camera_grab_mode_t grabMode) {
+  if (cameraUsers() != 0) {
+    Serial.printf("Camera reinit refused: %s is running\n", cameraUserName(cameraUsers()));
+    return false;
+  }
+  esp_camera_deinit();
+
+  camera_config_t config;
+  buildCameraConfig(config, format, frameSize);
+  config.grab_mode = grabMode;
   esp_err_t err = esp_camera_init(&config);
-  delay(2000);  // 延时2秒确保消息显示
-  showTwoLineMessage("正在初始化摄像头...","3");
-  delay(2000);  // 延时2秒确保消息显示
-  showTwoLineMessage("正在初始化摄像头...","4");
-  delay(2000);  // 延时2秒确保消息显示
-  showTwoLineMessage("正在初始化摄像头...","5");
   if (err != ESP_OK) {
-    Serial.printf("Camera init failed with error 0x%x (%s)\n", err, esp_err_to_name(err));
-    
-    // 详细错误信息
-    switch(err) {
-      case ESP_ERR_INVALID_STATE:
-        Serial.println("错误: 摄像头已被初始化或状态无效");
-        showStaticMessage("摄像头状态错误");
-        break;
-      case ESP_ERR_NOT_FOUND:
-        Serial.println("错误: 找不到摄像头硬件");
-        showStaticMessage("摄像头硬件错误");
-        break;
-      case ESP_ERR_NO_MEM:
-        Serial.println("错误: 内存不足");
-        showStaticMessage("内存不足");
-        break;
-      default:
-        Serial.printf("错误: 未知错误代码 0x%x\n", err);
-        showStaticMessage("摄像头初始化失败");
-        break;
-    }
-    
-    // 不要直接返回，继续执行以便调试
-    delay(3000);
-  } else {
-    Serial.println("Camera initialized successfully!");
+    Serial.printf("Camera reinit failed with error 0x%x (%s)\n", err, esp_err_to_name(err));
+    return false;
   }
-  
-  Serial.println("About to show message 3...");
-  showTwoLineMessage("正在初始化摄像头...","3");
-  delay(2000);  // 延时2秒确保消息显示
-  
-  Serial.println("About to get camera sensor...");
-  // 即使初始化失败，也尝试获取传感器（用于调试）
+  cachedConfig = config;
+  configCached = true;
   sensor_t * s = esp_camera_sensor_get();
-  
-  Serial.println("About to show message 4...");
-  showTwoLineMessage("正在初始化摄像头...","4");
-  delay(2000);  // 延时2秒确保消息显示
-  
   if (s != NULL) {
-    Serial.println("Camera sensor found and accessible");
-    // 设置图像参数以获得更好的压缩比
-    s->set_brightness(s, 0);     // -2 to 2
-    s->set_contrast(s, 0);       // -2 to 2
-    s->set_saturation(s, 0);     // -2 to 2
-    s->set_special_effect(s, 0); // 0 to 6 (0 - No Effect, 1 - Negative, 2 - Grayscale, 3 - Red Tint, 4 - Green Tint, 5 - Blue Tint, 6 - Sepia)
-    s->set_whitebal(s, 1);       // 0 = disable , 1 = enable
-    s->set_awb_gain(s, 1);       // 0 = disable , 1 = enable
-    s->set_wb_mode(s, 0);        // 0 to 4 - if awb_gain enabled (0 - Auto, 1 - Sunny, 2 - Cloudy, 3 - Office, 4 - Home)
-    
-    Serial.println("Camera sensor configured for optimal compression");
-    showStaticMessage("初始化成功");
-  } else {
-    Serial.println("Failed to get camera sensor");
-    showStaticMessage("传感器获取失败");
+    applySensorSettings(s);
   }
+  return true;
+}
+
+bool getCameraDriverConfig(camera_config_t* config) {
+  if (!configCached) return false;
+  *config = cachedConfig;
+  return true;
+}
+
+// 切换到预览模式（QQVGA），灰度预览模式下同时切换像素格式
+static bool enterPreviewMode() {
+  return setCameraMode(grayscalePreview ? CAMERA_MODE_PREVIEW_GRAY : CAMERA_MODE_PREVIEW);
+}
 
-  Serial.println("Camera initialization process completed");
+// 主循环拍照前切换模式；后台取帧者运行在其他模式时不能切换，提示后放弃
+static bool enterModeForCapture(CameraMode mode) {
+  if (setCameraMode(mode)) return true;
+  showStaticMessage("摄像头被占用");
+  return false;
 }
 
 void captureImage() {
+  if (!enterModeForCapture(CAMERA_MODE_ANALYZE)) return;
   camera_fb_t * fb = NULL;
   fb = esp_camera_fb_get();
   if(!fb) {
@@ -189,19 +557,168 @@ void captureImage() {
   Serial.printf("Image captured: %zu bytes\n", fb->len);
   showStaticMessage("拍照成功");
 
-  // Convert to base64
-  String base64Image = base64Encode(fb->buf, fb->len);
-  Serial.println("data:image/jpeg;base64," + base64Image);
+  // 边编码边输出到串口，不在内存中保存整段Base64
+  Serial.print("data:image/jpeg;base64,");
+  Base64Stream stream;
+  base64StreamBegin(&stream, writeToSerial, NULL);
+  base64StreamWrite(&stream, fb->buf, fb->len);
+  base64StreamEnd(&stream);
+  Serial.println();
   
   esp_camera_fb_return(fb);
 }
 
+// 自适应画质可用的分辨率级别（从小到大），不超过初始化时的分辨率
+static const framesize_t qualityFrameSizes[] = {FRAMESIZE_QVGA, FRAMESIZE_HVGA, FRAMESIZE_VGA};
+static const char* qualityFrameSizeNames[] = {"QVGA", "HVGA", "VGA"};
+static QualityController qualityController;
+static bool adaptiveQuality = false;
+
+// 开启/关闭自适应画质；需在initCamera()之后调用，当前分辨率即为上限（帧缓冲按它分配）
+void setAdaptiveQuality(bool enabled, uint32_t latencyBudgetMs) {
+  adaptiveQuality = false;
+  if (!enabled || !setCameraMode(CAMERA_MODE_ANALYZE)) return;
+  cameraLock();
+  sensor_t * s = esp_camera_sensor_get();
+  if (s == NULL) {
+    cameraUnlock();
+    return;
+  }
+
+  uint8_t levels = 0;
+  for (uint8_t i = 0; i < sizeof(qualityFrameSizes) / sizeof(qualityFrameSizes[0]); i++) {
+    if (qualityFrameSizes[i] <= s->status.framesize) levels = i + 1;
+  }
+  if (levels == 0) {
+    cameraUnlock();
+    Serial.println("Adaptive quality: frame size too small");
+    return;
+  }
+
+  QualityControllerConfig config;
+  qualityControllerDefaultConfig(&config, latencyBudgetMs, levels);
+  qualityControllerInit(&qualityController, &config, s->status.quality, levels - 1);
+  s->set_framesize(s, qualityFrameSizes[levels - 1]);
+  cameraUnlock();
+  adaptiveQuality = true;
+  Serial.printf("Adaptive quality on: budget %lu ms, up to %s, quality %d\n",
+                (unsigned long)latencyBudgetMs, qualityFrameSizeNames[levels - 1], qualityController.quality);
+}
+
+// 上传完成后调用：用这次请求实测的上行速率（resolveImageJpeg输出的请求体字节数和耗时）更新目标大小，
+// 并为下一帧调整画质和分辨率。请求体没有发出（连接失败等）时sentBytes为0，不更新
+void adaptQualityAfterUpload(size_t frameBytes, size_t sentBytes, uint32_t sentMs) {
+  if (!adaptiveQuality || sentBytes == 0) return;
+
+  qualityControllerReportUpload(&qualityController, sentBytes, sentMs);
+
+  uint8_t oldLevel = qualityController.sizeLevel;
+  if (!qualityControllerUpdate(&qualityController, frameBytes)) return;
+
+  // 上传任务和模式切换都会写传感器，写寄存器时持有驱动锁
+  cameraLock();
+  sensor_t * s = esp_camera_sensor_get();
+  if (s != NULL) {
+    s->set_quality(s, qualityController.quality);
+    if (qualityController.sizeLevel != oldLevel) {
+      s->set_framesize(s, qualityFrameSizes[qualityController.sizeLevel]);
+    }
+  }
+  cameraUnlock();
+  if (s == NULL) return;
+  Serial.printf("Adaptive quality: frame %u bytes, target %lu bytes, uplink %lu B/s -> %s quality %d\n",
+                (unsigned)frameBytes, (unsigned long)qualityController.targetBytes,
+                (unsigned long)qualityController.throughput,
+                qualityFrameSizeNames[qualityController.sizeLevel], qualityController.quality);
+}
+
+// 感兴趣区域，按画面比例（0~1）表示，分辨率被自适应画质切换后仍然有效
+struct AnalysisRegion {
+  float x;
+  float y;
+  float width;
+  float height;
+};
+
+static AnalysisRegion analysisRegion = {0, 0, 1, 1};
+static bool analysisRegionEnabled = false;
+static uint8_t* cropBuffer = NULL;
+static size_t cropCapacity = 0;
+static uint32_t croppedRequests = 0;
+static uint64_t croppedBytesSaved = 0;
+
+static String analyzeFrame(camera_fb_t* fb, const String& question, const AnalysisRegion* region);
+
+// 设置captureAndAnalyze()使用的固定分析区域；区域覆盖整个画面时取消裁剪
+void setAnalysisRegion(float x, float y, float width, float height) {
+  analysisRegion = {x, y, width, height};
+  analysisRegionEnabled = x > 0 || y > 0 || x + width < 1 || y + height < 1;
+  if (analysisRegionEnabled) {
+    Serial.printf("Analysis region: x=%.2f y=%.2f w=%.2f h=%.2f\n", x, y, width, height);
+  } else {
+    Serial.println("Analysis region: full frame");
+  }
+}
+
+static const AnalysisRegion* activeAnalysisRegion() {
+  return analysisRegionEnabled ? &analysisRegion : NULL;
+}
+
+static uint16_t regionToPixels(float fraction, uint16_t size) {
+  if (fraction <= 0) return 0;
+  if (fraction >= 1) return size;
+  return (uint16_t)(fraction * size + 0.5f);
+}
+
+// 在熵编码层面把JPEG帧裁剪到区域（对齐MCU边界），结果放在PSRAM裁剪缓冲区
+static bool cropFrameToRegion(camera_fb_t* fb, const AnalysisRegion& region,
+                              const uint8_t** cropData, size_t* cropLen) {
+  if (fb->format != PIXFORMAT_JPEG) return false;
+
+  size_t need = fb->len + 1024;
+  if (need > cropCapacity) {
+    free(cropBuffer);
+    cropBuffer = (uint8_t*)(psramFound() ? ps_malloc(need) : malloc(need));
+    cropCapacity = cropBuffer ? need : 0;
+    if (!cropBuffer) {
+      Serial.println("Crop buffer allocation failed");
+      return false;
+    }
+  }
+
+  JpegRect rect;
+  rect.x = regionToPixels(region.x, fb->width);
+  rect.y = regionToPixels(region.y, fb->height);
+  rect.width = regionToPixels(region.width, fb->width);
+  rect.height = regionToPixels(region.height, fb->height);
+
+  uint32_t start = micros();
+  lockDecoder();
+  bool ok = jpegCropMcu(fb->buf, fb->len, &rect, cropBuffer, cropCapacity, cropLen);
+  unlockDecoder();
+  if (!ok) {
+    Serial.println("JPEG crop failed, uploading full frame");
+    return false;
+  }
+  *cropData = cropBuffer;
+
+  croppedRequests++;
+  if (*cropLen < fb->len) croppedBytesSaved += fb->len - *cropLen;
+  Serial.printf("ROI %u,%u %ux%u of %ux%u: %u -> %u bytes (saved %d%%, %lu us), "
+                "%lu bytes saved over %lu requests\n",
+                rect.x, rect.y, rect.width, rect.height, (unsigned)fb->width, (unsigned)fb->height,
+                (unsigned)fb->len, (unsigned)*cropLen,
+                (int)(100 - (uint64_t)*cropLen * 100 / fb->len), (unsigned long)(micros() - start),
+                (unsigned long)croppedBytesSaved, (unsigned long)croppedRequests);
+  return true;
+}
+
 // 拍照并分析图像
 String captureAndAnalyze(const String& question) {
   showStaticMessage("开始拍照...");
+  if (!enterModeForCapture(CAMERA_MODE_ANALYZE)) return "错误：摄像头被占用";
   
-  camera_fb_t * fb = NULL;
-  fb = esp_camera_fb_get();
+  camera_fb_t * fb = esp_camera_fb_get();
   if(!fb) {
     Serial.println("Camera capture failed");
     showStaticMessage("拍照失败");
@@ -211,73 +728,233 @@ String captureAndAnalyze(const String& question) {
   Serial.printf("Image captured: %zu bytes\n", fb->len);
   showStaticMessage("图像分析中...");
 
-  // Convert to base64
-  String base64Image = base64Encode(fb->buf, fb->len);
+  // 调用AI分析（先查缓存）：直接从帧缓冲区边编码边上传，发送完成后才释放
+  String result = analyzeFrame(fb, question, activeAnalysisRegion());
   
   // 释放摄像头缓冲区
   esp_camera_fb_return(fb);
   
-  // 调用AI分析
-  String result = resolveImage(base64Image, question);
-  
   return result;
 }
 
-// 简单的JPEG到灰度转换（近似）
-bool simpleJpegToGrayscale(const uint8_t* jpegData, size_t jpegSize, 
-                          uint8_t* grayBuffer, uint16_t targetWidth, uint16_t targetHeight) {
-  // 这是一个简化的方法，实际上我们跳过JPEG解码，
-  // 而是使用摄像头原始的RGB565格式
-  // 对于实际应用，你可能需要使用专门的JPEG解码库
-  
-  // 为了简化，我们生成一个测试模式
-  for (int y = 0; y < targetHeight; y++) {
-    for (int x = 0; x < targetWidth; x++) {
-      // 创建一个简单的测试模式
-      uint8_t value = ((x + y) % 2) ? 255 : 0;
-      grayBuffer[y * targetWidth + x] = value;
-    }
+// 拍照，只上传画面中的一个区域（按比例0~1给出，向外对齐到JPEG的MCU边界）
+String captureAndAnalyzeRegion(const String& question, float x, float y, float width, float height) {
+  showStaticMessage("开始拍照...");
+  if (!enterModeForCapture(CAMERA_MODE_ANALYZE)) return "错误：摄像头被占用";
+
+  camera_fb_t * fb = esp_camera_fb_get();
+  if(!fb) {
+    Serial.println("Camera capture failed");
+    showStaticMessage("拍照失败");
+    return "拍照失败";
   }
+
+  showStaticMessage("图像分析中...");
+  AnalysisRegion region = {x, y, width, height};
+  String result = analyzeFrame(fb, question, &region);
+  esp_camera_fb_return(fb);
+  return result;
+}
+
+// 提取亮度缩略图（JPEG只解码DC系数，灰度/YUV直接取亮度）
+static bool frameToThumbnail(camera_fb_t* fb, uint8_t* thumb, uint16_t width, uint16_t height) {
+  lockDecoder();
+  bool ok = frameToGrayscale(fb, thumb, width, height, width);
+  unlockDecoder();
+  return ok;
+}
+
+static bool frameToSceneThumb(camera_fb_t* fb, uint8_t* thumb) {
+  return frameToThumbnail(fb, thumb, SCENE_THUMB_WIDTH, SCENE_THUMB_HEIGHT);
+}
+
+// 计算帧的感知哈希（9x8亮度缩略图的dHash），用作回答缓存的键
+bool frameAnswerHash(camera_fb_t* fb, uint64_t* hash) {
+  uint8_t thumb[ANSWER_HASH_WIDTH * ANSWER_HASH_HEIGHT];
+  if (!frameToThumbnail(fb, thumb, ANSWER_HASH_WIDTH, ANSWER_HASH_HEIGHT)) return false;
+  *hash = answerCacheHashThumb(thumb);
   return true;
 }
 
-// 缩放灰度图像
-void scaleGrayscaleImage(const uint8_t* srcImage, uint16_t srcWidth, uint16_t srcHeight,
-                        uint8_t* dstImage, uint16_t dstWidth, uint16_t dstHeight) {
-  for (int y = 0; y < dstHeight; y++) {
-    for (int x = 0; x < dstWidth; x++) {
-      // 简单的最近邻插值
-      int srcX = (x * srcWidth) / dstWidth;
-      int srcY = (y * srcHeight) / dstHeight;
-      
-      if (srcX >= srcWidth) srcX = srcWidth - 1;
-      if (srcY >= srcHeight) srcY = srcHeight - 1;
-      
-      dstImage[y * dstWidth + x] = srcImage[srcY * srcWidth + srcX];
+static bool jpegAnswerHash(const uint8_t* jpegData, size_t jpegSize, uint64_t* hash) {
+  uint8_t thumb[ANSWER_HASH_WIDTH * ANSWER_HASH_HEIGHT];
+  lockDecoder();
+  bool ok = jpegToGrayscale(jpegData, jpegSize, thumb, ANSWER_HASH_WIDTH, ANSWER_HASH_HEIGHT,
+                            ANSWER_HASH_WIDTH);
+  unlockDecoder();
+  if (!ok) return false;
+  *hash = answerCacheHashThumb(thumb);
+  return true;
+}
+
+// 分析一帧：先查回答缓存，未命中再上传，成功的回答写入缓存。帧缓冲区由调用者归还
+// region不为NULL时只上传裁剪后的区域，缓存键也按区域计算
+static String analyzeFrame(camera_fb_t* fb, const String& question, const AnalysisRegion* region) {
+  const uint8_t* image = fb->buf;
+  size_t imageLen = fb->len;
+  bool cropped = region != NULL && cropFrameToRegion(fb, *region, &image, &imageLen);
+
+  uint64_t imageHash = 0;
+  bool hashed = answerCacheEnabled() &&
+                (cropped ? jpegAnswerHash(image, imageLen, &imageHash) : frameAnswerHash(fb, &imageHash));
+  if (hashed) {
+    char cached[ANSWER_CACHE_TEXT_MAX];
+    uint8_t distance = 0;
+    if (answerCacheLookup(imageHash, question.c_str(), cached, sizeof(cached), &distance)) {
+      Serial.printf("缓存命中(汉明距离 %d): %s\n", distance, cached);
+      showStaticMessage(cached);
+      return String(cached);
     }
   }
+
+  size_t sentBytes = 0;
+  uint32_t sentMs = 0;
+  String result = resolveImageJpeg(image, imageLen, question, true, &sentBytes, &sentMs);
+  adaptQualityAfterUpload(imageLen, sentBytes, sentMs);
+  if (hashed && !result.startsWith("错误")) {
+    answerCacheStore(imageHash, question.c_str(), result.c_str());
+  }
+  return result;
+}
+
+// 分析后台录帧中offsetMs之前的画面（事件触发时使用），不再拍照
+String analyzeRecordedFrame(const String& question, uint32_t offsetMs) {
+  FrameRef frame;
+  if (!frameRecorderAcquireAt(offsetMs, &frame)) {
+    Serial.println("No recorded frame available");
+    return "错误: 没有录制的画面";
+  }
+  Serial.printf("Recorded frame #%lu: %u bytes, captured %lu ms ago\n",
+                (unsigned long)frame.sequence, (unsigned)frame.length,
+                (unsigned long)(millis() - frame.timestampMs));
+
+  // 帧在上传期间保持固定，录帧任务不会覆盖它
+  String result = resolveImageJpeg(frame.data, frame.length, question, true);
+  frameRecorderRelease(&frame);
+  return result;
+}
+
+// 判断帧相对上次放行时场景是否变化；缩略图提取失败时按变化处理
+bool frameSceneChanged(camera_fb_t* fb, SceneGate* gate) {
+  uint8_t thumb[SCENE_THUMB_WIDTH * SCENE_THUMB_HEIGHT];
+  if (!frameToSceneThumb(fb, thumb)) {
+    Serial.println("Scene thumbnail failed, treating frame as changed");
+    return true;
+  }
+  return sceneGateUpdate(gate, thumb, millis());
+}
+
+// 拍照，场景有变化时才分析；未变化时返回空字符串
+String captureAndAnalyzeOnChange(const String& question, SceneGate* gate) {
+  if (!enterModeForCapture(CAMERA_MODE_ANALYZE)) return "错误：摄像头被占用";
+  camera_fb_t * fb = esp_camera_fb_get();
+  if(!fb) {
+    Serial.println("Camera capture failed");
+    showStaticMessage("拍照失败");
+    return "拍照失败";
+  }
+
+  uint32_t start = micros();
+  bool changed = frameSceneChanged(fb, gate);
+  Serial.printf("Scene check: %d%% blocks changed, %lu us\n", gate->lastScore,
+                (unsigned long)(micros() - start));
+  if (!changed) {
+    esp_camera_fb_return(fb);
+    Serial.println("场景未变化，跳过分析");
+    return "";
+  }
+
+  showStaticMessage("图像分析中...");
+  String result = analyzeFrame(fb, question, activeAnalysisRegion());
+  esp_camera_fb_return(fb);
+  return result;
 }
 
 // 将灰度图像转换为单色位图
 void grayscaleToMono(const uint8_t* grayImage, uint8_t* monoImage, 
                     uint16_t width, uint16_t height, uint8_t threshold = 128) {
-  int byteWidth = (width + 7) / 8;  // 每行需要的字节数
-  
-  for (int y = 0; y < height; y++) {
-    for (int x = 0; x < width; x++) {
-      uint8_t grayValue = grayImage[y * width + x];
-      bool isWhite = grayValue > threshold;
-      
-      int byteIndex = y * byteWidth + x / 8;
-      int bitIndex = 7 - (x % 8);
-      
-      if (isWhite) {
-        monoImage[byteIndex] |= (1 << bitIndex);
-      } else {
-        monoImage[byteIndex] &= ~(1 << bitIndex);
-      }
-    }
+  lockDecoder();
+  ditherImage(DITHER_THRESHOLD, grayImage, monoImage, width, height, threshold);
+  unlockDecoder();
+}
+
+// 预览图在128x32屏幕上的位置（保持宽高比居中）
+struct PreviewLayout {
+  uint16_t width;
+  uint16_t height;
+  uint16_t offsetX;
+  uint16_t offsetY;
+};
+
+static PreviewLayout computePreviewLayout(uint16_t srcWidth, uint16_t srcHeight,
+                                          uint16_t maxWidth, uint16_t maxHeight) {
+  PreviewLayout layout = {maxWidth, maxHeight, 0, 0};
+  float aspectRatio = (float)srcWidth / (float)srcHeight;
+
+  if (aspectRatio > (float)maxWidth / maxHeight) {
+    // 图像较宽，以宽度为限制
+    layout.height = (uint16_t)(maxWidth / aspectRatio);
+    layout.offsetY = (maxHeight - layout.height) / 2;
+  } else {
+    // 图像较高，以高度为限制
+    layout.width = (uint16_t)(maxHeight * aspectRatio);
+    layout.offsetX = (maxWidth - layout.width) / 2;
+  }
+  return layout;
+}
+
+// 将一帧图像缩放后抖动到XBM显示缓冲区，阈值中点取图像区域平均亮度
+// JPEG帧流式解码，灰度/YUV422帧直接对亮度平面做区域平均
+static bool frameToPreviewMono(camera_fb_t* fb, const PreviewLayout& layout,
+                               uint8_t* grayBuffer, uint8_t* monoBuffer,
+                               uint16_t displayWidth, uint16_t displayHeight,
+                               LumaStats* stats) {
+  // 边框区域保持为0（黑色）
+  memset(grayBuffer, 0, displayWidth * displayHeight);
+  uint8_t* region = grayBuffer + layout.offsetY * displayWidth + layout.offsetX;
+
+  lockDecoder();
+  if (!frameToGrayscale(fb, region, layout.width, layout.height, displayWidth)) {
+    unlockDecoder();
+    Serial.printf("Preview conversion failed (pixel format %d)\n", fb->format);
+    return false;
   }
+
+  // 阈值按画面内容的亮度分布确定（不含边框）：单一阈值用Otsu，抖动用p5/p95中点
+  lumaStatsCompute(stats, region, layout.width, layout.height, displayWidth, 1);
+  uint8_t threshold = previewDither == DITHER_THRESHOLD ? lumaOtsuThreshold(stats) : lumaDitherThreshold(stats);
+
+  bool ok = ditherImage(previewDither, grayBuffer, monoBuffer, displayWidth, displayHeight, threshold);
+  unlockDecoder();
+  return ok;
+}
+
+// 预览时根据亮度统计调整传感器曝光补偿（ae_level，-2~2），在传感器自动曝光的基础上偏移
+#define AUTO_EXPOSURE_TARGET       118
+#define AUTO_EXPOSURE_TOLERANCE    24
+#define AUTO_EXPOSURE_INTERVAL_MS  500
+
+static bool previewAutoExposure = true;
+static uint32_t lastExposureChangeMs = 0;
+
+void setPreviewAutoExposure(bool enabled) {
+  previewAutoExposure = enabled;
+}
+
+static void adjustExposure(const LumaStats& stats) {
+  if (!previewAutoExposure || millis() - lastExposureChangeMs < AUTO_EXPOSURE_INTERVAL_MS) return;
+  int8_t step = lumaExposureStep(&stats, AUTO_EXPOSURE_TARGET, AUTO_EXPOSURE_TOLERANCE);
+  if (step == 0) return;
+  cameraLock();
+  sensor_t * s = esp_camera_sensor_get();
+  int level = s != NULL ? s->status.ae_level + step : 0;
+  bool changed = s != NULL && level >= -2 && level <= 2;
+  if (changed) s->set_ae_level(s, level);
+  cameraUnlock();
+  if (!changed) return;
+  lastExposureChangeMs = millis();
+  Serial.printf("Auto exposure: mean %d, clipped %d%%/%d%% -> ae_level %d\n",
+                stats.mean, stats.clippedLowPercent, stats.clippedHighPercent, level);
 }
 
 // 拍照并显示到OLED屏幕
@@ -285,11 +962,10 @@ void captureAndDisplayOnOled() {
   showTwoLineMessage("准备拍照显示...", "请稍等");
   delay(1000);
   
-  // 先切换到较小分辨率以便处理
-  sensor_t * s = esp_camera_sensor_get();
-  if (s != NULL) {
-    s->set_framesize(s, FRAMESIZE_QQVGA);  // 160x120
-    delay(300);  // 给传感器时间调整
+  // 切换到预览模式（已是预览模式时不做任何操作），分析时再切回
+  if (!enterPreviewMode()) {
+    showStaticMessage("摄像头被占用");
+    return;
   }
   
   showTwoLineMessage("正在拍照...", "");
@@ -309,113 +985,59 @@ void captureAndDisplayOnOled() {
   const uint16_t maxDisplayHeight = 32;
   
   // 计算保持宽高比的缩放尺寸
-  float aspectRatio = (float)fb->width / (float)fb->height;
-  uint16_t scaledWidth, scaledHeight;
-  uint16_t offsetX = 0, offsetY = 0;
-  
-  if (aspectRatio > (float)maxDisplayWidth / maxDisplayHeight) {
-    // 图像较宽，以宽度为限制
-    scaledWidth = maxDisplayWidth;
-    scaledHeight = (uint16_t)(maxDisplayWidth / aspectRatio);
-    offsetY = (maxDisplayHeight - scaledHeight) / 2;
-  } else {
-    // 图像较高，以高度为限制
-    scaledHeight = maxDisplayHeight;
-    scaledWidth = (uint16_t)(maxDisplayHeight * aspectRatio);
-    offsetX = (maxDisplayWidth - scaledWidth) / 2;
-  }
+  PreviewLayout layout = computePreviewLayout(fb->width, fb->height, maxDisplayWidth, maxDisplayHeight);
+  uint16_t scaledWidth = layout.width;
+  uint16_t scaledHeight = layout.height;
+  uint16_t offsetX = layout.offsetX;
+  uint16_t offsetY = layout.offsetY;
   
   Serial.printf("Scaled to: %dx%d, offset: (%d,%d)\n", scaledWidth, scaledHeight, offsetX, offsetY);
   
   // 分配显示缓冲区 (总是128x32)
   uint8_t* displayBuffer = (uint8_t*)malloc(maxDisplayWidth * maxDisplayHeight / 8);
-  if (!displayBuffer) {
+  uint8_t* grayBuffer = (uint8_t*)malloc(maxDisplayWidth * maxDisplayHeight);
+  if (!displayBuffer || !grayBuffer) {
     Serial.println("Failed to allocate display buffer");
+    free(displayBuffer);
+    free(grayBuffer);
     esp_camera_fb_return(fb);
     showStaticMessage("内存不足");
     return;
   }
   
-  // 清空缓冲区
-  memset(displayBuffer, 0, maxDisplayWidth * maxDisplayHeight / 8);
-  
-  // 改进的图像处理算法
-  // 由于JPEG解码复杂，我们使用一种简化但更有效的方法
-  // 对JPEG数据进行统计分析来生成近似的图像
-  
   showTwoLineMessage("转换图像格式...", "");
   
-  // 分析JPEG数据的亮度分布
-  uint32_t brightnessSum = 0;
-  uint32_t sampleCount = 0;
+  // 解码（JPEG）或直接取亮度平面，区域平均缩放到目标尺寸
+  LumaStats stats;
+  uint32_t decodeStart = micros();
+  bool converted = frameToPreviewMono(fb, layout, grayBuffer, displayBuffer,
+                                      maxDisplayWidth, maxDisplayHeight, &stats);
+  uint32_t decodeTime = micros() - decodeStart;
   
-  // 对JPEG数据进行采样以估算亮度
-  for (size_t i = 0; i < fb->len; i += 10) {
-    brightnessSum += fb->buf[i];
-    sampleCount++;
-  }
-  
-  uint8_t avgBrightness = brightnessSum / sampleCount;
-  Serial.printf("Average brightness: %d\n", avgBrightness);
-  
-  // 创建基于真实数据的简化图像，保持宽高比
-  for (int y = 0; y < scaledHeight; y++) {
-    for (int x = 0; x < scaledWidth; x++) {
-      // 从JPEG数据中智能采样
-      size_t sampleIndex1 = ((y * fb->height / scaledHeight) * 
-                             (fb->width / scaledWidth) + 
-                             (x * fb->width / scaledWidth)) % fb->len;
-      size_t sampleIndex2 = (sampleIndex1 + 1) % fb->len;
-      size_t sampleIndex3 = (sampleIndex1 + 2) % fb->len;
-      
-      // 取多个样本的平均值以获得更好的效果
-      uint16_t sampleValue = (fb->buf[sampleIndex1] + 
-                             fb->buf[sampleIndex2] + 
-                             fb->buf[sampleIndex3]) / 3;
-      
-      // 自适应阈值，基于局部和全局亮度
-      uint8_t localThreshold = (avgBrightness + sampleValue) / 2;
-      bool isWhite = sampleValue > localThreshold;
-      
-      // 添加一些对比度增强
-      if (abs((int)sampleValue - (int)avgBrightness) < 20) {
-        // 对于接近平均亮度的像素，增加随机性以显示细节
-        isWhite = (sampleValue + (x + y) % 30) > localThreshold;
-      }
-      
-      // 计算在显示缓冲区中的实际位置（加上偏移量）
-      int actualX = x + offsetX;
-      int actualY = y + offsetY;
-      
-      int byteIndex = actualY * (maxDisplayWidth / 8) + actualX / 8;
-      int bitIndex = 7 - (actualX % 8);
-      
-      if (isWhite) {
-        displayBuffer[byteIndex] |= (1 << bitIndex);
-      }
-    }
+  if (!converted) {
+    free(displayBuffer);
+    free(grayBuffer);
+    esp_camera_fb_return(fb);
+    showStaticMessage("图像解码失败");
+    return;
   }
+  Serial.printf("Decode + scale: %lu us, brightness mean %d, p5 %d, median %d, p95 %d, contrast %d\n",
+                (unsigned long)decodeTime, stats.mean, stats.p5, stats.median, stats.p95, stats.contrast);
+  adjustExposure(stats);
   
   showTwoLineMessage("正在显示...", "");
   
-  // 显示到OLED
-  u8g2.clearBuffer();
-  u8g2.drawXBM(0, 0, maxDisplayWidth, maxDisplayHeight, displayBuffer);
-  u8g2.sendBuffer();
+  // 显示到OLED：直接写入页缓冲区
+  showMonoImage(displayBuffer, maxDisplayWidth, maxDisplayHeight);
   
   Serial.printf("Image displayed: %dx%d -> %dx%d (ratio preserved), offset: (%d,%d)\n", 
                 fb->width, fb->height, scaledWidth, scaledHeight, offsetX, offsetY);
   
   // 清理资源
   free(displayBuffer);
+  free(grayBuffer);
   esp_camera_fb_return(fb);
   
-  // 恢复原来的分辨率
-  if (s != NULL) {
-    s->set_framesize(s, FRAMESIZE_VGA);
-    delay(100);
-  }
-  
   // 显示完成消息，但先让用户看到图像
   delay(3000);  // 让用户看到图像
   String sizeInfo = String(scaledWidth) + "x" + String(scaledHeight);
@@ -423,94 +1045,581 @@ void captureAndDisplayOnOled() {
   delay(2000);
 }
 
-// 新增：连续拍照显示功能
+// ===================
+// OLED实时预览
+// ===================
+// 拍照任务（核心0）按目标帧率取帧放入深度为1的队列，队列里有未显示的旧帧时直接替换；
+// 显示任务（核心1）转换第N帧并通过I2C发送时，拍照任务已在取第N+1帧。
+// 显示缓冲区常驻，每帧不分配内存。显示任务写页缓冲区和发送都在屏幕锁下进行，
+// 预览期间其他写屏（流水线和异步请求的回调、主循环的提示）不会与它交错，只是会被下一帧覆盖。
+
+#define LIVE_VIEW_WIDTH          128
+#define LIVE_VIEW_HEIGHT         32
+#define LIVE_VIEW_CAPTURE_STACK  3072
+#define LIVE_VIEW_DISPLAY_STACK  6144
+#define LIVE_VIEW_REPORT_MS      2000
+
+struct LiveViewStage {
+  uint32_t totalUs;
+  uint32_t maxUs;
+};
+
+struct LiveViewStats {
+  LiveViewStage capture;
+  LiveViewStage convert;      // 解码、缩放、抖动
+  LiveViewStage pack;         // 写入显示页缓冲区
+  LiveViewStage transfer;     // I2C发送
+  uint32_t captured;
+  uint32_t displayed;
+  uint32_t dropped;           // 未来得及显示就被新帧替换
+  uint32_t failures;
+};
+
+static QueueHandle_t liveViewQueue = NULL;
+// 句柄由xTaskCreatePinnedToCore直接写入，任务退出前自己清空
+static TaskHandle_t liveViewCaptureTask = NULL;
+static TaskHandle_t liveViewDisplayTask = NULL;
+static volatile bool liveViewRunning = false;
+static uint32_t liveViewPeriodMs = 100;
+static uint8_t liveViewTargetFps = 10;
+static LiveViewStats liveViewStats;
+static uint32_t liveViewStartMs = 0;
+static uint8_t liveViewGray[LIVE_VIEW_WIDTH * LIVE_VIEW_HEIGHT];
+static uint8_t liveViewMono[LIVE_VIEW_WIDTH * LIVE_VIEW_HEIGHT / 8];
+
+void stopLiveView();
+
+static inline void recordLiveStage(LiveViewStage* stage, uint32_t us) {
+  stage->totalUs += us;
+  if (us > stage->maxUs) stage->maxUs = us;
+}
+
+static void liveViewCaptureMain(void* param) {
+  TickType_t lastWake = xTaskGetTickCount();
+  while (liveViewRunning) {
+    uint32_t start = micros();
+    camera_fb_t * fb = esp_camera_fb_get();
+    if (!fb) {
+      liveViewStats.failures++;
+    } else {
+      recordLiveStage(&liveViewStats.capture, micros() - start);
+      liveViewStats.captured++;
+      // 显示跟不上时用新帧替换队列里的旧帧，屏幕上总是最新画面
+      camera_fb_t * old = NULL;
+      if (xQueueReceive(liveViewQueue, &old, 0) == pdTRUE) {
+        esp_camera_fb_return(old);
+        liveViewStats.dropped++;
+      }
+      xQueueSend(liveViewQueue, &fb, 0);
+    }
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(liveViewPeriodMs));
+  }
+  liveViewCaptureTask = NULL;
+  vTaskDelete(NULL);
+}
+
+static void liveViewDisplayMain(void* param) {
+  uint32_t lastReport = millis();
+  LiveViewStats reported = {};
+  while (liveViewRunning) {
+    camera_fb_t * fb = NULL;
+    if (xQueueReceive(liveViewQueue, &fb, pdMS_TO_TICKS(100)) != pdTRUE) continue;
+
+    uint32_t t0 = micros();
+    PreviewLayout layout = computePreviewLayout(fb->width, fb->height,
+                                                LIVE_VIEW_WIDTH, LIVE_VIEW_HEIGHT);
+    LumaStats stats;
+    bool ok = frameToPreviewMono(fb, layout, liveViewGray, liveViewMono,
+                                 LIVE_VIEW_WIDTH, LIVE_VIEW_HEIGHT, &stats);
+    // 转换完立即归还，驱动可以继续往这个缓冲区采集
+    esp_camera_fb_return(fb);
+    uint32_t t1 = micros();
+    if (!ok) {
+      liveViewStats.failures++;
+      continue;
+    }
+    lockScreen();
+    packMonoImage(liveViewMono, LIVE_VIEW_WIDTH, LIVE_VIEW_HEIGHT);
+    uint32_t t2 = micros();
+    sendDisplayBuffer();
+    unlockScreen();
+    uint32_t t3 = micros();
+    adjustExposure(stats);
+
+    recordLiveStage(&liveViewStats.convert, t1 - t0);
+    recordLiveStage(&liveViewStats.pack, t2 - t1);
+    recordLiveStage(&liveViewStats.transfer, t3 - t2);
+    liveViewStats.displayed++;
+
+    uint32_t now = millis();
+    if (now - lastReport >= LIVE_VIEW_REPORT_MS) {
+      uint32_t frames = liveViewStats.displayed - reported.displayed;
+      uint32_t captured = liveViewStats.captured - reported.captured;
+      Serial.printf("Live view: %.1f fps (target %d), capture %lu us, convert %lu us, "
+                    "pack %lu us, transfer %lu us\n",
+                    frames * 1000.0f / (now - lastReport), liveViewTargetFps,
+                    (unsigned long)(captured ? (liveViewStats.capture.totalUs - reported.capture.totalUs) / captured : 0),
+                    (unsigned long)((liveViewStats.convert.totalUs - reported.convert.totalUs) / frames),
+                    (unsigned long)((liveViewStats.pack.totalUs - reported.pack.totalUs) / frames),
+                    (unsigned long)((liveViewStats.transfer.totalUs - reported.transfer.totalUs) / frames));
+      reported = liveViewStats;
+      lastReport = now;
+    }
+  }
+  liveViewDisplayTask = NULL;
+  vTaskDelete(NULL);
+}
+
+// 启动实时预览，一直运行到stopLiveView()
+bool startLiveView(uint8_t targetFps) {
+  if (liveViewRunning || liveViewCaptureTask || liveViewDisplayTask) {
+    Serial.println("Live view already running");
+    return false;
+  }
+  if (targetFps == 0) targetFps = 1;
+  if (!liveViewQueue) {
+    liveViewQueue = xQueueCreate(1, sizeof(camera_fb_t*));
+    if (!liveViewQueue) return false;
+  }
+
+  // 流水线或录帧运行时拒绝启动（帧缓冲只有两个）；检查、切换到预览模式和登记
+  // 在同一次加锁中完成，中间不会被其他取帧者或模式切换插入
+  cameraLock();
+  uint8_t busy = cameraUsers();
+  bool claimed = busy == 0 && enterPreviewMode() && cameraUserBegin(CAMERA_USER_LIVE_VIEW);
+  cameraUnlock();
+  if (!claimed) {
+    Serial.printf("Live view: camera busy (%s)\n", busy ? cameraUserName(busy) : "mode switch failed");
+    return false;
+  }
+  memset(&liveViewStats, 0, sizeof(liveViewStats));
+  liveViewTargetFps = targetFps;
+  liveViewPeriodMs = 1000 / targetFps;
+  liveViewStartMs = millis();
+  liveViewRunning = true;
+
+  bool ok = xTaskCreatePinnedToCore(liveViewDisplayMain, "live_display", LIVE_VIEW_DISPLAY_STACK,
+                                    NULL, 3, &liveViewDisplayTask, 1) == pdPASS;
+  if (!ok) liveViewDisplayTask = NULL;
+  ok = ok && xTaskCreatePinnedToCore(liveViewCaptureMain, "live_capture", LIVE_VIEW_CAPTURE_STACK,
+                                     NULL, 4, &liveViewCaptureTask, 0) == pdPASS;
+  if (!ok) liveViewCaptureTask = NULL;
+  if (!ok) {
+    Serial.println("Live view: failed to start tasks");
+    stopLiveView();
+    return false;
+  }
+  Serial.printf("Live view started at %d fps target\n", targetFps);
+  return true;
+}
+
+void printLiveViewStats() {
+  LiveViewStats stats = liveViewStats;
+  uint32_t elapsed = millis() - liveViewStartMs;
+  uint32_t frames = stats.displayed ? stats.displayed : 1;
+  uint32_t captured = stats.captured ? stats.captured : 1;
+  Serial.printf("Live view: %lu frames displayed in %lu ms (%.1f fps, target %d), %lu dropped, %lu failures\n",
+                (unsigned long)stats.displayed, (unsigned long)elapsed,
+                elapsed ? stats.displayed * 1000.0f / elapsed : 0.0f, liveViewTargetFps,
+                (unsigned long)stats.dropped, (unsigned long)stats.failures);
+  Serial.printf("  avg/max us: capture %lu/%lu, convert %lu/%lu, pack %lu/%lu, transfer %lu/%lu\n",
+                (unsigned long)(stats.capture.totalUs / captured), (unsigned long)stats.capture.maxUs,
+                (unsigned long)(stats.convert.totalUs / frames), (unsigned long)stats.convert.maxUs,
+                (unsigned long)(stats.pack.totalUs / frames), (unsigned long)stats.pack.maxUs,
+                (unsigned long)(stats.transfer.totalUs / frames), (unsigned long)stats.transfer.maxUs);
+}
+
+void stopLiveView() {
+  liveViewRunning = false;
+  uint32_t start = millis();
+  while ((liveViewCaptureTask || liveViewDisplayTask) && millis() - start < 2000) {
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+  if (liveViewCaptureTask || liveViewDisplayTask) {
+    Serial.println("Live view: tasks did not exit in time");
+    return;
+  }
+  camera_fb_t * fb = NULL;
+  while (liveViewQueue && xQueueReceive(liveViewQueue, &fb, 0) == pdTRUE) {
+    esp_camera_fb_return(fb);
+  }
+  cameraUserEnd(CAMERA_USER_LIVE_VIEW);
+  printLiveViewStats();
+}
+
+// 连续拍照显示：以10fps实时预览5秒
 void continuousCaptureDisplay() {
   showTwoLineMessage("连续拍照模式", "开始中...");
   delay(1500);
-  
-  // 设置为较小分辨率以提高处理速度
-  sensor_t * s = esp_camera_sensor_get();
-  if (s != NULL) {
-    s->set_framesize(s, FRAMESIZE_QQVGA);  // 160x120
-    delay(200);
+
+  if (!startLiveView(10)) {
+    showStaticMessage("预览启动失败");
+    return;
   }
-  
-  for (int i = 0; i < 5; i++) {  // 连续拍摄5张照片
-    String countMsg = "拍照 " + String(i + 1) + "/5";
-    showTwoLineMessage(countMsg.c_str(), "");
-    
-    camera_fb_t * fb = esp_camera_fb_get();
-    if(!fb) {
-      Serial.println("Camera capture failed");
-      showStaticMessage("拍照失败");
-      continue;
+  delay(5000);
+  stopLiveView();
+
+  showTwoLineMessage("连续拍照完成", "实时预览5秒");
+  delay(2000);
+}
+
+// JPEG预览解码性能测试：分别在QQVGA和VGA下测量两种缩放比例的解码耗时
+void benchmarkJpegDecode(int frames) {
+  Serial.println("=== JPEG Decode Benchmark ===");
+  const CameraMode modes[] = {CAMERA_MODE_PREVIEW, CAMERA_MODE_ANALYZE};
+  const char* names[] = {"QQVGA", "VGA"};
+  static uint8_t grayBuffer[128 * 32];
+
+  for (int i = 0; i < 2; i++) {
+    if (!setCameraMode(modes[i])) continue;
+    uint32_t dcTotal = 0, fullTotal = 0, previewTotal = 0;
+    size_t bytesTotal = 0;
+    int decoded = 0;
+    for (int n = 0; n < frames; n++) {
+      camera_fb_t * fb = esp_camera_fb_get();
+      if (!fb) continue;
+      if (fb->format == PIXFORMAT_JPEG) {
+        lockDecoder();
+        uint32_t t0 = micros();
+        bool ok = jpegDecodeLuma(fb->buf, fb->len, JPEG_SCALE_1_8,
+                                 [](const uint8_t*, uint16_t, uint16_t, void*) {}, NULL);
+        uint32_t t1 = micros();
+        ok = ok && jpegDecodeLuma(fb->buf, fb->len, JPEG_SCALE_1_1,
+                                  [](const uint8_t*, uint16_t, uint16_t, void*) {}, NULL);
+        uint32_t t2 = micros();
+        PreviewLayout layout = computePreviewLayout(fb->width, fb->height, 128, 32);
+        ok = ok && jpegToGrayscale(fb->buf, fb->len, grayBuffer, layout.width, layout.height, layout.width);
+        uint32_t t3 = micros();
+        unlockDecoder();
+        if (ok) {
+          dcTotal += t1 - t0;
+          fullTotal += t2 - t1;
+          previewTotal += t3 - t2;
+          bytesTotal += fb->len;
+          decoded++;
+        }
+      }
+      esp_camera_fb_return(fb);
     }
-    
-    // 快速显示处理，保持宽高比
-    const uint16_t maxDisplayWidth = 128;
-    const uint16_t maxDisplayHeight = 32;
-    
-    // 计算保持宽高比的缩放尺寸
-    float aspectRatio = (float)fb->width / (float)fb->height;
-    uint16_t scaledWidth, scaledHeight;
-    uint16_t offsetX = 0, offsetY = 0;
-    
-    if (aspectRatio > (float)maxDisplayWidth / maxDisplayHeight) {
-      scaledWidth = maxDisplayWidth;
-      scaledHeight = (uint16_t)(maxDisplayWidth / aspectRatio);
-      offsetY = (maxDisplayHeight - scaledHeight) / 2;
+    if (decoded > 0) {
+      Serial.printf("%s: %d frames, avg %u bytes, DC-only %lu us, full IDCT %lu us, preview %lu us\n",
+                    names[i], decoded, (unsigned)(bytesTotal / decoded),
+                    (unsigned long)(dcTotal / decoded), (unsigned long)(fullTotal / decoded),
+                    (unsigned long)(previewTotal / decoded));
     } else {
-      scaledHeight = maxDisplayHeight;
-      scaledWidth = (uint16_t)(maxDisplayHeight * aspectRatio);
-      offsetX = (maxDisplayWidth - scaledWidth) / 2;
+      Serial.printf("%s: no frame decoded\n", names[i]);
     }
-    
-    uint8_t* displayBuffer = (uint8_t*)malloc(maxDisplayWidth * maxDisplayHeight / 8);
-    if (displayBuffer) {
-      memset(displayBuffer, 0, maxDisplayWidth * maxDisplayHeight / 8);
-      
-      // 简化快速处理
-      for (int y = 0; y < scaledHeight; y += 2) {  // 每隔一行处理以加快速度
-        for (int x = 0; x < scaledWidth; x += 2) {  // 每隔一列处理
-          size_t sampleIndex = ((y * fb->height / scaledHeight) * 
-                               (fb->width / scaledWidth) + 
-                               (x * fb->width / scaledWidth)) % fb->len;
-          
-          bool isWhite = fb->buf[sampleIndex] > 100;
-          
-          // 设置2x2的像素块
-          for (int dy = 0; dy < 2 && (y + dy) < scaledHeight; dy++) {
-            for (int dx = 0; dx < 2 && (x + dx) < scaledWidth; dx++) {
-              int px = x + dx + offsetX;
-              int py = y + dy + offsetY;
-              int byteIndex = py * (maxDisplayWidth / 8) + px / 8;
-              int bitIndex = 7 - (px % 8);
-              
-              if (isWhite) {
-                displayBuffer[byteIndex] |= (1 << bitIndex);
-              }
-            }
-          }
-        }
+  }
+
+  printCameraModeStats();
+  Serial.println("=== JPEG Decode Benchmark Complete ===");
+}
+
+// 抖动算法性能测试：对合成的128x32渐变图逐个算法计时
+void benchmarkDither(int iterations) {
+  Serial.println("=== Dither Benchmark ===");
+  static uint8_t grayBuffer[128 * 32];
+  static uint8_t monoBuffer[128 * 32 / 8];
+
+  // 水平渐变叠加垂直条纹，覆盖全部灰度
+  for (int y = 0; y < 32; y++) {
+    for (int x = 0; x < 128; x++) {
+      grayBuffer[y * 128 + x] = (uint8_t)((x * 2 + (y & 4) * 8) & 0xFF);
+    }
+  }
+
+  for (int mode = 0; mode < DITHER_MODE_COUNT; mode++) {
+    lockDecoder();
+    uint32_t start = micros();
+    for (int i = 0; i < iterations; i++) {
+      ditherImage((DitherMode)mode, grayBuffer, monoBuffer, 128, 32, 128);
+    }
+    uint32_t elapsed = micros() - start;
+    unlockDecoder();
+    Serial.printf("%-16s %lu us/frame\n", ditherModeName((DitherMode)mode),
+                  (unsigned long)(elapsed / iterations));
+  }
+  Serial.println("=== Dither Benchmark Complete ===");
+}
+
+// 以PBM（P1文本格式）输出XBM单色图，复制串口输出保存为.pbm即可查看
+static void printMonoPbm(const uint8_t* xbm, uint16_t width, uint16_t height) {
+  Serial.printf("P1\n%u %u\n", (unsigned)width, (unsigned)height);
+  uint16_t rowBytes = (width + 7) / 8;
+  char line[DITHER_MAX_WIDTH * 2 + 1];
+  for (uint16_t y = 0; y < height; y++) {
+    int n = 0;
+    for (uint16_t x = 0; x < width && x < DITHER_MAX_WIDTH; x++) {
+      // XBM中1为点亮，PBM中1为黑
+      line[n++] = (xbm[y * rowBytes + x / 8] >> (x & 7)) & 1 ? '0' : '1';
+      line[n++] = ' ';
+    }
+    line[n] = '\0';
+    Serial.println(line);
+  }
+}
+
+// 图像流水线基准：对固定语料逐段计时（缩放、阈值、抖动、打包、Base64），
+// 并把输出与黄金校验值比较，输出不一致时打印PBM便于对比
+bool benchmarkImagePipeline(int iterations) {
+  Serial.println("=== Image Pipeline Benchmark ===");
+  static ImageBenchBuffers buffers;
+  size_t maxFrame = 0;
+  for (int i = 0; i < imageBenchCaseCount; i++) {
+    size_t frameSize = imageBenchFrameSize(&imageBenchCases[i]);
+    if (frameSize > maxFrame) maxFrame = frameSize;
+  }
+  uint8_t* frame = (uint8_t*)(psramFound() ? ps_malloc(maxFrame) : malloc(maxFrame));
+  char* encoded = (char*)(psramFound() ? ps_malloc(base64EncodedLength(maxFrame)) : malloc(base64EncodedLength(maxFrame)));
+  if (!frame || !encoded) {
+    Serial.println("Image pipeline benchmark: allocation failed");
+    free(frame);
+    free(encoded);
+    return false;
+  }
+
+  int failures = 0;
+  // image_bench的缩放器和抖动器同样是静态的，和预览任务互斥
+  lockDecoder();
+  for (int i = 0; i < imageBenchCaseCount; i++) {
+    const ImageBenchCase* c = &imageBenchCases[i];
+    size_t frameSize = imageBenchFrameSize(c);
+    imageBenchFill(c, frame);
+
+    uint32_t start = micros();
+    for (int k = 0; k < iterations; k++) {
+      imageBenchScale(c, frame, &buffers);
+    }
+    uint32_t scaleUs = (micros() - start) / iterations;
+    Serial.printf("%-16s %ux%u -> %ux%u  scale %lu us (%lu kpix/s)\n", c->name,
+                  (unsigned)c->width, (unsigned)c->height, (unsigned)c->dstWidth, (unsigned)c->dstHeight,
+                  (unsigned long)scaleUs,
+                  (unsigned long)(scaleUs ? (uint64_t)c->width * c->height * 1000 / scaleUs : 0));
+
+    for (int mode = 0; mode < DITHER_MODE_COUNT; mode++) {
+      uint32_t thresholdUs = 0, ditherUs = 0, packUs = 0;
+      for (int k = 0; k < iterations; k++) {
+        imageBenchScale(c, frame, &buffers);
+        uint32_t t0 = micros();
+        uint8_t threshold = imageBenchThreshold(c, &buffers, (DitherMode)mode);
+        uint32_t t1 = micros();
+        imageBenchDither(&buffers, (DitherMode)mode, threshold);
+        uint32_t t2 = micros();
+        imageBenchPack(&buffers);
+        uint32_t t3 = micros();
+        thresholdUs += t1 - t0;
+        ditherUs += t2 - t1;
+        packUs += t3 - t2;
+      }
+      uint32_t checksum = imageBenchChecksum(buffers.pages, sizeof(buffers.pages));
+      bool match = checksum == c->pagesChecksum[mode];
+      Serial.printf("  %-16s threshold %lu us, dither %lu us, pack %lu us  %s\n",
+                    ditherModeName((DitherMode)mode), (unsigned long)(thresholdUs / iterations),
+                    (unsigned long)(ditherUs / iterations), (unsigned long)(packUs / iterations),
+                    match ? "OK" : "MISMATCH");
+      if (!match) {
+        failures++;
+        Serial.printf("  checksum %08lx, expected %08lx\n",
+                      (unsigned long)checksum, (unsigned long)c->pagesChecksum[mode]);
+        printMonoPbm(buffers.mono, IMAGE_BENCH_DISPLAY_WIDTH, IMAGE_BENCH_DISPLAY_HEIGHT);
       }
-      
-      // 显示
-      u8g2.clearBuffer();
-      u8g2.drawXBM(0, 0, maxDisplayWidth, maxDisplayHeight, displayBuffer);
-      u8g2.sendBuffer();
-      
-      free(displayBuffer);
     }
-    
+
+    start = micros();
+    size_t encodedLength = 0;
+    for (int k = 0; k < iterations; k++) {
+      encodedLength = base64EncodeTo(frame, frameSize, encoded);
+    }
+    uint32_t base64Us = (micros() - start) / iterations;
+    bool base64Match = imageBenchChecksum((const uint8_t*)encoded, encodedLength) == c->base64Checksum;
+    if (!base64Match) failures++;
+    Serial.printf("  base64 %u bytes: %lu us (%lu KB/s)  %s\n", (unsigned)frameSize, (unsigned long)base64Us,
+                  (unsigned long)(base64Us ? (uint64_t)frameSize * 1000 / base64Us : 0),
+                  base64Match ? "OK" : "MISMATCH");
+  }
+  unlockDecoder();
+
+  free(frame);
+  free(encoded);
+  Serial.printf("=== Image Pipeline Benchmark Complete: %d mismatches ===\n", failures);
+  return failures == 0;
+}
+
+// 亮度统计性能测试：合成QQVGA灰度帧和YUYV帧各统计一次，再对真实帧统计（JPEG走DC系数）
+void benchmarkLumaStats(int iterations) {
+  Serial.println("=== Luma Stats Benchmark ===");
+  const uint16_t width = 160;
+  const uint16_t height = 120;
+  uint8_t* frame = (uint8_t*)(psramFound() ? ps_malloc(width * height * 2) : malloc(width * height * 2));
+  if (!frame) {
+    Serial.println("Luma stats benchmark: allocation failed");
+    return;
+  }
+  for (int i = 0; i < width * height * 2; i++) {
+    frame[i] = (uint8_t)((i * 7) ^ (i >> 5));
+  }
+
+  static LumaStats stats;
+  uint32_t start = micros();
+  for (int i = 0; i < iterations; i++) {
+    lumaStatsCompute(&stats, frame, width, height, width, 1);
+  }
+  uint32_t grayUs = (micros() - start) / iterations;
+
+  start = micros();
+  for (int i = 0; i < iterations; i++) {
+    lumaStatsCompute(&stats, frame, width, height, width * 2, 2);
+  }
+  uint32_t yuvUs = (micros() - start) / iterations;
+
+  start = micros();
+  uint8_t threshold = 0;
+  for (int i = 0; i < iterations; i++) {
+    threshold = lumaOtsuThreshold(&stats);
+  }
+  uint32_t otsuUs = (micros() - start) / iterations;
+  free(frame);
+
+  Serial.printf("QQVGA gray %lu us, YUYV %lu us, Otsu %lu us (threshold %d)\n",
+                (unsigned long)grayUs, (unsigned long)yuvUs, (unsigned long)otsuUs, threshold);
+
+  camera_fb_t* fb = esp_camera_fb_get();
+  if (fb) {
+    lockDecoder();
+    start = micros();
+    bool ok = frameLumaStats(fb, &stats);
+    uint32_t frameUs = micros() - start;
+    unlockDecoder();
+    if (ok) {
+      Serial.printf("Camera frame %ux%u: %lu us, mean %d, p5 %d, p95 %d, clipped %d%%/%d%%, exposure step %d\n",
+                    (unsigned)fb->width, (unsigned)fb->height, (unsigned long)frameUs,
+                    stats.mean, stats.p5, stats.p95, stats.clippedLowPercent, stats.clippedHighPercent,
+                    lumaExposureStep(&stats, AUTO_EXPOSURE_TARGET, AUTO_EXPOSURE_TOLERANCE));
+    }
     esp_camera_fb_return(fb);
-    delay(1000);  // 每张照片间隔1秒
   }
-  
-  // 恢复分辨率
-  if (s != NULL) {
-    s->set_framesize(s, FRAMESIZE_VGA);
+  Serial.println("=== Luma Stats Benchmark Complete ===");
+}
+
+static bool discardOutput(const char* data, size_t length, void* ctx) {
+  return true;
+}
+
+// Base64编码性能测试：旧版逐字符String、预分配String、预分配PSRAM缓冲区、分块流式输出
+void benchmarkBase64(size_t length, int iterations) {
+  Serial.println("=== Base64 Benchmark ===");
+  size_t encodedLength = base64EncodedLength(length);
+  uint8_t* input = (uint8_t*)(psramFound() ? ps_malloc(length) : malloc(length));
+  char* output = (char*)(psramFound() ? ps_malloc(encodedLength) : malloc(encodedLength));
+  if (!input || !output) {
+    Serial.println("Failed to allocate benchmark buffers");
+    free(input);
+    free(output);
+    return;
+  }
+  for (size_t i = 0; i < length; i++) {
+    input[i] = (uint8_t)(i * 131 + (i >> 7));
+  }
+
+  const char* names[] = {"String by char", "String reserved", "buffer", "stream"};
+  for (int method = 0; method < 4; method++) {
+    uint32_t start = micros();
+    for (int i = 0; i < iterations; i++) {
+      if (method == 0) {
+        base64EncodeByChar(input, length);
+      } else if (method == 1) {
+        base64Encode(input, length);
+      } else if (method == 2) {
+        base64EncodeTo(input, length, output);
+      } else {
+        Base64Stream stream;
+        base64StreamBegin(&stream, discardOutput, NULL);
+        base64StreamWrite(&stream, input, length);
+        base64StreamEnd(&stream);
+      }
+    }
+    uint32_t elapsed = micros() - start;
+    if (elapsed == 0) elapsed = 1;
+    Serial.printf("%-16s %lu us/op, %.2f MB/s\n", names[method],
+                  (unsigned long)(elapsed / iterations),
+                  (double)length * iterations / elapsed);
+  }
+
+  free(input);
+  free(output);
+  Serial.println("=== Base64 Benchmark Complete ===");
+}
+
+// 场景检测测试：合成序列（缓慢亮度漂移、曝光闪烁、物体出现/移动/消失）的放行结果和耗时，
+// 以及真实帧提取缩略图的耗时
+void benchmarkSceneGate() {
+  Serial.println("=== Scene Gate Benchmark ===");
+  static uint8_t thumb[SCENE_THUMB_WIDTH * SCENE_THUMB_HEIGHT];
+  static SceneGate gate;
+  SceneGateConfig config;
+  sceneGateDefaultConfig(&config);
+  sceneGateInit(&gate, &config);
+
+  // 每帧间隔200ms；预期放行：0（首帧）、100（物体出现）、115（冷却期内移动）、150（物体消失）
+  uint32_t updateTime = 0;
+  uint32_t seed = 1;
+  for (int f = 0; f < 200; f++) {
+    int bright = f < 20 ? 0 : (f < 60 ? f - 20 : 40);
+    if (f >= 80) bright += (f & 1) ? 8 : -8;
+    int objectX = f >= 150 ? -1 : (f >= 102 ? 20 : (f >= 100 ? 4 : -1));
+    for (int y = 0; y < SCENE_THUMB_HEIGHT; y++) {
+      for (int x = 0; x < SCENE_THUMB_WIDTH; x++) {
+        seed = seed * 1103515245 + 12345;
+        int v = 60 + x * 3 + y * 2 + bright + (int)((seed >> 16) % 9) - 4;
+        if (objectX >= 0 && x >= objectX && x < objectX + 8 && y >= 8 && y < 16) v = 180 + bright;
+        thumb[y * SCENE_THUMB_WIDTH + x] = (uint8_t)constrain(v, 0, 255);
+      }
+    }
+    uint32_t start = micros();
+    bool fire = sceneGateUpdate(&gate, thumb, f * 200);
+    updateTime += micros() - start;
+    if (fire) Serial.printf("  frame %d: triggered, %d%% blocks changed\n", f, gate.lastScore);
+  }
+  Serial.printf("Synthetic: %lu frames, %lu triggers, %lu unchanged, %lu cooling, %lu us/frame\n",
+                (unsigned long)gate.frames, (unsigned long)gate.triggers,
+                (unsigned long)gate.unchanged, (unsigned long)gate.cooling,
+                (unsigned long)(updateTime / gate.frames));
+
+  camera_fb_t * fb = esp_camera_fb_get();
+  if (fb) {
+    uint32_t start = micros();
+    bool ok = frameToSceneThumb(fb, thumb);
+    Serial.printf("Thumbnail from %dx%d frame: %s, %lu us\n", fb->width, fb->height,
+                  ok ? "ok" : "failed", (unsigned long)(micros() - start));
+    esp_camera_fb_return(fb);
+  }
+  Serial.println("=== Scene Gate Benchmark Complete ===");
+}
+
+// 录制场景检测用的缩略图序列，按test/host/data/scene/*.seq的格式从串口输出：
+// 首行"SCENESEQ 32 24"，之后每帧一行"F <毫秒> <缩略图十六进制>"。
+// 保存串口输出后在主机上运行 test_scene_gate <文件>，可以离线重放并调整检测参数
+void recordSceneSequence(int frames, uint32_t intervalMs) {
+  static uint8_t thumb[SCENE_THUMB_WIDTH * SCENE_THUMB_HEIGHT];
+  static char hex[SCENE_THUMB_WIDTH * SCENE_THUMB_HEIGHT * 2 + 1];
+  const char digits[] = "0123456789abcdef";
+  Serial.printf("SCENESEQ %d %d\n", SCENE_THUMB_WIDTH, SCENE_THUMB_HEIGHT);
+  uint32_t start = millis();
+  for (int f = 0; f < frames; f++) {
+    camera_fb_t * fb = esp_camera_fb_get();
+    if (fb) {
+      uint32_t timestamp = millis() - start;
+      bool ok = frameToSceneThumb(fb, thumb);
+      esp_camera_fb_return(fb);
+      if (ok) {
+        for (int i = 0; i < SCENE_THUMB_WIDTH * SCENE_THUMB_HEIGHT; i++) {
+          hex[i * 2] = digits[thumb[i] >> 4];
+          hex[i * 2 + 1] = digits[thumb[i] & 0x0F];
+        }
+        hex[sizeof(hex) - 1] = '\0';
+        Serial.printf("F %lu %s\n", (unsigned long)timestamp, hex);
+      }
+    }
+    delay(intervalMs);
   }
-  
-  showTwoLineMessage("连续拍照完成", "共5张照片");
-  delay(2000);
 }
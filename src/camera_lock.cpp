@@ -0,0 +1,47 @@
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "camera_lock.h"
+
+static SemaphoreHandle_t driverLock = NULL;
+static volatile uint8_t activeUsers = 0;
+
+bool cameraLockInit() {
+  if (!driverLock) {
+    driverLock = xSemaphoreCreateRecursiveMutex();
+  }
+  return driverLock != NULL;
+}
+
+void cameraLock() {
+  if (driverLock) xSemaphoreTakeRecursive(driverLock, portMAX_DELAY);
+}
+
+void cameraUnlock() {
+  if (driverLock) xSemaphoreGiveRecursive(driverLock);
+}
+
+bool cameraUserBegin(CameraUser user) {
+  cameraLock();
+  bool ok = (activeUsers & user) == 0;
+  if (ok) activeUsers |= user;
+  cameraUnlock();
+  return ok;
+}
+
+void cameraUserEnd(CameraUser user) {
+  cameraLock();
+  activeUsers &= ~user;
+  cameraUnlock();
+}
+
+uint8_t cameraUsers() {
+  return activeUsers;
+}
+
+const char* cameraUserName(uint8_t users) {
+  if (users & CAMERA_USER_LIVE_VIEW) return "live view";
+  if (users & CAMERA_USER_PIPELINE) return "vision pipeline";
+  if (users & CAMERA_USER_RECORDER) return "frame recorder";
+  return "none";
+}
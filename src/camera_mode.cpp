@@ -0,0 +1,173 @@
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "camera_mode.h"
+#include "camera_lock.h"
+
+// 外部函数声明
+bool reinitCameraDriver(pixformat_t format, framesize_t frameSize, camera_grab_mode_t grabMode);
+bool getCameraDriverConfig(camera_config_t* config);
+int restoreSensorStatus(sensor_t* s, const camera_status_t& want);
+
+// 切换分辨率后最多取这么多帧等待新尺寸的帧出现
+#define CAMERA_MODE_MAX_DISCARD  6
+
+struct CameraProfile {
+  const char* name;
+  framesize_t frameSize;
+  pixformat_t pixelFormat;
+  uint8_t quality;
+  camera_grab_mode_t grabMode;
+  int8_t aeLevel;             // -2 ~ 2
+  gainceiling_t gainCeiling;
+  bool nightMode;             // AEC DSP（aec2），允许更长曝光
+};
+
+static CameraProfile profiles[CAMERA_MODE_COUNT];
+static camera_status_t modeStatus[CAMERA_MODE_COUNT];
+static bool modeStatusCached[CAMERA_MODE_COUNT];
+static CameraMode activeMode = CAMERA_MODE_ANALYZE;
+static CameraModeStats modeStats;
+
+void cameraModeReset() {
+  cameraLock();
+  const bool psram = psramFound();
+  const camera_grab_mode_t grab = psram ? CAMERA_GRAB_LATEST : CAMERA_GRAB_WHEN_EMPTY;
+  const uint8_t quality = psram ? 12 : 20;
+
+  profiles[CAMERA_MODE_ANALYZE] = {"analyze", psram ? FRAMESIZE_VGA : FRAMESIZE_QVGA, PIXFORMAT_JPEG,
+                                   quality, grab, 0, GAINCEILING_2X, false};
+  profiles[CAMERA_MODE_PREVIEW] = {"preview", FRAMESIZE_QQVGA, PIXFORMAT_JPEG,
+                                   quality, grab, 0, GAINCEILING_2X, false};
+  profiles[CAMERA_MODE_PREVIEW_GRAY] = {"preview-gray", FRAMESIZE_QQVGA, PIXFORMAT_GRAYSCALE,
+                                        quality, grab, 0, GAINCEILING_2X, false};
+  profiles[CAMERA_MODE_LOW_LIGHT] = {"low-light", FRAMESIZE_QVGA, PIXFORMAT_JPEG,
+                                     (uint8_t)(quality - 2), grab, 2, GAINCEILING_32X, true};
+
+  memset(modeStatusCached, 0, sizeof(modeStatusCached));
+  activeMode = CAMERA_MODE_ANALYZE;
+  cameraUnlock();
+}
+
+CameraMode getCameraMode() {
+  return activeMode;
+}
+
+const char* cameraModeName(CameraMode mode) {
+  return mode < CAMERA_MODE_COUNT && profiles[mode].name ? profiles[mode].name : "unknown";
+}
+
+// 第一次进入某模式时按预设写入传感器
+static void applyProfile(sensor_t* s, const CameraProfile& p) {
+  s->set_framesize(s, p.frameSize);
+  s->set_quality(s, p.quality);
+  s->set_ae_level(s, p.aeLevel);
+  s->set_gainceiling(s, p.gainCeiling);
+  s->set_aec2(s, p.nightMode ? 1 : 0);
+}
+
+// 取帧直到帧尺寸与新分辨率一致，返回取出并丢弃的帧数
+static int discardStaleFrames(framesize_t frameSize) {
+  const uint16_t width = resolution[frameSize].width;
+  const uint16_t height = resolution[frameSize].height;
+  for (int i = 1; i <= CAMERA_MODE_MAX_DISCARD; i++) {
+    camera_fb_t * fb = esp_camera_fb_get();
+    if (!fb) return i - 1;
+    bool current = fb->width == width && fb->height == height;
+    esp_camera_fb_return(fb);
+    if (current) return i;
+  }
+  Serial.println("Camera mode: new frame size not seen, giving up");
+  return CAMERA_MODE_MAX_DISCARD;
+}
+
+// 在cameraLock()下执行：切换可能释放并重建驱动，丢弃旧帧时也会取走帧缓冲，
+// 所以有后台取帧者（实时预览、流水线、录帧）登记时拒绝切换到其他模式
+static bool switchCameraMode(CameraMode mode) {
+  if (profiles[mode].name == NULL) cameraModeReset();
+  modeStats.requests++;
+  if (mode == activeMode) return true;
+  if (cameraUsers() != 0) {
+    modeStats.refused++;
+    Serial.printf("Camera mode -> %s refused: %s is running in %s mode\n", profiles[mode].name,
+                  cameraUserName(cameraUsers()), profiles[activeMode].name);
+    return false;
+  }
+
+  sensor_t * s = esp_camera_sensor_get();
+  camera_config_t driver;
+  if (s == NULL || !getCameraDriverConfig(&driver)) {
+    Serial.println("Camera mode: camera not initialized");
+    return false;
+  }
+
+  uint32_t start = millis();
+  modeStatus[activeMode] = s->status;
+  modeStatusCached[activeMode] = true;
+
+  // JPEG帧缓冲按驱动初始化时的分辨率分配，灰度帧缓冲正好是宽x高
+  const CameraProfile& p = profiles[mode];
+  bool reinit = p.pixelFormat != driver.pixel_format || p.grabMode != driver.grab_mode ||
+                (p.pixelFormat == PIXFORMAT_JPEG ? p.frameSize > driver.frame_size
+                                                 : p.frameSize != driver.frame_size);
+  if (reinit) {
+    // JPEG驱动按分析分辨率分配，之后在JPEG模式之间切换不用再重新初始化
+    const framesize_t analyzeSize = profiles[CAMERA_MODE_ANALYZE].frameSize;
+    framesize_t driverSize = p.pixelFormat == PIXFORMAT_JPEG && analyzeSize > p.frameSize ? analyzeSize : p.frameSize;
+    if (!reinitCameraDriver(p.pixelFormat, driverSize, p.grabMode)) {
+      return false;
+    }
+    s = esp_camera_sensor_get();
+    if (s == NULL) return false;
+    modeStats.reinits++;
+  }
+
+  framesize_t before = s->status.framesize;
+  int writes = 0;
+  if (modeStatusCached[mode]) {
+    writes = restoreSensorStatus(s, modeStatus[mode]);
+  } else {
+    applyProfile(s, p);
+  }
+  int discarded = 0;
+  if (reinit || s->status.framesize != before) {
+    discarded = discardStaleFrames(s->status.framesize);
+  }
+  activeMode = mode;
+
+  uint32_t elapsed = millis() - start;
+  modeStats.switches++;
+  modeStats.framesDiscarded += discarded;
+  modeStats.switchMs += elapsed;
+  modeStats.lastSwitchMs = elapsed;
+  if (elapsed > modeStats.maxSwitchMs) modeStats.maxSwitchMs = elapsed;
+  Serial.printf("Camera mode -> %s: %lu ms (%s, %d register writes, %d frames discarded)\n",
+                p.name, (unsigned long)elapsed, reinit ? "driver reinit" : "sensor only",
+                writes, discarded);
+  return true;
+}
+
+bool setCameraMode(CameraMode mode) {
+  if (mode >= CAMERA_MODE_COUNT) return false;
+  cameraLock();
+  bool ok = switchCameraMode(mode);
+  cameraUnlock();
+  return ok;
+}
+
+void getCameraModeStats(CameraModeStats* stats) {
+  cameraLock();
+  *stats = modeStats;
+  cameraUnlock();
+}
+
+void printCameraModeStats() {
+  CameraModeStats stats;
+  getCameraModeStats(&stats);
+  Serial.printf("Camera mode: %s, %lu requests, %lu switches (%lu driver reinits, %lu refused), "
+                "%lu frames discarded, %lu ms lost (avg %lu ms, max %lu ms)\n",
+                cameraModeName(activeMode), (unsigned long)stats.requests,
+                (unsigned long)stats.switches, (unsigned long)stats.reinits, (unsigned long)stats.refused,
+                (unsigned long)stats.framesDiscarded, (unsigned long)stats.switchMs,
+                (unsigned long)(stats.switches ? stats.switchMs / stats.switches : 0),
+                (unsigned long)stats.maxSwitchMs);
+}
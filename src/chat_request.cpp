@@ -0,0 +1,235 @@
+#include "chat_request.h"
+#include "base64_stream.h"
+#include <string.h>
+
+// 固定片段，按请求中的顺序排列
+static const char MODEL_OPEN[]     = "{\"model\":";
+// 流式响应默认不带用量，include_usage让服务器在[DONE]之前多发一个只含usage的事件，用于校正配额
+static const char STREAM_ON[]      = ",\"stream\":true,\"stream_options\":{\"include_usage\":true}";
+static const char MESSAGES_OPEN[]  = ",\"messages\":[";
+static const char SYSTEM_MESSAGE[] = "{\"role\":\"system\",\"content\":[{\"type\":\"text\","
+                                     "\"text\":\"You are a helpful assistant that analyzes images in Chinese.\"}]},";
+static const char USER_OPEN[]      = "{\"role\":\"user\",\"content\":[";
+static const char IMAGE_DATA_OPEN[] = "{\"type\":\"image_url\",\"image_url\":{\"url\":\"data:image/jpeg;base64,";
+static const char IMAGE_DATA_CLOSE[] = "\"}},";
+static const char IMAGE_URL_OPEN[] = "{\"type\":\"image_url\",\"image_url\":{\"url\":";
+static const char IMAGE_URL_CLOSE[] = "}},";
+static const char TEXT_OPEN[]      = "{\"type\":\"text\",\"text\":";
+static const char USER_CLOSE[]     = "}]}]}";
+static const char TEXT_USER_OPEN[] = "{\"role\":\"user\",\"content\":";
+static const char TEXT_USER_CLOSE[] = "}]}";
+
+#define LITERAL(r, s) chatRequestLiteral(r, s, sizeof(s) - 1)
+
+// 需要转义的字符输出到seq，返回序列长度；不需要转义时返回0。
+// 转义引号、反斜杠和控制字符，'/'和非ASCII原样输出
+static uint8_t escapeChar(uint8_t c, char* seq) {
+  const char* simple = NULL;
+  switch (c) {
+    case '"':  simple = "\\\""; break;
+    case '\\': simple = "\\\\"; break;
+    case '\b': simple = "\\b"; break;
+    case '\f': simple = "\\f"; break;
+    case '\n': simple = "\\n"; break;
+    case '\r': simple = "\\r"; break;
+    case '\t': simple = "\\t"; break;
+    default: {
+      if (c >= 0x20) return 0;
+      static const char hex[] = "0123456789abcdef";
+      memcpy(seq, "\\u00", 4);
+      seq[4] = hex[c >> 4];
+      seq[5] = hex[c & 15];
+      return 6;
+    }
+  }
+  seq[0] = simple[0];
+  seq[1] = simple[1];
+  return 2;
+}
+
+size_t jsonStringLength(const char* text, size_t length) {
+  size_t size = 2;
+  char seq[6];
+  for (size_t i = 0; i < length; i++) {
+    uint8_t n = escapeChar((uint8_t)text[i], seq);
+    size += n ? n : 1;
+  }
+  return size;
+}
+
+void chatRequestBegin(ChatRequest* r) {
+  memset(r, 0, sizeof(*r));
+}
+
+static void addPart(ChatRequest* r, ChatPartType type, const void* data, size_t length, size_t size) {
+  if (r->count >= CHAT_REQUEST_PARTS_MAX) {
+    r->overflow = true;
+    return;
+  }
+  ChatPart& p = r->parts[r->count++];
+  p.type = type;
+  p.data = (const uint8_t*)data;
+  p.length = length;
+  p.size = size;
+  r->total += size;
+}
+
+void chatRequestLiteral(ChatRequest* r, const char* json, size_t length) {
+  addPart(r, CHAT_PART_LITERAL, json, length, length);
+}
+
+void chatRequestString(ChatRequest* r, const char* text) {
+  if (text == NULL) text = "";
+  size_t length = strlen(text);
+  addPart(r, CHAT_PART_STRING, text, length, jsonStringLength(text, length));
+}
+
+void chatRequestRaw(ChatRequest* r, const uint8_t* data, size_t length) {
+  addPart(r, CHAT_PART_RAW, data, length, length);
+}
+
+void chatRequestBase64(ChatRequest* r, const uint8_t* data, size_t length) {
+  addPart(r, CHAT_PART_BASE64, data, length, base64EncodedLength(length));
+}
+
+bool chatRequestVisionImage(ChatRequest* r, const char* model, bool stream, const uint8_t* image,
+                            size_t imageLength, bool encoded, const char* question) {
+  chatRequestBegin(r);
+  LITERAL(r, MODEL_OPEN);
+  chatRequestString(r, model);
+  if (stream) LITERAL(r, STREAM_ON);
+  LITERAL(r, MESSAGES_OPEN);
+  LITERAL(r, USER_OPEN);
+  LITERAL(r, IMAGE_DATA_OPEN);
+  if (encoded) {
+    chatRequestRaw(r, image, imageLength);
+  } else {
+    chatRequestBase64(r, image, imageLength);
+  }
+  LITERAL(r, IMAGE_DATA_CLOSE);
+  LITERAL(r, TEXT_OPEN);
+  chatRequestString(r, question);
+  LITERAL(r, USER_CLOSE);
+  return !r->overflow;
+}
+
+bool chatRequestVisionUrl(ChatRequest* r, const char* model, const char* imageUrl, const char* question) {
+  chatRequestBegin(r);
+  LITERAL(r, MODEL_OPEN);
+  chatRequestString(r, model);
+  LITERAL(r, MESSAGES_OPEN);
+  LITERAL(r, SYSTEM_MESSAGE);
+  LITERAL(r, USER_OPEN);
+  LITERAL(r, IMAGE_URL_OPEN);
+  chatRequestString(r, imageUrl);
+  LITERAL(r, IMAGE_URL_CLOSE);
+  LITERAL(r, TEXT_OPEN);
+  chatRequestString(r, question);
+  LITERAL(r, USER_CLOSE);
+  return !r->overflow;
+}
+
+bool chatRequestText(ChatRequest* r, const char* model, const char* text) {
+  chatRequestBegin(r);
+  LITERAL(r, MODEL_OPEN);
+  chatRequestString(r, model);
+  LITERAL(r, MESSAGES_OPEN);
+  LITERAL(r, TEXT_USER_OPEN);
+  chatRequestString(r, text);
+  LITERAL(r, TEXT_USER_CLOSE);
+  return !r->overflow;
+}
+
+size_t chatRequestLength(const ChatRequest* r) {
+  return r->total;
+}
+
+// 从Base64输出的offset处开始生成最多length个字符
+static size_t produceBase64(const ChatPart& p, uint8_t* out, size_t length, size_t offset) {
+  // 对齐到4字符分组时整组直接编码到输出
+  if ((offset & 3) == 0 && length >= 4) {
+    size_t start = offset / 4 * 3;
+    size_t bytes = length / 4 * 3;
+    if (bytes > p.length - start) bytes = p.length - start;
+    return base64EncodeTo(p.data + start, bytes, (char*)out);
+  }
+
+  // 跨分组边界时单独编码一组，只取需要的部分
+  char group[4];
+  size_t start = offset / 4 * 3;
+  size_t bytes = p.length - start < 3 ? p.length - start : 3;
+  base64EncodeTo(p.data + start, bytes, group);
+  size_t skip = offset & 3;
+  size_t n = 4 - skip < length ? 4 - skip : length;
+  memcpy(out, group + skip, n);
+  return n;
+}
+
+// 生成JSON字符串：引号、逐字符转义、引号；转义序列可以跨两次读取
+static size_t produceString(ChatRequest* r, const ChatPart& p, uint8_t* out, size_t length) {
+  size_t written = 0;
+  while (written < length) {
+    if (r->pendingPosition < r->pendingLength) {
+      out[written++] = r->pending[r->pendingPosition++];
+      continue;
+    }
+    if (r->offset + written == 0) {
+      out[written++] = '"';
+      continue;
+    }
+    if (r->source >= p.length) {
+      out[written++] = '"';
+      break;
+    }
+    uint8_t c = p.data[r->source++];
+    uint8_t n = escapeChar(c, r->pending);
+    if (n == 0) {
+      out[written++] = c;
+    } else {
+      r->pendingLength = n;
+      r->pendingPosition = 0;
+    }
+  }
+  return written;
+}
+
+size_t chatRequestRead(ChatRequest* r, uint8_t* out, size_t length) {
+  size_t written = 0;
+  while (written < length && r->part < r->count) {
+    const ChatPart& p = r->parts[r->part];
+    size_t want = length - written;
+    if (want > p.size - r->offset) want = p.size - r->offset;
+    size_t n = 0;
+    switch (p.type) {
+      case CHAT_PART_LITERAL:
+      case CHAT_PART_RAW:
+        memcpy(out + written, p.data + r->offset, want);
+        n = want;
+        break;
+      case CHAT_PART_STRING:
+        n = produceString(r, p, out + written, want);
+        break;
+      case CHAT_PART_BASE64:
+        n = produceBase64(p, out + written, want, r->offset);
+        break;
+    }
+    written += n;
+    r->offset += n;
+    if (r->offset >= p.size) {
+      r->part++;
+      r->offset = 0;
+      r->source = 0;
+      r->pendingLength = r->pendingPosition = 0;
+    }
+  }
+  r->position += written;
+  return written;
+}
+
+void chatRequestRewind(ChatRequest* r) {
+  r->position = 0;
+  r->part = 0;
+  r->offset = 0;
+  r->source = 0;
+  r->pendingLength = r->pendingPosition = 0;
+}
@@ -0,0 +1,47 @@
+#include "chat_response.h"
+#include <string.h>
+
+void chatResponseFilter(JsonDocument& filter) {
+  filter.clear();
+  JsonObject choice = filter["choices"].createNestedObject();
+  choice["message"]["content"] = true;
+  choice["finish_reason"] = true;
+  filter["usage"] = true;
+}
+
+bool chatResponseRead(const JsonDocument& doc, ChatResponse* response) {
+  memset(response, 0, sizeof(*response));
+  JsonVariantConst choice = doc["choices"][0];
+  response->content = choice["message"]["content"];
+  response->finishReason = choice["finish_reason"];
+  JsonVariantConst usage = doc["usage"];
+  response->promptTokens = usage["prompt_tokens"] | 0u;
+  response->completionTokens = usage["completion_tokens"] | 0u;
+  response->totalTokens = usage["total_tokens"] | 0u;
+  return response->content != NULL;
+}
+
+void chatDeltaFilter(JsonDocument& filter) {
+  filter.clear();
+  JsonObject choice = filter["choices"].createNestedObject();
+  choice["delta"]["content"] = true;
+  choice["finish_reason"] = true;
+  filter["usage"] = true;
+}
+
+DeserializationError chatDeltaParse(JsonDocument& doc, const char* data, size_t length, ChatDelta* delta) {
+  memset(delta, 0, sizeof(*delta));
+  StaticJsonDocument<192> filter;
+  chatDeltaFilter(filter);
+  DeserializationError error = deserializeJson(doc, data, length, DeserializationOption::Filter(filter));
+  if (!error && doc.overflowed()) error = DeserializationError::NoMemory;
+  if (error) return error;
+  JsonVariantConst choice = doc["choices"][0];
+  delta->content = choice["delta"]["content"];
+  delta->finishReason = choice["finish_reason"];
+  JsonVariantConst usage = doc["usage"];
+  delta->promptTokens = usage["prompt_tokens"] | 0u;
+  delta->completionTokens = usage["completion_tokens"] | 0u;
+  delta->totalTokens = usage["total_tokens"] | 0u;
+  return error;
+}
@@ -0,0 +1,175 @@
+#include "dither.h"
+#include <string.h>
+
+// 标准Bayer索引矩阵
+static const uint8_t kBayer4[4][4] = {
+  { 0,  8,  2, 10},
+  {12,  4, 14,  6},
+  { 3, 11,  1,  9},
+  {15,  7, 13,  5}
+};
+
+static const uint8_t kBayer8[8][8] = {
+  { 0, 32,  8, 40,  2, 34, 10, 42},
+  {48, 16, 56, 24, 50, 18, 58, 26},
+  {12, 44,  4, 36, 14, 46,  6, 38},
+  {60, 28, 52, 20, 62, 30, 54, 22},
+  { 3, 35, 11, 43,  1, 33,  9, 41},
+  {51, 19, 59, 27, 49, 17, 57, 25},
+  {15, 47,  7, 39, 13, 45,  5, 37},
+  {63, 31, 55, 23, 61, 29, 53, 21}
+};
+
+const char* ditherModeName(DitherMode mode) {
+  switch (mode) {
+    case DITHER_THRESHOLD:       return "threshold";
+    case DITHER_BAYER4:          return "bayer4x4";
+    case DITHER_BAYER8:          return "bayer8x8";
+    case DITHER_FLOYD_STEINBERG: return "floyd-steinberg";
+    case DITHER_ATKINSON:        return "atkinson";
+    default:                     return "unknown";
+  }
+}
+
+static inline uint8_t clampThreshold(int v) {
+  return v < 0 ? 0 : (v > 255 ? 255 : (uint8_t)v);
+}
+
+bool ditherBegin(Ditherer* d, DitherMode mode, uint16_t width, uint8_t threshold) {
+  if (width == 0 || width > DITHER_MAX_WIDTH || mode >= DITHER_MODE_COUNT) return false;
+
+  d->mode = mode;
+  d->width = width;
+  d->threshold = threshold;
+  d->row = 0;
+
+  // 有序抖动把阈值矩阵按行展开到整行宽度，内层循环只需逐元素比较
+  if (mode == DITHER_BAYER4 || mode == DITHER_BAYER8) {
+    const int n = mode == DITHER_BAYER4 ? 4 : 8;
+    const int step = 256 / (n * n);
+    const int bias = (int)threshold - 128;
+    for (int y = 0; y < n; y++) {
+      for (int x = 0; x < width; x++) {
+        int m = n == 4 ? kBayer4[y][x & 3] : kBayer8[y][x & 7];
+        d->thresholds[y][x] = clampThreshold(m * step + step / 2 + bias);
+      }
+    }
+  }
+  memset(d->errors, 0, sizeof(d->errors));
+  return true;
+}
+
+// 8个0/1结果打包成一个字节，XBM格式低位在左
+static void packLevels(const uint8_t* levels, uint8_t* out, uint16_t width) {
+  uint16_t full = width / 8;
+  for (uint16_t i = 0; i < full; i++) {
+    const uint8_t* p = levels + i * 8;
+    out[i] = (uint8_t)(p[0] | (p[1] << 1) | (p[2] << 2) | (p[3] << 3) |
+                       (p[4] << 4) | (p[5] << 5) | (p[6] << 6) | (p[7] << 7));
+  }
+  if (width & 7) {
+    uint8_t b = 0;
+    for (uint16_t x = full * 8; x < width; x++) {
+      b |= levels[x] << (x & 7);
+    }
+    out[full] = b;
+  }
+}
+
+// 误差扩散使用的三行缓冲区轮换：当前行清零后变成最远的一行
+static void rotateErrorRows(Ditherer* d, int rowsUsed) {
+  int16_t* cur = d->errors[0];
+  if (rowsUsed == 2) {
+    memcpy(cur, d->errors[1], sizeof(d->errors[0]));
+    memset(d->errors[1], 0, sizeof(d->errors[0]));
+  } else {
+    memcpy(cur, d->errors[1], sizeof(d->errors[0]));
+    memcpy(d->errors[1], d->errors[2], sizeof(d->errors[0]));
+    memset(d->errors[2], 0, sizeof(d->errors[0]));
+  }
+}
+
+void ditherRow(Ditherer* d, const uint8_t* gray, uint8_t* monoRow) {
+  const uint16_t width = d->width;
+  uint8_t* levels = d->levels;
+
+  switch (d->mode) {
+    case DITHER_THRESHOLD: {
+      const uint8_t t = d->threshold;
+      for (uint16_t x = 0; x < width; x++) {
+        levels[x] = gray[x] > t;
+      }
+      break;
+    }
+
+    case DITHER_BAYER4:
+    case DITHER_BAYER8: {
+      const int n = d->mode == DITHER_BAYER4 ? 4 : 8;
+      const uint8_t* t = d->thresholds[d->row & (n - 1)];
+      for (uint16_t x = 0; x < width; x++) {
+        levels[x] = gray[x] > t[x];
+      }
+      break;
+    }
+
+    case DITHER_FLOYD_STEINBERG: {
+      // 误差以1/16为单位累加：右 7，左下 3，下 5，右下 1
+      int16_t* cur = d->errors[0] + 2;
+      int16_t* next = d->errors[1] + 2;
+      const int t = d->threshold;
+      for (uint16_t x = 0; x < width; x++) {
+        int v = gray[x] + ((cur[x] + 8) >> 4);
+        int on = v > t;
+        int err = v - (on ? 255 : 0);
+        levels[x] = (uint8_t)on;
+        cur[x + 1] += (int16_t)(err * 7);
+        next[x - 1] += (int16_t)(err * 3);
+        next[x] += (int16_t)(err * 5);
+        next[x + 1] += (int16_t)err;
+      }
+      rotateErrorRows(d, 2);
+      break;
+    }
+
+    case DITHER_ATKINSON: {
+      // 误差以1/8为单位，只扩散6/8：右1、右2，下一行左/中/右，下两行中
+      int16_t* cur = d->errors[0] + 2;
+      int16_t* next = d->errors[1] + 2;
+      int16_t* next2 = d->errors[2] + 2;
+      const int t = d->threshold;
+      for (uint16_t x = 0; x < width; x++) {
+        int v = gray[x] + ((cur[x] + 4) >> 3);
+        int on = v > t;
+        int err = v - (on ? 255 : 0);
+        levels[x] = (uint8_t)on;
+        cur[x + 1] += (int16_t)err;
+        cur[x + 2] += (int16_t)err;
+        next[x - 1] += (int16_t)err;
+        next[x] += (int16_t)err;
+        next[x + 1] += (int16_t)err;
+        next2[x] += (int16_t)err;
+      }
+      rotateErrorRows(d, 3);
+      break;
+    }
+
+    default:
+      memset(levels, 0, width);
+      break;
+  }
+
+  packLevels(levels, monoRow, width);
+  d->row++;
+}
+
+bool ditherImage(DitherMode mode, const uint8_t* gray, uint8_t* mono,
+                 uint16_t width, uint16_t height, uint8_t threshold) {
+  static Ditherer ditherer;
+  if (!ditherBegin(&ditherer, mode, width, threshold)) return false;
+
+  const uint16_t byteWidth = (width + 7) / 8;
+  for (uint16_t y = 0; y < height; y++) {
+    ditherRow(&ditherer, gray + (size_t)y * width, mono + (size_t)y * byteWidth);
+  }
+  return true;
+}
@@ -0,0 +1,74 @@
+#include "frame_gray.h"
+#include "jpeg_decoder.h"
+#include "image_scaler.h"
+
+static void onScaleRow(const uint8_t* row, uint16_t width, uint16_t y, void* ctx) {
+  areaScalerPushRow((AreaScaler*)ctx, row, 1);
+}
+
+bool jpegToGrayscale(const uint8_t* jpegData, size_t jpegSize,
+                     uint8_t* grayBuffer, uint16_t targetWidth, uint16_t targetHeight,
+                     uint16_t stride) {
+  JpegInfo info;
+  if (!jpegGetInfo(jpegData, jpegSize, &info)) {
+    return false;
+  }
+  JpegScale scale = jpegPickScale(info, targetWidth, targetHeight);
+
+  static AreaScaler scaler;
+  if (!areaScalerBegin(&scaler, jpegScaledSize(info.width, scale), jpegScaledSize(info.height, scale),
+                       grayBuffer, targetWidth, targetHeight, stride)) {
+    return false;
+  }
+  return jpegDecodeLuma(jpegData, jpegSize, scale, onScaleRow, &scaler);
+}
+
+bool lumaToGrayscale(const uint8_t* luma, uint16_t srcWidth, uint16_t srcHeight, uint8_t pixelStep,
+                     uint8_t* grayBuffer, uint16_t targetWidth, uint16_t targetHeight,
+                     uint16_t stride) {
+  static AreaScaler scaler;
+  if (!areaScalerBegin(&scaler, srcWidth, srcHeight, grayBuffer, targetWidth, targetHeight, stride)) {
+    return false;
+  }
+  size_t rowBytes = (size_t)srcWidth * pixelStep;
+  for (uint16_t y = 0; y < srcHeight; y++) {
+    areaScalerPushRow(&scaler, luma + y * rowBytes, pixelStep);
+  }
+  return true;
+}
+
+bool frameToGrayscale(const camera_fb_t* fb, uint8_t* grayBuffer,
+                      uint16_t targetWidth, uint16_t targetHeight, uint16_t stride) {
+  switch (fb->format) {
+    case PIXFORMAT_JPEG:
+      return jpegToGrayscale(fb->buf, fb->len, grayBuffer, targetWidth, targetHeight, stride);
+    case PIXFORMAT_GRAYSCALE:
+      return lumaToGrayscale(fb->buf, fb->width, fb->height, 1, grayBuffer, targetWidth, targetHeight, stride);
+    case PIXFORMAT_YUV422:
+      return lumaToGrayscale(fb->buf, fb->width, fb->height, 2, grayBuffer, targetWidth, targetHeight, stride);
+    default:
+      return false;
+  }
+}
+
+static void onStatsRow(const uint8_t* row, uint16_t width, uint16_t y, void* ctx) {
+  lumaStatsAddRow((LumaStats*)ctx, row, width, 1);
+}
+
+bool frameLumaStats(const camera_fb_t* fb, LumaStats* stats) {
+  switch (fb->format) {
+    case PIXFORMAT_GRAYSCALE:
+      lumaStatsCompute(stats, fb->buf, fb->width, fb->height, fb->width, 1);
+      return true;
+    case PIXFORMAT_YUV422:
+      lumaStatsCompute(stats, fb->buf, fb->width, fb->height, fb->width * 2, 2);
+      return true;
+    case PIXFORMAT_JPEG:
+      lumaStatsBegin(stats);
+      if (!jpegDecodeLuma(fb->buf, fb->len, JPEG_SCALE_1_8, onStatsRow, stats)) return false;
+      lumaStatsFinish(stats);
+      return true;
+    default:
+      return false;
+  }
+}
@@ -0,0 +1,187 @@
+#include <Arduino.h>
+#include "esp_camera.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include "frame_recorder.h"
+#include "camera_lock.h"
+
+#define RECORDER_TASK_STACK  4096
+#define RECORDER_TASK_CORE   1
+
+static FrameRing frameRing;
+static uint8_t* recorderArena = NULL;
+static uint32_t recorderArenaSize = 0;
+static SemaphoreHandle_t recorderLock = NULL;
+static TaskHandle_t recorderTask = NULL;
+static volatile bool recorderRunning = false;
+static uint32_t recorderIntervalMs = 0;
+static uint32_t recorderCaptureFailures = 0;
+static uint32_t recorderCopyUs = 0;
+
+static void recorderTaskMain(void* param) {
+  while (recorderRunning) {
+    uint32_t start = millis();
+    camera_fb_t* fb = esp_camera_fb_get();
+    if (!fb) {
+      recorderCaptureFailures++;
+      vTaskDelay(pdMS_TO_TICKS(100));
+      continue;
+    }
+    if (fb->format == PIXFORMAT_JPEG) {
+      uint32_t copyStart = micros();
+      xSemaphoreTake(recorderLock, portMAX_DELAY);
+      frameRingPush(&frameRing, fb->buf, fb->len, start);
+      xSemaphoreGive(recorderLock);
+      recorderCopyUs = micros() - copyStart;
+    }
+    esp_camera_fb_return(fb);
+
+    uint32_t elapsed = millis() - start;
+    if (elapsed < recorderIntervalMs) {
+      vTaskDelay(pdMS_TO_TICKS(recorderIntervalMs - elapsed));
+    }
+  }
+  recorderTask = NULL;
+  vTaskDelete(NULL);
+}
+
+bool startFrameRecorder(uint32_t arenaBytes, uint8_t maxFrames, uint32_t intervalMs) {
+  if (recorderRunning || recorderTask) {
+    Serial.println("Frame recorder already running");
+    return false;
+  }
+  if (esp_camera_sensor_get() == NULL) {
+    Serial.println("Frame recorder: camera not initialized");
+    return false;
+  }
+  if (!recorderLock) {
+    recorderLock = xSemaphoreCreateMutex();
+    if (!recorderLock) return false;
+  }
+
+  // 上次录下的帧可能还在上传中：重新初始化arena会清掉固定标记并覆盖这些帧，此时拒绝启动
+  xSemaphoreTake(recorderLock, portMAX_DELAY);
+  uint8_t pinned = frameRingPinnedCount(&frameRing);
+  if (pinned > 0) {
+    xSemaphoreGive(recorderLock);
+    Serial.printf("Frame recorder: %d recorded frames still in use, release them before restarting\n", pinned);
+    return false;
+  }
+  if (recorderArenaSize < arenaBytes) {
+    free(recorderArena);
+    recorderArena = (uint8_t*)(psramFound() ? ps_malloc(arenaBytes) : malloc(arenaBytes));
+    recorderArenaSize = recorderArena ? arenaBytes : 0;
+  }
+  if (!recorderArena) {
+    frameRingInit(&frameRing, NULL, 0, maxFrames);
+    xSemaphoreGive(recorderLock);
+    Serial.println("Frame recorder: arena allocation failed");
+    return false;
+  }
+  frameRingInit(&frameRing, recorderArena, arenaBytes, maxFrames);
+  xSemaphoreGive(recorderLock);
+
+  // 流水线和实时预览一直占着帧缓冲，与它们同时取帧谁都拿不到稳定的帧率
+  cameraLock();
+  uint8_t busy = cameraUsers();
+  bool claimed = busy == 0 && cameraUserBegin(CAMERA_USER_RECORDER);
+  cameraUnlock();
+  if (!claimed) {
+    Serial.printf("Frame recorder: camera busy (%s)\n", cameraUserName(busy));
+    return false;
+  }
+  recorderIntervalMs = intervalMs;
+  recorderCaptureFailures = 0;
+  recorderRunning = true;
+
+  // 句柄直接写入recorderTask，任务退出时的清空不会被这里覆盖
+  if (xTaskCreatePinnedToCore(recorderTaskMain, "frame_recorder", RECORDER_TASK_STACK,
+                              NULL, 4, &recorderTask, RECORDER_TASK_CORE) != pdPASS) {
+    recorderTask = NULL;
+    recorderRunning = false;
+    cameraUserEnd(CAMERA_USER_RECORDER);
+    Serial.println("Frame recorder: failed to start task");
+    return false;
+  }
+  Serial.printf("Frame recorder started: %lu bytes in %s, up to %d frames every %lu ms\n",
+                (unsigned long)arenaBytes, psramFound() ? "PSRAM" : "DRAM",
+                frameRing.capacity, (unsigned long)intervalMs);
+  return true;
+}
+
+void stopFrameRecorder() {
+  recorderRunning = false;
+  uint32_t start = millis();
+  while (recorderTask && millis() - start < 2000) {
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+  if (recorderTask) {
+    Serial.println("Frame recorder: task did not exit in time");
+    return;
+  }
+  cameraUserEnd(CAMERA_USER_RECORDER);
+  Serial.println("Frame recorder stopped");
+}
+
+bool frameRecorderRunning() {
+  return recorderRunning;
+}
+
+bool frameRecorderAcquireLatest(FrameRef* ref) {
+  if (!recorderLock) return false;
+  xSemaphoreTake(recorderLock, portMAX_DELAY);
+  bool ok = frameRingPeek(&frameRing, 0, ref);
+  if (ok) frameRingPin(&frameRing, ref);
+  xSemaphoreGive(recorderLock);
+  return ok;
+}
+
+bool frameRecorderAcquireAt(uint32_t offsetMs, FrameRef* ref) {
+  if (!recorderLock) return false;
+  xSemaphoreTake(recorderLock, portMAX_DELAY);
+  bool ok = frameRingFindAt(&frameRing, millis(), offsetMs, ref);
+  if (ok) frameRingPin(&frameRing, ref);
+  xSemaphoreGive(recorderLock);
+  return ok;
+}
+
+void frameRecorderRelease(const FrameRef* ref) {
+  if (!recorderLock) return;
+  xSemaphoreTake(recorderLock, portMAX_DELAY);
+  frameRingUnpin(&frameRing, ref);
+  xSemaphoreGive(recorderLock);
+}
+
+void getFrameRecorderStats(FrameRecorderStats* stats) {
+  memset(stats, 0, sizeof(*stats));
+  if (!recorderLock) return;
+  xSemaphoreTake(recorderLock, portMAX_DELAY);
+  stats->ring = frameRing.stats;
+  stats->frames = frameRing.count;
+  stats->capacity = frameRing.capacity;
+  stats->arenaBytes = frameRing.arenaSize;
+  FrameRef newest, oldest;
+  if (frameRingPeek(&frameRing, 0, &newest) && frameRingPeek(&frameRing, frameRing.count - 1, &oldest)) {
+    stats->spanMs = newest.timestampMs - oldest.timestampMs;
+  }
+  xSemaphoreGive(recorderLock);
+  stats->captureFailures = recorderCaptureFailures;
+  stats->copyUs = recorderCopyUs;
+}
+
+void printFrameRecorderStats() {
+  FrameRecorderStats stats;
+  getFrameRecorderStats(&stats);
+  Serial.printf("Frame recorder: %d/%d frames covering %lu ms, %lu/%lu bytes used (peak %lu), "
+                "avg frame %lu bytes, copy %lu us\n",
+                stats.frames, stats.capacity, (unsigned long)stats.spanMs,
+                (unsigned long)stats.ring.bytesUsed, (unsigned long)stats.arenaBytes,
+                (unsigned long)stats.ring.peakBytesUsed,
+                (unsigned long)(stats.frames ? stats.ring.bytesUsed / stats.frames : 0),
+                (unsigned long)stats.copyUs);
+  Serial.printf("  stored %lu, evicted %lu, dropped %lu (pinned) / %lu (too large), capture failures %lu\n",
+                (unsigned long)stats.ring.stored, (unsigned long)stats.ring.evicted,
+                (unsigned long)stats.ring.droppedPinned, (unsigned long)stats.ring.droppedTooLarge,
+                (unsigned long)stats.captureFailures);
+}
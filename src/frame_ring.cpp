@@ -0,0 +1,142 @@
+#include "frame_ring.h"
+#include <string.h>
+
+void frameRingInit(FrameRing* ring, uint8_t* arena, uint32_t arenaSize, uint8_t capacity) {
+  memset(ring, 0, sizeof(*ring));
+  ring->arena = arena;
+  ring->arenaSize = arenaSize;
+  ring->capacity = capacity == 0 || capacity > FRAME_RING_MAX_SLOTS ? FRAME_RING_MAX_SLOTS : capacity;
+}
+
+static inline uint8_t slotIndex(const FrameRing* ring, uint8_t i) {
+  return (uint8_t)((ring->head + i) % ring->capacity);
+}
+
+// 在不淘汰的前提下为length字节找位置，找不到返回false
+static bool findSpace(const FrameRing* ring, uint32_t length, uint32_t* offset) {
+  if (ring->count == 0) {
+    *offset = 0;
+    return length <= ring->arenaSize;
+  }
+  const FrameSlot& oldest = ring->slots[ring->head];
+  const FrameSlot& newest = ring->slots[slotIndex(ring, ring->count - 1)];
+  uint32_t tail = oldest.offset;
+  uint32_t write = newest.offset + newest.length;
+
+  if (write > tail) {
+    // 数据区为[tail, write)：先试尾部，再绕回开头
+    if (write + length <= ring->arenaSize) {
+      *offset = write;
+      return true;
+    }
+    if (length <= tail) {
+      *offset = 0;
+      return true;
+    }
+    return false;
+  }
+  // 已绕回：空闲区为[write, tail)
+  if (write + length <= tail) {
+    *offset = write;
+    return true;
+  }
+  return false;
+}
+
+static void evictOldest(FrameRing* ring) {
+  ring->stats.bytesUsed -= ring->slots[ring->head].length;
+  ring->head = slotIndex(ring, 1);
+  ring->count--;
+  ring->stats.evicted++;
+}
+
+bool frameRingPush(FrameRing* ring, const uint8_t* data, size_t length, uint32_t timestampMs) {
+  if (length == 0 || length > ring->arenaSize) {
+    ring->stats.droppedTooLarge++;
+    return false;
+  }
+
+  uint32_t offset = 0;
+  while (ring->count == ring->capacity || !findSpace(ring, (uint32_t)length, &offset)) {
+    if (ring->slots[ring->head].pins > 0) {
+      ring->stats.droppedPinned++;
+      return false;
+    }
+    evictOldest(ring);
+  }
+
+  memcpy(ring->arena + offset, data, length);
+  FrameSlot& slot = ring->slots[slotIndex(ring, ring->count)];
+  slot.offset = offset;
+  slot.length = (uint32_t)length;
+  slot.timestampMs = timestampMs;
+  slot.sequence = ring->nextSequence++;
+  slot.pins = 0;
+  ring->count++;
+
+  ring->stats.stored++;
+  ring->stats.bytesUsed += (uint32_t)length;
+  if (ring->stats.bytesUsed > ring->stats.peakBytesUsed) ring->stats.peakBytesUsed = ring->stats.bytesUsed;
+  return true;
+}
+
+static void fillRef(const FrameRing* ring, uint8_t index, FrameRef* ref) {
+  const FrameSlot& slot = ring->slots[index];
+  ref->data = ring->arena + slot.offset;
+  ref->length = slot.length;
+  ref->timestampMs = slot.timestampMs;
+  ref->sequence = slot.sequence;
+  ref->slot = index;
+}
+
+bool frameRingPeek(const FrameRing* ring, uint8_t back, FrameRef* ref) {
+  if (back >= ring->count) return false;
+  fillRef(ring, slotIndex(ring, ring->count - 1 - back), ref);
+  return true;
+}
+
+static inline uint32_t timeDistance(uint32_t a, uint32_t b) {
+  return a > b ? a - b : b - a;
+}
+
+bool frameRingFindAt(const FrameRing* ring, uint32_t nowMs, uint32_t offsetMs, FrameRef* ref) {
+  if (ring->count == 0) return false;
+  const FrameSlot& newest = ring->slots[slotIndex(ring, ring->count - 1)];
+  const FrameSlot& oldest = ring->slots[ring->head];
+  uint32_t target = nowMs - offsetMs;
+
+  // 按平均帧间隔估算距最新帧的帧数（时间戳单调递增）
+  int back = 0;
+  uint32_t span = newest.timestampMs - oldest.timestampMs;
+  if (ring->count > 1 && span > 0) {
+    int32_t ago = (int32_t)(newest.timestampMs - target);
+    if (ago > 0) back = (int)((uint64_t)ago * (ring->count - 1) / span);
+  }
+  if (back > ring->count - 1) back = ring->count - 1;
+
+  // 帧间隔不均匀时向两侧移动到最近的帧
+  auto timeAt = [&](int b) { return ring->slots[slotIndex(ring, ring->count - 1 - b)].timestampMs; };
+  while (back > 0 && timeDistance(timeAt(back - 1), target) <= timeDistance(timeAt(back), target)) back--;
+  while (back < ring->count - 1 && timeDistance(timeAt(back + 1), target) < timeDistance(timeAt(back), target)) back++;
+
+  fillRef(ring, slotIndex(ring, ring->count - 1 - back), ref);
+  return true;
+}
+
+void frameRingPin(FrameRing* ring, const FrameRef* ref) {
+  FrameSlot& slot = ring->slots[ref->slot];
+  if (slot.sequence == ref->sequence && slot.pins < 255) slot.pins++;
+}
+
+void frameRingUnpin(FrameRing* ring, const FrameRef* ref) {
+  FrameSlot& slot = ring->slots[ref->slot];
+  if (slot.sequence == ref->sequence && slot.pins > 0) slot.pins--;
+}
+
+uint8_t frameRingPinnedCount(const FrameRing* ring) {
+  uint8_t pinned = 0;
+  for (uint8_t i = 0; i < ring->count; i++) {
+    if (ring->slots[slotIndex(ring, i)].pins > 0) pinned++;
+  }
+  return pinned;
+}
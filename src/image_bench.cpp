@@ -0,0 +1,111 @@
+#include "image_bench.h"
+#include "image_scaler.h"
+#include "luma_stats.h"
+#include "mono_blit.h"
+#include <string.h>
+
+// 黄金值由当前实现生成；有意改变输出时重新生成并在提交中说明
+const ImageBenchCase imageBenchCases[] = {
+  {"gradient QQVGA", IMAGE_PATTERN_GRADIENT, 160, 120, 1, 42, 32,
+   {0x74081F3Fu, 0x0DFA037Bu, 0x257C48D5u, 0x4EE22E99u, 0x58FC6BCAu}, 0x642F4F06u},
+  {"blocks QQVGA", IMAGE_PATTERN_BLOCKS, 160, 120, 1, 42, 32,
+   {0xF42BF822u, 0x854F4932u, 0x3D9ACE67u, 0xF4204746u, 0xBA24594Cu}, 0xDB6D415Du},
+  {"rings QVGA YUYV", IMAGE_PATTERN_RINGS, 320, 240, 2, 42, 32,
+   {0xCB092522u, 0x3BFC77D1u, 0xA370DFFAu, 0x456D233Bu, 0x919480DFu}, 0x32BDE90Au},
+  {"dark QVGA", IMAGE_PATTERN_DARK, 320, 240, 1, 42, 32,
+   {0xAC5D248Au, 0xC8AB3A5Du, 0xD50E88EDu, 0x1EFF65FAu, 0x4A4A9677u}, 0xBEC150DDu},
+  {"rings 256x64", IMAGE_PATTERN_RINGS, 256, 64, 1, 128, 32,
+   {0xA7E9109Au, 0xB33E8AB8u, 0xD6E88185u, 0xB73CE80Fu, 0x0F51349Eu}, 0x6E70A1E7u},
+  {"blocks 128x32", IMAGE_PATTERN_BLOCKS, 128, 32, 1, 128, 32,
+   {0xA501E8C5u, 0xF390D0B1u, 0xF945E975u, 0x0664E630u, 0x9DACAA76u}, 0xF209B88Bu},
+};
+const uint8_t imageBenchCaseCount = sizeof(imageBenchCases) / sizeof(imageBenchCases[0]);
+
+size_t imageBenchFrameSize(const ImageBenchCase* c) {
+  return (size_t)c->width * c->height * c->pixelStep;
+}
+
+// 线性同余伪随机数，各平台结果一致
+static inline uint32_t nextRandom(uint32_t* state) {
+  *state = *state * 1664525u + 1013904223u;
+  return *state >> 24;
+}
+
+static uint8_t patternPixel(const ImageBenchCase* c, uint16_t x, uint16_t y, uint32_t* seed) {
+  switch (c->pattern) {
+    case IMAGE_PATTERN_GRADIENT:
+      return (uint8_t)(((uint32_t)x * 255 / (c->width - 1) + (uint32_t)y * 255 / (c->height - 1)) / 2);
+    case IMAGE_PATTERN_BLOCKS: {
+      int base = (((x / 16) + (y / 16)) & 1) ? 200 : 50;
+      int value = base + (int)nextRandom(seed) / 4 - 32;
+      return (uint8_t)(value < 0 ? 0 : value > 255 ? 255 : value);
+    }
+    case IMAGE_PATTERN_RINGS: {
+      int32_t dx = (int32_t)x - c->width / 2;
+      int32_t dy = (int32_t)y - c->height / 2;
+      return (uint8_t)(((uint32_t)(dx * dx + dy * dy) >> 4) & 0xFF);
+    }
+    case IMAGE_PATTERN_DARK:
+    default:
+      return (uint8_t)(nextRandom(seed) >> 3) + (uint8_t)(y * 16 / c->height);
+  }
+}
+
+void imageBenchFill(const ImageBenchCase* c, uint8_t* frame) {
+  uint32_t seed = 12345;
+  for (uint16_t y = 0; y < c->height; y++) {
+    for (uint16_t x = 0; x < c->width; x++) {
+      uint8_t* p = frame + ((size_t)y * c->width + x) * c->pixelStep;
+      p[0] = patternPixel(c, x, y, &seed);
+      if (c->pixelStep == 2) p[1] = (uint8_t)(x & 1 ? 0x90 : 0x70);  // 色度，缩放时应被跳过
+    }
+  }
+}
+
+static inline uint16_t offsetX(const ImageBenchCase* c) {
+  return (IMAGE_BENCH_DISPLAY_WIDTH - c->dstWidth) / 2;
+}
+
+static inline uint16_t offsetY(const ImageBenchCase* c) {
+  return (IMAGE_BENCH_DISPLAY_HEIGHT - c->dstHeight) / 2;
+}
+
+bool imageBenchScale(const ImageBenchCase* c, const uint8_t* frame, ImageBenchBuffers* b) {
+  memset(b->gray, 0, sizeof(b->gray));
+  uint8_t* region = b->gray + offsetY(c) * IMAGE_BENCH_DISPLAY_WIDTH + offsetX(c);
+  static AreaScaler scaler;
+  if (!areaScalerBegin(&scaler, c->width, c->height, region, c->dstWidth, c->dstHeight,
+                       IMAGE_BENCH_DISPLAY_WIDTH)) {
+    return false;
+  }
+  size_t stride = (size_t)c->width * c->pixelStep;
+  for (uint16_t y = 0; y < c->height; y++) {
+    areaScalerPushRow(&scaler, frame + y * stride, c->pixelStep);
+  }
+  return true;
+}
+
+uint8_t imageBenchThreshold(const ImageBenchCase* c, const ImageBenchBuffers* b, DitherMode mode) {
+  static LumaStats stats;
+  const uint8_t* region = b->gray + offsetY(c) * IMAGE_BENCH_DISPLAY_WIDTH + offsetX(c);
+  lumaStatsCompute(&stats, region, c->dstWidth, c->dstHeight, IMAGE_BENCH_DISPLAY_WIDTH, 1);
+  return mode == DITHER_THRESHOLD ? lumaOtsuThreshold(&stats) : lumaDitherThreshold(&stats);
+}
+
+bool imageBenchDither(ImageBenchBuffers* b, DitherMode mode, uint8_t threshold) {
+  return ditherImage(mode, b->gray, b->mono, IMAGE_BENCH_DISPLAY_WIDTH, IMAGE_BENCH_DISPLAY_HEIGHT, threshold);
+}
+
+void imageBenchPack(ImageBenchBuffers* b) {
+  monoBlitToPages(b->mono, IMAGE_BENCH_DISPLAY_WIDTH, IMAGE_BENCH_DISPLAY_HEIGHT,
+                  b->pages, IMAGE_BENCH_DISPLAY_WIDTH, IMAGE_BENCH_DISPLAY_HEIGHT / 8);
+}
+
+uint32_t imageBenchChecksum(const uint8_t* data, size_t length) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    h ^= data[i];
+    h *= 16777619u;
+  }
+  return h;
+}
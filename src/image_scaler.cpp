@@ -0,0 +1,107 @@
+#include "image_scaler.h"
+#include <string.h>
+
+// 坐标约定：水平方向上源像素x覆盖 [x*dstWidth, (x+1)*dstWidth)，
+// 目标像素dx覆盖 [dx*srcWidth, (dx+1)*srcWidth)，两者重叠长度即为权重，
+// 每个目标像素的权重和恰为srcWidth；垂直方向同理。
+// 缩小时一个源像素最多跨越一个目标像素边界。
+
+bool areaScalerBegin(AreaScaler* s, uint16_t srcWidth, uint16_t srcHeight,
+                     uint8_t* dst, uint16_t dstWidth, uint16_t dstHeight, uint16_t dstStride) {
+  if (dstWidth == 0 || dstHeight == 0 || dstWidth > AREA_SCALER_MAX_WIDTH) return false;
+  if (dstWidth > srcWidth || dstHeight > srcHeight) return false;
+
+  s->srcWidth = srcWidth;
+  s->srcHeight = srcHeight;
+  s->dstWidth = dstWidth;
+  s->dstHeight = dstHeight;
+  s->dst = dst;
+  s->dstStride = dstStride;
+  s->dstRow = 0;
+  s->rowEnd = 0;
+  s->rowBoundary = srcHeight;
+
+  uint32_t total = (uint32_t)srcWidth * srcHeight;
+  s->reciprocal = (((uint64_t)1 << 32) + total - 1) / total;
+  memset(s->acc, 0, sizeof(s->acc));
+  return true;
+}
+
+static void emitRow(AreaScaler* s) {
+  uint8_t* out = s->dst + s->dstRow * s->dstStride;
+  for (int dx = 0; dx < s->dstWidth; dx++) {
+    uint32_t v = (uint32_t)(((uint64_t)s->acc[dx] * s->reciprocal + ((uint64_t)1 << 31)) >> 32);
+    out[dx] = v > 255 ? 255 : (uint8_t)v;
+  }
+}
+
+void areaScalerPushRow(AreaScaler* s, const uint8_t* row, uint8_t pixelStep) {
+  if (s->dstRow >= s->dstHeight) return;
+
+  // 水平方向：按覆盖长度加权求和
+  const uint32_t dw = s->dstWidth;
+  const uint32_t sw = s->srcWidth;
+  uint32_t* hsum = s->hsum;
+  memset(hsum, 0, dw * sizeof(uint32_t));
+
+  uint32_t end = 0;
+  uint32_t boundary = sw;
+  uint16_t dx = 0;
+  for (uint32_t x = 0; x < sw; x++) {
+    uint32_t p = row[x * pixelStep];
+    end += dw;
+    if (end < boundary) {
+      hsum[dx] += p * dw;
+    } else {
+      uint32_t over = end - boundary;  // 落入下一个目标像素的部分
+      hsum[dx] += p * (dw - over);
+      dx++;
+      boundary += sw;
+      if (over) hsum[dx] += p * over;
+    }
+  }
+
+  // 垂直方向：同样按覆盖长度累加到目标行
+  const uint32_t dh = s->dstHeight;
+  uint32_t* acc = s->acc;
+  s->rowEnd += dh;
+  if (s->rowEnd < s->rowBoundary) {
+    for (uint32_t i = 0; i < dw; i++) acc[i] += hsum[i] * dh;
+    return;
+  }
+
+  uint32_t over = s->rowEnd - s->rowBoundary;
+  uint32_t inside = dh - over;
+  for (uint32_t i = 0; i < dw; i++) acc[i] += hsum[i] * inside;
+  emitRow(s);
+  s->dstRow++;
+  s->rowBoundary += s->srcHeight;
+  for (uint32_t i = 0; i < dw; i++) acc[i] = hsum[i] * over;
+}
+
+// 最近邻：目标像素中心 (dx + 1/2) * srcWidth / dstWidth 所在的源像素
+static void scaleNearest(const uint8_t* srcImage, uint16_t srcWidth, uint16_t srcHeight,
+                         uint8_t* dstImage, uint16_t dstWidth, uint16_t dstHeight) {
+  for (uint32_t dy = 0; dy < dstHeight; dy++) {
+    uint32_t sy = (2 * dy + 1) * srcHeight / (2 * (uint32_t)dstHeight);
+    const uint8_t* row = srcImage + (size_t)sy * srcWidth;
+    uint8_t* out = dstImage + (size_t)dy * dstWidth;
+    for (uint32_t dx = 0; dx < dstWidth; dx++) {
+      out[dx] = row[(2 * dx + 1) * srcWidth / (2 * (uint32_t)dstWidth)];
+    }
+  }
+}
+
+bool scaleGrayscaleImage(const uint8_t* srcImage, uint16_t srcWidth, uint16_t srcHeight,
+                         uint8_t* dstImage, uint16_t dstWidth, uint16_t dstHeight) {
+  if (srcWidth == 0 || srcHeight == 0 || dstWidth == 0 || dstHeight == 0) return false;
+  static AreaScaler scaler;
+  if (!areaScalerBegin(&scaler, srcWidth, srcHeight, dstImage, dstWidth, dstHeight, dstWidth)) {
+    scaleNearest(srcImage, srcWidth, srcHeight, dstImage, dstWidth, dstHeight);
+    return true;
+  }
+  for (uint16_t y = 0; y < srcHeight; y++) {
+    areaScalerPushRow(&scaler, srcImage + (size_t)y * srcWidth, 1);
+  }
+  return true;
+}
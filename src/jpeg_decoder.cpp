@@ -0,0 +1,790 @@
+#include "jpeg_decoder.h"
+#include <stdlib.h>
+#include <string.h>
+
+// 快速查表的位数，9位可覆盖摄像头码表中绝大多数码字
+#define JPEG_FAST_BITS 9
+
+// 之字形扫描顺序 -> 自然顺序，末尾填充用于防止损坏码流越界
+static const uint8_t kZigzag[64 + 16] = {
+   0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+  12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+  35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+  58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+  63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63
+};
+
+struct HuffTable {
+  uint16_t fast[1 << JPEG_FAST_BITS]; // (码长 << 8) | 符号，0表示走慢速路径
+  int32_t maxCode[17];                // 每个码长的最大码字，-1表示该长度无码字
+  int32_t valOffset[17];              // 码字 -> values下标的偏移
+  uint8_t values[256];
+  uint16_t encCode[256];              // 符号 -> 码字，裁剪重新编码时使用
+  uint8_t encLength[256];             // 符号 -> 码长，0表示码表中没有该符号
+  bool defined;
+};
+
+struct JpegComponent {
+  uint8_t id;
+  uint8_t h;
+  uint8_t v;
+  uint8_t tq;  // 量化表
+  uint8_t td;  // DC码表
+  uint8_t ta;  // AC码表
+  int dcPred;
+};
+
+struct BitReader {
+  const uint8_t* p;
+  const uint8_t* end;
+  uint32_t buf;
+  int bits;
+  bool marker;  // 遇到标记后不再读入数据，只补0
+};
+
+struct JpegContext {
+  uint16_t qt[4][64];     // 之字形顺序
+  HuffTable dc[2];
+  HuffTable ac[2];
+  JpegComponent comp[3];
+  uint8_t compCount;
+  uint8_t scanOrder[3];   // 扫描中各分量在comp[]中的下标
+  uint8_t scanCount;
+  uint16_t width;
+  uint16_t height;
+  uint8_t hmax;
+  uint8_t vmax;
+  uint16_t restartInterval;
+  BitReader br;
+  int16_t coef[64];
+  uint8_t* band;          // 一个MCU行的亮度条带
+  size_t bandCapacity;
+};
+
+static JpegContext* s_ctx = NULL;
+
+static inline uint16_t readU16(const uint8_t* p) {
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static bool buildHuffTable(HuffTable* t, const uint8_t* counts, const uint8_t* symbols, int total) {
+  memset(t->fast, 0, sizeof(t->fast));
+  memset(t->encLength, 0, sizeof(t->encLength));
+  memcpy(t->values, symbols, total);
+
+  int code = 0;
+  int k = 0;
+  for (int len = 1; len <= 16; len++) {
+    int n = counts[len - 1];
+    t->valOffset[len] = k - code;
+    if (n == 0) {
+      t->maxCode[len] = -1;
+    } else {
+      if (code + n > (1 << len)) return false;  // 码表非法
+      for (int i = 0; i < n; i++) {
+        t->encCode[symbols[k + i]] = (uint16_t)(code + i);
+        t->encLength[symbols[k + i]] = (uint8_t)len;
+      }
+      for (int i = 0; i < n && len <= JPEG_FAST_BITS; i++) {
+        int first = (code + i) << (JPEG_FAST_BITS - len);
+        int span = 1 << (JPEG_FAST_BITS - len);
+        uint16_t entry = (uint16_t)((len << 8) | symbols[k + i]);
+        for (int j = 0; j < span; j++) t->fast[first + j] = entry;
+      }
+      t->maxCode[len] = code + n - 1;
+    }
+    code = (code + n) << 1;
+    k += n;
+  }
+  t->defined = true;
+  return true;
+}
+
+// ===================
+// 位读取
+// ===================
+static inline void fillBits(BitReader& br) {
+  while (br.bits <= 24) {
+    uint32_t b = 0;
+    if (!br.marker && br.p < br.end) {
+      b = *br.p++;
+      if (b == 0xFF) {
+        if (br.p < br.end && *br.p == 0x00) {
+          br.p++;  // 填充字节
+        } else {
+          br.marker = true;
+          br.p--;  // 停在标记上，留给重启间隔处理
+          b = 0;
+        }
+      }
+    }
+    br.buf |= b << (24 - br.bits);
+    br.bits += 8;
+  }
+}
+
+static inline void consumeBits(BitReader& br, int n) {
+  br.buf <<= n;
+  br.bits -= n;
+}
+
+static inline int getBits(BitReader& br, int n) {
+  if (br.bits < n) fillBits(br);
+  int v = (int)(br.buf >> (32 - n));
+  consumeBits(br, n);
+  return v;
+}
+
+static inline int extendSign(int v, int n) {
+  return v < (1 << (n - 1)) ? v - (1 << n) + 1 : v;
+}
+
+static inline int decodeHuff(BitReader& br, const HuffTable& t) {
+  if (br.bits < 16) fillBits(br);
+  uint16_t e = t.fast[br.buf >> (32 - JPEG_FAST_BITS)];
+  if (e) {
+    consumeBits(br, e >> 8);
+    return e & 0xFF;
+  }
+  uint32_t code16 = br.buf >> 16;
+  for (int len = JPEG_FAST_BITS + 1; len <= 16; len++) {
+    int32_t c = (int32_t)(code16 >> (16 - len));
+    if (c <= t.maxCode[len]) {
+      consumeBits(br, len);
+      return t.values[c + t.valOffset[len]];
+    }
+  }
+  return -1;  // 码流损坏
+}
+
+// ===================
+// 块解码
+// ===================
+// coef为NULL时只跳过AC系数。返回最后一个非零系数的之字形下标，出错返回-1
+static int decodeBlock(JpegContext* c, JpegComponent& comp, int16_t* coef) {
+  BitReader& br = c->br;
+  const HuffTable& dct = c->dc[comp.td];
+  const HuffTable& act = c->ac[comp.ta];
+  const uint16_t* q = c->qt[comp.tq];
+
+  int t = decodeHuff(br, dct);
+  if (t < 0 || t > 11) return -1;
+  int diff = t ? extendSign(getBits(br, t), t) : 0;
+  comp.dcPred += diff;
+
+  int last = 0;
+  if (coef) {
+    memset(coef, 0, 64 * sizeof(int16_t));
+    coef[0] = (int16_t)(comp.dcPred * q[0]);
+  }
+
+  for (int k = 1; k < 64;) {
+    int rs = decodeHuff(br, act);
+    if (rs < 0) return -1;
+    int r = rs >> 4;
+    int s = rs & 15;
+    if (s == 0) {
+      if (r != 15) break;  // EOB
+      k += 16;
+      continue;
+    }
+    k += r;
+    if (k > 63) return -1;
+    if (coef) {
+      int v = extendSign(getBits(br, s), s);
+      coef[kZigzag[k]] = (int16_t)(v * q[k]);
+      last = k;
+    } else {
+      if (br.bits < s) fillBits(br);
+      consumeBits(br, s);
+    }
+    k++;
+  }
+  return last;
+}
+
+static inline uint8_t clampPixel(int v) {
+  return v < 0 ? 0 : (v > 255 ? 255 : (uint8_t)v);
+}
+
+// 仅含DC的块，IDCT结果为常数 DC/8 + 128
+static inline uint8_t dcToPixel(int dequantDc) {
+  return clampPixel(128 + ((dequantDc + 4) >> 3));
+}
+
+// 整数IDCT（与libjpeg jidctint相同的LL&M分解，12位定点）
+#define FIX(x) ((int)((x) * 4096 + 0.5))
+
+static inline void idct1D(int s0, int s1, int s2, int s3, int s4, int s5, int s6, int s7,
+                          int& x0, int& x1, int& x2, int& x3,
+                          int& t0, int& t1, int& t2, int& t3) {
+  int p1 = (s2 + s6) * FIX(0.5411961);
+  t2 = p1 + s6 * FIX(-1.847759065);
+  t3 = p1 + s2 * FIX(0.765366865);
+  t0 = (s0 + s4) * 4096;
+  t1 = (s0 - s4) * 4096;
+  x0 = t0 + t3;
+  x3 = t0 - t3;
+  x1 = t1 + t2;
+  x2 = t1 - t2;
+
+  t0 = s7;
+  t1 = s5;
+  t2 = s3;
+  t3 = s1;
+  int p3 = t0 + t2;
+  int p4 = t1 + t3;
+  p1 = t0 + t3;
+  int p2 = t1 + t2;
+  int p5 = (p3 + p4) * FIX(1.175875602);
+  t0 = t0 * FIX(0.298631336);
+  t1 = t1 * FIX(2.053119869);
+  t2 = t2 * FIX(3.072711026);
+  t3 = t3 * FIX(1.501321110);
+  p1 = p5 + p1 * FIX(-0.899976223);
+  p2 = p5 + p2 * FIX(-2.562915447);
+  p3 = p3 * FIX(-1.961570560);
+  p4 = p4 * FIX(-0.390180644);
+  t3 += p1 + p4;
+  t2 += p2 + p3;
+  t1 += p2 + p4;
+  t0 += p1 + p3;
+}
+
+static void idctBlock(const int16_t* in, uint8_t* out, int stride) {
+  int tmp[64];
+
+  // 列变换
+  for (int i = 0; i < 8; i++) {
+    const int16_t* d = in + i;
+    int* v = tmp + i;
+    if (d[8] == 0 && d[16] == 0 && d[24] == 0 && d[32] == 0 &&
+        d[40] == 0 && d[48] == 0 && d[56] == 0) {
+      int dc = d[0] * 4;
+      v[0] = v[8] = v[16] = v[24] = v[32] = v[40] = v[48] = v[56] = dc;
+      continue;
+    }
+    int x0, x1, x2, x3, t0, t1, t2, t3;
+    idct1D(d[0], d[8], d[16], d[24], d[32], d[40], d[48], d[56],
+           x0, x1, x2, x3, t0, t1, t2, t3);
+    x0 += 512; x1 += 512; x2 += 512; x3 += 512;
+    v[0]  = (x0 + t3) >> 10;
+    v[56] = (x0 - t3) >> 10;
+    v[8]  = (x1 + t2) >> 10;
+    v[48] = (x1 - t2) >> 10;
+    v[16] = (x2 + t1) >> 10;
+    v[40] = (x2 - t1) >> 10;
+    v[24] = (x3 + t0) >> 10;
+    v[32] = (x3 - t0) >> 10;
+  }
+
+  // 行变换，同时加上128电平偏移
+  for (int i = 0; i < 8; i++) {
+    const int* v = tmp + i * 8;
+    uint8_t* o = out + i * stride;
+    int x0, x1, x2, x3, t0, t1, t2, t3;
+    idct1D(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7],
+           x0, x1, x2, x3, t0, t1, t2, t3);
+    const int bias = 65536 + (128 << 17);
+    x0 += bias; x1 += bias; x2 += bias; x3 += bias;
+    o[0] = clampPixel((x0 + t3) >> 17);
+    o[7] = clampPixel((x0 - t3) >> 17);
+    o[1] = clampPixel((x1 + t2) >> 17);
+    o[6] = clampPixel((x1 - t2) >> 17);
+    o[2] = clampPixel((x2 + t1) >> 17);
+    o[5] = clampPixel((x2 - t1) >> 17);
+    o[3] = clampPixel((x3 + t0) >> 17);
+    o[4] = clampPixel((x3 - t0) >> 17);
+  }
+}
+
+#undef FIX
+
+// ===================
+// 文件头解析
+// ===================
+// 解析到SOS为止，scanStart返回熵编码数据的起始位置
+static bool parseHeaders(JpegContext* c, const uint8_t* data, size_t len, size_t* scanStart) {
+  if (len < 4 || data[0] != 0xFF || data[1] != 0xD8) return false;
+
+  size_t pos = 2;
+  bool haveFrame = false;
+  while (pos + 4 <= len) {
+    if (data[pos] != 0xFF) return false;
+    uint8_t marker = data[pos + 1];
+    if (marker == 0xFF) { pos++; continue; }  // 填充
+    uint16_t segLen = readU16(data + pos + 2);
+    if (segLen < 2 || pos + 2 + segLen > len) return false;
+    const uint8_t* seg = data + pos + 4;
+    size_t n = segLen - 2;
+
+    switch (marker) {
+      case 0xC0:  // SOF0 基线
+      case 0xC1: {
+        if (n < 6 || seg[0] != 8) return false;
+        c->height = readU16(seg + 1);
+        c->width = readU16(seg + 3);
+        c->compCount = seg[5];
+        if (c->compCount != 1 && c->compCount != 3) return false;
+        if (n < 6 + 3u * c->compCount || c->width == 0 || c->height == 0) return false;
+        c->hmax = 1;
+        c->vmax = 1;
+        for (int i = 0; i < c->compCount; i++) {
+          JpegComponent& comp = c->comp[i];
+          comp.id = seg[6 + i * 3];
+          comp.h = seg[7 + i * 3] >> 4;
+          comp.v = seg[7 + i * 3] & 15;
+          comp.tq = seg[8 + i * 3] & 3;
+          if (comp.h < 1 || comp.h > 2 || comp.v < 1 || comp.v > 2) return false;
+          if (comp.h > c->hmax) c->hmax = comp.h;
+          if (comp.v > c->vmax) c->vmax = comp.v;
+        }
+        // 单分量图像的扫描不交织，MCU固定为一个8x8块
+        if (c->compCount == 1) {
+          c->comp[0].h = c->comp[0].v = 1;
+          c->hmax = c->vmax = 1;
+        }
+        // 只解码亮度，色度分量的采样必须是1x1
+        for (int i = 1; i < c->compCount; i++) {
+          if (c->comp[i].h != 1 || c->comp[i].v != 1) return false;
+        }
+        haveFrame = true;
+        break;
+      }
+      case 0xC2: case 0xC3: case 0xC5: case 0xC6: case 0xC7:
+      case 0xC9: case 0xCA: case 0xCB: case 0xCD: case 0xCE: case 0xCF:
+        return false;  // 渐进式/无损/算术编码不支持
+      case 0xDB: {  // DQT
+        size_t i = 0;
+        while (i < n) {
+          uint8_t pq = seg[i] >> 4;
+          uint8_t tq = seg[i] & 3;
+          i++;
+          if (pq == 0) {
+            if (i + 64 > n) return false;
+            for (int k = 0; k < 64; k++) c->qt[tq][k] = seg[i + k];
+            i += 64;
+          } else {
+            if (i + 128 > n) return false;
+            for (int k = 0; k < 64; k++) c->qt[tq][k] = readU16(seg + i + k * 2);
+            i += 128;
+          }
+        }
+        break;
+      }
+      case 0xC4: {  // DHT
+        size_t i = 0;
+        while (i + 17 <= n) {
+          uint8_t tc = seg[i] >> 4;
+          uint8_t th = seg[i] & 15;
+          if (tc > 1 || th > 1) return false;
+          const uint8_t* counts = seg + i + 1;
+          int total = 0;
+          for (int k = 0; k < 16; k++) total += counts[k];
+          if (total > 256 || i + 17 + total > n) return false;
+          HuffTable* t = tc == 0 ? &c->dc[th] : &c->ac[th];
+          if (!buildHuffTable(t, counts, seg + i + 17, total)) return false;
+          i += 17 + total;
+        }
+        break;
+      }
+      case 0xDD:  // DRI
+        if (n < 2) return false;
+        c->restartInterval = readU16(seg);
+        break;
+      case 0xDA: {  // SOS
+        if (!haveFrame || n < 1) return false;
+        c->scanCount = seg[0];
+        if (c->scanCount != c->compCount || n < 1 + 2u * c->scanCount + 3) return false;
+        for (int i = 0; i < c->scanCount; i++) {
+          uint8_t id = seg[1 + i * 2];
+          int idx = -1;
+          for (int j = 0; j < c->compCount; j++) {
+            if (c->comp[j].id == id) idx = j;
+          }
+          if (idx < 0) return false;
+          c->comp[idx].td = seg[2 + i * 2] >> 4;
+          c->comp[idx].ta = seg[2 + i * 2] & 15;
+          if (c->comp[idx].td > 1 || c->comp[idx].ta > 1) return false;
+          if (!c->dc[c->comp[idx].td].defined || !c->ac[c->comp[idx].ta].defined) return false;
+          c->scanOrder[i] = (uint8_t)idx;
+        }
+        *scanStart = pos + 2 + segLen;
+        return true;
+      }
+      default:
+        break;  // APPn/COM等直接跳过
+    }
+    pos += 2 + segLen;
+  }
+  return false;
+}
+
+bool jpegGetInfo(const uint8_t* data, size_t len, JpegInfo* info) {
+  if (len < 4 || data[0] != 0xFF || data[1] != 0xD8) return false;
+
+  // 只遍历段头找SOF，不需要完整的解码上下文
+  size_t pos = 2;
+  while (pos + 4 <= len) {
+    if (data[pos] != 0xFF) return false;
+    uint8_t marker = data[pos + 1];
+    if (marker == 0xFF) { pos++; continue; }
+    uint16_t segLen = readU16(data + pos + 2);
+    if (segLen < 2 || pos + 2 + segLen > len) return false;
+    if (marker == 0xC0 || marker == 0xC1) {
+      const uint8_t* seg = data + pos + 4;
+      if (segLen < 8 + 3 || seg[5] == 0 || segLen < 8 + 3u * seg[5]) return false;
+      uint8_t hmax = 1, vmax = 1;
+      if (seg[5] > 1) {
+        for (int i = 0; i < seg[5]; i++) {
+          uint8_t h = seg[7 + i * 3] >> 4;
+          uint8_t v = seg[7 + i * 3] & 15;
+          if (h > hmax) hmax = h;
+          if (v > vmax) vmax = v;
+        }
+      }
+      info->height = readU16(seg + 1);
+      info->width = readU16(seg + 3);
+      info->components = seg[5];
+      info->mcuWidth = hmax * 8;
+      info->mcuHeight = vmax * 8;
+      return true;
+    }
+    if (marker == 0xDA) return false;  // 扫描前没有基线SOF
+    pos += 2 + segLen;
+  }
+  return false;
+}
+
+uint16_t jpegScaledSize(uint16_t size, JpegScale scale) {
+  return (uint16_t)((size + (1 << scale) - 1) >> scale);
+}
+
+JpegScale jpegPickScale(const JpegInfo& info, uint16_t minWidth, uint16_t minHeight) {
+  if (jpegScaledSize(info.width, JPEG_SCALE_1_8) >= minWidth &&
+      jpegScaledSize(info.height, JPEG_SCALE_1_8) >= minHeight) {
+    return JPEG_SCALE_1_8;
+  }
+  return JPEG_SCALE_1_1;
+}
+
+// 处理重启间隔：丢弃剩余位，跳过RSTn标记，重置DC预测
+static bool handleRestart(JpegContext* c) {
+  BitReader& br = c->br;
+  const uint8_t* p = br.p;
+  while (p + 1 < br.end && !(p[0] == 0xFF && p[1] >= 0xD0 && p[1] <= 0xD7)) p++;
+  if (p + 1 >= br.end) return false;
+  br.p = p + 2;
+  br.buf = 0;
+  br.bits = 0;
+  br.marker = false;
+  for (int i = 0; i < c->compCount; i++) c->comp[i].dcPred = 0;
+  return true;
+}
+
+// 取得静态上下文并解析文件头
+static JpegContext* beginContext(const uint8_t* data, size_t len, size_t* scanStart) {
+  if (s_ctx == NULL) {
+    s_ctx = (JpegContext*)calloc(1, sizeof(JpegContext));
+    if (s_ctx == NULL) return NULL;
+  }
+  JpegContext* c = s_ctx;
+  c->dc[0].defined = c->dc[1].defined = false;
+  c->ac[0].defined = c->ac[1].defined = false;
+  c->restartInterval = 0;
+  return parseHeaders(c, data, len, scanStart) ? c : NULL;
+}
+
+static void beginScan(JpegContext* c, const uint8_t* data, size_t len, size_t scanStart) {
+  BitReader& br = c->br;
+  br.p = data + scanStart;
+  br.end = data + len;
+  br.buf = 0;
+  br.bits = 0;
+  br.marker = false;
+  for (int i = 0; i < c->compCount; i++) c->comp[i].dcPred = 0;
+}
+
+bool jpegDecodeLuma(const uint8_t* data, size_t len, JpegScale scale,
+                    JpegRowCallback onRow, void* ctx) {
+  size_t scanStart = 0;
+  JpegContext* c = beginContext(data, len, &scanStart);
+  if (c == NULL) return false;
+
+  const bool dcOnly = scale == JPEG_SCALE_1_8;
+  const int blockPx = dcOnly ? 1 : 8;
+  const int mcuW = c->hmax * 8;
+  const int mcuH = c->vmax * 8;
+  const int mcusX = (c->width + mcuW - 1) / mcuW;
+  const int mcusY = (c->height + mcuH - 1) / mcuH;
+  const int bandW = mcusX * c->hmax * blockPx;
+  const int bandH = c->vmax * blockPx;
+  const uint16_t outW = jpegScaledSize(c->width, scale);
+  const uint16_t outH = jpegScaledSize(c->height, scale);
+
+  size_t need = (size_t)bandW * bandH;
+  if (need > c->bandCapacity) {
+    uint8_t* band = (uint8_t*)realloc(c->band, need);
+    if (band == NULL) return false;
+    c->band = band;
+    c->bandCapacity = need;
+  }
+
+  beginScan(c, data, len, scanStart);
+
+  JpegComponent& luma = c->comp[0];
+  uint16_t restartsLeft = c->restartInterval;
+  uint16_t y = 0;
+
+  for (int my = 0; my < mcusY; my++) {
+    for (int mx = 0; mx < mcusX; mx++) {
+      if (c->restartInterval) {
+        if (restartsLeft == 0) {
+          if (!handleRestart(c)) return false;
+          restartsLeft = c->restartInterval;
+        }
+        restartsLeft--;
+      }
+
+      for (int s = 0; s < c->scanCount; s++) {
+        JpegComponent& comp = c->comp[c->scanOrder[s]];
+        if (&comp != &luma) {
+          if (decodeBlock(c, comp, NULL) < 0) return false;
+          continue;
+        }
+        for (int by = 0; by < comp.v; by++) {
+          for (int bx = 0; bx < comp.h; bx++) {
+            uint8_t* dst = c->band + (by * blockPx) * bandW + (mx * comp.h + bx) * blockPx;
+            if (dcOnly) {
+              // DC模式仍需解析AC码字以保持位流同步，但无需反量化
+              if (decodeBlock(c, comp, NULL) < 0) return false;
+              *dst = dcToPixel(comp.dcPred * c->qt[comp.tq][0]);
+              continue;
+            }
+            int last = decodeBlock(c, comp, c->coef);
+            if (last < 0) return false;
+            if (last == 0) {
+              memset(dst, dcToPixel(c->coef[0]), 8);
+              for (int r = 1; r < 8; r++) memcpy(dst + r * bandW, dst, 8);
+            } else {
+              idctBlock(c->coef, dst, bandW);
+            }
+          }
+        }
+      }
+    }
+
+    // 输出本MCU行
+    for (int r = 0; r < bandH && y < outH; r++, y++) {
+      onRow(c->band + r * bandW, outW, y, ctx);
+    }
+  }
+  return true;
+}
+
+// ===================
+// MCU级裁剪
+// ===================
+// 在熵编码层面裁剪：逐块Huffman解码出量化系数，只把裁剪区域内的块用原码表重新编码，
+// 每行起始块的DC差分按新的相邻关系重新计算。不做IDCT和量化，画质和颜色都不变。
+
+struct BitWriter {
+  uint8_t* p;
+  uint8_t* end;
+  uint32_t buf;
+  int bits;
+  bool overflow;
+};
+
+static inline void putByte(BitWriter& bw, uint8_t b) {
+  if (bw.end - bw.p < 2) {
+    bw.overflow = true;
+    return;
+  }
+  *bw.p++ = b;
+  if (b == 0xFF) *bw.p++ = 0x00;  // 填充字节
+}
+
+static inline void putBits(BitWriter& bw, uint32_t code, int n) {
+  bw.buf = (bw.buf << n) | (code & ((1u << n) - 1));
+  bw.bits += n;
+  while (bw.bits >= 8) {
+    bw.bits -= 8;
+    putByte(bw, (uint8_t)(bw.buf >> bw.bits));
+  }
+}
+
+static inline bool putHuff(BitWriter& bw, const HuffTable& t, int symbol) {
+  if (t.encLength[symbol] == 0) return false;  // 原码表不含该符号，无法无损裁剪
+  putBits(bw, t.encCode[symbol], t.encLength[symbol]);
+  return true;
+}
+
+static inline int bitCategory(int v) {
+  int a = v < 0 ? -v : v;
+  int n = 0;
+  while (a) {
+    n++;
+    a >>= 1;
+  }
+  return n;
+}
+
+static inline void putValue(BitWriter& bw, int v, int n) {
+  if (v < 0) v += (1 << n) - 1;
+  putBits(bw, (uint32_t)v, n);
+}
+
+// 解码一个块的量化系数（之字形顺序），zz[0]为DC绝对值
+static bool decodeBlockQuantized(JpegContext* c, JpegComponent& comp, int16_t* zz) {
+  BitReader& br = c->br;
+  int t = decodeHuff(br, c->dc[comp.td]);
+  if (t < 0 || t > 11) return false;
+  comp.dcPred += t ? extendSign(getBits(br, t), t) : 0;
+
+  memset(zz, 0, 64 * sizeof(int16_t));
+  zz[0] = (int16_t)comp.dcPred;
+  for (int k = 1; k < 64;) {
+    int rs = decodeHuff(br, c->ac[comp.ta]);
+    if (rs < 0) return false;
+    int r = rs >> 4;
+    int s = rs & 15;
+    if (s == 0) {
+      if (r != 15) break;
+      k += 16;
+      continue;
+    }
+    k += r;
+    if (k > 63) return false;
+    zz[k] = (int16_t)extendSign(getBits(br, s), s);
+    k++;
+  }
+  return true;
+}
+
+static bool encodeBlock(BitWriter& bw, const HuffTable& dct, const HuffTable& act,
+                        const int16_t* zz, int* dcPred) {
+  int diff = zz[0] - *dcPred;
+  *dcPred = zz[0];
+  int n = bitCategory(diff);
+  if (!putHuff(bw, dct, n)) return false;
+  if (n) putValue(bw, diff, n);
+
+  int run = 0;
+  for (int k = 1; k < 64; k++) {
+    int v = zz[k];
+    if (v == 0) {
+      run++;
+      continue;
+    }
+    while (run > 15) {
+      if (!putHuff(bw, act, 0xF0)) return false;  // ZRL
+      run -= 16;
+    }
+    n = bitCategory(v);
+    if (!putHuff(bw, act, (run << 4) | n)) return false;
+    putValue(bw, v, n);
+    run = 0;
+  }
+  if (run > 0 && !putHuff(bw, act, 0x00)) return false;  // EOB
+  return !bw.overflow;
+}
+
+// 复制文件头到SOS为止：改写SOF中的尺寸，去掉DRI（裁剪结果不含重启标记）
+static size_t writeCroppedHeaders(const uint8_t* data, size_t scanStart, uint16_t width, uint16_t height,
+                                  uint8_t* out, size_t capacity) {
+  if (capacity < scanStart) return 0;
+  size_t pos = 2;
+  size_t written = 2;
+  out[0] = 0xFF;
+  out[1] = 0xD8;
+  while (pos < scanStart) {
+    if (data[pos + 1] == 0xFF) { pos++; continue; }
+    uint8_t marker = data[pos + 1];
+    size_t segSize = 2 + readU16(data + pos + 2);
+    if (marker != 0xDD) {
+      memcpy(out + written, data + pos, segSize);
+      if (marker == 0xC0 || marker == 0xC1) {
+        uint8_t* seg = out + written + 4;
+        seg[1] = height >> 8;
+        seg[2] = height & 0xFF;
+        seg[3] = width >> 8;
+        seg[4] = width & 0xFF;
+      }
+      written += segSize;
+    }
+    pos += segSize;
+  }
+  return written;
+}
+
+bool jpegCropMcu(const uint8_t* data, size_t len, JpegRect* rect,
+                 uint8_t* out, size_t capacity, size_t* outLen) {
+  size_t scanStart = 0;
+  JpegContext* c = beginContext(data, len, &scanStart);
+  if (c == NULL) return false;
+
+  // 裁剪区域向外对齐到MCU边界
+  const int mcuW = c->hmax * 8;
+  const int mcuH = c->vmax * 8;
+  const int mcusX = (c->width + mcuW - 1) / mcuW;
+  const int mcusY = (c->height + mcuH - 1) / mcuH;
+  if (rect->width == 0 || rect->height == 0 || rect->x >= c->width || rect->y >= c->height) return false;
+  uint32_t right = (uint32_t)rect->x + rect->width;
+  uint32_t bottom = (uint32_t)rect->y + rect->height;
+  if (right > c->width) right = c->width;
+  if (bottom > c->height) bottom = c->height;
+  const int mx0 = rect->x / mcuW;
+  const int my0 = rect->y / mcuH;
+  const int mx1 = (int)((right + mcuW - 1) / mcuW);
+  const int my1 = (int)((bottom + mcuH - 1) / mcuH);
+
+  rect->x = (uint16_t)(mx0 * mcuW);
+  rect->y = (uint16_t)(my0 * mcuH);
+  rect->width = (uint16_t)((mx1 == mcusX ? c->width : mx1 * mcuW) - rect->x);
+  rect->height = (uint16_t)((my1 == mcusY ? c->height : my1 * mcuH) - rect->y);
+
+  size_t headerSize = writeCroppedHeaders(data, scanStart, rect->width, rect->height, out, capacity);
+  if (headerSize == 0) return false;
+
+  BitWriter bw = {out + headerSize, out + capacity - 2, 0, 0, false};  // 末尾留给EOI
+  int outPred[3] = {0, 0, 0};
+  int16_t zz[64];
+
+  beginScan(c, data, len, scanStart);
+  uint16_t restartsLeft = c->restartInterval;
+  for (int my = 0; my < my1; my++) {
+    for (int mx = 0; mx < mcusX; mx++) {
+      if (c->restartInterval) {
+        if (restartsLeft == 0) {
+          if (!handleRestart(c)) return false;
+          restartsLeft = c->restartInterval;
+        }
+        restartsLeft--;
+      }
+
+      const bool inside = my >= my0 && mx >= mx0 && mx < mx1;
+      for (int s = 0; s < c->scanCount; s++) {
+        const int ci = c->scanOrder[s];
+        JpegComponent& comp = c->comp[ci];
+        for (int b = 0; b < comp.h * comp.v; b++) {
+          if (!inside) {
+            // 区域外只需保持位流和DC预测同步
+            if (decodeBlock(c, comp, NULL) < 0) return false;
+            continue;
+          }
+          if (!decodeBlockQuantized(c, comp, zz)) return false;
+          if (!encodeBlock(bw, c->dc[comp.td], c->ac[comp.ta], zz, &outPred[ci])) return false;
+        }
+      }
+    }
+  }
+
+  // 最后不满一字节的位用1填充
+  if (bw.bits > 0) putBits(bw, 0xFF, 8 - bw.bits);
+  if (bw.overflow) return false;
+  bw.p[0] = 0xFF;
+  bw.p[1] = 0xD9;
+  *outLen = (size_t)(bw.p + 2 - out);
+  return true;
+}
@@ -0,0 +1,57 @@
+#include "latency_histogram.h"
+#include <string.h>
+
+// 0~3各占一个桶；之后每个[2^e, 2^(e+1))区间按最高两位以下的2位分为4档
+static uint8_t bucketIndex(uint32_t us) {
+  if (us < 4) return (uint8_t)us;
+  uint8_t e = 31 - __builtin_clz(us);
+  uint32_t index = 4 * (e - 1) + ((us >> (e - 2)) & 3);
+  return index < LATENCY_BUCKETS ? (uint8_t)index : LATENCY_BUCKETS - 1;
+}
+
+// 桶内的最大值
+static uint32_t bucketUpper(uint8_t index) {
+  if (index < 4) return index;
+  uint8_t e = index / 4 + 1;
+  uint8_t sub = index % 4;
+  return ((uint32_t)(5 + sub) << (e - 2)) - 1;
+}
+
+void latencyHistogramReset(LatencyHistogram* h) {
+  memset(h, 0, sizeof(*h));
+}
+
+void latencyHistogramRecord(LatencyHistogram* h, uint32_t us) {
+  if (h->count == 0 || us < h->minUs) h->minUs = us;
+  if (us > h->maxUs) h->maxUs = us;
+  h->count++;
+  h->totalUs += us;
+  uint16_t& bucket = h->buckets[bucketIndex(us)];
+  if (bucket < UINT16_MAX) bucket++;
+}
+
+uint32_t latencyHistogramAverage(const LatencyHistogram* h) {
+  return h->count ? (uint32_t)(h->totalUs / h->count) : 0;
+}
+
+uint32_t latencyHistogramPercentile(const LatencyHistogram* h, uint8_t percent) {
+  if (h->count == 0) return 0;
+  if (percent > 100) percent = 100;
+  // 桶计数可能已饱和，按桶内的合计计算名次
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) total += h->buckets[i];
+  uint32_t rank = (total * percent + 99) / 100;
+  if (rank == 0) rank = 1;
+
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+    seen += h->buckets[i];
+    if (seen >= rank) {
+      uint32_t upper = bucketUpper(i);
+      if (upper > h->maxUs) upper = h->maxUs;
+      if (upper < h->minUs) upper = h->minUs;
+      return upper;
+    }
+  }
+  return h->maxUs;
+}
@@ -0,0 +1,128 @@
+#include "luma_stats.h"
+#include <string.h>
+
+// 裁剪占比超过此值时优先处理裁剪
+#define CLIP_LIMIT_PERCENT 8
+
+void lumaStatsBegin(LumaStats* stats) {
+  memset(stats, 0, sizeof(*stats));
+}
+
+void lumaStatsAddRow(LumaStats* stats, const uint8_t* row, uint16_t width, uint8_t step) {
+  uint32_t* h = stats->histogram;
+  uint16_t x = 0;
+  if (step == 1) {
+    // 32位对齐读取，一次处理4个像素
+    for (; x < width && ((uintptr_t)(row + x) & 3); x++) h[row[x]]++;
+    for (; x + 4 <= width; x += 4) {
+      uint32_t v = *(const uint32_t*)(row + x);
+      h[v & 0xFF]++;
+      h[(v >> 8) & 0xFF]++;
+      h[(v >> 16) & 0xFF]++;
+      h[v >> 24]++;
+    }
+    for (; x < width; x++) h[row[x]]++;
+  } else {
+    const uint8_t* p = row;
+    for (; x < width; x++, p += step) h[*p]++;
+  }
+  stats->count += width;
+}
+
+uint8_t lumaPercentile(const LumaStats* stats, uint8_t percent) {
+  uint32_t target = (uint32_t)((uint64_t)stats->count * percent / 100);
+  uint32_t sum = 0;
+  for (int v = 0; v < 256; v++) {
+    sum += stats->histogram[v];
+    if (sum > target) return (uint8_t)v;
+  }
+  return 255;
+}
+
+void lumaStatsFinish(LumaStats* stats) {
+  if (stats->count == 0) return;
+  const uint32_t* h = stats->histogram;
+
+  uint64_t total = 0;
+  uint32_t low = 0;
+  uint32_t high = 0;
+  int minValue = -1;
+  int maxValue = 0;
+  for (int v = 0; v < 256; v++) {
+    if (h[v] == 0) continue;
+    if (minValue < 0) minValue = v;
+    maxValue = v;
+    total += (uint64_t)h[v] * v;
+    if (v <= 8) low += h[v];
+    if (v >= 247) high += h[v];
+  }
+  stats->mean = (uint8_t)((total + stats->count / 2) / stats->count);
+  stats->min = (uint8_t)minValue;
+  stats->max = (uint8_t)maxValue;
+  stats->p5 = lumaPercentile(stats, 5);
+  stats->median = lumaPercentile(stats, 50);
+  stats->p95 = lumaPercentile(stats, 95);
+  stats->contrast = stats->p95 - stats->p5;
+  stats->clippedLowPercent = (uint8_t)((uint64_t)low * 100 / stats->count);
+  stats->clippedHighPercent = (uint8_t)((uint64_t)high * 100 / stats->count);
+}
+
+void lumaStatsCompute(LumaStats* stats, const uint8_t* pixels, uint16_t width, uint16_t height,
+                      uint16_t stride, uint8_t step) {
+  lumaStatsBegin(stats);
+  for (uint16_t y = 0; y < height; y++) {
+    lumaStatsAddRow(stats, pixels + (size_t)y * stride, width, step);
+  }
+  lumaStatsFinish(stats);
+}
+
+uint8_t lumaOtsuThreshold(const LumaStats* stats) {
+  if (stats->count == 0) return 128;
+  const uint32_t* h = stats->histogram;
+  uint64_t sumAll = 0;
+  for (int v = 0; v < 256; v++) sumAll += (uint64_t)h[v] * v;
+
+  // 类间方差 = (总均值 x 下方权重 - 下方和)^2 / (下方权重 x 上方权重)，乘以常数不影响最大值位置
+  // ESP32-S3只有单精度FPU，用float计算
+  uint64_t sumBelow = 0;
+  uint32_t weightBelow = 0;
+  float bestVariance = -1;
+  int best = stats->mean;
+  int bestEnd = best;
+  for (int t = 0; t < 255; t++) {
+    weightBelow += h[t];
+    sumBelow += (uint64_t)h[t] * t;
+    uint32_t weightAbove = stats->count - weightBelow;
+    if (weightBelow == 0) continue;
+    if (weightAbove == 0) break;
+    float num = (float)((int64_t)(sumAll * weightBelow) - (int64_t)((uint64_t)stats->count * sumBelow));
+    float variance = num * num / ((float)weightBelow * (float)weightAbove);
+    if (variance > bestVariance) {
+      bestVariance = variance;
+      best = t;
+      bestEnd = t;
+    } else if (variance == bestVariance) {
+      bestEnd = t;  // 两峰之间没有像素时方差相同，取中间
+    }
+  }
+  // 分割点之上的像素为白，阈值取分割点+1
+  best = (best + bestEnd) / 2;
+  return (uint8_t)(best < 255 ? best + 1 : 255);
+}
+
+uint8_t lumaDitherThreshold(const LumaStats* stats) {
+  if (stats->count == 0) return 128;
+  return (uint8_t)((stats->p5 + stats->p95 + 1) / 2);
+}
+
+int8_t lumaExposureStep(const LumaStats* stats, uint8_t target, uint8_t tolerance) {
+  if (stats->count == 0) return 0;
+  // 大片高光溢出时先压曝光，暗部死黑时先提曝光，都有时按均值判断
+  bool highClipped = stats->clippedHighPercent > CLIP_LIMIT_PERCENT;
+  bool lowClipped = stats->clippedLowPercent > CLIP_LIMIT_PERCENT;
+  if (highClipped && !lowClipped && stats->mean + tolerance / 2 > target) return -1;
+  if (lowClipped && !highClipped && stats->mean < target + tolerance / 2) return 1;
+  if (stats->mean > target + tolerance) return -1;
+  if (stats->mean + tolerance < target) return 1;
+  return 0;
+}
@@ -1,18 +1,51 @@
 #include <Arduino.h>
 #include <WiFi.h>
+#include "dither.h"
+#include "vision_pipeline.h"
+#include "scene_gate.h"
+#include "answer_cache.h"
+#include "camera_mode.h"
+#include "frame_recorder.h"
+#include "api_connection.h"
+#include "api_latency.h"
+#include "latency_histogram.h"
+#include "vision_requests.h"
 
 // 基本显示函数
 void initScreen();
 void showStaticMessage(const char* message);
 void showTwoLineMessage(const char* line1, const char* line2);
+void benchmarkOledBlit(int iterations); // 显示缓冲区填充性能测试
 
 
 // 摄像头功能
 void initCamera();
+bool startCameraInit();          // 后台初始化，立即返回
+bool cameraInitPoll();           // 刷新初始化进度显示，结束时返回true
+bool cameraReady();
+bool recoverCamera();            // 复位传感器并按缓存恢复设置，有后台取帧者时拒绝
+void benchmarkCameraBoot();      // 启动到第一帧耗时测试
 void captureImage();
 String captureAndAnalyze(const String& question);
+String captureAndAnalyzeOnChange(const String& question, SceneGate* gate); // 场景变化时才分析
+String captureAndAnalyzeRegion(const String& question, float x, float y, float width, float height); // 只上传画面中的区域
+void setAnalysisRegion(float x, float y, float width, float height); // captureAndAnalyze的固定分析区域
+String analyzeRecordedFrame(const String& question, uint32_t offsetMs); // 分析事件前录下的画面
+void benchmarkSceneGate();              // 场景检测测试
+void recordSceneSequence(int frames, uint32_t intervalMs); // 串口输出缩略图序列，供主机重放
+void setAdaptiveQuality(bool enabled, uint32_t latencyBudgetMs); // 按上行速率自适应画质
 void captureAndDisplayOnOled();  // 新增：拍照并显示到OLED
 void continuousCaptureDisplay(); // 新增：连续拍照显示功能
+bool startLiveView(uint8_t targetFps); // OLED实时预览，直到stopLiveView()
+void stopLiveView();
+void benchmarkJpegDecode(int frames); // JPEG预览解码性能测试
+void setGrayscalePreview(bool enabled); // 预览使用灰度直出模式
+void setPreviewDither(DitherMode mode);  // 预览抖动算法
+void benchmarkDither(int iterations);    // 抖动算法性能测试
+void benchmarkLumaStats(int iterations); // 亮度统计性能测试
+bool benchmarkImagePipeline(int iterations); // 图像流水线各阶段耗时与黄金输出比对
+void setPreviewAutoExposure(bool enabled); // 预览时按亮度统计调整曝光补偿
+void benchmarkBase64(size_t length, int iterations); // Base64编码性能测试
 
 // 麦克风功能
 bool initMicrophone();
@@ -24,6 +57,12 @@ int getMicrophoneSampleRate();
 
 // AI视觉分析功能
 String resolveImage(const String& imageBase64, const String& question);
+String resolveImageJpeg(const uint8_t* jpegData, size_t jpegSize, const String& question, bool showStatus);
+void setVisionApiUrl(const char* url); // 视觉接口地址（可指向本地模拟服务器）
+void setVisionStreaming(bool enabled); // 流式接收回答，边收边显示
+bool initVisionRateLimit(); // 创建限流器的锁，setup()中调用
+void setVisionRateLimit(uint32_t requestsPerMinute, uint32_t tokensPerMinute); // 按账户配额限流，0为不限
+void printVisionRateStats();
 String resolveImageFromURL(const String& imageUrl, const String& question);
 bool testAPIConnection();
 
@@ -47,6 +86,10 @@ bool hasRecordingData();
 void clearRecording();
 
 void testImageResolution();
+void testVisionPipeline(uint32_t durationMs); // 新增：流水线连续分析测试
+void testFrameRecorder(); // 新增：事件前画面分析测试
+void testAsyncVisionRequests(); // 新增：异步视觉请求测试
+void testVisionLoad(const char* apiUrl, uint16_t requests, uint32_t intervalMs); // 新增：接口负载测试
 void testImageDisplayFeatures(); // 新增：图像显示功能测试
 void testMicrophoneFeatures(); // 新增：麦克风功能测试
 void testRecordingPlayback(); // 新增：录音播放功能测试
@@ -54,6 +97,11 @@ void testRecordingPlayback(); // 新增：录音播放功能测试
 void setup() {
     Serial.begin(115200);
     Serial.println("=== ESP32 AI Vision System ===");
+
+    // 共享的接口连接、限流器和耗时统计的锁要在任何请求任务启动之前创建
+    if (!apiConnectionInit() || !initVisionRateLimit() || !apiLatencyInit()) {
+        Serial.println("API连接锁创建失败");
+    }
     
     // 初始化屏幕
     initScreen();
@@ -98,12 +146,12 @@ void setup() {
     // }
     // delay(2000);
     
-    // showStaticMessage("初始化摄像头");
-    // // 初始化摄像头
-    // initCamera();
-    // delay(2000);
+    // // 初始化摄像头：后台进行，最后等待完成
+    // startCameraInit();
+    // while (!cameraInitPoll()) {
+    //     delay(10);
+    // }
     
-    // showStaticMessage("摄像头初始化完成");
     // Serial.println("System initialization complete!");
 }
 
@@ -124,6 +172,18 @@ void loop() {
     // // 测试图像显示功能
     // testImageDisplayFeatures();
     
+    // // 测试流水线连续分析（需要WiFi和摄像头）
+    // testVisionPipeline(60000);
+    
+    // // 测试事件前画面分析（需要WiFi和摄像头）
+    // testFrameRecorder();
+    
+    // // 测试异步视觉请求（需要WiFi）
+    // testAsyncVisionRequests();
+    
+    // // 接口负载测试：指向局域网内的模拟服务器，不消耗额度
+    // testVisionLoad("http://192.168.1.100:8000/compatible-mode/v1/chat/completions", 50, 500);
+    
     // 长暂停，避免快速循环
     delay(5000);
 }
@@ -150,6 +210,35 @@ void testImageDisplayFeatures() {
     captureAndDisplayOnOled();
     delay(2000);
     
+    // 测试4：解码性能
+    showTwoLineMessage("测试4:", "解码性能测试");
+    benchmarkJpegDecode(10);
+    benchmarkDither(100);
+    benchmarkLumaStats(20);
+    benchmarkImagePipeline(5);
+    benchmarkOledBlit(100);
+    benchmarkBase64(40 * 1024, 5);
+    benchmarkSceneGate();
+    benchmarkCameraBoot();
+    delay(2000);
+    
+    // 测试5：灰度直出预览
+    showTwoLineMessage("测试5:", "灰度预览");
+    delay(2000);
+    setGrayscalePreview(true);
+    continuousCaptureDisplay();
+    setGrayscalePreview(false);
+    delay(2000);
+    
+    // 测试6：有序抖动预览
+    showTwoLineMessage("测试6:", "Bayer抖动");
+    delay(2000);
+    setPreviewDither(DITHER_BAYER8);
+    captureAndDisplayOnOled();
+    setPreviewDither(DITHER_FLOYD_STEINBERG);
+    delay(2000);
+    
+    printCameraModeStats();
     showTwoLineMessage("所有测试完成", "系统正常");
     delay(3000);
     
@@ -274,7 +363,9 @@ void testImageResolution() {
     Serial.println("=== AI Vision Demo ===");
   // 测试拍照并分析（需要API密钥）
     showStaticMessage("图像分析测试");
+    setVisionStreaming(true);
     String analysisResult = captureAndAnalyze("图中描绘的是什么景象？请用中文简短回答。");
+    setVisionStreaming(false);
     
     if (analysisResult.length() > 0 && !analysisResult.startsWith("错误")) {
         Serial.println("分析结果: " + analysisResult);
@@ -283,6 +374,7 @@ void testImageResolution() {
         Serial.println("分析失败: " + analysisResult);
         showStaticMessage("AI分析失败");
     }
+    printApiLatencyStats();
     
     delay(5000);
     
@@ -302,4 +394,232 @@ void testImageResolution() {
     
     Serial.println("=== Demo Cycle Complete ===");
     delay(10000);
-  }
\ No newline at end of file
+  }
+
+// 流水线结果回调：在结果任务中执行，屏幕只在这里更新
+static void onPipelineResult(const VisionResult* result, void* ctx) {
+    Serial.printf("[帧%lu]%s %s (%u 字节, 上传 %lu ms, 总延迟 %lu ms)\n",
+                  (unsigned long)result->frameId, result->cached ? "[缓存]" : "",
+                  result->text, (unsigned)result->imageBytes,
+                  (unsigned long)result->uploadMs, (unsigned long)result->latencyMs);
+    showStaticMessage(result->ok ? result->text : "AI分析失败");
+}
+
+void testVisionPipeline(uint32_t durationMs) {
+    Serial.println("=== Vision Pipeline Test ===");
+    showStaticMessage("流水线分析测试");
+
+    VisionPipelineConfig config;
+    visionPipelineDefaultConfig(&config, "图中描绘的是什么景象？请用中文简短回答。",
+                                onPipelineResult, NULL);
+
+    // 画面不变时不重复请求
+    static SceneGate gate;
+    SceneGateConfig gateConfig;
+    sceneGateDefaultConfig(&gateConfig);
+    sceneGateInit(&gate, &gateConfig);
+    config.gate = &gate;
+
+    // 上传控制在约1.5秒内
+    setAdaptiveQuality(true, 1500);
+
+    // 相同画面的回答直接复用，并持久化到LittleFS
+    if (answerCacheBegin(6)) {
+        answerCacheAttachStorage("/answers.bin");
+    }
+    if (!startVisionPipeline(&config)) {
+        showStaticMessage("流水线启动失败");
+        return;
+    }
+
+    uint32_t start = millis();
+    while (millis() - start < durationMs) {
+        delay(10000);
+        printVisionPipelineStats();
+    }
+
+    stopVisionPipeline();
+    setAdaptiveQuality(false, 0);
+    printVisionPipelineStats();
+    printAnswerCacheStats();
+    printApiConnectionStats();
+    printApiLatencyStats();
+    Serial.println("=== Vision Pipeline Test Complete ===");
+}
+
+void testFrameRecorder() {
+    Serial.println("=== Frame Recorder Test ===");
+    showStaticMessage("录帧测试");
+
+    // 1.5MB环形存储，每100ms一帧，VGA下约可保存4~6秒
+    if (!startFrameRecorder(1536 * 1024, 60, 100)) {
+        showStaticMessage("录帧启动失败");
+        return;
+    }
+    delay(5000);
+    printFrameRecorderStats();
+
+    // 模拟事件：分析事件发生前1秒的画面
+    uint32_t start = millis();
+    String result = analyzeRecordedFrame("图中描绘的是什么景象？请用中文简短回答。", 1000);
+    Serial.printf("事件前画面分析: %s (%lu ms)\n", result.c_str(), (unsigned long)(millis() - start));
+
+    stopFrameRecorder();
+    printFrameRecorderStats();
+    Serial.println("=== Frame Recorder Test Complete ===");
+}
+
+struct AsyncVisionCounts {
+    int finished;   // 收到回调的请求数
+    int completed;  // 成功的请求数
+};
+
+static void onAsyncVisionResult(const VisionRequestResult* result, void* ctx) {
+    static const char* statusNames[] = {"ok", "failed", "cancelled", "expired"};
+    Serial.printf("请求 %lu %s（排队 %lu ms，处理 %lu ms）: %s\n", (unsigned long)result->id,
+                  statusNames[result->status], (unsigned long)result->waitMs,
+                  (unsigned long)result->serviceMs, result->text);
+    AsyncVisionCounts* counts = (AsyncVisionCounts*)ctx;
+    counts->finished++;
+    if (result->status == VISION_REQUEST_OK) {
+        counts->completed++;
+    }
+}
+
+void testAsyncVisionRequests() {
+    Serial.println("=== Async Vision Request Test ===");
+    showStaticMessage("异步请求测试");
+    if (!startVisionRequestWorker(8)) {
+        showStaticMessage("请求任务启动失败");
+        return;
+    }
+
+    // 按账户配额限流（请按实际配额修改），超出时排队等待而不是收到429
+    setVisionRateLimit(60, 100000);
+
+    static AsyncVisionCounts counts;
+    counts = {};
+    int submitted = 0;
+    VisionRequest request;
+    visionRequestInit(&request);
+    request.imageUrl = "https://help-static-aliyun-doc.aliyuncs.com/file-manage-files/zh-CN/20241022/emyrja/dog_and_girl.jpeg";
+    request.onDone = onAsyncVisionResult;
+    request.ctx = &counts;
+
+    // 低优先级的普通请求（重复提交一次，与第一次合并）、10秒内必须开始的请求、高优先级请求，再取消一个
+    request.question = "图中有几个人？请用中文简短回答。";
+    if (submitVisionRequest(&request)) submitted++;
+    if (submitVisionRequest(&request)) submitted++;
+    request.question = "图中有什么动物？请用中文简短回答。";
+    request.timeoutMs = 10000;
+    if (submitVisionRequest(&request)) submitted++;
+    request.question = "图中描绘的是什么景象？请用中文简短回答。";
+    request.timeoutMs = 0;
+    request.priority = 5;
+    if (submitVisionRequest(&request)) submitted++;
+    request.question = "这个请求会被取消。";
+    request.priority = 0;
+    uint32_t cancelled = submitVisionRequest(&request);
+    if (cancelled) submitted++;
+    cancelVisionRequest(cancelled);
+
+    // 请求在后台处理，主循环继续刷新屏幕
+    uint32_t start = millis();
+    while (millis() - start < 60000) {
+        RequestQueueStats stats;
+        getVisionRequestStats(&stats);
+        if (counts.finished >= submitted) break;
+        char line[32];
+        snprintf(line, sizeof(line), "排队%d 完成%d", stats.depth, counts.completed);
+        showStaticMessage(line);
+        delay(500);
+    }
+
+    stopVisionRequestWorker();
+    printVisionRequestStats();
+    printVisionRateStats();
+    printApiConnectionStats();
+    printApiLatencyStats();
+    Serial.println("=== Async Vision Request Test Complete ===");
+}
+
+struct VisionLoadStats {
+    int finished;
+    int statusCounts[4];          // 按VisionRequestStatus计数
+    LatencyHistogram latency;     // 提交到收到结果（排队 + 处理）
+};
+
+static void onVisionLoadResult(const VisionRequestResult* result, void* ctx) {
+    VisionLoadStats* stats = (VisionLoadStats*)ctx;
+    stats->finished++;
+    stats->statusCounts[result->status]++;
+    if (result->status == VISION_REQUEST_OK || result->status == VISION_REQUEST_FAILED) {
+        latencyHistogramRecord(&stats->latency, (result->waitMs + result->serviceMs) * 1000);
+    }
+}
+
+// 接口负载测试：每intervalMs提交一个请求（问题各不相同，不会被合并），
+// 统计吞吐量、端到端延迟分布和各阶段耗时。apiUrl为NULL时使用DashScope（消耗额度）
+void testVisionLoad(const char* apiUrl, uint16_t requests, uint32_t intervalMs) {
+    Serial.println("=== Vision Load Test ===");
+    showStaticMessage("接口负载测试");
+    setVisionApiUrl(apiUrl);
+    setVisionRateLimit(0, 0);  // 不在客户端限流，测量服务器和网络本身的吞吐量
+    resetApiLatencyStats();
+    if (!startVisionRequestWorker(REQUEST_QUEUE_MAX)) {
+        showStaticMessage("请求任务启动失败");
+        setVisionApiUrl(NULL);
+        return;
+    }
+
+    static VisionLoadStats stats;
+    stats = {};
+    latencyHistogramReset(&stats.latency);
+    VisionRequest request;
+    visionRequestInit(&request);
+    request.imageUrl = "https://help-static-aliyun-doc.aliyuncs.com/file-manage-files/zh-CN/20241022/emyrja/dog_and_girl.jpeg";
+    request.onDone = onVisionLoadResult;
+    request.ctx = &stats;
+
+    int submitted = 0;
+    int rejected = 0;
+    char question[64];
+    uint32_t start = millis();
+    for (uint16_t i = 0; i < requests; i++) {
+        snprintf(question, sizeof(question), "负载测试 %u：图中有几个人？", (unsigned)i);
+        request.question = question;
+        if (submitVisionRequest(&request)) {
+            submitted++;
+        } else {
+            rejected++;  // 队列满
+        }
+        char line[32];
+        snprintf(line, sizeof(line), "提交%d 完成%d", submitted, stats.finished);
+        showStaticMessage(line);
+        delay(intervalMs);
+    }
+    while (stats.finished < submitted && millis() - start < 600000) {
+        delay(100);
+    }
+    uint32_t elapsed = millis() - start;
+
+    stopVisionRequestWorker();
+    setVisionApiUrl(NULL);
+    int ok = stats.statusCounts[VISION_REQUEST_OK];
+    Serial.printf("%d 个请求用时 %lu ms，成功 %d，失败 %d，超时 %d，队列满 %d\n", submitted,
+                  (unsigned long)elapsed, ok, stats.statusCounts[VISION_REQUEST_FAILED],
+                  stats.statusCounts[VISION_REQUEST_EXPIRED], rejected);
+    Serial.printf("吞吐量 %lu.%02lu 请求/秒\n", (unsigned long)(ok * 1000UL / elapsed),
+                  (unsigned long)(ok * 100000UL / elapsed % 100));
+    Serial.printf("端到端延迟 min %lu ms，avg %lu ms，p50 %lu ms，p95 %lu ms，max %lu ms\n",
+                  (unsigned long)(stats.latency.minUs / 1000),
+                  (unsigned long)(latencyHistogramAverage(&stats.latency) / 1000),
+                  (unsigned long)(latencyHistogramPercentile(&stats.latency, 50) / 1000),
+                  (unsigned long)(latencyHistogramPercentile(&stats.latency, 95) / 1000),
+                  (unsigned long)(stats.latency.maxUs / 1000));
+    printVisionRequestStats();
+    printVisionRateStats();
+    printApiConnectionStats();
+    printApiLatencyStats();
+    Serial.println("=== Vision Load Test Complete ===");
+}
@@ -0,0 +1,77 @@
+#include "mono_blit.h"
+
+// 8x8位矩阵转置：输入第r行字节的第c位（XBM，低位在左）变成输出第c列字节的第r位（低位在上）。
+// 8行拼成两个32位字（0~3行、4~7行），依次交换1x1、2x2、4x4子块，
+// 只用移位和掩码，不需要逐像素读写。
+static inline void transpose8x8(const uint8_t* in, size_t inStride, uint8_t* out) {
+  uint32_t lo = (uint32_t)in[0] | ((uint32_t)in[inStride] << 8) |
+                ((uint32_t)in[inStride * 2] << 16) | ((uint32_t)in[inStride * 3] << 24);
+  in += inStride * 4;
+  uint32_t hi = (uint32_t)in[0] | ((uint32_t)in[inStride] << 8) |
+                ((uint32_t)in[inStride * 2] << 16) | ((uint32_t)in[inStride * 3] << 24);
+  uint32_t t;
+
+  t = (lo ^ (lo >> 7)) & 0x00AA00AAu;  lo ^= t ^ (t << 7);
+  t = (hi ^ (hi >> 7)) & 0x00AA00AAu;  hi ^= t ^ (t << 7);
+  t = (lo ^ (lo >> 14)) & 0x0000CCCCu; lo ^= t ^ (t << 14);
+  t = (hi ^ (hi >> 14)) & 0x0000CCCCu; hi ^= t ^ (t << 14);
+
+  t = (lo & 0x0F0F0F0Fu) | ((hi & 0x0F0F0F0Fu) << 4);
+  hi = ((lo >> 4) & 0x0F0F0F0Fu) | (hi & 0xF0F0F0F0u);
+  lo = t;
+
+  out[0] = (uint8_t)lo;
+  out[1] = (uint8_t)(lo >> 8);
+  out[2] = (uint8_t)(lo >> 16);
+  out[3] = (uint8_t)(lo >> 24);
+  out[4] = (uint8_t)hi;
+  out[5] = (uint8_t)(hi >> 8);
+  out[6] = (uint8_t)(hi >> 16);
+  out[7] = (uint8_t)(hi >> 24);
+}
+
+void monoBlitToPages(const uint8_t* xbm, uint16_t width, uint16_t height,
+                     uint8_t* pages, uint16_t bufferWidth, uint8_t bufferPages) {
+  const size_t srcStride = (width + 7) / 8;
+  const uint16_t w = width < bufferWidth ? width : bufferWidth;
+  const uint16_t bufferHeight = (uint16_t)bufferPages * 8;
+  const uint16_t h = height < bufferHeight ? height : bufferHeight;
+
+  const uint16_t fullCols = w & ~7;
+  const uint16_t fullPages = h / 8;
+
+  for (uint16_t page = 0; page < fullPages; page++) {
+    const uint8_t* src = xbm + (size_t)page * 8 * srcStride;
+    uint8_t* dst = pages + (size_t)page * bufferWidth;
+    for (uint16_t x = 0; x < fullCols; x += 8) {
+      transpose8x8(src + x / 8, srcStride, dst + x);
+    }
+    // 右侧不足8列的部分逐列拼装
+    for (uint16_t x = fullCols; x < w; x++) {
+      const uint8_t* s = src + x / 8;
+      const uint8_t bit = x & 7;
+      uint8_t col = 0;
+      for (uint8_t r = 0; r < 8; r++) {
+        col |= ((s[r * srcStride] >> bit) & 1) << r;
+      }
+      dst[x] = col;
+    }
+  }
+
+  // 底部不足8行的页：只改写图像覆盖的位，保留该页下方原有内容
+  const uint8_t restRows = h & 7;
+  if (restRows) {
+    const uint8_t* src = xbm + (size_t)fullPages * 8 * srcStride;
+    uint8_t* dst = pages + (size_t)fullPages * bufferWidth;
+    const uint8_t keepMask = (uint8_t)(0xFF << restRows);
+    for (uint16_t x = 0; x < w; x++) {
+      const uint8_t* s = src + x / 8;
+      const uint8_t bit = x & 7;
+      uint8_t col = 0;
+      for (uint8_t r = 0; r < restRows; r++) {
+        col |= ((s[r * srcStride] >> bit) & 1) << r;
+      }
+      dst[x] = (dst[x] & keepMask) | col;
+    }
+  }
+}
@@ -0,0 +1,90 @@
+#include "quality_controller.h"
+
+void qualityControllerDefaultConfig(QualityControllerConfig* config, uint32_t latencyBudgetMs,
+                                    uint8_t sizeLevels) {
+  config->latencyBudgetMs = latencyBudgetMs;
+  config->initialTargetBytes = 30 * 1024;
+  config->minTargetBytes = 8 * 1024;
+  config->maxTargetBytes = 60 * 1024;
+  config->bestQuality = 10;
+  config->worstQuality = 40;
+  config->sizeLevels = sizeLevels;
+  config->sizeChangeInterval = 5;
+}
+
+static uint32_t clampTarget(const QualityControllerConfig& config, uint64_t target) {
+  if (target < config.minTargetBytes) return config.minTargetBytes;
+  if (target > config.maxTargetBytes) return config.maxTargetBytes;
+  return (uint32_t)target;
+}
+
+void qualityControllerInit(QualityController* qc, const QualityControllerConfig* config,
+                           uint8_t quality, uint8_t sizeLevel) {
+  qc->config = *config;
+  if (quality < config->bestQuality) quality = config->bestQuality;
+  if (quality > config->worstQuality) quality = config->worstQuality;
+  qc->quality = quality;
+  qc->sizeLevel = sizeLevel < config->sizeLevels ? sizeLevel : config->sizeLevels - 1;
+  qc->throughput = 0;
+  qc->targetBytes = clampTarget(*config, config->initialTargetBytes);
+  qc->lastFrameBytes = 0;
+  qc->framesSinceSizeChange = config->sizeChangeInterval;
+  qc->frames = 0;
+  qc->qualityChanges = 0;
+  qc->sizeChanges = 0;
+}
+
+void qualityControllerReportUpload(QualityController* qc, size_t bytesSent, uint32_t elapsedMs) {
+  if (elapsedMs == 0 || bytesSent == 0) return;
+  uint32_t sample = (uint32_t)((uint64_t)bytesSent * 1000 / elapsedMs);
+  qc->throughput = qc->throughput == 0 ? sample : (qc->throughput * 3 + sample) / 4;
+
+  // 发送的是Base64，原始JPEG只占3/4
+  uint64_t target = (uint64_t)qc->throughput * qc->config.latencyBudgetMs / 1000 * 3 / 4;
+  qc->targetBytes = clampTarget(qc->config, target);
+}
+
+bool qualityControllerUpdate(QualityController* qc, size_t frameBytes) {
+  const QualityControllerConfig& config = qc->config;
+  qc->frames++;
+  qc->lastFrameBytes = (uint32_t)frameBytes;
+  if (qc->framesSinceSizeChange < 255) qc->framesSinceSizeChange++;
+
+  uint32_t ratio = (uint32_t)((uint64_t)frameBytes * 100 / qc->targetBytes);
+  bool sizeAllowed = qc->framesSinceSizeChange >= config.sizeChangeInterval;
+  uint8_t quality = qc->quality;
+  uint8_t sizeLevel = qc->sizeLevel;
+
+  if (ratio > 125) {
+    // 偏大：按超出程度加大步长降低质量
+    uint8_t step = ratio > 200 ? 6 : (ratio > 150 ? 4 : 2);
+    if (quality < config.worstQuality) {
+      quality = quality + step > config.worstQuality ? config.worstQuality : quality + step;
+    } else if (sizeLevel > 0 && sizeAllowed) {
+      sizeLevel--;
+    }
+  } else if (ratio < 70) {
+    uint8_t step = ratio < 40 ? 4 : 2;
+    if (quality > config.bestQuality) {
+      quality = quality < config.bestQuality + step ? config.bestQuality : quality - step;
+    } else if (sizeLevel + 1 < config.sizeLevels && sizeAllowed) {
+      // 分辨率升一级数据量约翻倍，质量退回到中间值再慢慢提高
+      sizeLevel++;
+      quality = (config.bestQuality + config.worstQuality) / 2;
+    }
+  }
+
+  bool changed = false;
+  if (sizeLevel != qc->sizeLevel) {
+    qc->sizeLevel = sizeLevel;
+    qc->framesSinceSizeChange = 0;
+    qc->sizeChanges++;
+    changed = true;
+  }
+  if (quality != qc->quality) {
+    qc->quality = quality;
+    qc->qualityChanges++;
+    changed = true;
+  }
+  return changed;
+}
@@ -0,0 +1,96 @@
+#include "rate_limiter.h"
+#include <string.h>
+
+#define BUCKET_SCALE    60000     // 每分钟的毫秒数
+#define BURST_SECONDS   10
+
+static void bucketInit(TokenBucket* b, uint32_t ratePerMinute, uint32_t nowMs) {
+  b->ratePerMinute = ratePerMinute;
+  uint32_t burst = ratePerMinute * BURST_SECONDS / 60;
+  if (burst < 1) burst = 1;
+  b->capacity = (int64_t)burst * BUCKET_SCALE;
+  b->level = b->capacity;
+  b->lastMs = nowMs;
+}
+
+static void bucketRefill(TokenBucket* b, uint32_t nowMs) {
+  uint32_t elapsed = nowMs - b->lastMs;
+  b->lastMs = nowMs;
+  b->level += (int64_t)elapsed * b->ratePerMinute;
+  if (b->level > b->capacity) b->level = b->capacity;
+}
+
+// 放行cost需要等待的毫秒数；cost超过容量时只要求桶满
+static uint32_t bucketWait(const TokenBucket* b, uint32_t cost) {
+  if (b->ratePerMinute == 0) return 0;
+  int64_t need = (int64_t)cost * BUCKET_SCALE;
+  if (need > b->capacity) need = b->capacity;
+  if (b->level >= need) return 0;
+  return (uint32_t)((need - b->level + b->ratePerMinute - 1) / b->ratePerMinute);
+}
+
+void rateLimiterInit(RateLimiter* limiter, uint32_t requestsPerMinute, uint32_t tokensPerMinute, uint32_t nowMs) {
+  memset(limiter, 0, sizeof(*limiter));
+  bucketInit(&limiter->requests, requestsPerMinute, nowMs);
+  bucketInit(&limiter->tokens, tokensPerMinute, nowMs);
+}
+
+uint32_t rateLimiterAcquire(RateLimiter* limiter, uint32_t nowMs, uint32_t tokens) {
+  bucketRefill(&limiter->requests, nowMs);
+  bucketRefill(&limiter->tokens, nowMs);
+
+  uint32_t wait = 0;
+  if (limiter->paused) {
+    if ((int32_t)(limiter->pausedUntilMs - nowMs) > 0) {
+      wait = limiter->pausedUntilMs - nowMs;
+    } else {
+      limiter->paused = false;
+    }
+  }
+  uint32_t requestWait = bucketWait(&limiter->requests, 1);
+  uint32_t tokenWait = bucketWait(&limiter->tokens, tokens);
+  if (requestWait > wait) wait = requestWait;
+  if (tokenWait > wait) wait = tokenWait;
+  if (wait > 0) return wait;
+
+  if (limiter->requests.ratePerMinute) limiter->requests.level -= BUCKET_SCALE;
+  if (limiter->tokens.ratePerMinute) limiter->tokens.level -= (int64_t)tokens * BUCKET_SCALE;
+  limiter->stats.granted++;
+  return 0;
+}
+
+void rateLimiterRecordDelay(RateLimiter* limiter, uint32_t delayMs) {
+  if (delayMs == 0) return;
+  limiter->stats.delayed++;
+  limiter->stats.totalDelayMs += delayMs;
+  if (delayMs > limiter->stats.maxDelayMs) limiter->stats.maxDelayMs = delayMs;
+}
+
+void rateLimiterSettle(RateLimiter* limiter, uint32_t nowMs, uint32_t estimatedTokens, uint32_t actualTokens) {
+  if (limiter->tokens.ratePerMinute == 0) return;
+  bucketRefill(&limiter->tokens, nowMs);
+  limiter->tokens.level += ((int64_t)estimatedTokens - (int64_t)actualTokens) * BUCKET_SCALE;
+  if (limiter->tokens.level > limiter->tokens.capacity) limiter->tokens.level = limiter->tokens.capacity;
+}
+
+void rateLimiterPause(RateLimiter* limiter, uint32_t nowMs, uint32_t pauseMs) {
+  limiter->stats.throttled++;
+  uint32_t until = nowMs + pauseMs;
+  // 已有更晚的暂停时不缩短
+  if (!limiter->paused || (int32_t)(until - limiter->pausedUntilMs) > 0) {
+    limiter->pausedUntilMs = until;
+  }
+  limiter->paused = true;
+}
+
+uint32_t retryBackoffMs(uint8_t attempt, uint32_t retryAfterMs, uint32_t baseMs, uint32_t maxMs, uint32_t random) {
+  if (retryAfterMs > 0) {
+    // 多个调用者同时收到429时错开重试
+    return retryAfterMs + (baseMs ? random % baseMs : 0);
+  }
+  uint32_t ceiling = maxMs;
+  if (attempt < 31 && (baseMs << attempt) >> attempt == baseMs && (baseMs << attempt) < maxMs) {
+    ceiling = baseMs << attempt;
+  }
+  return random % (ceiling + 1);
+}
@@ -0,0 +1,142 @@
+#include "request_queue.h"
+#include <string.h>
+
+void requestQueueInit(RequestQueue* q, uint8_t capacity) {
+  memset(q, 0, sizeof(*q));
+  q->capacity = capacity == 0 || capacity > REQUEST_QUEUE_MAX ? REQUEST_QUEUE_MAX : capacity;
+  q->nextId = 1;
+}
+
+static uint32_t allocateId(RequestQueue* q) {
+  uint32_t id = q->nextId++;
+  if (q->nextId == 0) q->nextId = 1;  // 0保留为无效id
+  return id;
+}
+
+int requestQueuePush(RequestQueue* q, uint8_t priority, uint32_t nowMs, uint32_t timeoutMs, uint32_t* id) {
+  for (int i = 0; i < q->capacity; i++) {
+    RequestSlot& slot = q->slots[i];
+    if (slot.state != REQUEST_SLOT_FREE) continue;
+    slot.state = REQUEST_SLOT_QUEUED;
+    slot.priority = priority;
+    slot.id = allocateId(q);
+    slot.sequence = q->nextSequence++;
+    slot.enqueuedMs = nowMs;
+    slot.startedMs = 0;
+    // 截止时间恰好为0时顺延1ms，0表示不限时
+    slot.deadlineMs = timeoutMs ? (nowMs + timeoutMs ? nowMs + timeoutMs : 1) : 0;
+    *id = slot.id;
+
+    q->stats.submitted++;
+    q->stats.depth++;
+    if (q->stats.depth > q->stats.peakDepth) q->stats.peakDepth = q->stats.depth;
+    return i;
+  }
+  q->stats.rejected++;
+  return -1;
+}
+
+uint32_t requestQueueJoin(RequestQueue* q, int slot, uint8_t priority, uint32_t nowMs, uint32_t timeoutMs) {
+  if (slot < 0 || slot >= q->capacity || q->slots[slot].state == REQUEST_SLOT_FREE) return 0;
+  RequestSlot& s = q->slots[slot];
+  if (s.state == REQUEST_SLOT_QUEUED) {
+    if (priority > s.priority) s.priority = priority;
+    if (s.deadlineMs != 0) {
+      uint32_t deadline = timeoutMs ? (nowMs + timeoutMs ? nowMs + timeoutMs : 1) : 0;
+      if (deadline == 0 || (int32_t)(deadline - s.deadlineMs) > 0) s.deadlineMs = deadline;
+    }
+  }
+  q->stats.submitted++;
+  q->stats.coalesced++;
+  return allocateId(q);
+}
+
+static void recordWait(RequestQueue* q, const RequestSlot& slot, uint32_t nowMs) {
+  uint32_t wait = nowMs - slot.enqueuedMs;
+  q->stats.totalWaitMs += wait;
+  if (wait > q->stats.maxWaitMs) q->stats.maxWaitMs = wait;
+}
+
+int requestQueuePopExpired(RequestQueue* q, uint32_t nowMs) {
+  for (int i = 0; i < q->capacity; i++) {
+    RequestSlot& slot = q->slots[i];
+    if (slot.state != REQUEST_SLOT_QUEUED || slot.deadlineMs == 0) continue;
+    if ((int32_t)(nowMs - slot.deadlineMs) >= 0) {
+      slot.state = REQUEST_SLOT_FREE;
+      q->stats.depth--;
+      q->stats.expired++;
+      recordWait(q, slot, nowMs);
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool requestQueueNextDeadline(const RequestQueue* q, uint32_t nowMs, uint32_t* waitMs) {
+  bool found = false;
+  int32_t nearest = 0;
+  for (int i = 0; i < q->capacity; i++) {
+    const RequestSlot& slot = q->slots[i];
+    if (slot.state != REQUEST_SLOT_QUEUED || slot.deadlineMs == 0) continue;
+    int32_t remaining = (int32_t)(slot.deadlineMs - nowMs);
+    if (!found || remaining < nearest) nearest = remaining;
+    found = true;
+  }
+  if (found) *waitMs = nearest > 0 ? (uint32_t)nearest : 0;
+  return found;
+}
+
+int requestQueuePop(RequestQueue* q, uint32_t nowMs) {
+  int best = -1;
+  for (int i = 0; i < q->capacity; i++) {
+    const RequestSlot& slot = q->slots[i];
+    if (slot.state != REQUEST_SLOT_QUEUED) continue;
+    if (best < 0) {
+      best = i;
+      continue;
+    }
+    const RequestSlot& current = q->slots[best];
+    if (slot.priority > current.priority ||
+        (slot.priority == current.priority && (int32_t)(slot.sequence - current.sequence) < 0)) {
+      best = i;
+    }
+  }
+  if (best < 0) return -1;
+
+  RequestSlot& slot = q->slots[best];
+  slot.state = REQUEST_SLOT_ACTIVE;
+  slot.startedMs = nowMs;
+  q->stats.depth--;
+  recordWait(q, slot, nowMs);
+  return best;
+}
+
+void requestQueueFinish(RequestQueue* q, int slot, uint32_t nowMs) {
+  if (slot < 0 || slot >= q->capacity || q->slots[slot].state != REQUEST_SLOT_ACTIVE) return;
+  RequestSlot& s = q->slots[slot];
+  uint32_t service = nowMs - s.startedMs;
+  q->stats.served++;
+  q->stats.totalServiceMs += service;
+  if (service > q->stats.maxServiceMs) q->stats.maxServiceMs = service;
+  s.state = REQUEST_SLOT_FREE;
+}
+
+int requestQueueCancel(RequestQueue* q, uint32_t id) {
+  for (int i = 0; i < q->capacity; i++) {
+    RequestSlot& slot = q->slots[i];
+    if (slot.state == REQUEST_SLOT_QUEUED && slot.id == id) {
+      slot.state = REQUEST_SLOT_FREE;
+      q->stats.depth--;
+      q->stats.cancelled++;
+      return i;
+    }
+  }
+  return -1;
+}
+
+int requestQueueFind(const RequestQueue* q, uint32_t id) {
+  for (int i = 0; i < q->capacity; i++) {
+    if (q->slots[i].state != REQUEST_SLOT_FREE && q->slots[i].id == id) return i;
+  }
+  return -1;
+}
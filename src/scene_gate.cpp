@@ -0,0 +1,96 @@
+#include "scene_gate.h"
+#include <string.h>
+
+#define SCENE_PIXELS (SCENE_THUMB_WIDTH * SCENE_THUMB_HEIGHT)
+#define SCENE_BLOCKS_X (SCENE_THUMB_WIDTH / SCENE_BLOCK_SIZE)
+#define SCENE_BLOCKS_Y (SCENE_THUMB_HEIGHT / SCENE_BLOCK_SIZE)
+
+void sceneGateDefaultConfig(SceneGateConfig* config) {
+  config->pixelThreshold = 12;
+  config->changedPercent = 5;
+  config->cooldownMs = 3000;
+  config->backgroundShift = 3;
+  config->compensateBrightness = true;
+}
+
+void sceneGateInit(SceneGate* gate, const SceneGateConfig* config) {
+  memset(gate, 0, sizeof(*gate));
+  gate->config = *config;
+}
+
+// 背景与当前帧的整体亮度差（当前 - 背景），8.8定点
+static int32_t meanOffset(const SceneGate* gate, const uint8_t* thumb) {
+  uint32_t thumbSum = 0;
+  uint32_t backgroundSum = 0;
+  for (int i = 0; i < SCENE_PIXELS; i++) {
+    thumbSum += thumb[i];
+    backgroundSum += gate->background[i];
+  }
+  return ((int32_t)(thumbSum << 8) - (int32_t)backgroundSum) / SCENE_PIXELS;
+}
+
+uint8_t sceneGateScore(const SceneGate* gate, const uint8_t* thumb) {
+  if (!gate->hasBackground) return 100;
+
+  const int32_t offset = gate->config.compensateBrightness ? meanOffset(gate, thumb) : 0;
+  const uint32_t blockLimit = (uint32_t)gate->config.pixelThreshold *
+                              SCENE_BLOCK_SIZE * SCENE_BLOCK_SIZE << 8;
+
+  // 每个块的绝对差之和，8.8定点，逐行累加到所在列的块
+  uint32_t sad[SCENE_BLOCKS_X];
+  int changed = 0;
+  for (int by = 0; by < SCENE_BLOCKS_Y; by++) {
+    memset(sad, 0, sizeof(sad));
+    for (int y = by * SCENE_BLOCK_SIZE; y < (by + 1) * SCENE_BLOCK_SIZE; y++) {
+      const uint8_t* row = thumb + y * SCENE_THUMB_WIDTH;
+      const uint16_t* bg = gate->background + y * SCENE_THUMB_WIDTH;
+      for (int x = 0; x < SCENE_THUMB_WIDTH; x++) {
+        int32_t d = ((int32_t)row[x] << 8) - bg[x] - offset;
+        sad[x / SCENE_BLOCK_SIZE] += d < 0 ? -d : d;
+      }
+    }
+    for (int bx = 0; bx < SCENE_BLOCKS_X; bx++) {
+      if (sad[bx] > blockLimit) changed++;
+    }
+  }
+  return (uint8_t)(changed * 100 / SCENE_BLOCK_COUNT);
+}
+
+static void replaceBackground(SceneGate* gate, const uint8_t* thumb) {
+  for (int i = 0; i < SCENE_PIXELS; i++) {
+    gate->background[i] = (uint16_t)(thumb[i] << 8);
+  }
+  gate->hasBackground = true;
+}
+
+static void blendBackground(SceneGate* gate, const uint8_t* thumb) {
+  const uint8_t shift = gate->config.backgroundShift;
+  for (int i = 0; i < SCENE_PIXELS; i++) {
+    int32_t bg = gate->background[i];
+    bg += (((int32_t)thumb[i] << 8) - bg) >> shift;
+    gate->background[i] = (uint16_t)bg;
+  }
+}
+
+bool sceneGateUpdate(SceneGate* gate, const uint8_t* thumb, uint32_t nowMs) {
+  gate->frames++;
+  uint8_t score = sceneGateScore(gate, thumb);
+  gate->lastScore = score;
+
+  if (score < gate->config.changedPercent) {
+    blendBackground(gate, thumb);
+    gate->unchanged++;
+    return false;
+  }
+
+  // 有变化但仍在冷却期：不更新背景，冷却结束后仍会触发
+  if (gate->triggers > 0 && nowMs - gate->lastTriggerMs < gate->config.cooldownMs) {
+    gate->cooling++;
+    return false;
+  }
+
+  replaceBackground(gate, thumb);
+  gate->lastTriggerMs = nowMs;
+  gate->triggers++;
+  return true;
+}
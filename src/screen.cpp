@@ -1,6 +1,9 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include <U8g2lib.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "mono_blit.h"
 
 // 定义OLED显示屏参数
 #define SCREEN_WIDTH 128    // OLED显示宽度，单位：像素
@@ -15,8 +18,24 @@
 // 创建U8g2显示对象 - 使用SSD1306 128x32 I2C显示屏（全局访问）
 U8G2_SSD1306_128X32_UNIVISION_F_HW_I2C u8g2(U8G2_R0, /* reset=*/ U8X8_PIN_NONE, /* clock=*/ SCL_PIN, /* data=*/ SDA_PIN);
 
+// 显示缓冲区只有一个：实时预览的显示任务、流水线和异步请求的回调、主循环都会写屏，
+// 每个显示函数从写缓冲区到发送完成都持有这把锁（递归锁，外层可以把多步操作包在一起）。
+// 在initScreen()中创建，早于任何写屏的任务
+static SemaphoreHandle_t screenLock = NULL;
+
+void lockScreen() {
+  if (screenLock) xSemaphoreTakeRecursive(screenLock, portMAX_DELAY);
+}
+
+void unlockScreen() {
+  if (screenLock) xSemaphoreGiveRecursive(screenLock);
+}
+
 void initScreen() {
   Serial.println("Initializing OLED Display...");
+  if (!screenLock) {
+    screenLock = xSemaphoreCreateRecursiveMutex();
+  }
   
   // 初始化U8g2显示屏
   u8g2.begin();
@@ -35,6 +54,7 @@ void initScreen() {
 }
 
 void showStaticMessage(const char* message) {
+  lockScreen();
   u8g2.clearBuffer();
   
   // 先尝试检测是否包含中文字符
@@ -51,15 +71,18 @@ void showStaticMessage(const char* message) {
   u8g2.setCursor(2, 15);
   u8g2.print(message);
   u8g2.sendBuffer();
+  unlockScreen();
 }
 
 void showTwoLineMessage(const char* line1, const char* line2) {  
+  lockScreen();
   u8g2.clearBuffer();
   u8g2.setCursor(2, 14);
   u8g2.print(line1);
   u8g2.setCursor(2, 30);
   u8g2.print(line2);
   u8g2.sendBuffer();
+  unlockScreen();
   }
 
 void showScrollMessage(const char* message) {  
@@ -71,22 +94,144 @@ void showScrollMessage(const char* message) {
   if (textWidth > screenWidth) {
     Serial.println("Using scroll animation");
     for (int x = screenWidth; x > -textWidth; x -= 2) {
+      lockScreen();
       u8g2.clearBuffer();
       u8g2.setCursor(x, 15);
       u8g2.print(message);
       u8g2.sendBuffer();
+      unlockScreen();
       delay(50);
     }
   } else {
     Serial.println("Using centered display");
     int x = (screenWidth - textWidth) / 2;
+    lockScreen();
     u8g2.clearBuffer();
     u8g2.setCursor(x, 15);
     u8g2.print(message);
     u8g2.sendBuffer();
+    unlockScreen();
     
     // 添加停留时间，确保消息可见
     delay(1000);
   }
   Serial.println("showScrollMessage completed");
 }
+
+// 流式文本：按屏幕宽度自动换行，只显示最后两行，新内容到达时调用
+void showStreamingText(const char* text) {
+  lockScreen();
+  const int lineHeight = 16;
+  const int maxLines = SCREEN_HEIGHT / lineHeight;
+  int screenWidth = u8g2.getDisplayWidth() - 2;
+
+  // 记录最近maxLines行的起点（环形）
+  const char* lineStarts[4] = {text};
+  int lineCount = 1;
+  int lineWidth = 0;
+  const char* p = text;
+  while (*p) {
+    int len = 1;
+    uint8_t c = (uint8_t)*p;
+    if (c >= 0xF0) len = 4;
+    else if (c >= 0xE0) len = 3;
+    else if (c >= 0xC0) len = 2;
+
+    if (*p == '\n') {
+      lineStarts[lineCount++ % maxLines] = p + 1;
+      lineWidth = 0;
+      p++;
+      continue;
+    }
+    char glyph[5] = {0};
+    for (int i = 0; i < len && p[i]; i++) glyph[i] = p[i];
+    int w = u8g2.getUTF8Width(glyph);
+    if (lineWidth + w > screenWidth) {
+      lineStarts[lineCount++ % maxLines] = p;
+      lineWidth = 0;
+    }
+    lineWidth += w;
+    p += strnlen(glyph, len);
+  }
+
+  u8g2.clearBuffer();
+  int first = lineCount > maxLines ? lineCount - maxLines : 0;
+  for (int i = first; i < lineCount; i++) {
+    const char* start = lineStarts[i % maxLines];
+    const char* end = i + 1 < lineCount ? lineStarts[(i + 1) % maxLines] : p;
+    char line[96];
+    size_t n = end - start;
+    if (n >= sizeof(line)) n = sizeof(line) - 1;
+    memcpy(line, start, n);
+    line[n] = '\0';
+    if (n > 0 && line[n - 1] == '\n') line[n - 1] = '\0';
+    u8g2.setCursor(2, 14 + (i - first) * lineHeight);
+    u8g2.print(line);
+  }
+  u8g2.sendBuffer();
+  unlockScreen();
+}
+
+// 单色图像（XBM格式，低位在左）直接写入显示缓冲区的页格式，不经过drawXBM，不发送。
+// 与sendDisplayBuffer()分开调用时，调用者应在外层持有lockScreen()，两步之间不会被其他写屏插入
+void packMonoImage(const uint8_t* xbm, uint16_t width, uint16_t height) {
+  lockScreen();
+  uint8_t* buffer = u8g2.getBufferPtr();
+  uint16_t bufferWidth = u8g2.getBufferTileWidth() * 8;
+  uint8_t bufferPages = u8g2.getBufferTileHeight();
+
+  // 图像没有覆盖整个屏幕时先清空，覆盖时每个字节都会被改写
+  if (width < bufferWidth || height < bufferPages * 8) {
+    u8g2.clearBuffer();
+  }
+  monoBlitToPages(xbm, width, height, buffer, bufferWidth, bufferPages);
+  unlockScreen();
+}
+
+// 把显示缓冲区通过I2C发送到屏幕
+void sendDisplayBuffer() {
+  lockScreen();
+  u8g2.sendBuffer();
+  unlockScreen();
+}
+
+// 显示单色图像
+void showMonoImage(const uint8_t* xbm, uint16_t width, uint16_t height) {
+  lockScreen();
+  packMonoImage(xbm, width, height);
+  sendDisplayBuffer();
+  unlockScreen();
+}
+
+// 比较drawXBM与直写页缓冲区的耗时（只测填充缓冲区，不含I2C传输）
+void benchmarkOledBlit(int iterations) {
+  Serial.println("=== OLED Blit Benchmark ===");
+  static uint8_t image[SCREEN_WIDTH * SCREEN_HEIGHT / 8];
+  for (size_t i = 0; i < sizeof(image); i++) {
+    image[i] = (uint8_t)(i * 37 + (i >> 4));  // 近似抖动后的随机图案
+  }
+
+  lockScreen();
+  uint8_t* buffer = u8g2.getBufferPtr();
+  uint16_t bufferWidth = u8g2.getBufferTileWidth() * 8;
+  uint8_t bufferPages = u8g2.getBufferTileHeight();
+
+  uint32_t start = micros();
+  for (int i = 0; i < iterations; i++) {
+    u8g2.clearBuffer();
+    u8g2.drawXBM(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, image);
+  }
+  uint32_t xbmTime = micros() - start;
+
+  start = micros();
+  for (int i = 0; i < iterations; i++) {
+    monoBlitToPages(image, SCREEN_WIDTH, SCREEN_HEIGHT, buffer, bufferWidth, bufferPages);
+  }
+  uint32_t blitTime = micros() - start;
+
+  Serial.printf("drawXBM: %lu us/frame, page blit: %lu us/frame\n",
+                (unsigned long)(xbmTime / iterations), (unsigned long)(blitTime / iterations));
+  u8g2.clearBuffer();
+  unlockScreen();
+  Serial.println("=== OLED Blit Benchmark Complete ===");
+}
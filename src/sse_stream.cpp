@@ -0,0 +1,171 @@
+#include "sse_stream.h"
+#include <string.h>
+
+enum ChunkState : uint8_t {
+  CHUNK_SIZE = 0,     // 十六进制长度
+  CHUNK_EXTENSION,    // ';'之后的扩展，忽略到行尾
+  CHUNK_SIZE_LF,
+  CHUNK_DATA,
+  CHUNK_DATA_CR,      // 载荷之后的CRLF
+  CHUNK_DATA_LF,
+  CHUNK_TRAILER,      // 结束分块之后的尾部字段，直到空行（行首）
+  CHUNK_TRAILER_FIELD,
+  CHUNK_TRAILER_FIELD_LF,
+  CHUNK_TRAILER_LF,
+  CHUNK_DONE
+};
+
+void chunkDecoderInit(ChunkDecoder* d) {
+  memset(d, 0, sizeof(*d));
+}
+
+static inline int hexValue(uint8_t c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+size_t chunkDecoderFeed(ChunkDecoder* d, uint8_t* data, size_t len) {
+  size_t out = 0;
+  size_t i = 0;
+  while (i < len && !d->done && !d->error) {
+    uint8_t c = data[i];
+    switch (d->state) {
+      case CHUNK_SIZE: {
+        int v = hexValue(c);
+        if (v >= 0) {
+          d->remaining = (d->remaining << 4) | (uint32_t)v;
+        } else if (c == ';' || c == ' ' || c == '\t') {
+          d->state = CHUNK_EXTENSION;
+        } else if (c == '\r') {
+          d->state = CHUNK_SIZE_LF;
+        } else {
+          d->error = true;
+        }
+        i++;
+        break;
+      }
+      case CHUNK_EXTENSION:
+        if (c == '\r') d->state = CHUNK_SIZE_LF;
+        i++;
+        break;
+      case CHUNK_SIZE_LF:
+        if (c != '\n') {
+          d->error = true;
+        } else if (d->remaining == 0) {
+          d->state = CHUNK_TRAILER;
+        } else {
+          d->state = CHUNK_DATA;
+        }
+        i++;
+        break;
+      case CHUNK_DATA: {
+        // 整段载荷向前搬移
+        size_t n = len - i;
+        if (n > d->remaining) n = d->remaining;
+        memmove(data + out, data + i, n);
+        out += n;
+        i += n;
+        d->remaining -= (uint32_t)n;
+        if (d->remaining == 0) d->state = CHUNK_DATA_CR;
+        break;
+      }
+      case CHUNK_DATA_CR:
+        if (c != '\r') d->error = true;
+        d->state = CHUNK_DATA_LF;
+        i++;
+        break;
+      case CHUNK_DATA_LF:
+        if (c != '\n') d->error = true;
+        d->state = CHUNK_SIZE;
+        i++;
+        break;
+      case CHUNK_TRAILER:
+        d->state = c == '\r' ? CHUNK_TRAILER_LF : CHUNK_TRAILER_FIELD;
+        i++;
+        break;
+      case CHUNK_TRAILER_FIELD:
+        if (c == '\r') d->state = CHUNK_TRAILER_FIELD_LF;
+        i++;
+        break;
+      case CHUNK_TRAILER_FIELD_LF:
+        if (c != '\n') d->error = true;
+        d->state = CHUNK_TRAILER;
+        i++;
+        break;
+      case CHUNK_TRAILER_LF:
+        if (c != '\n') d->error = true;
+        d->state = CHUNK_DONE;
+        d->done = true;
+        i++;
+        break;
+      default:
+        i++;
+        break;
+    }
+  }
+  return out;
+}
+
+void sseParserInit(SseParser* p, SseEventCallback onEvent, void* ctx) {
+  memset(p, 0, sizeof(*p));
+  p->onEvent = onEvent;
+  p->ctx = ctx;
+}
+
+static void endLine(SseParser* p) {
+  char* line = p->data + p->length;
+  size_t stored = p->lineLength;
+  if (p->length + stored > SSE_EVENT_MAX - 1) stored = SSE_EVENT_MAX - 1 - p->length;
+
+  if (p->lineLength == 0) {
+    // 空行：分发事件
+    if (p->overflow) {
+      p->dropped++;
+    } else if (p->length > 0) {
+      p->data[p->length] = '\0';
+      p->events++;
+      if (p->onEvent) p->onEvent(p->data, p->length, p->ctx);
+    }
+    p->length = 0;
+    p->overflow = false;
+  } else if (!p->overflow && stored >= 5 && memcmp(line, "data:", 5) == 0) {
+    if (stored < p->lineLength) {
+      p->overflow = true;
+    } else {
+      size_t skip = (stored > 5 && line[5] == ' ') ? 6 : 5;
+      size_t valueLength = stored - skip;
+      // 多个data行之间以'\n'连接
+      if (p->length > 0) {
+        line[0] = '\n';
+        memmove(line + 1, line + skip, valueLength);
+        p->length += 1 + valueLength;
+      } else {
+        memmove(line, line + skip, valueLength);
+        p->length = valueLength;
+      }
+    }
+  }
+  // 注释（':'开头）和其他字段（event/id/retry）不保存
+  p->lineLength = 0;
+}
+
+void sseParserFeed(SseParser* p, const char* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    char c = data[i];
+    if (p->skipLf) {
+      p->skipLf = false;
+      if (c == '\n') continue;
+    }
+    if (c == '\r' || c == '\n') {
+      p->skipLf = c == '\r';
+      endLine(p);
+      continue;
+    }
+    if (p->length + p->lineLength < SSE_EVENT_MAX - 1) {
+      p->data[p->length + p->lineLength] = c;
+    }
+    p->lineLength++;
+  }
+}
@@ -0,0 +1,362 @@
+#include <Arduino.h>
+#include "esp_camera.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include "vision_pipeline.h"
+#include "answer_cache.h"
+#include "camera_mode.h"
+#include "camera_lock.h"
+
+// 外部函数声明
+String resolveImageJpeg(const uint8_t* jpegData, size_t jpegSize, const String& question, bool showStatus,
+                        size_t* sentBytes, uint32_t* sentMs);
+bool frameSceneChanged(camera_fb_t* fb, SceneGate* gate);
+bool frameAnswerHash(camera_fb_t* fb, uint64_t* hash);
+void adaptQualityAfterUpload(size_t frameBytes, size_t sentBytes, uint32_t sentMs);
+
+// 任务配置：拍照和结果在核心1（与Arduino loop同核），上传在核心0（与WiFi协议栈同核）
+#define CAPTURE_TASK_STACK 6144    // 场景检测的缩略图在栈上
+#define UPLOAD_TASK_STACK  12288   // TLS握手需要较大的栈
+#define RESULT_TASK_STACK  6144
+#define CAPTURE_TASK_CORE  1
+#define UPLOAD_TASK_CORE   0
+#define RESULT_TASK_CORE   1
+
+struct FrameItem {
+  camera_fb_t* fb;
+  uint32_t frameId;
+  uint32_t capturedAt;
+  bool hashed;
+  uint64_t imageHash;           // 回答缓存的键，在拍照任务中计算（JPEG解码器不可重入）
+};
+
+struct ResultItem {
+  VisionResult result;
+  char* text;             // 堆上的结果副本，由结果任务释放
+};
+
+static QueueHandle_t frameQueue = NULL;
+static QueueHandle_t resultQueue = NULL;
+// 任务句柄由xTaskCreatePinnedToCore直接写入，任务退出前自己清空
+static TaskHandle_t captureTask = NULL;
+static TaskHandle_t uploadTask = NULL;
+static TaskHandle_t resultTask = NULL;
+static volatile bool pipelineRunning = false;
+
+static VisionPipelineConfig pipelineConfig;
+static String pipelineQuestion;
+static uint32_t pipelineStartMs = 0;
+
+// 三个任务分布在两个核心上更新统计，主循环随时复制，都在statsLock下进行
+static VisionPipelineStats pipelineStats;
+static SemaphoreHandle_t statsLock = NULL;
+
+static void recordStage(VisionStageStats* stage, uint32_t ms) {
+  xSemaphoreTake(statsLock, portMAX_DELAY);
+  stage->count++;
+  stage->totalMs += ms;
+  if (ms > stage->maxMs) stage->maxMs = ms;
+  xSemaphoreGive(statsLock);
+}
+
+static void countEvent(uint32_t* counter) {
+  xSemaphoreTake(statsLock, portMAX_DELAY);
+  (*counter)++;
+  xSemaphoreGive(statsLock);
+}
+
+static void notePeak(QueueHandle_t queue, uint8_t* peak) {
+  uint8_t depth = (uint8_t)uxQueueMessagesWaiting(queue);
+  xSemaphoreTake(statsLock, portMAX_DELAY);
+  if (depth > *peak) *peak = depth;
+  xSemaphoreGive(statsLock);
+}
+
+static void captureTaskMain(void* param) {
+  uint32_t frameId = 0;
+  while (pipelineRunning) {
+    uint32_t start = millis();
+
+    // 帧队列已满时先归还队列里的旧帧再取新帧：帧缓冲只有两个，
+    // 上传任务占用一个、队列占用一个时再取帧会一直阻塞到超时
+    if (uxQueueSpacesAvailable(frameQueue) == 0) {
+      FrameItem old;
+      if (xQueueReceive(frameQueue, &old, 0) == pdTRUE) {
+        esp_camera_fb_return(old.fb);
+        countEvent(&pipelineStats.framesDropped);
+      }
+    }
+
+    camera_fb_t* fb = esp_camera_fb_get();
+    if (!fb) {
+      Serial.println("Pipeline: camera capture failed");
+      countEvent(&pipelineStats.captureFailures);
+      vTaskDelay(pdMS_TO_TICKS(100));
+      continue;
+    }
+    // 场景未变化的帧直接归还，不占用上传
+    if (pipelineConfig.gate && !frameSceneChanged(fb, pipelineConfig.gate)) {
+      esp_camera_fb_return(fb);
+      recordStage(&pipelineStats.capture, millis() - start);
+      countEvent(&pipelineStats.framesUnchanged);
+      uint32_t elapsed = millis() - start;
+      if (elapsed < pipelineConfig.captureIntervalMs) {
+        vTaskDelay(pdMS_TO_TICKS(pipelineConfig.captureIntervalMs - elapsed));
+      }
+      continue;
+    }
+    recordStage(&pipelineStats.capture, millis() - start);
+
+    FrameItem item = {fb, ++frameId, (uint32_t)millis(), false, 0};
+    item.hashed = answerCacheEnabled() && frameAnswerHash(fb, &item.imageHash);
+    if (xQueueSend(frameQueue, &item, 0) != pdTRUE) {
+      esp_camera_fb_return(fb);
+      countEvent(&pipelineStats.framesDropped);
+    }
+    notePeak(frameQueue, &pipelineStats.frameQueuePeak);
+
+    uint32_t elapsed = millis() - start;
+    if (elapsed < pipelineConfig.captureIntervalMs) {
+      vTaskDelay(pdMS_TO_TICKS(pipelineConfig.captureIntervalMs - elapsed));
+    }
+  }
+  captureTask = NULL;
+  vTaskDelete(NULL);
+}
+
+static void uploadTaskMain(void* param) {
+  while (pipelineRunning) {
+    FrameItem item;
+    if (xQueueReceive(frameQueue, &item, pdMS_TO_TICKS(100)) != pdTRUE) continue;
+
+    // 帧缓冲区在请求发送完成后才归还，上传期间不复制图像
+    uint32_t start = millis();
+    String text;
+    bool cached = false;
+    if (item.hashed) {
+      char answer[ANSWER_CACHE_TEXT_MAX];
+      cached = answerCacheLookup(item.imageHash, pipelineQuestion.c_str(), answer, sizeof(answer), NULL);
+      if (cached) text = answer;
+    }
+    if (!cached) {
+      size_t sentBytes = 0;
+      uint32_t sentMs = 0;
+      text = resolveImageJpeg(item.fb->buf, item.fb->len, pipelineQuestion, false, &sentBytes, &sentMs);
+      adaptQualityAfterUpload(item.fb->len, sentBytes, sentMs);
+      if (item.hashed && !text.startsWith("错误")) {
+        answerCacheStore(item.imageHash, pipelineQuestion.c_str(), text.c_str());
+      }
+    }
+    size_t imageBytes = item.fb->len;
+    esp_camera_fb_return(item.fb);
+    uint32_t uploadMs = millis() - start;
+    if (cached) {
+      countEvent(&pipelineStats.cacheHits);
+    } else {
+      recordStage(&pipelineStats.upload, uploadMs);
+    }
+
+    ResultItem entry;
+    entry.result.frameId = item.frameId;
+    entry.result.cached = cached;
+    entry.result.ok = !text.startsWith("错误");
+    entry.result.latencyMs = millis() - item.capturedAt;
+    entry.result.uploadMs = uploadMs;
+    entry.result.imageBytes = imageBytes;
+    entry.text = strdup(text.c_str());
+    if (!entry.result.ok) countEvent(&pipelineStats.uploadFailures);
+
+    // 结果队列满时阻塞等待，让慢回调对上游形成反压
+    bool queued = false;
+    while (pipelineRunning && !queued) {
+      queued = xQueueSend(resultQueue, &entry, pdMS_TO_TICKS(100)) == pdTRUE;
+    }
+    if (!queued) {
+      free(entry.text);
+    }
+    notePeak(resultQueue, &pipelineStats.resultQueuePeak);
+  }
+  uploadTask = NULL;
+  vTaskDelete(NULL);
+}
+
+static void resultTaskMain(void* param) {
+  while (pipelineRunning) {
+    ResultItem entry;
+    if (xQueueReceive(resultQueue, &entry, pdMS_TO_TICKS(100)) != pdTRUE) continue;
+
+    uint32_t start = millis();
+    entry.result.text = entry.text ? entry.text : "错误：内存不足";
+    if (pipelineConfig.onResult) {
+      pipelineConfig.onResult(&entry.result, pipelineConfig.ctx);
+    }
+    free(entry.text);
+    recordStage(&pipelineStats.result, millis() - start);
+  }
+  resultTask = NULL;
+  vTaskDelete(NULL);
+}
+
+void visionPipelineDefaultConfig(VisionPipelineConfig* config, const char* question,
+                                 VisionResultCallback onResult, void* ctx) {
+  config->question = question;
+  config->captureIntervalMs = 200;
+  config->frameQueueDepth = 1;
+  config->resultQueueDepth = 4;
+  config->gate = NULL;
+  config->onResult = onResult;
+  config->ctx = ctx;
+}
+
+bool startVisionPipeline(const VisionPipelineConfig* config) {
+  if (pipelineRunning || captureTask || uploadTask || resultTask) {
+    Serial.println("Pipeline already running");
+    return false;
+  }
+  if (esp_camera_sensor_get() == NULL) {
+    Serial.println("Pipeline: camera not initialized");
+    return false;
+  }
+  if (!statsLock) {
+    statsLock = xSemaphoreCreateMutex();
+    if (!statsLock) return false;
+  }
+  // 帧缓冲只有两个，录帧或实时预览同时取帧时拍照任务会取不到帧：它们运行时拒绝启动。
+  // 检查、切换到分析模式和登记在同一次加锁中完成，中间不会被其他取帧者插入
+  cameraLock();
+  uint8_t busy = cameraUsers();
+  bool claimed = busy == 0 && setCameraMode(CAMERA_MODE_ANALYZE) && cameraUserBegin(CAMERA_USER_PIPELINE);
+  cameraUnlock();
+  if (!claimed) {
+    Serial.printf("Pipeline: camera busy (%s)\n", busy ? cameraUserName(busy) : "mode switch failed");
+    return false;
+  }
+
+  pipelineConfig = *config;
+  if (pipelineConfig.frameQueueDepth == 0) pipelineConfig.frameQueueDepth = 1;
+  if (pipelineConfig.resultQueueDepth == 0) pipelineConfig.resultQueueDepth = 1;
+  pipelineQuestion = config->question ? config->question : "";
+
+  frameQueue = xQueueCreate(pipelineConfig.frameQueueDepth, sizeof(FrameItem));
+  resultQueue = xQueueCreate(pipelineConfig.resultQueueDepth, sizeof(ResultItem));
+  if (!frameQueue || !resultQueue) {
+    Serial.println("Pipeline: failed to create queues");
+    stopVisionPipeline();
+    return false;
+  }
+
+  xSemaphoreTake(statsLock, portMAX_DELAY);
+  memset(&pipelineStats, 0, sizeof(pipelineStats));
+  xSemaphoreGive(statsLock);
+  pipelineStartMs = millis();
+  pipelineRunning = true;
+
+  // 句柄直接写入各自的变量：FreeRTOS在任务可运行之前就写出句柄，任务退出时的清空不会被这里覆盖
+  bool ok = xTaskCreatePinnedToCore(captureTaskMain, "vision_capture", CAPTURE_TASK_STACK,
+                                    NULL, 5, &captureTask, CAPTURE_TASK_CORE) == pdPASS;
+  if (!ok) captureTask = NULL;
+  ok = ok && xTaskCreatePinnedToCore(uploadTaskMain, "vision_upload", UPLOAD_TASK_STACK,
+                                     NULL, 4, &uploadTask, UPLOAD_TASK_CORE) == pdPASS;
+  if (!ok) uploadTask = NULL;
+  ok = ok && xTaskCreatePinnedToCore(resultTaskMain, "vision_result", RESULT_TASK_STACK,
+                                     NULL, 3, &resultTask, RESULT_TASK_CORE) == pdPASS;
+  if (!ok) resultTask = NULL;
+
+  if (!ok) {
+    Serial.println("Pipeline: failed to create tasks");
+    stopVisionPipeline();
+    return false;
+  }
+  Serial.printf("Pipeline started: interval %lu ms, frame queue %d, result queue %d\n",
+                (unsigned long)pipelineConfig.captureIntervalMs,
+                pipelineConfig.frameQueueDepth, pipelineConfig.resultQueueDepth);
+  return true;
+}
+
+void stopVisionPipeline() {
+  pipelineRunning = false;
+
+  // 等待任务自行退出；上传任务可能正在等待网络响应
+  uint32_t start = millis();
+  while ((captureTask || uploadTask || resultTask) && millis() - start < 30000) {
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+  if (captureTask || uploadTask || resultTask) {
+    Serial.println("Pipeline: tasks did not exit in time");
+    return;
+  }
+
+  if (frameQueue) {
+    FrameItem item;
+    while (xQueueReceive(frameQueue, &item, 0) == pdTRUE) {
+      esp_camera_fb_return(item.fb);
+    }
+    vQueueDelete(frameQueue);
+    frameQueue = NULL;
+  }
+  if (resultQueue) {
+    ResultItem entry;
+    while (xQueueReceive(resultQueue, &entry, 0) == pdTRUE) {
+      free(entry.text);
+    }
+    vQueueDelete(resultQueue);
+    resultQueue = NULL;
+  }
+  cameraUserEnd(CAMERA_USER_PIPELINE);
+  if (statsLock) {
+    xSemaphoreTake(statsLock, portMAX_DELAY);
+    pipelineStats.runningMs = millis() - pipelineStartMs;
+    xSemaphoreGive(statsLock);
+  }
+  Serial.println("Pipeline stopped");
+}
+
+bool visionPipelineRunning() {
+  return pipelineRunning;
+}
+
+void getVisionPipelineStats(VisionPipelineStats* stats) {
+  if (!statsLock) {
+    memset(stats, 0, sizeof(*stats));
+    return;
+  }
+  xSemaphoreTake(statsLock, portMAX_DELAY);
+  *stats = pipelineStats;
+  xSemaphoreGive(statsLock);
+  if (pipelineRunning) {
+    stats->frameQueued = frameQueue ? (uint8_t)uxQueueMessagesWaiting(frameQueue) : 0;
+    stats->resultQueued = resultQueue ? (uint8_t)uxQueueMessagesWaiting(resultQueue) : 0;
+    stats->runningMs = millis() - pipelineStartMs;
+  }
+}
+
+static void printStage(const char* name, const VisionStageStats& stage) {
+  Serial.printf("  %-8s count %lu, avg %lu ms, max %lu ms\n", name,
+                (unsigned long)stage.count,
+                (unsigned long)(stage.count ? stage.totalMs / stage.count : 0),
+                (unsigned long)stage.maxMs);
+}
+
+void printVisionPipelineStats() {
+  VisionPipelineStats stats;
+  getVisionPipelineStats(&stats);
+
+  Serial.println("=== Vision Pipeline Stats ===");
+  printStage("capture", stats.capture);
+  printStage("upload", stats.upload);
+  printStage("result", stats.result);
+  Serial.printf("  frame queue %d (peak %d), result queue %d (peak %d)\n",
+                stats.frameQueued, stats.frameQueuePeak, stats.resultQueued, stats.resultQueuePeak);
+  Serial.printf("  dropped %lu, unchanged %lu, cache hits %lu, capture failures %lu, upload failures %lu\n",
+                (unsigned long)stats.framesDropped, (unsigned long)stats.framesUnchanged,
+                (unsigned long)stats.cacheHits,
+                (unsigned long)stats.captureFailures,
+                (unsigned long)stats.uploadFailures);
+  if (stats.runningMs > 0) {
+    Serial.printf("  throughput %.2f results/min over %lu s\n",
+                  stats.result.count * 60000.0f / stats.runningMs,
+                  (unsigned long)(stats.runningMs / 1000));
+  }
+}
@@ -0,0 +1,369 @@
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include "vision_requests.h"
+
+// 外部函数声明
+String resolveVisionRequest(const uint8_t* jpegData, size_t jpegSize, const char* imageUrl,
+                            const String& question, const char* model);
+
+#define REQUEST_TASK_STACK 12288   // TLS握手需要较大的栈
+#define REQUEST_TASK_CORE  0
+#define EXPIRY_TASK_STACK  4096    // 只执行超时通知和回调
+
+// 等待同一请求结果的调用者
+struct RequestSubscriber {
+  uint32_t id;
+  uint32_t enqueuedMs;
+  VisionRequestCallback onDone;
+  void* ctx;
+};
+
+// 请求内容，与队列槽位一一对应
+struct RequestPayload {
+  const uint8_t* image;
+  size_t imageLength;
+  bool hasUrl;
+  bool cancelRequested;        // 发送中被取消
+  char imageUrl[VISION_REQUEST_URL_MAX];
+  char question[VISION_REQUEST_QUESTION_MAX];
+  char model[VISION_REQUEST_MODEL_MAX];
+  RequestSubscriber subscribers[VISION_REQUEST_SUBSCRIBERS_MAX];
+  uint8_t subscriberCount;
+};
+
+static RequestQueue requestQueue;
+static RequestPayload* payloads = NULL;
+static SemaphoreHandle_t requestLock = NULL;
+// 以下三个在requestLock下修改；任务退出时在锁内清空自己的句柄，
+// 所以持锁时看到非NULL的句柄，对应的任务一定还存在，可以安全地通知
+static TaskHandle_t volatile requestTask = NULL;
+static TaskHandle_t volatile expiryTask = NULL;
+static volatile bool workerRunning = false;
+
+static void deliver(VisionRequestCallback onDone, void* ctx, uint32_t id, VisionRequestStatus status,
+                    const char* text, uint32_t waitMs, uint32_t serviceMs) {
+  if (!onDone) return;
+  VisionRequestResult result = {id, status, text, waitMs, serviceMs};
+  onDone(&result, ctx);
+}
+
+// 通知请求的所有调用者（在锁外调用，subscribers为复制出的列表）；
+// startedMs为0表示没有开始处理，等待时间算到nowMs
+static void deliverAll(const RequestSubscriber* subscribers, uint8_t count, VisionRequestStatus status,
+                       const char* text, uint32_t startedMs, uint32_t nowMs) {
+  uint32_t end = startedMs ? startedMs : nowMs;
+  for (uint8_t i = 0; i < count; i++) {
+    const RequestSubscriber& s = subscribers[i];
+    // 处理开始后才合并进来的调用者没有排队时间
+    uint32_t waitMs = (int32_t)(end - s.enqueuedMs) > 0 ? end - s.enqueuedMs : 0;
+    deliver(s.onDone, s.ctx, s.id, status, text, waitMs, startedMs ? nowMs - startedMs : 0);
+  }
+}
+
+// 找到id所属的槽位（排队中或处理中），*index输出调用者在列表中的位置
+static int findSubscriber(uint32_t id, uint8_t* index) {
+  for (int i = 0; i < requestQueue.capacity; i++) {
+    if (requestQueue.slots[i].state == REQUEST_SLOT_FREE) continue;
+    const RequestPayload& p = payloads[i];
+    for (uint8_t j = 0; j < p.subscriberCount; j++) {
+      if (p.subscribers[j].id == id) {
+        *index = j;
+        return i;
+      }
+    }
+  }
+  return -1;
+}
+
+// 找一个可以合并的请求：同一图像缓冲区（或同一URL）、同样的问题和模型，且未被取消
+static int findDuplicate(const VisionRequest* request) {
+  const char* url = request->imageUrl;
+  const char* model = request->model ? request->model : "";
+  for (int i = 0; i < requestQueue.capacity; i++) {
+    if (requestQueue.slots[i].state == REQUEST_SLOT_FREE) continue;
+    const RequestPayload& p = payloads[i];
+    if (p.cancelRequested || p.subscriberCount >= VISION_REQUEST_SUBSCRIBERS_MAX) continue;
+    if (p.hasUrl != (url != NULL)) continue;
+    if (url ? strcmp(p.imageUrl, url) != 0
+            : (p.image != request->image || p.imageLength != request->imageLength)) continue;
+    if (strcmp(p.question, request->question) != 0 || strcmp(p.model, model) != 0) continue;
+    return i;
+  }
+  return -1;
+}
+
+// 取出所有已超时的请求并通知
+static void expireRequests() {
+  while (true) {
+    xSemaphoreTake(requestLock, portMAX_DELAY);
+    uint32_t now = millis();
+    int slot = requestQueuePopExpired(&requestQueue, now);
+    if (slot < 0) {
+      xSemaphoreGive(requestLock);
+      return;
+    }
+    RequestSlot info = requestQueue.slots[slot];
+    RequestPayload& p = payloads[slot];
+    RequestSubscriber subscribers[VISION_REQUEST_SUBSCRIBERS_MAX];
+    uint8_t count = p.subscriberCount;
+    memcpy(subscribers, p.subscribers, sizeof(RequestSubscriber) * count);
+    xSemaphoreGive(requestLock);
+
+    Serial.printf("Vision request %lu expired after %lu ms in queue\n",
+                  (unsigned long)info.id, (unsigned long)(now - info.enqueuedMs));
+    deliverAll(subscribers, count, VISION_REQUEST_EXPIRED, "", 0, now);
+  }
+}
+
+static void requestTaskMain(void* param) {
+  while (workerRunning) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    expireRequests();
+
+    while (workerRunning) {
+      xSemaphoreTake(requestLock, portMAX_DELAY);
+      int slot = requestQueuePop(&requestQueue, millis());
+      if (slot < 0) {
+        xSemaphoreGive(requestLock);
+        break;
+      }
+      // 处理中的槽位不会被复用，内容可以在锁外读取
+      RequestSlot info = requestQueue.slots[slot];
+      RequestPayload& p = payloads[slot];
+      xSemaphoreGive(requestLock);
+
+      String text = resolveVisionRequest(p.image, p.imageLength, p.hasUrl ? p.imageUrl : NULL,
+                                         p.question, p.model);
+
+      xSemaphoreTake(requestLock, portMAX_DELAY);
+      uint32_t now = millis();
+      bool cancelled = p.cancelRequested;
+      RequestSubscriber subscribers[VISION_REQUEST_SUBSCRIBERS_MAX];
+      uint8_t count = p.subscriberCount;
+      memcpy(subscribers, p.subscribers, sizeof(RequestSubscriber) * count);
+      requestQueueFinish(&requestQueue, slot, now);
+      if (cancelled) requestQueue.stats.cancelled++;
+      xSemaphoreGive(requestLock);
+
+      VisionRequestStatus status = cancelled ? VISION_REQUEST_CANCELLED :
+                                   text.startsWith("错误") ? VISION_REQUEST_FAILED : VISION_REQUEST_OK;
+      deliverAll(subscribers, count, status, cancelled ? "" : text.c_str(), info.startedMs, now);
+
+      // 发送下一个之前先取出已到期的请求，不发送过期请求
+      expireRequests();
+    }
+  }
+  xSemaphoreTake(requestLock, portMAX_DELAY);
+  requestTask = NULL;
+  xSemaphoreGive(requestLock);
+  vTaskDelete(NULL);
+}
+
+// 截止时间由单独的任务按时检查：工作任务发送一个请求可能要数十秒，其间到期的排队请求
+// 也要按时通知调用者。睡到最早的截止时间，新的限时请求入队时被提前唤醒
+static void expiryTaskMain(void* param) {
+  while (workerRunning) {
+    expireRequests();
+    xSemaphoreTake(requestLock, portMAX_DELAY);
+    uint32_t waitMs = 0;
+    bool pending = requestQueueNextDeadline(&requestQueue, millis(), &waitMs);
+    xSemaphoreGive(requestLock);
+    ulTaskNotifyTake(pdTRUE, pending ? pdMS_TO_TICKS(waitMs) + 1 : portMAX_DELAY);
+  }
+  xSemaphoreTake(requestLock, portMAX_DELAY);
+  expiryTask = NULL;
+  xSemaphoreGive(requestLock);
+  vTaskDelete(NULL);
+}
+
+void visionRequestInit(VisionRequest* request) {
+  memset(request, 0, sizeof(*request));
+}
+
+bool startVisionRequestWorker(uint8_t capacity) {
+  if (workerRunning || requestTask || expiryTask) {
+    Serial.println("Vision request worker already running");
+    return false;
+  }
+  if (!requestLock) {
+    requestLock = xSemaphoreCreateMutex();
+    if (!requestLock) return false;
+  }
+  if (!payloads) {
+    size_t bytes = sizeof(RequestPayload) * REQUEST_QUEUE_MAX;
+    payloads = (RequestPayload*)(psramFound() ? ps_calloc(1, bytes) : calloc(1, bytes));
+    if (!payloads) {
+      Serial.println("Vision request worker: allocation failed");
+      return false;
+    }
+  }
+  // 持锁创建任务并记下句柄：任务即使立即退出，也要等这里放锁后才能清空自己的句柄
+  xSemaphoreTake(requestLock, portMAX_DELAY);
+  requestQueueInit(&requestQueue, capacity);
+  workerRunning = true;
+  TaskHandle_t worker = NULL;
+  TaskHandle_t expiry = NULL;
+  bool ok = xTaskCreatePinnedToCore(requestTaskMain, "vision_requests", REQUEST_TASK_STACK,
+                                    NULL, 3, &worker, REQUEST_TASK_CORE) == pdPASS;
+  ok = ok && xTaskCreatePinnedToCore(expiryTaskMain, "vision_expiry", EXPIRY_TASK_STACK,
+                                     NULL, 3, &expiry, REQUEST_TASK_CORE) == pdPASS;
+  requestTask = worker;
+  expiryTask = expiry;
+  if (!ok) {
+    // 已启动的工作任务看到workerRunning为false后自行退出
+    workerRunning = false;
+    if (worker) xTaskNotifyGive(worker);
+  }
+  xSemaphoreGive(requestLock);
+
+  if (!ok) {
+    Serial.println("Vision request worker: failed to start task");
+    return false;
+  }
+  Serial.printf("Vision request worker started, queue capacity %d\n", requestQueue.capacity);
+  return true;
+}
+
+void stopVisionRequestWorker() {
+  if (!requestLock) return;
+  // 在锁内清除workerRunning：此后submitVisionRequest不会再入队，下面的取消不会漏掉请求
+  xSemaphoreTake(requestLock, portMAX_DELAY);
+  workerRunning = false;
+  if (requestTask) xTaskNotifyGive(requestTask);
+  if (expiryTask) xTaskNotifyGive(expiryTask);
+  xSemaphoreGive(requestLock);
+
+  uint32_t start = millis();
+  // 正在发送的请求可能需要数十秒
+  while ((requestTask || expiryTask) && millis() - start < 60000) {
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+  if (requestTask || expiryTask) {
+    Serial.println("Vision request worker: task did not exit in time");
+    return;
+  }
+
+  // 排队中的请求以取消结束，合并的调用者逐个取消
+  for (int i = 0; i < requestQueue.capacity; i++) {
+    while (requestQueue.slots[i].state == REQUEST_SLOT_QUEUED && payloads[i].subscriberCount > 0) {
+      cancelVisionRequest(payloads[i].subscribers[0].id);
+    }
+  }
+  Serial.println("Vision request worker stopped");
+}
+
+bool visionRequestWorkerRunning() {
+  return workerRunning;
+}
+
+uint32_t submitVisionRequest(const VisionRequest* request) {
+  if (!requestLock || !request->question) return 0;
+  if ((request->image == NULL || request->imageLength == 0) && request->imageUrl == NULL) return 0;
+  if (request->imageUrl && strlen(request->imageUrl) >= VISION_REQUEST_URL_MAX) return 0;
+  if (strlen(request->question) >= VISION_REQUEST_QUESTION_MAX) return 0;
+  if (request->model && strlen(request->model) >= VISION_REQUEST_MODEL_MAX) return 0;
+
+  xSemaphoreTake(requestLock, portMAX_DELAY);
+  // 工作任务正在停止或已退出：入队的请求既不会被发送，也赶不上停止时的取消
+  if (!workerRunning || !requestTask) {
+    xSemaphoreGive(requestLock);
+    return 0;
+  }
+  uint32_t now = millis();
+  uint32_t id = 0;
+  int slot = findDuplicate(request);
+  if (slot >= 0) {
+    // 同一帧的同一问题只发送一次，结果交给每个调用者
+    id = requestQueueJoin(&requestQueue, slot, request->priority, now, request->timeoutMs);
+    RequestPayload& p = payloads[slot];
+    p.subscribers[p.subscriberCount++] = {id, now, request->onDone, request->ctx};
+    xSemaphoreGive(requestLock);
+    Serial.printf("Vision request %lu joined request %lu\n", (unsigned long)id,
+                  (unsigned long)requestQueue.slots[slot].id);
+    return id;
+  }
+
+  slot = requestQueuePush(&requestQueue, request->priority, now, request->timeoutMs, &id);
+  if (slot >= 0) {
+    RequestPayload& p = payloads[slot];
+    p.image = request->image;
+    p.imageLength = request->imageLength;
+    p.hasUrl = request->imageUrl != NULL;
+    p.cancelRequested = false;
+    strcpy(p.imageUrl, request->imageUrl ? request->imageUrl : "");
+    strcpy(p.question, request->question);
+    strcpy(p.model, request->model ? request->model : "");
+    p.subscribers[0] = {id, now, request->onDone, request->ctx};
+    p.subscriberCount = 1;
+    // 持锁通知，任务不会在此期间退出
+    xTaskNotifyGive(requestTask);
+    if (request->timeoutMs && expiryTask) xTaskNotifyGive(expiryTask);
+  }
+  xSemaphoreGive(requestLock);
+
+  if (slot < 0) {
+    Serial.println("Vision request queue full");
+    return 0;
+  }
+  return id;
+}
+
+bool cancelVisionRequest(uint32_t id) {
+  if (!requestLock || id == 0) return false;
+  xSemaphoreTake(requestLock, portMAX_DELAY);
+  uint8_t index = 0;
+  int slot = findSubscriber(id, &index);
+  if (slot < 0) {
+    xSemaphoreGive(requestLock);
+    return false;
+  }
+  RequestPayload& p = payloads[slot];
+  RequestSubscriber subscriber = p.subscribers[index];
+  bool queued = requestQueue.slots[slot].state == REQUEST_SLOT_QUEUED;
+
+  if (p.subscriberCount > 1) {
+    // 还有其他调用者在等待，请求照常进行，只通知被取消的这一个
+    memmove(&p.subscribers[index], &p.subscribers[index + 1],
+            sizeof(RequestSubscriber) * (p.subscriberCount - index - 1));
+    p.subscriberCount--;
+    requestQueue.stats.cancelled++;
+  } else if (queued) {
+    requestQueueCancel(&requestQueue, requestQueue.slots[slot].id);
+    p.subscriberCount = 0;
+  } else {
+    // 正在发送的请求无法中断，结束后丢弃结果
+    p.cancelRequested = true;
+    xSemaphoreGive(requestLock);
+    return true;
+  }
+  uint32_t now = millis();
+  xSemaphoreGive(requestLock);
+  deliverAll(&subscriber, 1, VISION_REQUEST_CANCELLED, "", 0, now);
+  return true;
+}
+
+void getVisionRequestStats(RequestQueueStats* stats) {
+  if (!requestLock) {
+    memset(stats, 0, sizeof(*stats));
+    return;
+  }
+  xSemaphoreTake(requestLock, portMAX_DELAY);
+  *stats = requestQueue.stats;
+  xSemaphoreGive(requestLock);
+}
+
+void printVisionRequestStats() {
+  RequestQueueStats stats;
+  getVisionRequestStats(&stats);
+  uint32_t started = stats.served + stats.expired;
+  Serial.printf("Vision requests: %lu submitted (%lu coalesced), %lu served, %lu cancelled, %lu expired, %lu rejected\n",
+                (unsigned long)stats.submitted, (unsigned long)stats.coalesced, (unsigned long)stats.served,
+                (unsigned long)stats.cancelled, (unsigned long)stats.expired, (unsigned long)stats.rejected);
+  Serial.printf("  queue depth %d (peak %d), wait avg %lu ms max %lu ms, service avg %lu ms max %lu ms\n",
+                stats.depth, stats.peakDepth,
+                (unsigned long)(started ? stats.totalWaitMs / started : 0), (unsigned long)stats.maxWaitMs,
+                (unsigned long)(stats.served ? stats.totalServiceMs / stats.served : 0),
+                (unsigned long)stats.maxServiceMs);
+}
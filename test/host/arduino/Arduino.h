@@ -0,0 +1,143 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+// ===================
+// 主机上的Arduino核心（只含客户端路径用到的部分）
+// ===================
+// 与ESP32 Arduino核心的接口和行为一致：String、Print/Stream（含超时读取）、Serial（输出到stdout）、
+// millis/delay和ESP对象。只用于test/host中把ai_vision、api_connection等联网模块编译到Linux，
+// 对着mock_dashscope.py运行；不是完整实现，固件仍使用真正的核心。
+// 主机上没有堆统计，ESP.getFreeHeap()等返回0；psramFound()返回false。
+
+using std::max;
+using std::min;
+
+class String {
+public:
+  String() {}
+  String(const char* s) : _s(s ? s : "") {}
+  String(const std::string& s) : _s(s) {}
+  explicit String(char c) : _s(1, c) {}
+  String(int v) : _s(std::to_string(v)) {}
+  String(unsigned int v) : _s(std::to_string(v)) {}
+  String(long v) : _s(std::to_string(v)) {}
+  String(unsigned long v) : _s(std::to_string(v)) {}
+  String(double v, unsigned int decimals = 2);
+
+  const char* c_str() const { return _s.c_str(); }
+  unsigned int length() const { return (unsigned int)_s.size(); }
+  bool isEmpty() const { return _s.empty(); }
+  bool reserve(unsigned int size) { _s.reserve(size); return true; }
+  char operator[](unsigned int i) const { return i < _s.size() ? _s[i] : '\0'; }
+  char charAt(unsigned int i) const { return (*this)[i]; }
+
+  String substring(unsigned int from) const;
+  String substring(unsigned int from, unsigned int to) const;
+  int indexOf(char c, unsigned int from = 0) const;
+  int indexOf(const String& s, unsigned int from = 0) const;
+  bool startsWith(const String& prefix) const;
+  bool endsWith(const String& suffix) const;
+  bool equals(const String& s) const { return _s == s._s; }
+  bool equalsIgnoreCase(const String& s) const;
+  long toInt() const { return atol(_s.c_str()); }
+  void trim();
+  void toLowerCase();
+
+  bool concat(const char* s, unsigned int length) { _s.append(s, length); return true; }
+  String& operator+=(const String& s) { _s += s._s; return *this; }
+  String& operator+=(const char* s) { _s += s ? s : ""; return *this; }
+  String& operator+=(char c) { _s += c; return *this; }
+
+  bool operator==(const String& s) const { return _s == s._s; }
+  bool operator==(const char* s) const { return _s == (s ? s : ""); }
+  bool operator!=(const String& s) const { return _s != s._s; }
+  bool operator!=(const char* s) const { return !(*this == s); }
+
+  friend String operator+(const String& a, const String& b) { return String(a._s + b._s); }
+  friend String operator+(const String& a, const char* b) { return String(a._s + (b ? b : "")); }
+  friend String operator+(const char* a, const String& b) { return String((a ? a : "") + b._s); }
+  friend String operator+(const String& a, char b) { return String(a._s + b); }
+
+private:
+  std::string _s;
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+
+  size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+  size_t print(const char* s) { return write(s); }
+  size_t print(int v) { return print(String(v)); }
+  size_t println() { return write("\n"); }
+  size_t println(const String& s) { return print(s) + println(); }
+  size_t println(const char* s) { return print(s) + println(); }
+  size_t println(int v) { return print(v) + println(); }
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+// 读取带超时（默认1000毫秒），与Arduino的Stream相同
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual size_t readBytes(char* buffer, size_t length);
+  size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+  String readStringUntil(char terminator);
+  void setTimeout(unsigned long ms) { _timeout = ms; }
+  unsigned long getTimeout() const { return _timeout; }
+
+protected:
+  int timedRead();
+  unsigned long _timeout = 1000;
+};
+
+// 写到stdout；hostSerialMute(true)后丢弃输出（负载测试时不打印每个请求的日志）
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud) {}
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+void hostSerialMute(bool mute);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+class EspClass {
+public:
+  uint32_t getFreeHeap() { return 0; }
+  uint32_t getMinFreeHeap() { return 0; }
+  uint32_t getFreePsram() { return 0; }
+};
+
+extern EspClass ESP;
+
+bool psramFound();
+void* ps_malloc(size_t size);
+void* ps_calloc(size_t n, size_t size);
+uint32_t esp_random();
+
+#endif // ARDUINO_H
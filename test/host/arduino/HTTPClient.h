@@ -0,0 +1,86 @@
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+// ===================
+// 主机上的HTTPClient
+// ===================
+// 按ESP32 Arduino核心的HTTPClient实现客户端路径用到的接口，行为保持一致：
+// begin(client, url)绑定调用者的连接；sendRequest()在连接已建立时直接复用，否则自己连接，
+// 发请求头（setReuse(true)时带Connection: keep-alive）和Stream请求体（每次最多1460字节），
+// 按_tcpTimeout（5000毫秒）等待响应头；collectHeaders()登记的响应头可用header()读取；
+// getString()按Content-Length或分块传输读完响应体；end()在服务器允许时保持连接。
+// 响应为HTTP/1.0或带Connection: close时不复用。错误码与核心相同。
+
+#define HTTPC_ERROR_CONNECTION_REFUSED  (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED  (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED       (-4)
+#define HTTPC_ERROR_CONNECTION_LOST     (-5)
+#define HTTPC_ERROR_NO_STREAM           (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER      (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM        (-8)
+#define HTTPC_ERROR_ENCODING            (-9)
+#define HTTPC_ERROR_STREAM_WRITE        (-10)
+#define HTTPC_ERROR_READ_TIMEOUT        (-11)
+
+#define HTTP_TCP_BUFFER_SIZE 1460
+#define HTTPCLIENT_DEFAULT_TCP_TIMEOUT 5000
+
+class HTTPClient {
+public:
+  HTTPClient();
+  ~HTTPClient();
+
+  bool begin(WiFiClient& client, const String& url);
+  void end();
+  bool connected();
+
+  void setReuse(bool reuse) { _reuse = reuse; }
+  void setTimeout(uint16_t ms) { _tcpTimeout = ms; }
+  void addHeader(const String& name, const String& value);
+  void collectHeaders(const char* headerKeys[], size_t count);
+  String header(const char* name);
+
+  int sendRequest(const char* type, Stream* stream, size_t size);
+
+  int getSize() { return _size; }
+  WiFiClient* getStreamPtr() { return connected() ? _client : NULL; }
+  String getString();
+
+  static String errorToString(int error);
+
+private:
+  struct CollectedHeader {
+    String key;
+    String value;
+  };
+
+  bool connect();
+  bool sendHeader(const char* type);
+  int handleHeaderResponse();
+  int readBody(std::string* out);
+  bool readLine(std::string* line);
+  int returnError(int error);
+  void disconnect();
+  void clear();
+
+  WiFiClient* _client = NULL;
+  String _host;
+  uint16_t _port = 0;
+  String _uri;
+  String _headers;
+  String _userAgent = "ESP32HTTPClient";
+  bool _reuse = true;
+  bool _canReuse = false;
+  uint16_t _tcpTimeout = HTTPCLIENT_DEFAULT_TCP_TIMEOUT;
+  int _returnCode = 0;
+  int _size = -1;
+  bool _chunked = false;
+  CollectedHeader* _currentHeaders = NULL;
+  size_t _headerKeysCount = 0;
+};
+
+#endif // HTTP_CLIENT_H
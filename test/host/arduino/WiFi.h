@@ -0,0 +1,72 @@
+#ifndef WIFI_H
+#define WIFI_H
+
+#include <Arduino.h>
+
+// ===================
+// 主机上的WiFi和WiFiClient
+// ===================
+// WiFi.status()总是WL_CONNECTED，hostByName用getaddrinfo（IPv4）。
+// WiFiClient是阻塞连接、非阻塞读取的TCP套接字，行为与ESP32核心一致：read()没有数据时返回-1，
+// 对方关闭且数据读完后connected()返回false；写入用MSG_NOSIGNAL，对方已关闭时返回0而不是SIGPIPE。
+
+enum wl_status_t {
+  WL_IDLE_STATUS = 0,
+  WL_CONNECTED = 3,
+  WL_DISCONNECTED = 6
+};
+
+class IPAddress {
+public:
+  IPAddress() : _address(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+    : _address((uint32_t)a | (uint32_t)b << 8 | (uint32_t)c << 16 | (uint32_t)d << 24) {}
+  operator uint32_t() const { return _address; }      // 网络字节序
+  uint8_t operator[](int i) const { return (uint8_t)(_address >> (8 * i)); }
+  String toString() const;
+
+private:
+  uint32_t _address;
+};
+
+class WiFiClient : public Stream {
+public:
+  WiFiClient() {}
+  virtual ~WiFiClient();
+  WiFiClient(const WiFiClient&) = delete;
+  WiFiClient& operator=(const WiFiClient&) = delete;
+
+  virtual int connect(IPAddress ip, uint16_t port);
+  virtual int connect(const char* host, uint16_t port);
+  virtual uint8_t connected();
+  virtual void stop();
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buffer, size_t size) override;
+  int available() override;
+  int read() override;
+  int peek() override;
+  virtual int read(uint8_t* buffer, size_t size);
+  using Print::write;
+
+  int fd() const { return _fd; }
+
+private:
+  bool fillBuffer();
+
+  int _fd = -1;
+  bool _peerClosed = false;
+  uint8_t _rx[1460];             // 单字节读取（响应头）时的接收缓冲
+  size_t _rxLength = 0;
+  size_t _rxPosition = 0;
+};
+
+class WiFiClass {
+public:
+  wl_status_t status() { return WL_CONNECTED; }
+  int hostByName(const char* host, IPAddress& result);
+};
+
+extern WiFiClass WiFi;
+
+#endif // WIFI_H
@@ -0,0 +1,49 @@
+#ifndef WIFI_CLIENT_SECURE_H
+#define WIFI_CLIENT_SECURE_H
+
+#include <WiFi.h>
+
+// ===================
+// 主机上的WiFiClientSecure（OpenSSL）
+// ===================
+// 在WiFiClient的TCP连接上做TLS握手（按主机名连接时带SNI），握手完成后套接字改为非阻塞，
+// 读取行为与WiFiClient一致：没有解密后的数据时read()返回-1，对方关闭后connected()返回false。
+// 与固件中setInsecure()后的行为一样不校验证书，可以直接连接mock_dashscope.py --tls的自签名证书。
+// 不做会话恢复：每次connect()都是完整握手，与ESP32核心的WiFiClientSecure一致（stop()时释放
+// mbedTLS上下文，不保存会话）。
+
+struct ssl_ctx_st;
+struct ssl_st;
+
+class WiFiClientSecure : public WiFiClient {
+public:
+  WiFiClientSecure() {}
+  ~WiFiClientSecure() override;
+
+  void setInsecure() {}
+  int connect(IPAddress ip, uint16_t port) override;
+  int connect(const char* host, uint16_t port) override;
+  uint8_t connected() override;
+  void stop() override;
+
+  size_t write(const uint8_t* buffer, size_t size) override;
+  int available() override;
+  int read() override;
+  int peek() override;
+  int read(uint8_t* buffer, size_t size) override;
+  using WiFiClient::write;
+
+private:
+  bool handshake(const char* host);
+  bool fillBuffer();
+  int receive(uint8_t* buffer, size_t size);
+
+  ssl_ctx_st* _ctx = nullptr;
+  ssl_st* _ssl = nullptr;
+  bool _peerClosed = false;
+  uint8_t _rx[1460];
+  size_t _rxLength = 0;
+  size_t _rxPosition = 0;
+};
+
+#endif // WIFI_CLIENT_SECURE_H
@@ -0,0 +1,181 @@
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <ctype.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static std::atomic<bool> serialMuted(false);
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+// ---- String ----
+
+String::String(double v, unsigned int decimals) {
+  char text[64];
+  snprintf(text, sizeof(text), "%.*f", (int)decimals, v);
+  _s = text;
+}
+
+String String::substring(unsigned int from) const {
+  return from >= _s.size() ? String() : String(_s.substr(from));
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) std::swap(from, to);
+  if (from >= _s.size()) return String();
+  return String(_s.substr(from, std::min<size_t>(to, _s.size()) - from));
+}
+
+int String::indexOf(char c, unsigned int from) const {
+  size_t i = _s.find(c, from);
+  return i == std::string::npos ? -1 : (int)i;
+}
+
+int String::indexOf(const String& s, unsigned int from) const {
+  size_t i = _s.find(s._s, from);
+  return i == std::string::npos ? -1 : (int)i;
+}
+
+bool String::startsWith(const String& prefix) const {
+  return _s.compare(0, prefix._s.size(), prefix._s) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+  return _s.size() >= suffix._s.size() &&
+         _s.compare(_s.size() - suffix._s.size(), suffix._s.size(), suffix._s) == 0;
+}
+
+bool String::equalsIgnoreCase(const String& s) const {
+  if (_s.size() != s._s.size()) return false;
+  for (size_t i = 0; i < _s.size(); i++) {
+    if (tolower((unsigned char)_s[i]) != tolower((unsigned char)s._s[i])) return false;
+  }
+  return true;
+}
+
+void String::trim() {
+  size_t end = _s.size();
+  while (end > 0 && isspace((unsigned char)_s[end - 1])) end--;
+  size_t start = 0;
+  while (start < end && isspace((unsigned char)_s[start])) start++;
+  _s = _s.substr(start, end - start);
+}
+
+void String::toLowerCase() {
+  for (char& c : _s) c = (char)tolower((unsigned char)c);
+}
+
+// ---- Print / Stream ----
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (n < size && write(buffer[n])) n++;
+  return n;
+}
+
+size_t Print::printf(const char* format, ...) {
+  char small[256];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(small, sizeof(small), format, args);
+  va_end(args);
+  if (length < 0) return 0;
+  if ((size_t)length < sizeof(small)) return write((const uint8_t*)small, length);
+
+  std::string text(length + 1, '\0');
+  va_start(args, format);
+  vsnprintf(&text[0], text.size(), format, args);
+  va_end(args);
+  return write((const uint8_t*)text.data(), length);
+}
+
+int Stream::timedRead() {
+  unsigned long start = millis();
+  do {
+    int c = read();
+    if (c >= 0) return c;
+    delay(1);
+  } while (millis() - start < _timeout);
+  return -1;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+  size_t n = 0;
+  while (n < length) {
+    int c = timedRead();
+    if (c < 0) break;
+    buffer[n++] = (char)c;
+  }
+  return n;
+}
+
+String Stream::readStringUntil(char terminator) {
+  std::string text;
+  int c = timedRead();
+  while (c >= 0 && c != terminator) {
+    text += (char)c;
+    c = timedRead();
+  }
+  return String(text);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  if (serialMuted) return size;
+  return fwrite(buffer, 1, size, stdout);
+}
+
+void hostSerialMute(bool mute) {
+  fflush(stdout);
+  serialMuted = mute;
+}
+
+// ---- 时间和系统 ----
+
+int64_t esp_timer_get_time() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+unsigned long millis() {
+  return (unsigned long)(uint32_t)(esp_timer_get_time() / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)(uint32_t)esp_timer_get_time();
+}
+
+void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield() {
+  std::this_thread::yield();
+}
+
+bool psramFound() {
+  return false;
+}
+
+void* ps_malloc(size_t size) {
+  return malloc(size);
+}
+
+void* ps_calloc(size_t n, size_t size) {
+  return calloc(n, size);
+}
+
+uint32_t esp_random() {
+  static std::mutex lock;
+  static std::mt19937 generator(std::random_device{}());
+  std::lock_guard<std::mutex> guard(lock);
+  return generator();
+}
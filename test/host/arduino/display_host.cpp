@@ -0,0 +1,10 @@
+#include <Arduino.h>
+
+// 屏幕函数（固件在main.cpp中实现）：状态提示输出到Serial，流式刷新的整段文字不输出
+
+void showStaticMessage(const char* message) {
+  Serial.printf("[屏幕] %s\n", message);
+}
+
+void showStreamingText(const char* text) {
+}
@@ -0,0 +1,10 @@
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#include <stdint.h>
+
+// 主机上的esp_timer：单调时钟，从程序启动开始的微秒数
+
+int64_t esp_timer_get_time();
+
+#endif // ESP_TIMER_H
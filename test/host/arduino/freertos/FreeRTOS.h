@@ -0,0 +1,25 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdint.h>
+
+// ===================
+// 主机上的FreeRTOS（只含客户端路径用到的部分）
+// ===================
+// 任务是std::thread，一个tick为1毫秒；互斥锁是std::timed_mutex；任务通知用条件变量实现计数。
+// 核心号和优先级被忽略。vTaskDelete(NULL)只能作为任务函数的最后一条语句（与本仓库的用法一致），
+// 任务函数返回后线程结束。
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdFAIL  0
+#define pdPASS  1
+#define portMAX_DELAY 0xFFFFFFFFu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#endif // FREERTOS_H
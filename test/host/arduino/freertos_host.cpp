@@ -0,0 +1,93 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+struct HostSemaphore {
+  std::timed_mutex mutex;
+};
+
+struct HostTask {
+  std::mutex lock;
+  std::condition_variable notified;
+  uint32_t notifications = 0;
+};
+
+// 当前线程所属的任务；不是由xTaskCreate创建的线程（main）为NULL
+static thread_local HostTask* currentTask = NULL;
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return new HostSemaphore();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+  if (ticks == portMAX_DELAY) {
+    semaphore->mutex.lock();
+    return pdTRUE;
+  }
+  return semaphore->mutex.try_lock_for(std::chrono::milliseconds(ticks)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  semaphore->mutex.unlock();
+  return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+  delete semaphore;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                                   void* param, UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+  HostTask* task = new HostTask();
+  if (handle) *handle = task;
+  std::thread([task, function, param]() {
+    currentTask = task;
+    function(param);
+    // 任务函数以vTaskDelete(NULL)结束；按本仓库的约定，此前已在锁内清空了别处保存的句柄
+    delete task;
+  }).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackDepth, void* param,
+                       UBaseType_t priority, TaskHandle_t* handle) {
+  return xTaskCreatePinnedToCore(function, name, stackDepth, param, priority, handle, 0);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  // 只支持删除自己，返回后任务函数随即结束
+}
+
+void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  std::lock_guard<std::mutex> guard(task->lock);
+  task->notifications++;
+  task->notified.notify_one();
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+  HostTask* task = currentTask;
+  if (!task) {
+    // main线程没有通知值，只等待
+    if (ticks != portMAX_DELAY) vTaskDelay(ticks);
+    return 0;
+  }
+  std::unique_lock<std::mutex> guard(task->lock);
+  auto ready = [task]() { return task->notifications > 0; };
+  if (ticks == portMAX_DELAY) {
+    task->notified.wait(guard, ready);
+  } else {
+    task->notified.wait_for(guard, std::chrono::milliseconds(ticks), ready);
+  }
+  uint32_t value = task->notifications;
+  if (value) task->notifications = clearOnExit ? 0 : value - 1;
+  return value;
+}
@@ -0,0 +1,272 @@
+#include <HTTPClient.h>
+
+HTTPClient::HTTPClient() {}
+
+HTTPClient::~HTTPClient() {
+  delete[] _currentHeaders;
+}
+
+// scheme://host[:port]/path，只保存主机、端口和路径；连接由调用者提供
+bool HTTPClient::begin(WiFiClient& client, const String& url) {
+  _client = &client;
+  int schemeEnd = url.indexOf("://");
+  if (schemeEnd < 0) return false;
+  String scheme = url.substring(0, schemeEnd);
+  _port = scheme == "https" ? 443 : 80;
+  int hostStart = schemeEnd + 3;
+  int pathStart = url.indexOf('/', hostStart);
+  _host = pathStart < 0 ? url.substring(hostStart) : url.substring(hostStart, pathStart);
+  _uri = pathStart < 0 ? String("/") : url.substring(pathStart);
+  int colon = _host.indexOf(':');
+  if (colon >= 0) {
+    _port = (uint16_t)_host.substring(colon + 1).toInt();
+    _host = _host.substring(0, colon);
+  }
+  return _host.length() > 0;
+}
+
+void HTTPClient::end() {
+  disconnect();
+  clear();
+}
+
+bool HTTPClient::connected() {
+  return _client && (_client->available() > 0 || _client->connected());
+}
+
+void HTTPClient::addHeader(const String& name, const String& value) {
+  // 这两个由sendHeader()生成
+  if (name.equalsIgnoreCase("Connection") || name.equalsIgnoreCase("Host")) return;
+  if (name.equalsIgnoreCase("User-Agent")) {
+    _userAgent = value;
+    return;
+  }
+  _headers += name + ": " + value + "\r\n";
+}
+
+void HTTPClient::collectHeaders(const char* headerKeys[], size_t count) {
+  delete[] _currentHeaders;
+  _currentHeaders = new CollectedHeader[count];
+  _headerKeysCount = count;
+  for (size_t i = 0; i < count; i++) _currentHeaders[i].key = headerKeys[i];
+}
+
+String HTTPClient::header(const char* name) {
+  for (size_t i = 0; i < _headerKeysCount; i++) {
+    if (_currentHeaders[i].key.equalsIgnoreCase(name)) return _currentHeaders[i].value;
+  }
+  return String();
+}
+
+bool HTTPClient::connect() {
+  if (connected()) {
+    // 复用连接：丢弃上一个响应的残留数据
+    while (_client->available() > 0) _client->read();
+    return true;
+  }
+  if (!_client) return false;
+  return _client->connect(_host.c_str(), _port) != 0;
+}
+
+bool HTTPClient::sendHeader(const char* type) {
+  if (!connected()) return false;
+  String header = String(type) + " " + _uri + " HTTP/1.1\r\nHost: " + _host;
+  if (_port != 80 && _port != 443) header += ":" + String((int)_port);
+  header += "\r\nUser-Agent: " + _userAgent + "\r\nConnection: ";
+  header += _reuse ? "keep-alive" : "close";
+  header += "\r\nAccept-Encoding: identity;q=1,chunked;q=0.1,*;q=0\r\n";
+  header += _headers + "\r\n";
+  return _client->write((const uint8_t*)header.c_str(), header.length()) == header.length();
+}
+
+int HTTPClient::sendRequest(const char* type, Stream* stream, size_t size) {
+  if (!stream) return returnError(HTTPC_ERROR_NO_STREAM);
+  if (!connect()) return returnError(HTTPC_ERROR_CONNECTION_REFUSED);
+  if (size > 0) addHeader("Content-Length", String((unsigned long)size));
+  if (!sendHeader(type)) return returnError(HTTPC_ERROR_SEND_HEADER_FAILED);
+
+  // 请求体按TCP分段大小从stream读出后写入连接
+  uint8_t buffer[HTTP_TCP_BUFFER_SIZE];
+  size_t written = 0;
+  while (written < size && connected()) {
+    int available = stream->available();
+    if (available <= 0) break;
+    size_t want = std::min((size_t)available, std::min(size - written, sizeof(buffer)));
+    size_t n = stream->readBytes((char*)buffer, want);
+    if (n == 0) break;
+    if (_client->write(buffer, n) != n) return returnError(HTTPC_ERROR_SEND_PAYLOAD_FAILED);
+    written += n;
+  }
+  if (written != size) return returnError(HTTPC_ERROR_SEND_PAYLOAD_FAILED);
+  return returnError(handleHeaderResponse());
+}
+
+// 读一行（去掉行尾的\r\n），两次收到数据之间超过_tcpTimeout时失败
+bool HTTPClient::readLine(std::string* line) {
+  line->clear();
+  unsigned long lastData = millis();
+  while (true) {
+    int c = _client->read();
+    if (c >= 0) {
+      lastData = millis();
+      if (c == '\n') break;
+      *line += (char)c;
+      continue;
+    }
+    if (!_client->connected()) return false;
+    if (millis() - lastData > _tcpTimeout) return false;
+    delay(1);
+  }
+  if (!line->empty() && line->back() == '\r') line->pop_back();
+  return true;
+}
+
+int HTTPClient::handleHeaderResponse() {
+  if (!connected()) return HTTPC_ERROR_NOT_CONNECTED;
+  clear();
+  _canReuse = _reuse;
+  _chunked = false;
+  unsigned long lastData = millis();
+  bool firstLine = true;
+
+  while (connected()) {
+    if (_client->available() <= 0) {
+      if (millis() - lastData > _tcpTimeout) return HTTPC_ERROR_READ_TIMEOUT;
+      delay(1);
+      continue;
+    }
+    std::string raw;
+    if (!readLine(&raw)) break;
+    lastData = millis();
+    String line(raw);
+    if (firstLine) {
+      firstLine = false;
+      if (_canReuse && line.startsWith("HTTP/1.")) _canReuse = line[7] != '0';
+      int codeStart = line.indexOf(' ') + 1;
+      _returnCode = (int)line.substring(codeStart, line.indexOf(' ', codeStart)).toInt();
+      continue;
+    }
+    if (line.length() == 0) {
+      return _returnCode ? _returnCode : HTTPC_ERROR_NO_HTTP_SERVER;
+    }
+    int colon = line.indexOf(':');
+    if (colon <= 0) continue;
+    String name = line.substring(0, colon);
+    String value = line.substring(colon + 1);
+    value.trim();
+    if (name.equalsIgnoreCase("Content-Length")) _size = (int)value.toInt();
+    if (_canReuse && name.equalsIgnoreCase("Connection") &&
+        value.indexOf("close") >= 0 && value.indexOf("keep-alive") < 0) {
+      _canReuse = false;
+    }
+    if (name.equalsIgnoreCase("Transfer-Encoding")) _chunked = value.equalsIgnoreCase("chunked");
+    for (size_t i = 0; i < _headerKeysCount; i++) {
+      if (_currentHeaders[i].key.equalsIgnoreCase(name)) {
+        _currentHeaders[i].value = value;
+        break;
+      }
+    }
+  }
+  return HTTPC_ERROR_CONNECTION_LOST;
+}
+
+// 按Content-Length、分块传输或连接关闭读完响应体，返回读到的字节数或错误码
+int HTTPClient::readBody(std::string* out) {
+  uint8_t buffer[HTTP_TCP_BUFFER_SIZE];
+  if (!_chunked) {
+    unsigned long lastData = millis();
+    while (_size < 0 || (int)out->size() < _size) {
+      size_t want = sizeof(buffer);
+      if (_size >= 0) want = std::min(want, (size_t)_size - out->size());
+      int n = _client->read(buffer, want);
+      if (n > 0) {
+        out->append((const char*)buffer, n);
+        lastData = millis();
+        continue;
+      }
+      if (!_client->connected()) {
+        // 没有Content-Length时读到连接关闭为止
+        return _size < 0 ? (int)out->size() : HTTPC_ERROR_CONNECTION_LOST;
+      }
+      if (millis() - lastData > _tcpTimeout) return HTTPC_ERROR_READ_TIMEOUT;
+      delay(1);
+    }
+    return (int)out->size();
+  }
+
+  while (true) {
+    std::string line;
+    if (!readLine(&line)) return HTTPC_ERROR_CONNECTION_LOST;
+    char* end = NULL;
+    long length = strtol(line.c_str(), &end, 16);
+    if (end == line.c_str() || length < 0) return HTTPC_ERROR_ENCODING;
+    if (length == 0) {
+      // 结束分块之后的trailer，以空行结束
+      while (readLine(&line) && !line.empty()) {}
+      return (int)out->size();
+    }
+    size_t remaining = (size_t)length;
+    unsigned long lastData = millis();
+    while (remaining > 0) {
+      int n = _client->read(buffer, std::min(remaining, sizeof(buffer)));
+      if (n > 0) {
+        out->append((const char*)buffer, n);
+        remaining -= n;
+        lastData = millis();
+        continue;
+      }
+      if (!_client->connected()) return HTTPC_ERROR_CONNECTION_LOST;
+      if (millis() - lastData > _tcpTimeout) return HTTPC_ERROR_READ_TIMEOUT;
+      delay(1);
+    }
+    if (!readLine(&line) || !line.empty()) return HTTPC_ERROR_ENCODING;
+  }
+}
+
+String HTTPClient::getString() {
+  std::string body;
+  if ((_size > 0 || _size == -1) && connected()) {
+    int result = readBody(&body);
+    if (result < 0) {
+      Serial.printf("HTTPClient: reading body failed: %s\n", errorToString(result).c_str());
+      returnError(result);
+    }
+  }
+  end();
+  return String(body);
+}
+
+// 出错时断开连接，连接上可能还有未读的响应
+int HTTPClient::returnError(int error) {
+  if (error < 0 && _client && _client->connected()) _client->stop();
+  return error;
+}
+
+void HTTPClient::disconnect() {
+  if (!connected()) return;
+  while (_client->available() > 0) _client->read();
+  if (!(_reuse && _canReuse)) _client->stop();
+}
+
+void HTTPClient::clear() {
+  _returnCode = 0;
+  _size = -1;
+  _headers = "";
+}
+
+String HTTPClient::errorToString(int error) {
+  switch (error) {
+    case HTTPC_ERROR_CONNECTION_REFUSED: return "connection refused";
+    case HTTPC_ERROR_SEND_HEADER_FAILED: return "send header failed";
+    case HTTPC_ERROR_SEND_PAYLOAD_FAILED: return "send payload failed";
+    case HTTPC_ERROR_NOT_CONNECTED: return "not connected";
+    case HTTPC_ERROR_CONNECTION_LOST: return "connection lost";
+    case HTTPC_ERROR_NO_STREAM: return "no stream";
+    case HTTPC_ERROR_NO_HTTP_SERVER: return "no HTTP server";
+    case HTTPC_ERROR_TOO_LESS_RAM: return "too less ram";
+    case HTTPC_ERROR_ENCODING: return "Transfer-Encoding not supported";
+    case HTTPC_ERROR_STREAM_WRITE: return "Stream write error";
+    case HTTPC_ERROR_READ_TIMEOUT: return "read Timeout";
+    default: return String();
+  }
+}
@@ -0,0 +1,137 @@
+#include <WiFi.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+WiFiClass WiFi;
+
+String IPAddress::toString() const {
+  char text[16];
+  snprintf(text, sizeof(text), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+  return String(text);
+}
+
+int WiFiClass::hostByName(const char* host, IPAddress& result) {
+  addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* list = NULL;
+  if (getaddrinfo(host, NULL, &hints, &list) != 0 || !list) return 0;
+  uint32_t address = ((sockaddr_in*)list->ai_addr)->sin_addr.s_addr;
+  freeaddrinfo(list);
+  result = IPAddress(address & 0xFF, address >> 8 & 0xFF, address >> 16 & 0xFF, address >> 24);
+  return 1;
+}
+
+// ---- WiFiClient ----
+
+WiFiClient::~WiFiClient() {
+  stop();
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+  stop();
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return 0;
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = (uint32_t)ip;
+  if (::connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+    close(fd);
+    return 0;
+  }
+  // 关闭Nagle：请求头和请求体分开写，否则后一次写要等对方的延迟确认（Linux上约40毫秒），
+  // 会算进上传和首字节时间
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  _fd = fd;
+  _peerClosed = false;
+  _rxLength = _rxPosition = 0;
+  return 1;
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+  IPAddress ip;
+  if (!WiFi.hostByName(host, ip)) return 0;
+  return connect(ip, port);
+}
+
+uint8_t WiFiClient::connected() {
+  if (_fd < 0) return 0;
+  if (_rxPosition < _rxLength) return 1;
+  if (_peerClosed) return 0;
+  uint8_t c;
+  ssize_t n = recv(_fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (n > 0) return 1;
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 1;
+  _peerClosed = true;
+  return 0;
+}
+
+void WiFiClient::stop() {
+  if (_fd >= 0) close(_fd);
+  _fd = -1;
+  _peerClosed = false;
+  _rxLength = _rxPosition = 0;
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+  if (_fd < 0) return 0;
+  size_t sent = 0;
+  while (sent < size) {
+    ssize_t n = send(_fd, buffer + sent, size - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    sent += n;
+  }
+  return sent;
+}
+
+int WiFiClient::available() {
+  if (_fd < 0) return 0;
+  int pending = 0;
+  if (ioctl(_fd, FIONREAD, &pending) != 0) pending = 0;
+  return (int)(_rxLength - _rxPosition) + pending;
+}
+
+bool WiFiClient::fillBuffer() {
+  if (_rxPosition < _rxLength) return true;
+  if (_fd < 0 || _peerClosed) return false;
+  ssize_t n = recv(_fd, _rx, sizeof(_rx), MSG_DONTWAIT);
+  if (n == 0) _peerClosed = true;
+  if (n <= 0) return false;
+  _rxLength = n;
+  _rxPosition = 0;
+  return true;
+}
+
+int WiFiClient::read() {
+  return fillBuffer() ? _rx[_rxPosition++] : -1;
+}
+
+int WiFiClient::peek() {
+  return fillBuffer() ? _rx[_rxPosition] : -1;
+}
+
+// 先交出缓冲中的数据，再直接从套接字读取；没有数据时返回-1
+int WiFiClient::read(uint8_t* buffer, size_t size) {
+  if (_fd < 0 || size == 0) return -1;
+  size_t n = 0;
+  if (_rxPosition < _rxLength) {
+    n = std::min(size, _rxLength - _rxPosition);
+    memcpy(buffer, _rx + _rxPosition, n);
+    _rxPosition += n;
+  }
+  if (n < size && !_peerClosed) {
+    ssize_t k = recv(_fd, buffer + n, size - n, MSG_DONTWAIT);
+    if (k == 0) _peerClosed = true;
+    if (k > 0) n += k;
+  }
+  return n > 0 ? (int)n : -1;
+}
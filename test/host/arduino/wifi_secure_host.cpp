@@ -0,0 +1,143 @@
+#include <WiFiClientSecure.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+WiFiClientSecure::~WiFiClientSecure() {
+  stop();
+  if (_ctx) SSL_CTX_free(_ctx);
+}
+
+int WiFiClientSecure::connect(IPAddress ip, uint16_t port) {
+  stop();
+  if (!WiFiClient::connect(ip, port)) return 0;
+  return handshake(NULL) ? 1 : 0;
+}
+
+// WiFiClient::connect(host, port)会转到虚函数connect(ip, port)，这里自己解析后直接建TCP连接
+int WiFiClientSecure::connect(const char* host, uint16_t port) {
+  stop();
+  IPAddress ip;
+  if (!WiFi.hostByName(host, ip) || !WiFiClient::connect(ip, port)) return 0;
+  return handshake(host) ? 1 : 0;
+}
+
+// 阻塞套接字上完成握手，之后改为非阻塞
+bool WiFiClientSecure::handshake(const char* host) {
+  if (!_ctx) {
+    _ctx = SSL_CTX_new(TLS_client_method());
+    if (!_ctx) {
+      WiFiClient::stop();
+      return false;
+    }
+    SSL_CTX_set_verify(_ctx, SSL_VERIFY_NONE, NULL);
+    // OpenSSL用write()发送，对方已关闭时会收到SIGPIPE（明文连接用MSG_NOSIGNAL避免）
+    signal(SIGPIPE, SIG_IGN);
+  }
+  _ssl = SSL_new(_ctx);
+  bool ok = _ssl && SSL_set_fd(_ssl, fd()) == 1;
+  if (ok && host) SSL_set_tlsext_host_name(_ssl, host);
+  ok = ok && SSL_connect(_ssl) == 1;
+  if (!ok) {
+    unsigned long error = ERR_get_error();
+    Serial.printf("WiFiClientSecure: TLS handshake failed (%s)\n",
+                  error ? ERR_reason_error_string(error) : "connection closed");
+    ERR_clear_error();
+    stop();
+    return false;
+  }
+  fcntl(fd(), F_SETFL, fcntl(fd(), F_GETFL) | O_NONBLOCK);
+  return true;
+}
+
+void WiFiClientSecure::stop() {
+  if (_ssl) {
+    if (!_peerClosed) SSL_shutdown(_ssl);
+    SSL_free(_ssl);
+    _ssl = NULL;
+  }
+  WiFiClient::stop();
+  _peerClosed = false;
+  _rxLength = _rxPosition = 0;
+}
+
+// 非阻塞读取解密后的数据：返回字节数，暂时没有数据返回0，对方关闭或出错返回-1
+int WiFiClientSecure::receive(uint8_t* buffer, size_t size) {
+  if (!_ssl || _peerClosed) return -1;
+  int n = SSL_read(_ssl, buffer, (int)size);
+  if (n > 0) return n;
+  int error = SSL_get_error(_ssl, n);
+  if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) return 0;
+  // close_notify、没有close_notify的TCP关闭和其他错误都按对方关闭处理
+  ERR_clear_error();
+  _peerClosed = true;
+  return -1;
+}
+
+bool WiFiClientSecure::fillBuffer() {
+  if (_rxPosition < _rxLength) return true;
+  int n = receive(_rx, sizeof(_rx));
+  if (n <= 0) return false;
+  _rxLength = n;
+  _rxPosition = 0;
+  return true;
+}
+
+uint8_t WiFiClientSecure::connected() {
+  if (!_ssl) return 0;
+  if (fillBuffer()) return 1;
+  return _peerClosed ? 0 : 1;
+}
+
+// 只统计已解密的数据；套接字上未凑成完整记录的字节（或会话票据）不算
+int WiFiClientSecure::available() {
+  if (!_ssl) return 0;
+  fillBuffer();
+  return (int)(_rxLength - _rxPosition) + SSL_pending(_ssl);
+}
+
+int WiFiClientSecure::read() {
+  return fillBuffer() ? _rx[_rxPosition++] : -1;
+}
+
+int WiFiClientSecure::peek() {
+  return fillBuffer() ? _rx[_rxPosition] : -1;
+}
+
+int WiFiClientSecure::read(uint8_t* buffer, size_t size) {
+  if (!_ssl || size == 0) return -1;
+  size_t n = 0;
+  if (_rxPosition < _rxLength) {
+    n = std::min(size, _rxLength - _rxPosition);
+    memcpy(buffer, _rx + _rxPosition, n);
+    _rxPosition += n;
+  }
+  if (n < size) {
+    int k = receive(buffer + n, size - n);
+    if (k > 0) n += k;
+  }
+  return n > 0 ? (int)n : -1;
+}
+
+// 发送缓冲满时等待套接字可写后重试（参数不变，OpenSSL要求重试时传入同一缓冲区）
+size_t WiFiClientSecure::write(const uint8_t* buffer, size_t size) {
+  if (!_ssl || _peerClosed) return 0;
+  size_t sent = 0;
+  while (sent < size) {
+    int n = SSL_write(_ssl, buffer + sent, (int)(size - sent));
+    if (n > 0) {
+      sent += n;
+      continue;
+    }
+    int error = SSL_get_error(_ssl, n);
+    if (error != SSL_ERROR_WANT_WRITE && error != SSL_ERROR_WANT_READ) {
+      ERR_clear_error();
+      break;
+    }
+    pollfd p = {fd(), (short)(error == SSL_ERROR_WANT_WRITE ? POLLOUT : POLLIN), 0};
+    if (poll(&p, 1, 5000) <= 0) break;
+  }
+  return sent;
+}
@@ -0,0 +1,207 @@
+// 图像流水线主机基准：语料帧包装成camera_fb_t，走设备上的frameToGrayscale分派，
+// 再阈值 -> 抖动 -> 打包，逐段计时；每种抖动算法的输出与golden/下的PBM逐像素比较，
+// 合成语料同时核对image_bench.cpp中的FNV校验值（设备上benchmarkImagePipeline用的是同一组）。
+// 有意改变输出时用 --update 重新生成PBM，并在提交中说明原因。
+//
+// PBM与camera.cpp中printMonoPbm的串口输出格式相同，设备上打印的图可以直接和黄金文件对比。
+
+#include "host_test.h"
+#include "image_bench.h"
+#include "frame_gray.h"
+#include "jpeg_decoder.h"
+#include "luma_stats.h"
+#include "mono_blit.h"
+#include "base64_stream.h"
+#include <ctype.h>
+
+#define DISPLAY_W IMAGE_BENCH_DISPLAY_WIDTH
+#define DISPLAY_H IMAGE_BENCH_DISPLAY_HEIGHT
+
+struct CorpusFrame {
+  std::string name;
+  camera_fb_t fb;
+  std::vector<uint8_t> data;
+  uint16_t dstWidth;
+  uint16_t dstHeight;
+  const ImageBenchCase* benchCase;  // 合成语料对应的用例，JPEG为NULL
+};
+
+static bool updateGoldens = false;
+static int iterations = 20;
+
+static std::string slug(const std::string& name) {
+  std::string s;
+  for (char c : name) s += c == ' ' ? '_' : (char)tolower((unsigned char)c);
+  return s;
+}
+
+// 与printMonoPbm相同：P1文本，XBM中1为点亮、PBM中1为黑
+static std::string monoToPbm(const uint8_t* xbm, uint16_t width, uint16_t height) {
+  std::string out = "P1\n" + std::to_string(width) + " " + std::to_string(height) + "\n";
+  uint16_t rowBytes = (width + 7) / 8;
+  for (uint16_t y = 0; y < height; y++) {
+    for (uint16_t x = 0; x < width; x++) {
+      out += (xbm[y * rowBytes + x / 8] >> (x & 7)) & 1 ? "0 " : "1 ";
+    }
+    out += "\n";
+  }
+  return out;
+}
+
+static void checkGolden(const std::string& file, const std::string& pbm) {
+  std::string path = hostPath(("golden/" + file).c_str());
+  if (updateGoldens) {
+    CHECK(hostWriteFile(path, pbm.data(), pbm.size()));
+    return;
+  }
+  std::vector<uint8_t> golden;
+  if (!hostReadFile(path, &golden)) {
+    fprintf(stderr, "missing golden %s (run with --update)\n", path.c_str());
+    hostFailures++;
+    return;
+  }
+  if (golden.size() != pbm.size() || memcmp(golden.data(), pbm.data(), pbm.size()) != 0) {
+    std::string actual = path + ".actual";
+    hostWriteFile(actual, pbm.data(), pbm.size());
+    fprintf(stderr, "%s differs from golden, output written to %s\n", file.c_str(), actual.c_str());
+    hostFailures++;
+  }
+}
+
+static CorpusFrame syntheticFrame(const ImageBenchCase* c) {
+  CorpusFrame f;
+  f.name = c->name;
+  f.data.resize(imageBenchFrameSize(c));
+  imageBenchFill(c, f.data.data());
+  f.dstWidth = c->dstWidth;
+  f.dstHeight = c->dstHeight;
+  f.benchCase = c;
+  f.fb = camera_fb_t();
+  f.fb.format = c->pixelStep == 2 ? PIXFORMAT_YUV422 : PIXFORMAT_GRAYSCALE;
+  f.fb.width = c->width;
+  f.fb.height = c->height;
+  return f;
+}
+
+static bool jpegFrame(const char* file, CorpusFrame* f) {
+  if (!hostReadFile(hostPath(file), &f->data)) {
+    fprintf(stderr, "missing corpus frame %s\n", file);
+    return false;
+  }
+  f->name = file;
+  f->name = f->name.substr(f->name.find('/') + 1);
+  f->name = f->name.substr(0, f->name.rfind('.'));
+  f->benchCase = NULL;
+  f->fb = camera_fb_t();
+  f->fb.format = PIXFORMAT_JPEG;
+  return true;
+}
+
+// JPEG帧的预览尺寸按屏幕保持宽高比（与camera.cpp的computePreviewLayout相同）
+static void setPreviewSize(CorpusFrame* f, uint16_t srcWidth, uint16_t srcHeight) {
+  float aspect = (float)srcWidth / (float)srcHeight;
+  if (aspect > (float)DISPLAY_W / DISPLAY_H) {
+    f->dstWidth = DISPLAY_W;
+    f->dstHeight = (uint16_t)(DISPLAY_W / aspect);
+  } else {
+    f->dstWidth = (uint16_t)(DISPLAY_H * aspect);
+    f->dstHeight = DISPLAY_H;
+  }
+}
+
+static void runFrame(CorpusFrame* f) {
+  f->fb.buf = f->data.data();
+  f->fb.len = f->data.size();
+  static ImageBenchBuffers b;
+  uint16_t offsetX = (DISPLAY_W - f->dstWidth) / 2;
+  uint16_t offsetY = (DISPLAY_H - f->dstHeight) / 2;
+  uint8_t* region = b.gray + offsetY * DISPLAY_W + offsetX;
+
+  uint64_t start = hostMicros();
+  for (int k = 0; k < iterations; k++) {
+    memset(b.gray, 0, sizeof(b.gray));
+    CHECK(frameToGrayscale(&f->fb, region, f->dstWidth, f->dstHeight, DISPLAY_W));
+  }
+  uint64_t scaleUs = (hostMicros() - start) / iterations;
+
+  // 设备路径和image_bench的缩放阶段必须逐字节一致，否则FNV黄金值不代表设备行为
+  if (f->benchCase) {
+    static ImageBenchBuffers reference;
+    CHECK(imageBenchScale(f->benchCase, f->fb.buf, &reference));
+    CHECK(memcmp(reference.gray, b.gray, sizeof(b.gray)) == 0);
+  }
+  uint8_t scaled[sizeof(b.gray)];
+  memcpy(scaled, b.gray, sizeof(scaled));
+
+  printf("%-22s %4zux%-4zu -> %3ux%-3u scale %6llu us\n", f->name.c_str(), f->fb.width, f->fb.height,
+         (unsigned)f->dstWidth, (unsigned)f->dstHeight, (unsigned long long)scaleUs);
+
+  for (int mode = 0; mode < DITHER_MODE_COUNT; mode++) {
+    static LumaStats stats;
+    uint8_t threshold = 0;
+    uint64_t thresholdUs = 0, ditherUs = 0, packUs = 0;
+    for (int k = 0; k < iterations; k++) {
+      memcpy(b.gray, scaled, sizeof(scaled));
+      uint64_t t0 = hostMicros();
+      lumaStatsCompute(&stats, region, f->dstWidth, f->dstHeight, DISPLAY_W, 1);
+      threshold = mode == DITHER_THRESHOLD ? lumaOtsuThreshold(&stats) : lumaDitherThreshold(&stats);
+      uint64_t t1 = hostMicros();
+      CHECK(ditherImage((DitherMode)mode, b.gray, b.mono, DISPLAY_W, DISPLAY_H, threshold));
+      uint64_t t2 = hostMicros();
+      monoBlitToPages(b.mono, DISPLAY_W, DISPLAY_H, b.pages, DISPLAY_W, DISPLAY_H / 8);
+      uint64_t t3 = hostMicros();
+      thresholdUs += t1 - t0;
+      ditherUs += t2 - t1;
+      packUs += t3 - t2;
+    }
+    printf("  %-16s threshold %3d  %5llu us, dither %5llu us, pack %5llu us\n",
+           ditherModeName((DitherMode)mode), threshold, (unsigned long long)(thresholdUs / iterations),
+           (unsigned long long)(ditherUs / iterations), (unsigned long long)(packUs / iterations));
+
+    if (f->benchCase) {
+      CHECK_EQ(imageBenchChecksum(b.pages, sizeof(b.pages)), f->benchCase->pagesChecksum[mode]);
+    }
+    checkGolden(slug(f->name) + "_" + ditherModeName((DitherMode)mode) + ".pbm",
+                monoToPbm(b.mono, DISPLAY_W, DISPLAY_H));
+  }
+
+  if (f->benchCase) {
+    std::vector<char> encoded(base64EncodedLength(f->data.size()));
+    uint64_t t0 = hostMicros();
+    size_t length = base64EncodeTo(f->data.data(), f->data.size(), encoded.data());
+    printf("  base64 %zu bytes: %llu us\n", f->data.size(), (unsigned long long)(hostMicros() - t0));
+    CHECK_EQ(imageBenchChecksum((const uint8_t*)encoded.data(), length), f->benchCase->base64Checksum);
+  }
+}
+
+int main(int argc, char** argv) {
+  updateGoldens = hostHasFlag(argc, argv, "--update");
+
+  std::vector<CorpusFrame> corpus;
+  for (int i = 0; i < imageBenchCaseCount; i++) {
+    corpus.push_back(syntheticFrame(&imageBenchCases[i]));
+  }
+  const char* jpegFiles[] = {"data/img_160x120_420.jpg", "data/img_640x480_420.jpg"};
+  for (const char* file : jpegFiles) {
+    CorpusFrame f;
+    if (!jpegFrame(file, &f)) {
+      hostFailures++;
+      continue;
+    }
+    JpegInfo info;
+    if (!jpegGetInfo(f.data.data(), f.data.size(), &info)) {
+      fprintf(stderr, "%s: JPEG header parse failed\n", file);
+      hostFailures++;
+      continue;
+    }
+    f.fb.width = info.width;
+    f.fb.height = info.height;
+    setPreviewSize(&f, info.width, info.height);
+    corpus.push_back(f);
+  }
+
+  for (CorpusFrame& f : corpus) {
+    runFrame(&f);
+  }
+  return hostTestResult(updateGoldens ? "bench_image_pipeline (goldens updated)" : "bench_image_pipeline");
+}
@@ -0,0 +1,198 @@
+// 亮度统计：与直接排序/双精度计算的参考结果比较（均值、最值、百分位、裁剪占比、Otsu），
+// 覆盖非对齐起点、奇数宽度、带stride的子区域和YUYV步长；JPEG帧走frameLumaStats
+// （DC系数），结果应与libjpeg 1/8缩放参考图（data/ref/）的统计完全一致。
+// 打印QQVGA/VGA灰度、YUYV和Otsu的耗时，对应设备上的benchmarkLumaStats。
+
+#include "host_test.h"
+#include "luma_stats.h"
+#include "frame_gray.h"
+#include <algorithm>
+#include <stdlib.h>
+
+struct Plane {
+  uint16_t width, height, stride;
+  uint8_t step;
+  std::vector<uint8_t> data;
+  size_t offset;  // 第一个像素的字节偏移，用于测试非对齐起点
+  const uint8_t* pixels() const { return data.data() + offset; }
+};
+
+static Plane makePlane(uint16_t width, uint16_t height, uint16_t stride, uint8_t step, size_t offset, int kind) {
+  Plane p = {width, height, stride, step, {}, offset};
+  p.data.assign(offset + (size_t)stride * height, 0);
+  for (uint16_t y = 0; y < height; y++) {
+    for (uint16_t x = 0; x < width; x++) {
+      int v;
+      switch (kind) {
+        case 0: v = rand() & 0xFF; break;                                      // 均匀噪声
+        case 1: v = (x < width / 2 ? 40 : 190) + rand() % 30; break;          // 双峰
+        case 2: v = rand() % 12; break;                                        // 欠曝，大量死黑
+        default: v = 240 + rand() % 16; break;                                 // 过曝
+      }
+      p.data[offset + (size_t)y * stride + (size_t)x * step] = (uint8_t)v;
+      if (step == 2) p.data[offset + (size_t)y * stride + x * 2 + 1] = 0xEE;  // 色度不能被统计
+    }
+  }
+  return p;
+}
+
+static void checkAgainstReference(const Plane& p, const char* label) {
+  std::vector<uint8_t> values;
+  for (uint16_t y = 0; y < p.height; y++) {
+    for (uint16_t x = 0; x < p.width; x++) values.push_back(p.pixels()[(size_t)y * p.stride + x * p.step]);
+  }
+  std::sort(values.begin(), values.end());
+  uint64_t total = 0;
+  uint32_t low = 0, high = 0;
+  for (uint8_t v : values) {
+    total += v;
+    low += v <= 8;
+    high += v >= 247;
+  }
+  uint32_t n = (uint32_t)values.size();
+
+  LumaStats s;
+  lumaStatsCompute(&s, p.pixels(), p.width, p.height, p.stride, p.step);
+  int before = hostFailures;
+  CHECK_EQ(s.count, n);
+  CHECK_EQ(s.mean, (total + n / 2) / n);
+  CHECK_EQ(s.min, values.front());
+  CHECK_EQ(s.max, values.back());
+  CHECK_EQ(s.p5, values[(uint64_t)n * 5 / 100]);
+  CHECK_EQ(s.median, values[(uint64_t)n * 50 / 100]);
+  CHECK_EQ(s.p95, values[(uint64_t)n * 95 / 100]);
+  CHECK_EQ(s.contrast, s.p95 - s.p5);
+  CHECK_EQ(s.clippedLowPercent, (uint64_t)low * 100 / n);
+  CHECK_EQ(s.clippedHighPercent, (uint64_t)high * 100 / n);
+
+  // Otsu：阈值-1处的类间方差应等于所有分割点中的最大值（单精度实现允许极小的相对误差）
+  double best = -1, at = -1;
+  uint8_t threshold = lumaOtsuThreshold(&s);
+  for (int t = 0; t < 255; t++) {
+    double w0 = 0, s0 = 0, w1 = 0, s1 = 0;
+    for (int v = 0; v < 256; v++) {
+      if (v <= t) { w0 += s.histogram[v]; s0 += (double)s.histogram[v] * v; }
+      else { w1 += s.histogram[v]; s1 += (double)s.histogram[v] * v; }
+    }
+    if (w0 == 0 || w1 == 0) continue;
+    double d = s0 / w0 - s1 / w1;
+    double variance = w0 * w1 * d * d;
+    if (variance > best) best = variance;
+    if (t == threshold - 1) at = variance;
+  }
+  if (best > 0 && at < best * (1 - 1e-5)) {
+    fprintf(stderr, "%s: Otsu threshold %d has variance %.6g, best %.6g\n", label, threshold, at, best);
+    hostFailures++;
+  }
+  if (hostFailures != before) fprintf(stderr, "  in %s\n", label);
+}
+
+static void checkExposureStep() {
+  LumaStats s;
+  std::vector<uint8_t> pixels(64 * 64);
+  auto fill = [&](int base, int spread) {
+    for (uint8_t& v : pixels) v = (uint8_t)std::min(255, base + rand() % spread);
+    lumaStatsCompute(&s, pixels.data(), 64, 64, 64, 1);
+  };
+  fill(110, 16);
+  CHECK_EQ(lumaExposureStep(&s, 118, 24), 0);
+  fill(20, 30);
+  CHECK_EQ(lumaExposureStep(&s, 118, 24), 1);
+  fill(200, 56);
+  CHECK_EQ(lumaExposureStep(&s, 118, 24), -1);
+  lumaStatsBegin(&s);
+  CHECK_EQ(lumaExposureStep(&s, 118, 24), 0);
+  CHECK_EQ(lumaOtsuThreshold(&s), 128);
+}
+
+static bool readPgm(const std::string& path, std::vector<uint8_t>* pixels, int* width, int* height) {
+  std::vector<uint8_t> data;
+  int maxval = 0, offset = 0;
+  if (!hostReadFile(path, &data) ||
+      sscanf((const char*)data.data(), "P5 %d %d %d%n", width, height, &maxval, &offset) != 3) {
+    return false;
+  }
+  pixels->assign(data.begin() + offset + 1, data.end());
+  return pixels->size() == (size_t)*width * *height;
+}
+
+static void checkJpegFrames() {
+  const char* names[] = {"img_160x120_420", "img_160x120_444", "img_100x75_gray", "img_100x75_rst"};
+  for (const char* name : names) {
+    std::vector<uint8_t> jpeg, ref;
+    int width, height;
+    if (!hostReadFile(hostPath("data/") + name + ".jpg", &jpeg) ||
+        !readPgm(hostPath("data/ref/") + name + "_1_8.pgm", &ref, &width, &height)) {
+      fprintf(stderr, "missing data for %s\n", name);
+      hostFailures++;
+      continue;
+    }
+    camera_fb_t fb = {};
+    fb.buf = jpeg.data();
+    fb.len = jpeg.size();
+    fb.format = PIXFORMAT_JPEG;
+    LumaStats fromJpeg, fromRef;
+    CHECK(frameLumaStats(&fb, &fromJpeg));
+    lumaStatsCompute(&fromRef, ref.data(), width, height, width, 1);
+    CHECK(memcmp(fromJpeg.histogram, fromRef.histogram, sizeof(fromRef.histogram)) == 0);
+    CHECK_EQ(fromJpeg.mean, fromRef.mean);
+  }
+}
+
+static double timeStats(const Plane& p, int runs) {
+  static LumaStats s;
+  uint64_t start = hostMicros();
+  for (int i = 0; i < runs; i++) lumaStatsCompute(&s, p.pixels(), p.width, p.height, p.stride, p.step);
+  return (double)(hostMicros() - start) / runs;
+}
+
+static void benchmark() {
+  srand(16);
+  Plane qqvga = makePlane(160, 120, 160, 1, 0, 0);
+  Plane yuyv = makePlane(160, 120, 320, 2, 0, 0);
+  Plane vga = makePlane(640, 480, 640, 1, 0, 0);
+  const int runs = 2000;
+  double qqvgaUs = timeStats(qqvga, runs);
+  double yuyvUs = timeStats(yuyv, runs);
+  double vgaUs = timeStats(vga, runs / 10);
+
+  LumaStats s;
+  lumaStatsCompute(&s, qqvga.pixels(), 160, 120, 160, 1);
+  volatile uint8_t threshold = 0;
+  uint64_t start = hostMicros();
+  for (int i = 0; i < runs; i++) threshold = lumaOtsuThreshold(&s);
+  double otsuUs = (double)(hostMicros() - start) / runs;
+
+  std::vector<uint8_t> jpeg;
+  double jpegUs = 0;
+  if (hostReadFile(hostPath("data/img_640x480_420.jpg"), &jpeg)) {
+    camera_fb_t fb = {};
+    fb.buf = jpeg.data();
+    fb.len = jpeg.size();
+    fb.format = PIXFORMAT_JPEG;
+    start = hostMicros();
+    for (int i = 0; i < runs / 10; i++) frameLumaStats(&fb, &s);
+    jpegUs = (double)(hostMicros() - start) / (runs / 10);
+  }
+  printf("QQVGA gray %.2f us, QQVGA YUYV %.2f us, VGA gray %.2f us, Otsu %.2f us (threshold %d), "
+         "VGA JPEG (DC) %.1f us\n", qqvgaUs, yuyvUs, vgaUs, otsuUs, threshold, jpegUs);
+}
+
+int main() {
+  srand(5);
+  for (int kind = 0; kind < 4; kind++) {
+    char label[64];
+    snprintf(label, sizeof(label), "kind %d QQVGA", kind);
+    checkAgainstReference(makePlane(160, 120, 160, 1, 0, kind), label);
+    snprintf(label, sizeof(label), "kind %d odd width, unaligned", kind);
+    checkAgainstReference(makePlane(37, 11, 41, 1, 3, kind), label);
+    snprintf(label, sizeof(label), "kind %d YUYV", kind);
+    checkAgainstReference(makePlane(42, 32, 84, 2, 0, kind), label);
+    snprintf(label, sizeof(label), "kind %d 1x1", kind);
+    checkAgainstReference(makePlane(1, 1, 1, 1, 1, kind), label);
+  }
+  checkExposureStep();
+  checkJpegFrames();
+  benchmark();
+  return hostTestResult("bench_luma_stats");
+}
@@ -0,0 +1,102 @@
+#ifndef HOST_CLIENT_H
+#define HOST_CLIENT_H
+
+#include <Arduino.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+// ===================
+// 主机客户端构建的公共部分
+// ===================
+// ai_vision.cpp的接口（固件中由main.cpp、camera.cpp各自声明），以及启动mock_dashscope.py子进程的
+// MockServer：start()等到服务器输出监听地址后返回接口地址，stop()发SIGTERM并返回服务器的请求统计。
+// Python解释器由CMake通过HOST_PYTHON传入。
+
+typedef void (*VisionTokenCallback)(const char* token, void* ctx);
+
+String resolveImageJpeg(const uint8_t* jpegData, size_t jpegSize, const String& question, bool showStatus);
+String resolveImageJpeg(const uint8_t* jpegData, size_t jpegSize, const String& question, bool showStatus,
+                        size_t* sentBytes, uint32_t* sentMs);
+String resolveImageJpegStream(const uint8_t* jpegData, size_t jpegSize, const String& question,
+                              VisionTokenCallback onToken, void* ctx, bool showStatus);
+String resolveImageFromURL(const String& imageUrl, const String& question);
+bool testAPIConnection();
+void setVisionApiUrl(const char* url);
+void setVisionStreaming(bool enabled);
+bool initVisionRateLimit();
+void setVisionRateLimit(uint32_t requestsPerMinute, uint32_t tokensPerMinute);
+void printVisionRateStats();
+
+#ifdef HOST_PYTHON
+
+class MockServer {
+public:
+  ~MockServer() { stop(); }
+
+  // args为mock_dashscope.py的选项（不含--port），返回接口地址，失败时返回空字符串
+  std::string start(const std::vector<std::string>& args) {
+    int out[2];
+    if (pipe(out) != 0) return "";
+    std::string script = std::string(HOST_TEST_DIR) + "/mock_dashscope.py";
+    std::vector<std::string> argv = {HOST_PYTHON, script, "--port", "0"};
+    argv.insert(argv.end(), args.begin(), args.end());
+    fflush(stdout);
+    _pid = fork();
+    if (_pid == 0) {
+      dup2(out[1], STDOUT_FILENO);
+      close(out[0]);
+      close(out[1]);
+      std::vector<char*> raw;
+      for (std::string& a : argv) raw.push_back(&a[0]);
+      raw.push_back(NULL);
+      execv(raw[0], raw.data());
+      _exit(127);
+    }
+    close(out[1]);
+    _out = out[0];
+    if (_pid < 0) return "";
+
+    // 第一行："listening on <url>"
+    std::string line = readLine(10000);
+    const std::string prefix = "listening on ";
+    if (line.compare(0, prefix.size(), prefix) != 0) {
+      fprintf(stderr, "mock server did not start: %s\n", line.c_str());
+      stop();
+      return "";
+    }
+    return line.substr(prefix.size());
+  }
+
+  std::string stop() {
+    std::string summary;
+    if (_pid > 0) {
+      kill(_pid, SIGTERM);
+      summary = readLine(5000);
+      waitpid(_pid, NULL, 0);
+      _pid = -1;
+    }
+    if (_out >= 0) close(_out);
+    _out = -1;
+    return summary;
+  }
+
+private:
+  std::string readLine(int timeoutMs) {
+    std::string line;
+    char c;
+    pollfd p = {_out, POLLIN, 0};
+    while (poll(&p, 1, timeoutMs) > 0 && read(_out, &c, 1) == 1 && c != '\n') line += c;
+    return line;
+  }
+
+  pid_t _pid = -1;
+  int _out = -1;
+};
+
+#endif // HOST_PYTHON
+
+#endif // HOST_CLIENT_H
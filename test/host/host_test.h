@@ -0,0 +1,84 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// ===================
+// 主机测试公共部分
+// ===================
+// 断言宏只记录失败不中止，便于一次看到全部差异；main最后返回hostTestResult()。
+// 计时用steady_clock，基准结果以微秒打印，只作相对比较（主机和ESP32-S3差一个数量级以上）。
+
+static int hostFailures = 0;
+
+#define CHECK(cond)                                                              \
+  do {                                                                           \
+    if (!(cond)) {                                                               \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);   \
+      hostFailures++;                                                            \
+    }                                                                            \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                           \
+  do {                                                                           \
+    long long va_ = (long long)(a), vb_ = (long long)(b);                        \
+    if (va_ != vb_) {                                                            \
+      fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n",          \
+              __FILE__, __LINE__, #a, #b, va_, vb_);                             \
+      hostFailures++;                                                            \
+    }                                                                            \
+  } while (0)
+
+static inline int hostTestResult(const char* name) {
+  if (hostFailures == 0) {
+    printf("%s: OK\n", name);
+    return 0;
+  }
+  printf("%s: %d failures\n", name, hostFailures);
+  return 1;
+}
+
+static inline uint64_t hostMicros() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 测试数据目录由CMake通过HOST_TEST_DIR传入
+static inline std::string hostPath(const char* relative) {
+  return std::string(HOST_TEST_DIR) + "/" + relative;
+}
+
+static inline bool hostReadFile(const std::string& path, std::vector<uint8_t>* data) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  data->clear();
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    data->insert(data->end(), chunk, chunk + n);
+  }
+  fclose(f);
+  return true;
+}
+
+static inline bool hostWriteFile(const std::string& path, const void* data, size_t length) {
+  FILE* f = fopen(path.c_str(), "wb");
+  if (!f) return false;
+  bool ok = fwrite(data, 1, length, f) == length;
+  return fclose(f) == 0 && ok;
+}
+
+// 命令行中是否有某个开关（如 --update）
+static inline bool hostHasFlag(int argc, char** argv, const char* flag) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], flag) == 0) return true;
+  }
+  return false;
+}
+
+#endif // HOST_TEST_H
@@ -0,0 +1,86 @@
+// 用libjpeg生成test_jpeg_decoder的参考亮度图：data/ref/<名称>_1_1.pgm（完整ISLOW IDCT）
+// 和 data/ref/<名称>_1_8.pgm（libjpeg的1/8缩放，即DC系数）。
+// 只在找到libjpeg时构建，不是测试；更换语料后手动运行一次并提交生成的PGM：
+//   ./_gate_build/make_jpeg_refs data/img_100x75_420.jpg ...
+
+#include <stddef.h>
+#include <stdio.h>
+#include <jpeglib.h>
+#include <string>
+#include <vector>
+
+static bool decodeReference(const std::vector<uint8_t>& data, int denom,
+                            std::vector<uint8_t>* pixels, int* width, int* height) {
+  jpeg_decompress_struct cinfo;
+  jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, (unsigned char*)data.data(), data.size());
+  if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+  // 只要Y分量：不做颜色转换，取第一个分量
+  cinfo.out_color_space = cinfo.num_components == 1 ? JCS_GRAYSCALE : JCS_YCbCr;
+  cinfo.scale_num = 1;
+  cinfo.scale_denom = denom;
+  cinfo.dct_method = JDCT_ISLOW;
+  jpeg_start_decompress(&cinfo);
+  *width = cinfo.output_width;
+  *height = cinfo.output_height;
+  int components = cinfo.output_components;
+  std::vector<uint8_t> row((size_t)*width * components);
+  pixels->clear();
+  while (cinfo.output_scanline < cinfo.output_height) {
+    JSAMPROW r = row.data();
+    jpeg_read_scanlines(&cinfo, &r, 1);
+    for (int x = 0; x < *width; x++) pixels->push_back(row[x * components]);
+  }
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <file.jpg>...\n", argv[0]);
+    return 2;
+  }
+  for (int i = 1; i < argc; i++) {
+    std::string path = argv[i];
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+      fprintf(stderr, "cannot open %s\n", path.c_str());
+      return 1;
+    }
+    std::vector<uint8_t> data;
+    int ch;
+    while ((ch = fgetc(f)) != EOF) data.push_back((uint8_t)ch);
+    fclose(f);
+
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : path.substr(0, slash);
+    std::string name = path.substr(slash + 1);
+    name = name.substr(0, name.rfind('.'));
+    const int denoms[] = {1, 8};
+    for (int denom : denoms) {
+      std::vector<uint8_t> pixels;
+      int width = 0, height = 0;
+      if (!decodeReference(data, denom, &pixels, &width, &height)) {
+        fprintf(stderr, "%s: libjpeg decode failed\n", path.c_str());
+        return 1;
+      }
+      std::string out = dir + "/ref/" + name + "_1_" + std::to_string(denom) + ".pgm";
+      FILE* o = fopen(out.c_str(), "wb");
+      if (!o) {
+        fprintf(stderr, "cannot write %s\n", out.c_str());
+        return 1;
+      }
+      fprintf(o, "P5\n%d %d\n255\n", width, height);
+      fwrite(pixels.data(), 1, pixels.size(), o);
+      fclose(o);
+      printf("%s %dx%d\n", out.c_str(), width, height);
+    }
+  }
+  return 0;
+}
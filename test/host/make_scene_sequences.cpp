@@ -0,0 +1,136 @@
+// 生成data/scene/下的场景序列：从data/中的JPEG完整解码亮度，按场景取裁剪窗口、
+// 叠加传感器噪声/曝光变化/遮挡物，再经frameToGrayscale（与设备相同的缩略图路径）缩成32x24。
+// 输出格式与设备上recordSceneSequence的串口输出相同；"# expect"行是人工确认过的放行帧，
+// 由test_scene_gate核对。不是测试，更换场景后手动运行：
+//   ./_gate_build/make_scene_sequences
+
+#include "host_test.h"
+#include "frame_gray.h"
+#include "jpeg_decoder.h"
+#include "scene_gate.h"
+#include <stdlib.h>
+
+struct Luma {
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> pixels;
+};
+
+static void onRow(const uint8_t* row, uint16_t width, uint16_t y, void* ctx) {
+  Luma* l = (Luma*)ctx;
+  l->width = width;
+  l->height = y + 1;
+  l->pixels.insert(l->pixels.end(), row, row + width);
+}
+
+static bool loadLuma(const char* file, Luma* luma) {
+  std::vector<uint8_t> jpeg;
+  return hostReadFile(hostPath(file), &jpeg) &&
+         jpegDecodeLuma(jpeg.data(), jpeg.size(), JPEG_SCALE_1_1, onRow, luma);
+}
+
+struct FrameEdit {
+  int windowX, windowY, windowWidth, windowHeight;  // 在源图中的取景窗口
+  int brightness;                                    // 整体亮度偏移（曝光）
+  int noise;                                         // 逐像素均匀噪声幅度
+  int objectX, objectY, objectSize, objectLevel;     // 窗口坐标中的方块遮挡物，objectSize为0表示没有
+};
+
+class SequenceWriter {
+ public:
+  SequenceWriter(const char* name, const char* description, const char* expect) : name_(name) {
+    text_ = std::string("SCENESEQ 32 24\n# ") + description + "\n# expect " + expect + "\n";
+  }
+
+  void frame(const Luma& src, const FrameEdit& e, uint32_t timestampMs) {
+    std::vector<uint8_t> window((size_t)e.windowWidth * e.windowHeight);
+    for (int y = 0; y < e.windowHeight; y++) {
+      for (int x = 0; x < e.windowWidth; x++) {
+        int v = src.pixels[(size_t)(e.windowY + y) * src.width + e.windowX + x] + e.brightness;
+        if (e.noise) v += (int)(rand() % (2 * e.noise + 1)) - e.noise;
+        if (e.objectSize && x >= e.objectX && x < e.objectX + e.objectSize &&
+            y >= e.objectY && y < e.objectY + e.objectSize) {
+          v = e.objectLevel;
+        }
+        window[(size_t)y * e.windowWidth + x] = (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v);
+      }
+    }
+    camera_fb_t fb = {};
+    fb.buf = window.data();
+    fb.len = window.size();
+    fb.width = e.windowWidth;
+    fb.height = e.windowHeight;
+    fb.format = PIXFORMAT_GRAYSCALE;
+    uint8_t thumb[SCENE_THUMB_WIDTH * SCENE_THUMB_HEIGHT];
+    frameToGrayscale(&fb, thumb, SCENE_THUMB_WIDTH, SCENE_THUMB_HEIGHT, SCENE_THUMB_WIDTH);
+
+    char hex[sizeof(thumb) * 2 + 1];
+    for (size_t i = 0; i < sizeof(thumb); i++) snprintf(hex + i * 2, 3, "%02x", thumb[i]);
+    text_ += "F " + std::to_string(timestampMs) + " " + hex + "\n";
+  }
+
+  bool save() {
+    std::string path = hostPath(("data/scene/" + name_ + ".seq").c_str());
+    printf("%s\n", path.c_str());
+    return hostWriteFile(path, text_.data(), text_.size());
+  }
+
+ private:
+  std::string name_;
+  std::string text_;
+};
+
+int main() {
+  Luma vga, qqvga;
+  if (!loadLuma("data/img_640x480_420.jpg", &vga) || !loadLuma("data/img_160x120_420.jpg", &qqvga)) {
+    fprintf(stderr, "cannot decode corpus images\n");
+    return 1;
+  }
+  srand(8);
+
+  // 静止画面，传感器噪声加自动曝光来回跳动±10级：只有首帧放行
+  {
+    SequenceWriter w("static_flicker", "static scene, sensor noise and +-10 exposure flicker, 5 fps", "0");
+    for (int f = 0; f < 60; f++) {
+      FrameEdit e = {0, 0, 640, 480, (f & 1) ? 10 : -10, 4, 0, 0, 0, 0};
+      w.frame(vga, e, f * 200);
+    }
+    if (!w.save()) return 1;
+  }
+
+  // 缓慢变亮60级（日光变化）：背景滑动平均吸收，不放行
+  {
+    SequenceWriter w("slow_drift", "static scene brightening by 60 levels over 12 s, 5 fps", "0");
+    for (int f = 0; f < 80; f++) {
+      FrameEdit e = {0, 0, 640, 480, (f < 60 ? f : 60) - 30, 3, 0, 0, 0, 0};
+      w.frame(vga, e, f * 200);
+    }
+    if (!w.save()) return 1;
+  }
+
+  // 物体进入、在冷却期内移动、离开
+  {
+    SequenceWriter w("object_enter_leave",
+                     "dark object enters at 20, moves at 22 (cooldown), leaves at 50, 5 fps", "0 20 35 50");
+    for (int f = 0; f < 70; f++) {
+      int size = f >= 20 && f < 50 ? 40 : 0;
+      int x = f >= 22 ? 100 : 30;
+      FrameEdit e = {0, 0, 160, 120, 0, 3, x, 40, size, 20};
+      w.frame(qqvga, e, f * 200);
+    }
+    if (!w.save()) return 1;
+  }
+
+  // 镜头平移后停住：平移期间按冷却间隔放行，冷却中积压的变化在45帧放行，之后不再放行
+  {
+    SequenceWriter w("pan_then_hold", "camera pans 8 px per frame for 40 frames then holds, 5 fps",
+                     "0 15 30 45");
+    for (int f = 0; f < 80; f++) {
+      int x = (f < 40 ? f : 40) * 8;
+      FrameEdit e = {x, 80, 320, 240, 0, 3, 0, 0, 0, 0};
+      w.frame(vga, e, f * 200);
+    }
+    if (!w.save()) return 1;
+  }
+  return 0;
+}
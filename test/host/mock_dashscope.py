@@ -0,0 +1,428 @@
+#!/usr/bin/env python3
+# ===================
+# DashScope兼容接口的本地模拟服务器
+# ===================
+# 实现 POST /compatible-mode/v1/chat/completions：非流式返回chat.completion，"stream": true时以
+# 分块传输的SSE逐段返回chat.completion.chunk，stream_options.include_usage时最后附带用量事件，
+# 以"data: [DONE]"结束。用于在主机（test/host的客户端构建、vision_load）或局域网内的设备
+# （setVisionApiUrl("http://<电脑IP>:8000/compatible-mode/v1/chat/completions")）上测试，
+# 不需要外网、API密钥和额度。只用Python标准库。
+#
+# 校验请求：JSON格式、model和messages字段、Authorization: Bearer（--api-key给出时必须一致），
+# data URL中的图像必须是能解码的Base64 JPEG（FF D8开头）；不合格时按DashScope的格式返回400/401。
+#
+# 可配置：
+#   --latency-ms       收到请求到发出响应头的时间（模拟排队和推理），--jitter-ms在其上随机增加
+#   --bandwidth-kbps   响应体的下行带宽（按块限速），0为不限
+#   --token-interval-ms  流式响应两段delta之间的间隔；--delta-chars每段的字符数
+#   --error-rate / --error-status  按比例返回错误（4xx/5xx），429时带Retry-After（--retry-after）
+#   --answers-file     JSON对象{"问题中的关键字": "回答"}，按问题匹配；不匹配时用--default-answer
+# 问题文本中的标记可以控制单个请求（标记本身不影响回答匹配）：
+#   [mock:status=429,times=1,retry_after=1]  同一问题的前times次返回该状态码（默认每次）
+#   [mock:truncate]      流式响应在回答中途断开、不发[DONE]；非流式响应只发一半响应体
+#   [mock:delta=1500]    本请求每段delta的字符数
+#   [mock:latency=800]   本请求的响应头延迟（毫秒）
+#   [mock:no_usage]      流式响应不发用量事件（服务器不支持include_usage）
+#   [mock:close]         响应后关闭连接（Connection: close）
+#
+# --tls时以https监听（ssl.SSLContext，证书和私钥默认用data/tls/中提交的自签名证书，CN=localhost，
+# 也可用--tls-cert/--tls-key指定）。握手在每个连接的处理线程中完成，统计中给出握手次数和
+# 其中会话恢复的次数，用于检查客户端的长连接复用。证书的生成方式：
+#   openssl req -x509 -newkey rsa:2048 -nodes -days 36500 -subj "/CN=localhost" \
+#     -addext "subjectAltName=DNS:localhost,IP:127.0.0.1" -keyout mock_key.pem -out mock_cert.pem
+#
+# 用法：
+#   python3 mock_dashscope.py --port 8000 --latency-ms 300 --token-interval-ms 40
+# --port 0时由系统分配端口；启动后第一行输出 "listening on <接口地址>"，
+# 收到SIGTERM或Ctrl+C时输出请求统计后退出。
+
+import argparse
+import base64
+import binascii
+import json
+import os
+import random
+import re
+import signal
+import ssl
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+API_PATH = "/compatible-mode/v1/chat/completions"
+MARKER = re.compile(r"\[mock:([^\]]*)\]")
+TLS_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "data", "tls")
+
+
+def parse_markers(question):
+    """取出问题中的[mock:...]标记，返回(去掉标记的问题, 选项字典)"""
+    options = {}
+    for group in MARKER.findall(question):
+        for item in group.split(","):
+            item = item.strip()
+            if not item:
+                continue
+            key, _, value = item.partition("=")
+            options[key.strip()] = value.strip() if value else "1"
+    return MARKER.sub("", question).strip(), options
+
+
+def error_body(status, message, code):
+    return {
+        "error": {"message": message, "type": code, "param": None, "code": code},
+        "request_id": "mock-%08x" % random.getrandbits(32),
+    }
+
+
+ERRORS = {
+    400: ("invalid_request_error", "Invalid request"),
+    401: ("invalid_api_key", "Incorrect API key provided."),
+    403: ("access_denied", "Access denied."),
+    404: ("model_not_found", "The model does not exist."),
+    429: ("limit_requests", "Requests rate limit exceeded, please try again later."),
+    500: ("internal_error", "An internal error has occured, please try again later."),
+    502: ("bad_gateway", "Bad gateway."),
+    503: ("service_unavailable", "The service is temporarily unavailable."),
+}
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.requests = 0
+        self.streamed = 0
+        self.statuses = {}
+        self.connections = 0
+        self.tls_handshakes = 0
+        self.tls_resumed = 0
+        self.request_bytes = 0
+        self.response_bytes = 0
+
+    def record(self, status, streamed, request_bytes, response_bytes):
+        with self.lock:
+            self.requests += 1
+            self.streamed += 1 if streamed else 0
+            self.statuses[status] = self.statuses.get(status, 0) + 1
+            self.request_bytes += request_bytes
+            self.response_bytes += response_bytes
+
+    def summary(self):
+        with self.lock:
+            statuses = ", ".join("%d x %d" % (n, s) for s, n in sorted(self.statuses.items()))
+            tls = ""
+            if self.tls_handshakes:
+                tls = ", %d TLS handshakes (%d resumed)" % (self.tls_handshakes, self.tls_resumed)
+            return ("mock: %d requests (%d streamed) on %d connections%s, status %s, "
+                    "%d bytes in, %d bytes out" % (self.requests, self.streamed, self.connections,
+                                                    tls, statuses or "-", self.request_bytes,
+                                                    self.response_bytes))
+
+
+class MockServer(ThreadingHTTPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+    def __init__(self, address, config):
+        super().__init__(address, Handler)
+        self.config = config
+        self.answers = {}
+        if config.answers_file:
+            with open(config.answers_file, encoding="utf-8") as f:
+                self.answers = json.load(f)
+        self.stats = Stats()
+        self.tls = None
+        if config.tls:
+            self.tls = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+            self.tls.load_cert_chain(config.tls_cert, config.tls_key)
+        # [mock:status=...,times=N]：按带标记的原始问题计数
+        self.failures = {}
+        self.failures_lock = threading.Lock()
+        self.random = random.Random(config.seed)
+
+    def get_request(self):
+        # 接受连接的线程不做握手，否则一个不发ClientHello的客户端会挡住后面所有连接
+        sock, address = super().get_request()
+        if self.tls:
+            sock = self.tls.wrap_socket(sock, server_side=True, do_handshake_on_connect=False)
+        return sock, address
+
+    @property
+    def scheme(self):
+        return "https" if self.tls else "http"
+
+    def answer_for(self, question):
+        for key, answer in self.answers.items():
+            if key in question:
+                return answer
+        return self.config.default_answer
+
+    def should_fail(self, question, options):
+        """返回(状态码, Retry-After秒数)，不需要失败时状态码为0"""
+        retry_after = int(options.get("retry_after", self.config.retry_after))
+        if "status" in options:
+            times = int(options.get("times", 0))
+            with self.failures_lock:
+                count = self.failures.get(question, 0)
+                self.failures[question] = count + 1
+            if times == 0 or count < times:
+                return int(options["status"]), retry_after
+        if self.config.error_rate > 0:
+            with self.failures_lock:
+                roll = self.random.random()
+            if roll < self.config.error_rate:
+                return self.config.error_status, retry_after
+        return 0, 0
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    server_version = "mock-dashscope/1.0"
+    # 响应头和响应体分开写，开着Nagle时响应体要等客户端的延迟确认（约40毫秒），会算进下载时间
+    disable_nagle_algorithm = True
+
+    def log_message(self, fmt, *args):
+        if self.server.config.verbose:
+            sys.stderr.write("mock: %s %s\n" % (self.address_string(), fmt % args))
+
+    def setup(self):
+        if self.server.tls:
+            self.request.do_handshake()
+        super().setup()
+        with self.server.stats.lock:
+            self.server.stats.connections += 1
+            if self.server.tls:
+                self.server.stats.tls_handshakes += 1
+                self.server.stats.tls_resumed += 1 if self.request.session_reused else 0
+
+    # ---- 发送 ----
+
+    def write_throttled(self, data):
+        """按--bandwidth-kbps限速写出，返回写出的字节数"""
+        kbps = self.server.config.bandwidth_kbps
+        if kbps <= 0:
+            self.wfile.write(data)
+            return len(data)
+        bytes_per_s = kbps * 1000 / 8
+        block = max(64, int(bytes_per_s / 50))   # 约20毫秒一块
+        for i in range(0, len(data), block):
+            piece = data[i:i + block]
+            start = time.monotonic()
+            self.wfile.write(piece)
+            self.wfile.flush()
+            spare = len(piece) / bytes_per_s - (time.monotonic() - start)
+            if spare > 0:
+                time.sleep(spare)
+        return len(data)
+
+    def send_json(self, status, body, extra_headers=(), close=False, truncate=False):
+        data = json.dumps(body, ensure_ascii=False).encode("utf-8")
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(data)))
+        for name, value in extra_headers:
+            self.send_header(name, value)
+        if close or truncate:
+            self.send_header("Connection", "close")
+            self.close_connection = True
+        self.end_headers()
+        sent = self.write_throttled(data[:len(data) // 2] if truncate else data)
+        self.wfile.flush()
+        return sent
+
+    def send_chunk(self, data):
+        return self.write_throttled(b"%x\r\n%s\r\n" % (len(data), data))
+
+    def send_event(self, body):
+        text = body if isinstance(body, str) else json.dumps(body, ensure_ascii=False)
+        sent = self.send_chunk(("data: %s\n\n" % text).encode("utf-8"))
+        self.wfile.flush()
+        return sent
+
+    def send_error_json(self, status, message=None, retry_after=0):
+        code, default_message = ERRORS.get(status, ("error", "Mock error."))
+        headers = [("Retry-After", str(retry_after))] if status == 429 and retry_after else []
+        return self.send_json(status, error_body(status, message or default_message, code), headers)
+
+    # ---- 请求 ----
+
+    def do_GET(self):
+        if self.path == "/health":
+            self.send_json(200, {"status": "ok"})
+        else:
+            self.send_error_json(404, "Not found.")
+
+    def do_POST(self):
+        length = int(self.headers.get("Content-Length", 0))
+        raw = self.rfile.read(length) if length > 0 else b""
+        status, streamed, sent = self.handle_completion(raw)
+        self.server.stats.record(status, streamed, len(raw), sent)
+
+    def handle_completion(self, raw):
+        """处理一次请求，返回(状态码, 是否流式, 响应体字节数)"""
+        config = self.server.config
+        if self.path != API_PATH:
+            return 404, False, self.send_error_json(404, "Not found: %s" % self.path)
+
+        auth = self.headers.get("Authorization", "")
+        if not auth.startswith("Bearer ") or len(auth) <= 7 or \
+                (config.api_key and auth[7:] != config.api_key):
+            return 401, False, self.send_error_json(401)
+
+        try:
+            request = json.loads(raw.decode("utf-8"))
+            model = request["model"]
+            question, has_image = self.read_messages(request["messages"])
+        except (ValueError, KeyError, TypeError, UnicodeDecodeError) as e:
+            return 400, False, self.send_error_json(400, "Invalid request: %s" % e)
+
+        raw_question = question
+        question, options = parse_markers(question)
+        stream = bool(request.get("stream"))
+        include_usage = bool((request.get("stream_options") or {}).get("include_usage")) and \
+            "no_usage" not in options
+
+        latency = int(options.get("latency", config.latency_ms))
+        if config.jitter_ms:
+            latency += random.randint(0, config.jitter_ms)
+        if latency > 0:
+            time.sleep(latency / 1000)
+
+        status, retry_after = self.server.should_fail(raw_question, options)
+        if status:
+            return status, False, self.send_error_json(status, retry_after=retry_after)
+
+        answer = self.server.answer_for(question)
+        prompt_tokens = 28 + len(question) + (1000 if has_image else 0)
+        completion_tokens = len(answer)
+        usage = {"prompt_tokens": prompt_tokens, "completion_tokens": completion_tokens,
+                 "total_tokens": prompt_tokens + completion_tokens}
+        truncate = "truncate" in options
+        close = "close" in options or config.close
+        if stream:
+            delta = int(options.get("delta", config.delta_chars))
+            sent = self.stream_answer(model, answer, usage if include_usage else None, delta,
+                                      truncate, close)
+            return 200, True, sent
+        body = {
+            "id": "chatcmpl-mock", "object": "chat.completion", "created": int(time.time()),
+            "model": model,
+            "choices": [{"index": 0, "message": {"role": "assistant", "content": answer},
+                         "finish_reason": "stop", "logprobs": None}],
+            "usage": usage,
+        }
+        return 200, False, self.send_json(200, body, close=close, truncate=truncate)
+
+    def read_messages(self, messages):
+        """返回(最后一条用户消息的文字, 是否带图像)；图像data URL必须是Base64 JPEG"""
+        question = ""
+        has_image = False
+        for message in messages:
+            if message["role"] not in ("system", "user", "assistant"):
+                raise ValueError("unknown role %s" % message["role"])
+            content = message["content"]
+            if isinstance(content, str):
+                if message["role"] == "user":
+                    question = content
+                continue
+            for part in content:
+                if part["type"] == "text":
+                    if message["role"] == "user":
+                        question = part["text"]
+                elif part["type"] == "image_url":
+                    self.check_image(part["image_url"]["url"])
+                    has_image = True
+                else:
+                    raise ValueError("unknown content type %s" % part["type"])
+        return question, has_image
+
+    @staticmethod
+    def check_image(url):
+        if url.startswith("http://") or url.startswith("https://"):
+            return
+        prefix = "data:image/jpeg;base64,"
+        if not url.startswith(prefix):
+            raise ValueError("image url must be http(s) or %s..." % prefix)
+        try:
+            jpeg = base64.b64decode(url[len(prefix):], validate=True)
+        except binascii.Error as e:
+            raise ValueError("bad base64 image: %s" % e)
+        if jpeg[:2] != b"\xff\xd8":
+            raise ValueError("image is not a JPEG")
+
+    def stream_answer(self, model, answer, usage, delta_chars, truncate, close):
+        config = self.server.config
+        self.send_response(200)
+        self.send_header("Content-Type", "text/event-stream;charset=UTF-8")
+        self.send_header("Cache-Control", "no-cache")
+        self.send_header("Transfer-Encoding", "chunked")
+        if close or truncate:
+            self.send_header("Connection", "close")
+            self.close_connection = True
+        self.end_headers()
+
+        head = {"id": "chatcmpl-mock", "object": "chat.completion.chunk", "created": int(time.time()),
+                "model": model}
+        pieces = [answer[i:i + delta_chars] for i in range(0, len(answer), max(1, delta_chars))]
+        sent = 0
+        for i, piece in enumerate(pieces):
+            if truncate and i >= max(1, len(pieces) // 2):
+                # 中途断开：不发结束分块
+                self.wfile.flush()
+                return sent
+            delta = {"content": piece}
+            if i == 0:
+                delta = {"role": "assistant", "content": piece}
+            sent += self.send_event(dict(head, choices=[{"index": 0, "delta": delta,
+                                                          "finish_reason": None}]))
+            if config.token_interval_ms > 0:
+                time.sleep(config.token_interval_ms / 1000)
+        sent += self.send_event(dict(head, choices=[{"index": 0, "delta": {}, "finish_reason": "stop"}]))
+        if usage:
+            sent += self.send_event(dict(head, choices=[], usage=usage))
+        sent += self.send_event("[DONE]")
+        self.wfile.write(b"0\r\n\r\n")
+        self.wfile.flush()
+        return sent + 5
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Local stand-in for DashScope /compatible-mode/v1/chat/completions")
+    parser.add_argument("--host", default="127.0.0.1", help="listen address (0.0.0.0 for devices on the LAN)")
+    parser.add_argument("--port", type=int, default=8000, help="0 picks a free port")
+    parser.add_argument("--api-key", default="", help="required Bearer token, empty accepts any")
+    parser.add_argument("--latency-ms", type=int, default=0, help="delay before the response headers")
+    parser.add_argument("--jitter-ms", type=int, default=0, help="random extra latency 0..N ms")
+    parser.add_argument("--bandwidth-kbps", type=float, default=0, help="response body bandwidth, 0 = unlimited")
+    parser.add_argument("--token-interval-ms", type=int, default=0, help="delay between streamed deltas")
+    parser.add_argument("--delta-chars", type=int, default=4, help="characters per streamed delta")
+    parser.add_argument("--error-rate", type=float, default=0, help="fraction of requests answered with --error-status")
+    parser.add_argument("--error-status", type=int, default=500)
+    parser.add_argument("--retry-after", type=int, default=1, help="Retry-After seconds sent with 429")
+    parser.add_argument("--answers-file", help='JSON object {"question keyword": "answer"}')
+    parser.add_argument("--default-answer", default="图中有一个女孩和一只狗坐在海滩上，女孩正在和狗击掌。")
+    parser.add_argument("--close", action="store_true", help="close the connection after every response")
+    parser.add_argument("--tls", action="store_true", help="serve https with --tls-cert/--tls-key")
+    parser.add_argument("--tls-cert", default=os.path.join(TLS_DIR, "mock_cert.pem"))
+    parser.add_argument("--tls-key", default=os.path.join(TLS_DIR, "mock_key.pem"))
+    parser.add_argument("--seed", type=int, default=None, help="seed for --error-rate")
+    parser.add_argument("--verbose", action="store_true", help="log every request to stderr")
+    config = parser.parse_args()
+
+    server = MockServer((config.host, config.port), config)
+    print("listening on %s://%s:%d%s" % (server.scheme, config.host, server.server_address[1], API_PATH),
+          flush=True)
+
+    def stop(signum, frame):
+        threading.Thread(target=server.shutdown, daemon=True).start()
+    signal.signal(signal.SIGTERM, stop)
+    try:
+        server.serve_forever(poll_interval=0.05)
+    except KeyboardInterrupt:
+        pass
+    server.server_close()
+    print(server.stats.summary(), flush=True)
+
+
+if __name__ == "__main__":
+    main()
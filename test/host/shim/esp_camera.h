@@ -0,0 +1,39 @@
+#ifndef ESP_CAMERA_H
+#define ESP_CAMERA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===================
+// esp_camera.h 的主机替身
+// ===================
+// 只提供frame_gray等模块用到的帧类型，枚举顺序与esp32-camera的sensor.h一致。
+// 测试自己填充camera_fb_t（buf指向语料帧），不模拟采集。
+
+typedef enum {
+  PIXFORMAT_RGB565,
+  PIXFORMAT_YUV422,
+  PIXFORMAT_YUV420,
+  PIXFORMAT_GRAYSCALE,
+  PIXFORMAT_JPEG,
+  PIXFORMAT_RGB888,
+  PIXFORMAT_RAW,
+  PIXFORMAT_RGB444,
+  PIXFORMAT_RGB555,
+} pixformat_t;
+
+struct camera_timestamp_t {
+  long tv_sec;
+  long tv_usec;
+};
+
+typedef struct {
+  uint8_t* buf;
+  size_t len;
+  size_t width;
+  size_t height;
+  pixformat_t format;
+  camera_timestamp_t timestamp;
+} camera_fb_t;
+
+#endif // ESP_CAMERA_H
@@ -0,0 +1,223 @@
+// 回答缓存表：64位FNV-1a问题哈希；哈希相同但问题文本不同时不命中；汉明距离阈值和取最近的条目；
+// 同一键覆盖、淘汰最久未使用的条目；过长的问题和回答不缓存；
+// 日志写出后重放得到相同的表，新记录覆盖旧记录，记录多于容量时按LRU保留最后写入的；
+// 日志在任意字节处截断时只加载完整的记录并报告不完整。
+
+#include "host_test.h"
+#include "answer_table.h"
+
+static const uint8_t CAPACITY = 4;
+
+struct Log {
+  std::vector<uint8_t> data;
+  size_t position = 0;
+  size_t limit = SIZE_MAX;      // 模拟截断：只能读到这里
+};
+
+static size_t logWrite(void* ctx, const void* data, size_t length) {
+  Log* log = (Log*)ctx;
+  log->data.insert(log->data.end(), (const uint8_t*)data, (const uint8_t*)data + length);
+  return length;
+}
+
+static size_t logRead(void* ctx, void* data, size_t length) {
+  Log* log = (Log*)ctx;
+  size_t end = std::min(log->data.size(), log->limit);
+  size_t n = log->position < end ? std::min(length, end - log->position) : 0;
+  memcpy(data, log->data.data() + log->position, n);
+  log->position += n;
+  return n;
+}
+
+static std::string lookup(AnswerTable* t, uint64_t imageHash, const char* question, uint8_t* distance = NULL) {
+  int index = answerTableLookup(t, imageHash, question, distance);
+  return index >= 0 ? t->entries[index].text : "";
+}
+
+static void checkQuestionHash() {
+  // FNV-1a 64位的标准值
+  CHECK(answerQuestionHash("") == 0xcbf29ce484222325ull);
+  CHECK(answerQuestionHash("a") == 0xaf63dc4c8601ec8cull);
+  CHECK(answerQuestionHash("foobar") == 0x85944171f73967e8ull);
+  CHECK(answerQuestionHash("图中有什么？") != answerQuestionHash("图中有几个人？"));
+}
+
+static void checkLookup() {
+  AnswerEntry entries[CAPACITY];
+  AnswerTable t;
+  answerTableInit(&t, entries, CAPACITY, 6);
+  const uint64_t image = 0x0123456789abcdefull;
+
+  CHECK(lookup(&t, image, "图中有什么？").empty());
+  CHECK(answerTableStore(&t, image, "图中有什么？", "一只狗", NULL) >= 0);
+  CHECK_EQ(t.count, 1);
+
+  // 汉明距离不超过6命中，7不命中
+  uint8_t distance = 0;
+  CHECK(lookup(&t, image ^ 0x3f, "图中有什么？", &distance) == "一只狗");
+  CHECK_EQ(distance, 6);
+  CHECK(lookup(&t, image ^ 0x7f, "图中有什么？").empty());
+  answerTableSetMaxDistance(&t, 7);
+  CHECK(lookup(&t, image ^ 0x7f, "图中有什么？") == "一只狗");
+  answerTableSetMaxDistance(&t, 200);
+  CHECK_EQ(t.maxDistance, 64);
+  answerTableSetMaxDistance(&t, 6);
+
+  // 不同问题不命中；多个候选取距离最近的
+  CHECK(lookup(&t, image, "图中有几个人？").empty());
+  CHECK(answerTableStore(&t, image ^ 0xff00000000000000ull, "图中有什么？", "一只猫", NULL) >= 0);
+  CHECK_EQ(t.count, 2);
+  CHECK(lookup(&t, image ^ 0xfe00000000000000ull, "图中有什么？", &distance) == "一只猫");
+  CHECK_EQ(distance, 1);
+  CHECK(lookup(&t, image ^ 1, "图中有什么？") == "一只狗");
+}
+
+// 问题哈希相同但文本不同（碰撞）：比较全文，不返回别的问题的回答
+static void checkHashCollision() {
+  AnswerEntry entries[CAPACITY];
+  AnswerTable t;
+  answerTableInit(&t, entries, CAPACITY, 6);
+  int index = answerTableStore(&t, 42, "图中有什么？", "一只狗", NULL);
+  CHECK(index >= 0);
+  entries[index].questionHash = answerQuestionHash("图中有几个人？");
+  CHECK(lookup(&t, 42, "图中有几个人？").empty());
+
+  // 写入碰撞的问题占用新条目，不覆盖原来的
+  CHECK(answerTableStore(&t, 42, "图中有几个人？", "没有人", NULL) != index);
+  CHECK_EQ(t.count, 2);
+  CHECK(lookup(&t, 42, "图中有几个人？") == "没有人");
+  CHECK(std::string(entries[index].text) == "一只狗");
+}
+
+// 两两之间汉明距离16的画面
+static uint64_t imageFor(int i) {
+  return 0x0101010101010101ull << i;
+}
+
+static void checkStoreAndEviction() {
+  AnswerEntry entries[CAPACITY];
+  AnswerTable t;
+  answerTableInit(&t, entries, CAPACITY, 4);
+  bool evicted = true;
+  for (int i = 0; i < CAPACITY; i++) {
+    char answer[16];
+    snprintf(answer, sizeof(answer), "answer %d", i);
+    CHECK(answerTableStore(&t, imageFor(i), "q", answer, &evicted) >= 0);
+    CHECK(!evicted);
+  }
+  CHECK_EQ(t.count, CAPACITY);
+
+  // 同一问题、同一画面（距离在阈值内）覆盖
+  int slot = answerTableStore(&t, imageFor(2) ^ 1, "q", "answer 2b", &evicted);
+  CHECK(!evicted);
+  CHECK_EQ(t.count, CAPACITY);
+  CHECK(std::string(entries[slot].text) == "answer 2b");
+
+  // 使用过条目0后，最久未使用的是条目1
+  CHECK(lookup(&t, imageFor(0), "q") == "answer 0");
+  CHECK(answerTableStore(&t, imageFor(7), "q", "answer 7", &evicted) >= 0);
+  CHECK(evicted);
+  CHECK_EQ(t.count, CAPACITY);
+  CHECK(lookup(&t, imageFor(1), "q").empty());
+  CHECK(lookup(&t, imageFor(0), "q") == "answer 0");
+  CHECK(lookup(&t, imageFor(7), "q") == "answer 7");
+
+  // 过长的问题或回答不写入
+  std::string longQuestion(ANSWER_CACHE_QUESTION_MAX, 'q');
+  std::string longAnswer(ANSWER_CACHE_TEXT_MAX, 'a');
+  CHECK_EQ(answerTableStore(&t, 1, longQuestion.c_str(), "a", &evicted), -1);
+  CHECK_EQ(answerTableStore(&t, 1, "q", longAnswer.c_str(), &evicted), -1);
+  CHECK(!evicted);
+  longQuestion.pop_back();
+  longAnswer.pop_back();
+  CHECK(answerTableStore(&t, 1, longQuestion.c_str(), longAnswer.c_str(), NULL) >= 0);
+  CHECK(lookup(&t, 1, longQuestion.c_str()) == longAnswer);
+
+  answerTableClear(&t);
+  CHECK_EQ(t.count, 0);
+  CHECK(lookup(&t, imageFor(7), "q").empty());
+}
+
+static void checkReplay() {
+  const char* questions[] = {"图中有什么？", "图中有几个人？", "请详细描述这张图"};
+  struct Record {
+    uint64_t imageHash;
+    const char* question;
+    const char* answer;
+  };
+  // 6条记录：3个问题各一个画面，后面3条覆盖第一个问题、加两个新画面
+  const Record written[] = {
+    {100, questions[0], "旧回答"},
+    {200, questions[1], "两个人"},
+    {300, questions[2], "一片海滩，\"远处\"有船"},
+    {101, questions[0], "新回答"},
+    {0xffffull << 40, questions[0], "另一个画面"},
+    {0xffffull << 48, questions[1], ""},
+  };
+  Log log;
+  std::vector<size_t> recordEnd;
+  for (const Record& r : written) {
+    CHECK(answerRecordWrite(r.imageHash, r.question, r.answer, logWrite, &log));
+    recordEnd.push_back(log.data.size());
+  }
+
+  AnswerEntry entries[CAPACITY];
+  AnswerTable t;
+  answerTableInit(&t, entries, CAPACITY, 6);
+  uint32_t records = 0;
+  CHECK(answerTableReplay(&t, logRead, &log, &records));
+  CHECK_EQ(records, 6);
+  // 101覆盖了100；5个不同的键放进4个条目，最早写入的200被淘汰
+  CHECK_EQ(t.count, CAPACITY);
+  CHECK(lookup(&t, 100, questions[0]) == "新回答");
+  CHECK(lookup(&t, 200, questions[1]).empty());
+  CHECK(lookup(&t, 300, questions[2]) == "一片海滩，\"远处\"有船");
+  CHECK(lookup(&t, 0xffffull << 40, questions[0]) == "另一个画面");
+  CHECK(answerTableLookup(&t, 0xffffull << 48, questions[1], NULL) >= 0);
+
+  // 重放前清空表
+  answerTableStore(&t, 999, "别的问题", "x", NULL);
+  log.position = 0;
+  CHECK(answerTableReplay(&t, logRead, &log, &records));
+  CHECK(lookup(&t, 999, "别的问题").empty());
+
+  // 在每个字节处截断：完整的记录全部加载，残缺的记录报告不完整
+  for (size_t cut = 0; cut <= log.data.size(); cut++) {
+    log.position = 0;
+    log.limit = cut;
+    uint32_t expected = 0;
+    bool boundary = cut == 0;
+    for (size_t end : recordEnd) {
+      if (end <= cut) expected++;
+      if (end == cut) boundary = true;
+    }
+    bool complete = answerTableReplay(&t, logRead, &log, &records);
+    CHECK_EQ(records, expected);
+    CHECK_EQ(complete, boundary);
+  }
+  log.limit = SIZE_MAX;
+
+  // 长度字段不合法（超过回答上限）：停在该记录
+  Log bad;
+  answerRecordWrite(1, "q", "ok", logWrite, &bad);
+  uint64_t image = 2;
+  uint16_t length = 1;
+  logWrite(&bad, &image, sizeof(image));
+  logWrite(&bad, &length, sizeof(length));
+  logWrite(&bad, "q", 1);
+  length = ANSWER_CACHE_TEXT_MAX;
+  logWrite(&bad, &length, sizeof(length));
+  bad.data.insert(bad.data.end(), ANSWER_CACHE_TEXT_MAX, 'a');
+  CHECK(!answerTableReplay(&t, logRead, &bad, &records));
+  CHECK_EQ(records, 1);
+  CHECK(lookup(&t, 1, "q") == "ok");
+}
+
+int main() {
+  checkQuestionHash();
+  checkLookup();
+  checkHashCollision();
+  checkStoreAndEviction();
+  checkReplay();
+  return hostTestResult("test_answer_table");
+}
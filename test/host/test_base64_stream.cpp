@@ -0,0 +1,145 @@
+// Base64编码：RFC 4648测试向量；整块编码和按随机片段流式编码都与逐字符的旧实现逐字节一致；
+// sink每次收到的长度不超过内部缓冲区且（除最后一次外）是4的倍数，sink返回false后编码中止；
+// 打印整块、流式和旧实现的吞吐量。
+
+#include "host_test.h"
+#include "base64_stream.h"
+#include <stdlib.h>
+
+// 与camera.cpp中base64EncodeByChar相同的旧实现，作为参考
+static std::string legacyEncode(const uint8_t* data, size_t length) {
+  const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  for (size_t i = 0; i < length; i += 3) {
+    uint32_t b = (data[i] << 16) | ((i + 1 < length ? data[i + 1] : 0) << 8) | (i + 2 < length ? data[i + 2] : 0);
+    out += chars[(b >> 18) & 63];
+    out += chars[(b >> 12) & 63];
+    out += i + 1 < length ? chars[(b >> 6) & 63] : '=';
+    out += i + 2 < length ? chars[b & 63] : '=';
+  }
+  return out;
+}
+
+struct SinkState {
+  std::string text;
+  int calls = 0;
+  bool oddChunk = false;     // 出现了非4倍数的中间块
+  bool oversized = false;
+  int failAfter = -1;        // 第几次调用开始返回false
+};
+
+static bool collect(const char* data, size_t length, void* ctx) {
+  SinkState* s = (SinkState*)ctx;
+  if (s->failAfter >= 0 && s->calls >= s->failAfter) return false;
+  if (length > BASE64_STREAM_CHUNK) s->oversized = true;
+  if (!s->text.empty() && s->text.size() % 4 != 0) s->oddChunk = true;
+  s->text.append(data, length);
+  s->calls++;
+  return true;
+}
+
+static bool discard(const char*, size_t, void*) {
+  return true;
+}
+
+static std::string encodeBulk(const std::vector<uint8_t>& data) {
+  std::string out(base64EncodedLength(data.size()), '?');
+  size_t n = base64EncodeTo(data.data(), data.size(), &out[0]);
+  CHECK_EQ(n, out.size());
+  return out;
+}
+
+static void checkVectors() {
+  const char* vectors[][2] = {
+    {"", ""}, {"f", "Zg=="}, {"fo", "Zm8="}, {"foo", "Zm9v"},
+    {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="}, {"foobar", "Zm9vYmFy"},
+  };
+  for (auto& v : vectors) {
+    std::vector<uint8_t> data(v[0], v[0] + strlen(v[0]));
+    CHECK(encodeBulk(data) == v[1]);
+  }
+  std::vector<uint8_t> high = {0xFB, 0xFF, 0xBF};
+  CHECK(encodeBulk(high) == "+/+/");
+}
+
+static void checkAgainstLegacy() {
+  srand(3);
+  for (size_t n = 0; n < 5000; n += n < 64 ? 1 : 131) {
+    std::vector<uint8_t> data(n);
+    for (uint8_t& b : data) b = (uint8_t)rand();
+    std::string expected = legacyEncode(data.data(), n);
+    CHECK(encodeBulk(data) == expected);
+
+    for (int trial = 0; trial < 4; trial++) {
+      SinkState sink;
+      Base64Stream st;
+      base64StreamBegin(&st, collect, &sink);
+      size_t i = 0;
+      while (i < n) {
+        size_t k = (size_t)rand() % (trial == 0 ? 4 : 1500);
+        if (k > n - i) k = n - i;
+        CHECK(base64StreamWrite(&st, data.data() + i, k));
+        i += k;
+      }
+      CHECK(base64StreamEnd(&st));
+      if (sink.text != expected) {
+        fprintf(stderr, "stream mismatch at length %zu, trial %d\n", n, trial);
+        hostFailures++;
+      }
+      CHECK_EQ(st.total, expected.size());
+      CHECK(!sink.oddChunk);
+      CHECK(!sink.oversized);
+    }
+  }
+}
+
+static void checkSinkFailure() {
+  std::vector<uint8_t> data(4000, 0x5A);
+  SinkState sink;
+  sink.failAfter = 2;
+  Base64Stream st;
+  base64StreamBegin(&st, collect, &sink);
+  bool ok = base64StreamWrite(&st, data.data(), data.size());
+  ok = base64StreamEnd(&st) && ok;
+  CHECK(!ok);
+  CHECK(st.failed);
+  CHECK_EQ(sink.calls, 2);
+}
+
+static void benchmark() {
+  const size_t length = 60 * 1024;  // 与VGA JPEG帧的量级相近
+  std::vector<uint8_t> data(length);
+  for (size_t i = 0; i < length; i++) data[i] = (uint8_t)(i * 131 + (i >> 7));
+  std::string out(base64EncodedLength(length), 0);
+  const int runs = 100;
+
+  uint64_t start = hostMicros();
+  for (int i = 0; i < runs; i++) base64EncodeTo(data.data(), length, &out[0]);
+  double bulkUs = (double)(hostMicros() - start) / runs;
+
+  start = hostMicros();
+  for (int i = 0; i < runs; i++) {
+    Base64Stream st;
+    base64StreamBegin(&st, discard, NULL);
+    base64StreamWrite(&st, data.data(), length);
+    base64StreamEnd(&st);
+  }
+  double streamUs = (double)(hostMicros() - start) / runs;
+
+  start = hostMicros();
+  size_t sink = 0;
+  for (int i = 0; i < runs; i++) sink += legacyEncode(data.data(), length).size();
+  double legacyUs = (double)(hostMicros() - start) / runs;
+
+  printf("%zu bytes: buffer %.1f us (%.0f MB/s), stream %.1f us (%.0f MB/s), legacy %.1f us (%.0f MB/s)\n",
+         length, bulkUs, length / bulkUs, streamUs, length / streamUs, legacyUs, length / legacyUs);
+  CHECK(sink > 0);
+}
+
+int main() {
+  checkVectors();
+  checkAgainstLegacy();
+  checkSinkFailure();
+  benchmark();
+  return hostTestResult("test_base64_stream");
+}
@@ -0,0 +1,296 @@
+// 对话请求模板：三种请求与ArduinoJson序列化同一文档（旧的构建方式）逐字节一致，3000个随机问题和URL；
+// 每种读取大小（1字节到整个请求体）分段读出的结果都相同，总字节数等于chatRequestLength()；
+// 输出能解析为JSON，问题、URL和图像字节原样取回；其他控制字符写成\u00XX；
+// 读到一半或读完后回到开头重发，两次输出相同。
+
+#include "host_test.h"
+#include "chat_request.h"
+#include "base64_stream.h"
+#include <ArduinoJson.h>
+#include <stdlib.h>
+
+static const char* MODEL = "qwen-vl-max";
+static const char* SYSTEM_PROMPT = "You are a helpful assistant that analyzes images in Chinese.";
+
+static std::string readAll(ChatRequest* r, size_t step) {
+  std::string out;
+  std::vector<uint8_t> buffer(step);
+  size_t n;
+  while ((n = chatRequestRead(r, buffer.data(), step)) > 0) {
+    CHECK(n <= step);
+    out.append((const char*)buffer.data(), n);
+  }
+  return out;
+}
+
+static std::string base64(const std::vector<uint8_t>& data) {
+  std::string out(base64EncodedLength(data.size()), '?');
+  base64EncodeTo(data.data(), data.size(), &out[0]);
+  return out;
+}
+
+static std::vector<uint8_t> unbase64(const std::string& text) {
+  static const std::string chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::vector<uint8_t> out;
+  uint32_t bits = 0;
+  int count = 0;
+  for (char c : text) {
+    if (c == '=') break;
+    bits = bits << 6 | (uint32_t)chars.find(c);
+    if (++count == 4) {
+      out.push_back(bits >> 16);
+      out.push_back(bits >> 8);
+      out.push_back(bits);
+      bits = 0;
+      count = 0;
+    }
+  }
+  if (count == 2) out.push_back(bits >> 4);
+  if (count == 3) {
+    out.push_back(bits >> 10);
+    out.push_back(bits >> 2);
+  }
+  return out;
+}
+
+// ---- 旧的构建方式：ArduinoJson文档序列化 ----
+
+static std::string serialize(const JsonDocument& doc) {
+  std::string out;
+  serializeJson(doc, out);
+  return out;
+}
+
+static std::string referenceImage(bool stream, const std::string& encoded, const std::string& question) {
+  DynamicJsonDocument doc(65536);
+  doc["model"] = MODEL;
+  if (stream) {
+    doc["stream"] = true;
+    doc["stream_options"]["include_usage"] = true;
+  }
+  JsonObject user = doc["messages"].createNestedObject();
+  user["role"] = "user";
+  JsonArray content = user.createNestedArray("content");
+  JsonObject image = content.createNestedObject();
+  image["type"] = "image_url";
+  image["image_url"]["url"] = "data:image/jpeg;base64," + encoded;
+  JsonObject text = content.createNestedObject();
+  text["type"] = "text";
+  text["text"] = question;
+  return serialize(doc);
+}
+
+static std::string referenceUrl(const std::string& url, const std::string& question) {
+  DynamicJsonDocument doc(16384);
+  doc["model"] = MODEL;
+  JsonArray messages = doc.createNestedArray("messages");
+  JsonObject system = messages.createNestedObject();
+  system["role"] = "system";
+  JsonObject prompt = system["content"].createNestedObject();
+  prompt["type"] = "text";
+  prompt["text"] = SYSTEM_PROMPT;
+  JsonObject user = messages.createNestedObject();
+  user["role"] = "user";
+  JsonArray content = user.createNestedArray("content");
+  JsonObject image = content.createNestedObject();
+  image["type"] = "image_url";
+  image["image_url"]["url"] = url;
+  JsonObject text = content.createNestedObject();
+  text["type"] = "text";
+  text["text"] = question;
+  return serialize(doc);
+}
+
+static std::string referenceText(const std::string& text) {
+  DynamicJsonDocument doc(16384);
+  doc["model"] = MODEL;
+  JsonObject user = doc["messages"].createNestedObject();
+  user["role"] = "user";
+  user["content"] = text;
+  return serialize(doc);
+}
+
+// 随机文本：ASCII、中文、需要转义的引号和反斜杠、ArduinoJson也会转义的控制字符
+static std::string randomText(size_t maxLength) {
+  static const char* pieces[] = {
+    "a", "Z", "7", " ", "?", "/", "\"", "\\", "\n", "\t", "\r", "\b", "\f", "{", "}", ":", ",",
+    "图", "中", "有", "什么", "？", "，", "😀", "http://", "[mock:close]",
+  };
+  std::string out;
+  size_t length = (size_t)rand() % (maxLength + 1);
+  while (out.size() < length) out += pieces[rand() % (sizeof(pieces) / sizeof(pieces[0]))];
+  return out;
+}
+
+static std::vector<uint8_t> randomBytes(size_t length) {
+  std::vector<uint8_t> data(length);
+  for (uint8_t& b : data) b = (uint8_t)rand();
+  return data;
+}
+
+static void checkAgainstReference() {
+  srand(25);
+  int mismatches = 0;
+  for (int i = 0; i < 3000; i++) {
+    std::string question = randomText(200);
+    std::string url = "https://example.com/" + randomText(60);
+    std::vector<uint8_t> image = randomBytes((size_t)rand() % 300);
+    bool stream = i & 1;
+    size_t step = 1 + (size_t)rand() % 700;
+
+    ChatRequest r;
+    CHECK(chatRequestVisionImage(&r, MODEL, stream, image.data(), image.size(), false, question.c_str()));
+    std::string expected = referenceImage(stream, base64(image), question);
+    std::string got = readAll(&r, step);
+    mismatches += got != expected;
+    CHECK_EQ(chatRequestLength(&r), expected.size());
+
+    // 图像已是Base64时原样输出
+    std::string encoded = base64(image);
+    CHECK(chatRequestVisionImage(&r, MODEL, stream, (const uint8_t*)encoded.data(), encoded.size(), true,
+                                 question.c_str()));
+    mismatches += readAll(&r, step) != expected;
+
+    CHECK(chatRequestVisionUrl(&r, MODEL, url.c_str(), question.c_str()));
+    expected = referenceUrl(url, question);
+    mismatches += readAll(&r, step) != expected;
+    CHECK_EQ(chatRequestLength(&r), expected.size());
+
+    CHECK(chatRequestText(&r, MODEL, question.c_str()));
+    expected = referenceText(question);
+    mismatches += readAll(&r, step) != expected;
+    CHECK_EQ(chatRequestLength(&r), expected.size());
+  }
+  CHECK_EQ(mismatches, 0);
+}
+
+// 每种读取大小都得到同样的字节，总数等于chatRequestLength()
+static void checkReadSizes() {
+  srand(7);
+  std::vector<uint8_t> image = randomBytes(101);        // 不是3的倍数，末尾有填充
+  const char* question = "图中的\"路标\"写着什么？\\ 第一行\n第二行\t/结束";
+  ChatRequest r;
+  CHECK(chatRequestVisionImage(&r, MODEL, true, image.data(), image.size(), false, question));
+  std::string expected = referenceImage(true, base64(image), question);
+  size_t length = chatRequestLength(&r);
+  CHECK_EQ(length, expected.size());
+
+  int mismatches = 0;
+  for (size_t step = 1; step <= length + 1; step++) {
+    chatRequestRewind(&r);
+    std::string got = readAll(&r, step);
+    if (got != expected) {
+      if (mismatches++ == 0) fprintf(stderr, "read size %zu differs\n", step);
+    }
+    CHECK_EQ(got.size(), length);
+    CHECK_EQ(r.position, length);
+  }
+  CHECK_EQ(mismatches, 0);
+}
+
+// 输出是合法JSON，问题、URL和图像字节原样取回
+static void checkRoundTrip() {
+  srand(11);
+  for (int i = 0; i < 200; i++) {
+    std::string question = randomText(120);
+    std::string url = "https://example.com/" + randomText(40);
+    std::vector<uint8_t> image = randomBytes((size_t)rand() % 500);
+
+    ChatRequest r;
+    chatRequestVisionImage(&r, MODEL, false, image.data(), image.size(), false, question.c_str());
+    std::string body = readAll(&r, 64);
+    DynamicJsonDocument doc(65536);
+    CHECK(deserializeJson(doc, body) == DeserializationError::Ok);
+    CHECK(doc["model"].as<std::string>() == MODEL);
+    JsonArray content = doc["messages"][0]["content"];
+    std::string dataUrl = content[0]["image_url"]["url"].as<std::string>();
+    const std::string prefix = "data:image/jpeg;base64,";
+    CHECK(dataUrl.compare(0, prefix.size(), prefix) == 0);
+    CHECK(unbase64(dataUrl.substr(prefix.size())) == image);
+    CHECK(content[1]["text"].as<std::string>() == question);
+
+    chatRequestVisionUrl(&r, MODEL, url.c_str(), question.c_str());
+    body = readAll(&r, 64);
+    CHECK(deserializeJson(doc, body) == DeserializationError::Ok);
+    CHECK(doc["messages"][0]["content"][0]["text"].as<std::string>() == SYSTEM_PROMPT);
+    CHECK(doc["messages"][1]["content"][0]["image_url"]["url"].as<std::string>() == url);
+    CHECK(doc["messages"][1]["content"][1]["text"].as<std::string>() == question);
+  }
+}
+
+// 没有简写形式的控制字符写成\u00XX（ArduinoJson 6原样输出，这里与参考不同）
+static void checkControlCharacters() {
+  std::string question = "a";
+  for (int c = 1; c < 0x20; c++) question += (char)c;
+  question += "\x7f" "z";
+
+  ChatRequest r;
+  chatRequestText(&r, MODEL, question.c_str());
+  std::string body = readAll(&r, 5);
+  CHECK_EQ(body.size(), chatRequestLength(&r));
+  CHECK(body.find("\\u0001\\u0002") != std::string::npos);
+  CHECK(body.find("\\u000b") != std::string::npos);
+  CHECK(body.find("\\u001f") != std::string::npos);
+  CHECK(body.find("\\b\\t\\n\\u000b\\f\\r") != std::string::npos);
+  CHECK(body.find("\x7f" "z") != std::string::npos);
+  for (char c : body) CHECK((uint8_t)c >= 0x20);
+
+  // 转义序列跨两次读取时结果相同
+  for (size_t step = 1; step <= 8; step++) {
+    chatRequestRewind(&r);
+    CHECK(readAll(&r, step) == body);
+  }
+
+  DynamicJsonDocument doc(4096);
+  CHECK(deserializeJson(doc, body) == DeserializationError::Ok);
+  CHECK(doc["messages"][0]["content"].as<std::string>() == question);
+  CHECK_EQ(jsonStringLength(question.data(), question.size()),
+           2 + 1 + 5 * 2 + 26 * 6 + 2);
+}
+
+// 重发：读到一半或读完后回到开头，输出相同
+static void checkRewind() {
+  srand(13);
+  std::vector<uint8_t> image = randomBytes(1000);
+  ChatRequest r;
+  chatRequestVisionImage(&r, MODEL, true, image.data(), image.size(), false, "图中有什么？\n\"再说一遍\"");
+  std::string first = readAll(&r, 97);
+  CHECK_EQ(first.size(), chatRequestLength(&r));
+  uint8_t byte;
+  CHECK_EQ(chatRequestRead(&r, &byte, 1), 0);
+
+  chatRequestRewind(&r);
+  CHECK(readAll(&r, 1460) == first);
+
+  // 在Base64分组和转义序列中间停下再重来
+  for (size_t stop : {1ul, 40ul, 151ul, first.size() - 3}) {
+    chatRequestRewind(&r);
+    std::vector<uint8_t> partial(stop);
+    size_t got = 0;
+    while (got < stop) got += chatRequestRead(&r, partial.data() + got, std::min<size_t>(7, stop - got));
+    CHECK(std::string((const char*)partial.data(), stop) == first.substr(0, stop));
+    chatRequestRewind(&r);
+    CHECK_EQ(r.position, 0);
+    CHECK(readAll(&r, 64) == first);
+  }
+}
+
+static void checkOverflow() {
+  ChatRequest r;
+  chatRequestBegin(&r);
+  for (int i = 0; i < CHAT_REQUEST_PARTS_MAX; i++) chatRequestLiteral(&r, "x", 1);
+  CHECK(!r.overflow);
+  chatRequestLiteral(&r, "y", 1);
+  CHECK(r.overflow);
+  CHECK_EQ(chatRequestLength(&r), CHAT_REQUEST_PARTS_MAX);
+}
+
+int main() {
+  checkAgainstReference();
+  checkReadSizes();
+  checkRoundTrip();
+  checkControlCharacters();
+  checkRewind();
+  checkOverflow();
+  return hostTestResult("test_chat_request");
+}
@@ -0,0 +1,143 @@
+// 对话接口响应解析：data/chat/completion_150k.json是一个带logprobs的约150KB非流式响应，
+// 按TCP分段大小、随机长度和逐字节从读取器喂给chatResponseParse，回答、结束原因和用量都必须正确，
+// 文档占用只取决于回答长度（远小于响应本身，也就是getString()需要的缓冲区）。
+// 另查回答超过CHAT_ANSWER_MAX时返回NoMemory、错误响应没有choices、响应在任意位置截断时报错。
+// 打印150KB响应的解析耗时。
+
+#include "host_test.h"
+#include "chat_response.h"
+#include <stdlib.h>
+
+// 模拟HTTP连接：每次readBytes最多返回一个分段，分段长度由segment决定（0为随机1~1460）
+struct SegmentReader {
+  const std::string& data;
+  size_t segment;
+  size_t pos = 0;
+  size_t reads = 0;
+
+  SegmentReader(const std::string& d, size_t s) : data(d), segment(s) {}
+
+  int read() {
+    reads++;
+    return pos < data.size() ? (uint8_t)data[pos++] : -1;
+  }
+
+  size_t readBytes(char* buffer, size_t length) {
+    reads++;
+    size_t n = segment ? segment : 1 + (size_t)rand() % 1460;
+    n = std::min(n, std::min(length, data.size() - pos));
+    memcpy(buffer, data.data() + pos, n);
+    pos += n;
+    return n;
+  }
+};
+
+static std::string loadText(const char* rel) {
+  std::vector<uint8_t> data;
+  if (!hostReadFile(hostPath(rel), &data)) {
+    fprintf(stderr, "cannot read %s\n", rel);
+    hostFailures++;
+  }
+  return std::string(data.begin(), data.end());
+}
+
+// 把canned响应中的回答替换为content（已是JSON转义后的文本）
+static std::string withAnswer(const std::string& response, const std::string& content) {
+  size_t start = response.find("\"content\":\"") + 11;
+  size_t end = start;
+  while (response[end] != '"') end += response[end] == '\\' ? 2 : 1;
+  return response.substr(0, start) + content + response.substr(end);
+}
+
+static void checkCanned(const std::string& response, const std::string& answer) {
+  CHECK(response.size() >= 150 * 1024);
+  size_t segments[] = {1460, 0, 1, 536, 65536};
+  srand(20);
+  for (size_t segment : segments) {
+    DynamicJsonDocument doc(CHAT_RESPONSE_DOC_SIZE);
+    SegmentReader reader(response, segment);
+    ChatResponse r;
+    DeserializationError error = chatResponseParse(doc, reader, &r);
+    CHECK(error == DeserializationError::Ok);
+    if (error) {
+      fprintf(stderr, "segment %zu: %s\n", segment, error.c_str());
+      continue;
+    }
+    CHECK(r.content && answer == r.content);
+    CHECK(r.finishReason && strcmp(r.finishReason, "stop") == 0);
+    CHECK_EQ(r.promptTokens, 1234);
+    CHECK_EQ(r.completionTokens, 156);
+    CHECK_EQ(r.totalTokens, 1390);
+    CHECK_EQ(reader.pos, response.size());
+    // 过滤掉logprobs等字段后文档只比回答多出固定的键和节点，在CHAT_RESPONSE_DOC_SIZE预留的512字节以内
+    CHECK(doc.memoryUsage() < answer.size() + 512);
+    if (segment == 1460) {
+      printf("%zu-byte response, %zu-byte answer: document %zu bytes used of %d\n", response.size(),
+             answer.size(), doc.memoryUsage(), CHAT_RESPONSE_DOC_SIZE);
+    }
+  }
+}
+
+static void checkAnswerLimit(const std::string& response) {
+  // 文档容量减去键、节点和usage后至少能放下CHAT_ANSWER_MAX - 1字节的回答
+  for (size_t length : {(size_t)CHAT_ANSWER_MAX - 1, (size_t)CHAT_ANSWER_MAX + 600}) {
+    std::string content(length, 'a');
+    std::string text = withAnswer(response, content);
+    DynamicJsonDocument doc(CHAT_RESPONSE_DOC_SIZE);
+    SegmentReader reader(text, 1460);
+    ChatResponse r;
+    DeserializationError error = chatResponseParse(doc, reader, &r);
+    if (length < CHAT_ANSWER_MAX) {
+      CHECK(error == DeserializationError::Ok);
+      CHECK(!error && r.content && content == r.content);
+    } else {
+      CHECK(error == DeserializationError::NoMemory);
+    }
+  }
+}
+
+static void checkErrors(const std::string& response) {
+  const std::string errorBody =
+      "{\"error\":{\"message\":\"Requests rate limit exceeded\",\"type\":\"limit_requests\","
+      "\"code\":\"limit_requests\"},\"request_id\":\"0\"}";
+  DynamicJsonDocument doc(CHAT_RESPONSE_DOC_SIZE);
+  SegmentReader reader(errorBody, 1460);
+  ChatResponse r;
+  CHECK(chatResponseParse(doc, reader, &r) == DeserializationError::Ok);
+  CHECK(r.content == NULL);
+  CHECK(!chatResponseRead(doc, &r));
+
+  // 连接中途断开：任何截断位置都不能得到回答
+  int accepted = 0;
+  for (size_t cut = 0; cut < response.size(); cut += 997) {
+    std::string truncated = response.substr(0, cut);
+    SegmentReader partial(truncated, 1460);
+    if (chatResponseParse(doc, partial, &r) == DeserializationError::Ok) accepted++;
+  }
+  CHECK_EQ(accepted, 0);
+}
+
+static void benchmark(const std::string& response) {
+  DynamicJsonDocument doc(CHAT_RESPONSE_DOC_SIZE);
+  const int runs = 50;
+  size_t answers = 0;
+  uint64_t start = hostMicros();
+  for (int i = 0; i < runs; i++) {
+    SegmentReader reader(response, 1460);
+    ChatResponse r;
+    if (chatResponseParse(doc, reader, &r) == DeserializationError::Ok && r.content) answers++;
+  }
+  double us = (double)(hostMicros() - start) / runs;
+  printf("parse %zu bytes: %.1f us (%.0f MB/s)\n", response.size(), us, response.size() / us);
+  CHECK_EQ(answers, runs);
+}
+
+int main() {
+  std::string response = loadText("data/chat/completion_150k.json");
+  std::string answer = loadText("data/chat/completion_150k.answer.txt");
+  checkCanned(response, answer);
+  checkAnswerLimit(response);
+  checkErrors(response);
+  benchmark(response);
+  return hostTestResult("test_chat_response");
+}
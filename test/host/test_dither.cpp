@@ -0,0 +1,110 @@
+// 抖动引擎：常数灰度的点亮比例应接近灰度/255（有序抖动按矩阵级数量化，
+// Atkinson只扩散6/8误差，只要求端点正确且单调），单一阈值逐像素精确，
+// 非8倍数宽度的尾字节不带多余位，逐行接口与整幅接口结果相同；打印各算法耗时。
+
+#include "host_test.h"
+#include "dither.h"
+#include <math.h>
+
+#define W DITHER_MAX_WIDTH
+#define H 32
+
+static int countOn(const uint8_t* mono, uint16_t width, uint16_t height) {
+  uint16_t rowBytes = (width + 7) / 8;
+  int on = 0;
+  for (uint16_t y = 0; y < height; y++) {
+    for (uint16_t x = 0; x < width; x++) on += (mono[y * rowBytes + x / 8] >> (x & 7)) & 1;
+  }
+  return on;
+}
+
+static double coverage(DitherMode mode, uint8_t level) {
+  static uint8_t gray[W * H], mono[W * H / 8];
+  memset(gray, level, sizeof(gray));
+  CHECK(ditherImage(mode, gray, mono, W, H, 128));
+  return countOn(mono, W, H) / (double)(W * H);
+}
+
+static void checkCoverage() {
+  // 允许误差：单一阈值不做要求，4x4矩阵17级，8x8矩阵65级，Floyd-Steinberg近似连续
+  const double tolerance[DITHER_MODE_COUNT] = {1.0, 1.0 / 16 + 0.01, 1.0 / 64 + 0.01, 0.02, 1.0};
+  for (int mode = 0; mode < DITHER_MODE_COUNT; mode++) {
+    double previous = -1;
+    for (int level = 0; level <= 255; level += 5) {
+      double c = coverage((DitherMode)mode, (uint8_t)level);
+      if (fabs(c - level / 255.0) > tolerance[mode]) {
+        fprintf(stderr, "%s level %d: coverage %.3f\n", ditherModeName((DitherMode)mode), level, c);
+        hostFailures++;
+      }
+      if (c + 1e-9 < previous) {
+        fprintf(stderr, "%s level %d: coverage not monotonic\n", ditherModeName((DitherMode)mode), level);
+        hostFailures++;
+      }
+      previous = c;
+    }
+    CHECK(coverage((DitherMode)mode, 0) == 0.0);
+    CHECK(coverage((DitherMode)mode, 255) == 1.0);
+  }
+}
+
+static void checkThresholdExact() {
+  static uint8_t gray[W * H], mono[W * H / 8];
+  for (int i = 0; i < W * H; i++) gray[i] = (uint8_t)(i * 37);
+  const uint8_t thresholds[] = {0, 90, 128, 254};
+  for (uint8_t t : thresholds) {
+    CHECK(ditherImage(DITHER_THRESHOLD, gray, mono, W, H, t));
+    int bad = 0;
+    for (int i = 0; i < W * H; i++) {
+      bad += (int)((mono[i / 8] >> (i & 7)) & 1) != (gray[i] > t);
+    }
+    CHECK_EQ(bad, 0);
+  }
+  // 有序抖动的阈值中点平移：提高阈值点亮更少
+  memset(gray, 128, sizeof(gray));
+  CHECK(ditherImage(DITHER_BAYER8, gray, mono, W, H, 96));
+  int low = countOn(mono, W, H);
+  CHECK(ditherImage(DITHER_BAYER8, gray, mono, W, H, 160));
+  CHECK(countOn(mono, W, H) < low);
+}
+
+// 宽13：每行2字节，第二字节只有低5位可能为1；逐行接口与整幅接口一致
+static void checkOddWidthAndRows() {
+  const uint16_t width = 13, height = 9;
+  uint8_t gray[width * height];
+  for (int i = 0; i < width * height; i++) gray[i] = (uint8_t)(i * 11 + 40);
+  for (int mode = 0; mode < DITHER_MODE_COUNT; mode++) {
+    uint8_t whole[2 * height], rows[2 * height];
+    memset(whole, 0xFF, sizeof(whole));
+    CHECK(ditherImage((DitherMode)mode, gray, whole, width, height, 128));
+    static Ditherer d;
+    CHECK(ditherBegin(&d, (DitherMode)mode, width, 128));
+    for (int y = 0; y < height; y++) ditherRow(&d, gray + y * width, rows + y * 2);
+    CHECK(memcmp(whole, rows, sizeof(whole)) == 0);
+    for (int y = 0; y < height; y++) CHECK_EQ(whole[y * 2 + 1] & 0xE0, 0);
+  }
+  static Ditherer d;
+  CHECK(!ditherBegin(&d, DITHER_FLOYD_STEINBERG, DITHER_MAX_WIDTH + 1, 128));
+  CHECK(!ditherBegin(&d, DITHER_MODE_COUNT, 8, 128));
+}
+
+static void benchmark() {
+  static uint8_t gray[W * H], mono[W * H / 8];
+  for (int y = 0; y < H; y++) {
+    for (int x = 0; x < W; x++) gray[y * W + x] = (uint8_t)((x * 2 + (y & 4) * 8) & 0xFF);
+  }
+  const int runs = 5000;
+  for (int mode = 0; mode < DITHER_MODE_COUNT; mode++) {
+    uint64_t start = hostMicros();
+    for (int i = 0; i < runs; i++) ditherImage((DitherMode)mode, gray, mono, W, H, 128);
+    printf("%-16s %6.2f us/frame\n", ditherModeName((DitherMode)mode),
+           (double)(hostMicros() - start) / runs);
+  }
+}
+
+int main() {
+  checkCoverage();
+  checkThresholdExact();
+  checkOddWidthAndRows();
+  benchmark();
+  return hostTestResult("test_dither");
+}
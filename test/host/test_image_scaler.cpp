@@ -0,0 +1,160 @@
+// 区域平均缩放器：与双精度面积加权平均比较（定点倒数的舍入误差不超过约半级），
+// 常数图缩放后不变，YUYV步长2与抽出的亮度平面结果相同，stride之外的像素不被写入，
+// 放大和超宽目标被AreaScaler拒绝，scaleGrayscaleImage对它们改用最近邻（每个目标像素等于其中心所在的源像素），
+// 尺寸为0时返回false且不写入；打印各尺寸的缩放耗时。
+
+#include "host_test.h"
+#include "image_scaler.h"
+#include <math.h>
+#include <stdlib.h>
+
+struct ScaleCase {
+  uint16_t srcWidth, srcHeight, dstWidth, dstHeight;
+};
+
+static const ScaleCase cases[] = {
+  {160, 120, 42, 32}, {160, 120, 128, 32}, {320, 240, 128, 32}, {640, 480, 42, 32},
+  {7, 5, 3, 2}, {100, 100, 100, 100}, {1, 1, 1, 1}, {129, 31, 128, 31}, {96, 96, 9, 8},
+};
+
+static double referencePixel(const std::vector<uint8_t>& src, const ScaleCase& c, int dx, int dy) {
+  double x0 = (double)dx * c.srcWidth / c.dstWidth, x1 = (double)(dx + 1) * c.srcWidth / c.dstWidth;
+  double y0 = (double)dy * c.srcHeight / c.dstHeight, y1 = (double)(dy + 1) * c.srcHeight / c.dstHeight;
+  double sum = 0, weight = 0;
+  for (int y = (int)y0; y < ceil(y1); y++) {
+    for (int x = (int)x0; x < ceil(x1); x++) {
+      double wx = fmin(x + 1, x1) - fmax(x, x0);
+      double wy = fmin(y + 1, y1) - fmax(y, y0);
+      if (wx <= 0 || wy <= 0) continue;
+      sum += src[y * c.srcWidth + x] * wx * wy;
+      weight += wx * wy;
+    }
+  }
+  return sum / weight;
+}
+
+static void checkCase(const ScaleCase& c) {
+  std::vector<uint8_t> src((size_t)c.srcWidth * c.srcHeight);
+  std::vector<uint8_t> dst((size_t)c.dstWidth * c.dstHeight);
+  srand(c.srcWidth * 31 + c.dstWidth);
+  for (uint8_t& v : src) v = (uint8_t)(rand() & 0xFF);
+
+  scaleGrayscaleImage(src.data(), c.srcWidth, c.srcHeight, dst.data(), c.dstWidth, c.dstHeight);
+  double maxError = 0;
+  for (int y = 0; y < c.dstHeight; y++) {
+    for (int x = 0; x < c.dstWidth; x++) {
+      double e = fabs(referencePixel(src, c, x, y) - dst[y * c.dstWidth + x]);
+      if (e > maxError) maxError = e;
+    }
+  }
+  if (maxError > 0.52) {
+    fprintf(stderr, "%ux%u -> %ux%u: max error %.3f\n", c.srcWidth, c.srcHeight, c.dstWidth, c.dstHeight, maxError);
+    hostFailures++;
+  }
+
+  // YUYV：亮度在偶数字节，色度不能混入
+  std::vector<uint8_t> yuyv(src.size() * 2);
+  for (size_t i = 0; i < src.size(); i++) {
+    yuyv[i * 2] = src[i];
+    yuyv[i * 2 + 1] = (uint8_t)(i & 1 ? 0xFF : 0x00);
+  }
+  // 写入更大的缓冲区（stride = dstWidth + 3），检查行间隙不被覆盖
+  uint16_t stride = c.dstWidth + 3;
+  std::vector<uint8_t> strided((size_t)stride * c.dstHeight, 0xA5);
+  static AreaScaler scaler;
+  CHECK(areaScalerBegin(&scaler, c.srcWidth, c.srcHeight, strided.data(), c.dstWidth, c.dstHeight, stride));
+  for (int y = 0; y < c.srcHeight; y++) {
+    areaScalerPushRow(&scaler, yuyv.data() + (size_t)y * c.srcWidth * 2, 2);
+  }
+  int mismatches = 0, overwritten = 0;
+  for (int y = 0; y < c.dstHeight; y++) {
+    for (int x = 0; x < stride; x++) {
+      uint8_t v = strided[y * stride + x];
+      if (x < c.dstWidth && v != dst[y * c.dstWidth + x]) mismatches++;
+      if (x >= c.dstWidth && v != 0xA5) overwritten++;
+    }
+  }
+  CHECK_EQ(mismatches, 0);
+  CHECK_EQ(overwritten, 0);
+
+  // 常数图保持不变（倒数舍入不能让255溢出或让中间值偏移）
+  const uint8_t levels[] = {0, 77, 255};
+  for (uint8_t level : levels) {
+    std::fill(src.begin(), src.end(), level);
+    scaleGrayscaleImage(src.data(), c.srcWidth, c.srcHeight, dst.data(), c.dstWidth, c.dstHeight);
+    int bad = 0;
+    for (uint8_t v : dst) bad += v != level;
+    CHECK_EQ(bad, 0);
+  }
+
+  const int runs = 200;
+  uint64_t start = hostMicros();
+  for (int i = 0; i < runs; i++) {
+    scaleGrayscaleImage(src.data(), c.srcWidth, c.srcHeight, dst.data(), c.dstWidth, c.dstHeight);
+  }
+  double us = (double)(hostMicros() - start) / runs;
+  printf("%4ux%-4u -> %3ux%-3u  max error %.3f  %8.1f us\n", c.srcWidth, c.srcHeight,
+         c.dstWidth, c.dstHeight, maxError, us);
+}
+
+// 最近邻参考：目标像素中心映射回源图
+static uint8_t nearestPixel(const std::vector<uint8_t>& src, const ScaleCase& c, int dx, int dy) {
+  int sx = (int)floor((dx + 0.5) * c.srcWidth / c.dstWidth);
+  int sy = (int)floor((dy + 0.5) * c.srcHeight / c.dstHeight);
+  return src[sy * c.srcWidth + sx];
+}
+
+static void checkNearestFallback() {
+  const ScaleCase fallback[] = {
+    {40, 30, 80, 30}, {40, 30, 40, 60}, {3, 2, 128, 32}, {1, 1, 5, 4}, {64, 8, 128, 32},
+    {160, 4, 42, 32},                                        // 宽度缩小、高度放大
+    {640, 2, AREA_SCALER_MAX_WIDTH + 32, 1},                 // 超过区域平均的最大宽度
+  };
+  for (const ScaleCase& c : fallback) {
+    std::vector<uint8_t> src((size_t)c.srcWidth * c.srcHeight);
+    srand(c.srcWidth * 17 + c.dstHeight);
+    for (uint8_t& v : src) v = (uint8_t)(rand() & 0xFF);
+    std::vector<uint8_t> dst((size_t)c.dstWidth * c.dstHeight + 1, 0xA5);
+    CHECK(scaleGrayscaleImage(src.data(), c.srcWidth, c.srcHeight, dst.data(), c.dstWidth, c.dstHeight));
+    int mismatches = 0;
+    for (int y = 0; y < c.dstHeight; y++) {
+      for (int x = 0; x < c.dstWidth; x++) mismatches += dst[y * c.dstWidth + x] != nearestPixel(src, c, x, y);
+    }
+    if (mismatches) {
+      fprintf(stderr, "%ux%u -> %ux%u: %d pixels differ from nearest neighbour\n",
+              c.srcWidth, c.srcHeight, c.dstWidth, c.dstHeight, mismatches);
+      hostFailures++;
+    }
+    CHECK_EQ(dst.back(), 0xA5);
+  }
+
+  // 整数倍放大：每个源像素正好复制成k x k块
+  const uint8_t src[] = {10, 20, 30, 40, 50, 60};
+  uint8_t dst[9 * 4];
+  CHECK(scaleGrayscaleImage(src, 3, 2, dst, 9, 4));
+  const uint8_t expected[] = {
+    10, 10, 10, 20, 20, 20, 30, 30, 30,
+    10, 10, 10, 20, 20, 20, 30, 30, 30,
+    40, 40, 40, 50, 50, 50, 60, 60, 60,
+    40, 40, 40, 50, 50, 50, 60, 60, 60,
+  };
+  CHECK(memcmp(dst, expected, sizeof(dst)) == 0);
+
+  // 尺寸为0：不写入
+  memset(dst, 0xA5, sizeof(dst));
+  CHECK(!scaleGrayscaleImage(src, 3, 2, dst, 0, 4));
+  CHECK(!scaleGrayscaleImage(src, 0, 2, dst, 9, 4));
+  CHECK_EQ(dst[0], 0xA5);
+}
+
+int main() {
+  for (const ScaleCase& c : cases) checkCase(c);
+
+  static AreaScaler scaler;
+  uint8_t dst[AREA_SCALER_MAX_WIDTH * 2];
+  CHECK(!areaScalerBegin(&scaler, 40, 30, dst, 80, 30, 80));   // 不支持放大
+  CHECK(!areaScalerBegin(&scaler, 40, 30, dst, 40, 60, 40));
+  CHECK(!areaScalerBegin(&scaler, 640, 2, dst, AREA_SCALER_MAX_WIDTH + 1, 1, AREA_SCALER_MAX_WIDTH + 1));
+  checkNearestFallback();
+  return hostTestResult("test_image_scaler");
+}
@@ -0,0 +1,165 @@
+// JPEG亮度解码器：与libjpeg生成的参考图（data/ref/，见make_jpeg_refs.cpp）比较。
+// 语料覆盖4:2:0、4:2:2、4:4:4、灰度和带重启标记的文件；完整IDCT与libjpeg ISLOW
+// 的差异不超过1级，1/8缩放（只取DC）必须完全一致。另外检查截断/损坏输入只返回失败、
+// MCU裁剪结果解码后与原图对应区域一致，并打印每个文件两种缩放的解码耗时。
+
+#include "host_test.h"
+#include "jpeg_decoder.h"
+#include <stdlib.h>
+
+static const char* corpus[] = {
+  "img_100x75_420", "img_100x75_422", "img_100x75_444", "img_100x75_gray", "img_100x75_rst",
+  "img_160x120_420", "img_160x120_422", "img_160x120_444", "img_160x120_gray", "img_160x120_rst",
+};
+
+struct Image {
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> pixels;
+  bool rowOrderOk = true;
+};
+
+static void onRow(const uint8_t* row, uint16_t width, uint16_t y, void* ctx) {
+  Image* img = (Image*)ctx;
+  if (img->height == 0) img->width = width;
+  if (y != img->height || width != img->width) img->rowOrderOk = false;
+  img->pixels.insert(img->pixels.end(), row, row + width);
+  img->height++;
+}
+
+static void ignoreRow(const uint8_t*, uint16_t, uint16_t, void*) {}
+
+static bool readPgm(const std::string& path, Image* img) {
+  std::vector<uint8_t> data;
+  if (!hostReadFile(path, &data)) return false;
+  int maxval = 0, offset = 0;
+  if (sscanf((const char*)data.data(), "P5 %d %d %d%n", &img->width, &img->height, &maxval, &offset) != 3) {
+    return false;
+  }
+  offset++;  // 头部后的单个空白
+  img->pixels.assign(data.begin() + offset, data.end());
+  return img->pixels.size() == (size_t)img->width * img->height;
+}
+
+static void compareToReference(const char* name, const std::vector<uint8_t>& jpeg, JpegScale scale) {
+  Image ref;
+  std::string refPath = hostPath("data/ref/") + name + (scale == JPEG_SCALE_1_8 ? "_1_8.pgm" : "_1_1.pgm");
+  if (!readPgm(refPath, &ref)) {
+    fprintf(stderr, "missing reference %s\n", refPath.c_str());
+    hostFailures++;
+    return;
+  }
+
+  Image out;
+  CHECK(jpegDecodeLuma(jpeg.data(), jpeg.size(), scale, onRow, &out));
+  CHECK(out.rowOrderOk);
+  CHECK_EQ(out.width, ref.width);
+  CHECK_EQ(out.height, ref.height);
+  if (out.pixels.size() != ref.pixels.size()) return;
+
+  int maxDiff = 0;
+  for (size_t i = 0; i < out.pixels.size(); i++) {
+    int d = abs(out.pixels[i] - ref.pixels[i]);
+    if (d > maxDiff) maxDiff = d;
+  }
+  int allowed = scale == JPEG_SCALE_1_8 ? 0 : 1;
+  if (maxDiff > allowed) {
+    fprintf(stderr, "%s scale 1/%d: max diff %d (allowed %d)\n", name, 1 << scale, maxDiff, allowed);
+    hostFailures++;
+  }
+}
+
+// 每个截断长度和若干字节翻转都不能越界或卡死，只允许返回失败或解出尺寸正确的图
+static void checkCorruptInput(const std::vector<uint8_t>& jpeg) {
+  for (size_t len = 0; len < jpeg.size(); len += len < 700 ? 1 : 97) {
+    std::vector<uint8_t> truncated(jpeg.begin(), jpeg.begin() + len);
+    jpegDecodeLuma(truncated.data(), truncated.size(), JPEG_SCALE_1_1, ignoreRow, NULL);
+    jpegDecodeLuma(truncated.data(), truncated.size(), JPEG_SCALE_1_8, ignoreRow, NULL);
+  }
+  uint32_t seed = 7;
+  for (int n = 0; n < 300; n++) {
+    std::vector<uint8_t> corrupt = jpeg;
+    seed = seed * 1664525u + 1013904223u;
+    corrupt[(seed >> 8) % corrupt.size()] ^= (uint8_t)(1 << (seed >> 28 & 7));
+    jpegDecodeLuma(corrupt.data(), corrupt.size(), JPEG_SCALE_1_1, ignoreRow, NULL);
+  }
+}
+
+// 裁剪后的文件独立解码，应与原图完整解码的对应区域逐像素相同（系数未改动）
+static void checkCrop(const char* name, const std::vector<uint8_t>& jpeg) {
+  Image full;
+  CHECK(jpegDecodeLuma(jpeg.data(), jpeg.size(), JPEG_SCALE_1_1, onRow, &full));
+  JpegRect rect = {(uint16_t)(full.width / 3), (uint16_t)(full.height / 4),
+                   (uint16_t)(full.width / 2), (uint16_t)(full.height / 2)};
+  std::vector<uint8_t> out(jpeg.size());
+  size_t outLen = 0;
+  if (!jpegCropMcu(jpeg.data(), jpeg.size(), &rect, out.data(), out.size(), &outLen)) {
+    fprintf(stderr, "%s: crop failed\n", name);
+    hostFailures++;
+    return;
+  }
+  Image crop;
+  CHECK(jpegDecodeLuma(out.data(), outLen, JPEG_SCALE_1_1, onRow, &crop));
+  CHECK_EQ(crop.width, rect.width);
+  CHECK_EQ(crop.height, rect.height);
+  if (crop.width != rect.width || crop.height != rect.height) return;
+  int mismatches = 0;
+  for (int y = 0; y < crop.height; y++) {
+    for (int x = 0; x < crop.width; x++) {
+      if (crop.pixels[y * crop.width + x] != full.pixels[(rect.y + y) * full.width + rect.x + x]) mismatches++;
+    }
+  }
+  if (mismatches) {
+    fprintf(stderr, "%s: %d cropped pixels differ from the full decode\n", name, mismatches);
+    hostFailures++;
+  }
+}
+
+static void timeDecode(const char* name, const std::vector<uint8_t>& jpeg, const JpegInfo& info) {
+  const int runs = 100;
+  uint64_t us[2];
+  const JpegScale scales[] = {JPEG_SCALE_1_1, JPEG_SCALE_1_8};
+  for (int s = 0; s < 2; s++) {
+    uint64_t start = hostMicros();
+    for (int i = 0; i < runs; i++) jpegDecodeLuma(jpeg.data(), jpeg.size(), scales[s], ignoreRow, NULL);
+    us[s] = (hostMicros() - start) / runs;
+  }
+  printf("%-18s %4ux%-4u mcu %2ux%-2u %6zu bytes  full %5llu us  DC %5llu us\n", name,
+         (unsigned)info.width, (unsigned)info.height, (unsigned)info.mcuWidth, (unsigned)info.mcuHeight,
+         jpeg.size(), (unsigned long long)us[0], (unsigned long long)us[1]);
+}
+
+int main() {
+  for (const char* name : corpus) {
+    std::vector<uint8_t> jpeg;
+    if (!hostReadFile(hostPath("data/") + name + ".jpg", &jpeg)) {
+      fprintf(stderr, "missing %s.jpg\n", name);
+      hostFailures++;
+      continue;
+    }
+    JpegInfo info;
+    CHECK(jpegGetInfo(jpeg.data(), jpeg.size(), &info));
+    compareToReference(name, jpeg, JPEG_SCALE_1_1);
+    compareToReference(name, jpeg, JPEG_SCALE_1_8);
+    checkCrop(name, jpeg);
+    checkCorruptInput(jpeg);
+    timeDecode(name, jpeg, info);
+  }
+
+  std::vector<uint8_t> vga;
+  if (hostReadFile(hostPath("data/img_640x480_420.jpg"), &vga)) {
+    JpegInfo info;
+    CHECK(jpegGetInfo(vga.data(), vga.size(), &info));
+    // 预览只需42x32，VGA源图应选DC解码；目标比1/8结果大时退回完整IDCT
+    CHECK_EQ(jpegPickScale(info, 42, 32), JPEG_SCALE_1_8);
+    CHECK_EQ(jpegPickScale(info, 128, 96), JPEG_SCALE_1_1);
+    checkCrop("img_640x480_420", vga);
+    timeDecode("img_640x480_420", vga, info);
+  }
+
+  const uint8_t notJpeg[] = {0x89, 'P', 'N', 'G', 0, 0, 0, 0};
+  JpegInfo info;
+  CHECK(!jpegGetInfo(notJpeg, sizeof(notJpeg), &info));
+  CHECK(!jpegDecodeLuma(notJpeg, sizeof(notJpeg), JPEG_SCALE_1_1, ignoreRow, NULL));
+  return hostTestResult("test_jpeg_decoder");
+}
@@ -0,0 +1,184 @@
+// 自适应画质控制：上行速率的滑动平均和目标字节数（Base64的3/4、上下限）；没有发出数据的上传不更新；
+// 按帧大小与目标之比的质量步长和边界（125%、70%）；质量到上限后降分辨率、到下限后升分辨率并退回中间质量；
+// 两次分辨率切换之间的最少帧数；初始化时质量和分辨率级别的截断。
+
+#include "host_test.h"
+#include "quality_controller.h"
+
+static const uint32_t BUDGET_MS = 500;
+static const uint8_t LEVELS = 4;
+
+static QualityController makeController(uint8_t quality, uint8_t sizeLevel) {
+  QualityControllerConfig config;
+  qualityControllerDefaultConfig(&config, BUDGET_MS, LEVELS);
+  QualityController qc;
+  qualityControllerInit(&qc, &config, quality, sizeLevel);
+  return qc;
+}
+
+// 帧大小为目标的percent%（向上取整，整数比值恰好等于percent）
+static size_t frameAt(const QualityController& qc, uint32_t percent) {
+  return ((size_t)qc.targetBytes * percent + 99) / 100;
+}
+
+static void checkInit() {
+  QualityController qc = makeController(5, 9);
+  CHECK_EQ(qc.quality, 10);
+  CHECK_EQ(qc.sizeLevel, LEVELS - 1);
+  CHECK_EQ(qc.targetBytes, 30 * 1024);
+  CHECK_EQ(qc.throughput, 0);
+  qc = makeController(50, 1);
+  CHECK_EQ(qc.quality, 40);
+  CHECK_EQ(qc.sizeLevel, 1);
+}
+
+static void checkThroughput() {
+  QualityController qc = makeController(20, 2);
+
+  // 没有发出数据或耗时为0：不更新
+  qualityControllerReportUpload(&qc, 0, 120);
+  qualityControllerReportUpload(&qc, 5000, 0);
+  CHECK_EQ(qc.throughput, 0);
+  CHECK_EQ(qc.targetBytes, 30 * 1024);
+
+  // 100 KB/s x 500 ms x 3/4
+  qualityControllerReportUpload(&qc, 100000, 1000);
+  CHECK_EQ(qc.throughput, 100000);
+  CHECK_EQ(qc.targetBytes, 37500);
+
+  // 滑动平均：(3 x 100000 + 20000) / 4
+  qualityControllerReportUpload(&qc, 20000, 1000);
+  CHECK_EQ(qc.throughput, 80000);
+  CHECK_EQ(qc.targetBytes, 30000);
+
+  // 目标截断到8KB~60KB
+  QualityController slow = makeController(20, 2);
+  qualityControllerReportUpload(&slow, 1000, 1000);
+  CHECK_EQ(slow.targetBytes, 8 * 1024);
+  QualityController fast = makeController(20, 2);
+  qualityControllerReportUpload(&fast, 10000000, 1000);
+  CHECK_EQ(fast.targetBytes, 60 * 1024);
+}
+
+static void checkQualitySteps() {
+  struct Step {
+    uint32_t percent;
+    int delta;
+  };
+  const Step steps[] = {
+    {210, 6}, {201, 6}, {160, 4}, {151, 4}, {130, 2}, {126, 2},
+    {125, 0}, {100, 0}, {70, 0},
+    {69, -2}, {40, -2}, {39, -4}, {10, -4},
+  };
+  for (const Step& step : steps) {
+    QualityController qc = makeController(25, 1);
+    bool changed = qualityControllerUpdate(&qc, frameAt(qc, step.percent));
+    CHECK_EQ(qc.quality - 25, step.delta);
+    CHECK_EQ(changed, step.delta != 0);
+    CHECK_EQ(qc.sizeLevel, 1);
+    CHECK_EQ(qc.qualityChanges, step.delta != 0 ? 1 : 0);
+    CHECK_EQ(qc.frames, 1);
+    CHECK_EQ(qc.lastFrameBytes, frameAt(qc, step.percent));
+  }
+
+  // 步长不越过质量上下限
+  QualityController qc = makeController(37, 1);
+  qualityControllerUpdate(&qc, frameAt(qc, 300));
+  CHECK_EQ(qc.quality, 40);
+  qc = makeController(12, 1);
+  qualityControllerUpdate(&qc, frameAt(qc, 10));
+  CHECK_EQ(qc.quality, 10);
+}
+
+static void checkSizeSteps() {
+  // 质量已到上限：降一级分辨率，质量不变
+  QualityController qc = makeController(40, 3);
+  CHECK(qualityControllerUpdate(&qc, frameAt(qc, 300)));
+  CHECK_EQ(qc.sizeLevel, 2);
+  CHECK_EQ(qc.quality, 40);
+  CHECK_EQ(qc.sizeChanges, 1);
+  CHECK_EQ(qc.qualityChanges, 0);
+
+  // 最低一级不能再降
+  qc = makeController(40, 0);
+  CHECK(!qualityControllerUpdate(&qc, frameAt(qc, 300)));
+  CHECK_EQ(qc.sizeLevel, 0);
+
+  // 质量已到下限：升一级分辨率，质量退回中间值
+  qc = makeController(10, 1);
+  CHECK(qualityControllerUpdate(&qc, frameAt(qc, 30)));
+  CHECK_EQ(qc.sizeLevel, 2);
+  CHECK_EQ(qc.quality, 25);
+  CHECK_EQ(qc.sizeChanges, 1);
+  CHECK_EQ(qc.qualityChanges, 1);
+
+  // 最高一级不能再升
+  qc = makeController(10, LEVELS - 1);
+  CHECK(!qualityControllerUpdate(&qc, frameAt(qc, 30)));
+  CHECK_EQ(qc.sizeLevel, LEVELS - 1);
+  CHECK_EQ(qc.quality, 10);
+}
+
+// 分辨率切换后至少sizeChangeInterval帧才能再切换
+static void checkSizeChangeInterval() {
+  QualityController qc = makeController(40, 3);
+  uint8_t interval = qc.config.sizeChangeInterval;
+  CHECK_EQ(interval, 5);
+  CHECK(qualityControllerUpdate(&qc, frameAt(qc, 300)));
+  CHECK_EQ(qc.sizeLevel, 2);
+
+  for (uint8_t i = 1; i < interval; i++) {
+    CHECK(!qualityControllerUpdate(&qc, frameAt(qc, 300)));
+    CHECK_EQ(qc.sizeLevel, 2);
+  }
+  CHECK(qualityControllerUpdate(&qc, frameAt(qc, 300)));
+  CHECK_EQ(qc.sizeLevel, 1);
+  CHECK_EQ(qc.sizeChanges, 2);
+  CHECK_EQ(qc.frames, interval + 1);
+
+  // 升分辨率后质量回到中间值，质量调整不受间隔限制，再到下限时仍要等满间隔
+  qc = makeController(10, 0);
+  CHECK(qualityControllerUpdate(&qc, frameAt(qc, 30)));
+  CHECK_EQ(qc.sizeLevel, 1);
+  int frames = 1;
+  while (qc.quality > 10) {
+    CHECK(qualityControllerUpdate(&qc, frameAt(qc, 30)));
+    CHECK_EQ(qc.sizeLevel, 1);
+    frames++;
+  }
+  while (qc.sizeLevel == 1 && frames < 20) {
+    qualityControllerUpdate(&qc, frameAt(qc, 30));
+    frames++;
+  }
+  CHECK_EQ(qc.sizeLevel, 2);
+  CHECK_EQ(frames, 1 + interval);
+}
+
+// 闭环：帧大小随质量近似线性变化，收敛到目标的70%~125%之内后不再调整
+static void checkConvergence() {
+  QualityController qc = makeController(10, 3);
+  qualityControllerReportUpload(&qc, 20000, 1000);     // 目标约7.5KB，截断到8KB
+  CHECK_EQ(qc.targetBytes, 8 * 1024);
+  int changes = 0;
+  for (int i = 0; i < 60; i++) {
+    // 最高一级质量10约60KB，每降一级分辨率减半，质量每加1约减2%
+    size_t bytes = (size_t)(60000.0 / (1 << (3 - qc.sizeLevel)) * (1.0 - (qc.quality - 10) * 0.02));
+    if (qualityControllerUpdate(&qc, bytes)) changes++;
+  }
+  uint32_t ratio = qc.lastFrameBytes * 100 / qc.targetBytes;
+  CHECK(ratio >= 70 && ratio <= 125);
+  CHECK(qc.sizeLevel < 3);
+  CHECK(changes > 0 && changes < 30);
+  printf("converged: level %d quality %d, frame %lu bytes, target %lu, %d changes\n", qc.sizeLevel,
+         qc.quality, (unsigned long)qc.lastFrameBytes, (unsigned long)qc.targetBytes, changes);
+}
+
+int main() {
+  checkInit();
+  checkThroughput();
+  checkQualitySteps();
+  checkSizeSteps();
+  checkSizeChangeInterval();
+  checkConvergence();
+  return hostTestResult("test_quality_controller");
+}
@@ -0,0 +1,233 @@
+// 接口限流：用模拟时钟对一个429替身服务器（按60秒滑动窗口统计账户的请求数和token数，
+// 超出时返回429和Retry-After）跑多个工作任务，客户端流程与ai_vision.cpp的postVisionBody/
+// settleQuota相同：按估计预扣、429时退回预扣并暂停全部请求后退避重试、完成后按实际用量校正。
+//   不限流：会收到429，靠Retry-After暂停和重试全部完成；
+//   限流设为账户配额：桶容量（10秒的配额）叠加在整分钟的速率上，窗口边缘仍有少量429；
+//   限流设为配额的5/6（请求数或token数）：不再收到429，吞吐仍在配额的80%以上；
+//   流式响应带用量（include_usage）时估计收敛到实际用量，没有用量时按估计结算、估计不变。
+// 另有令牌桶、暂停、退避和结算的单元检查。
+
+#include "host_test.h"
+#include "rate_limiter.h"
+#include <stdlib.h>
+#include <deque>
+
+#define RETRY_MAX_ATTEMPTS 3     // 与ai_vision.cpp相同
+#define RETRY_BASE_MS      1000
+#define RETRY_MAX_MS       30000
+#define SERVICE_MS         2000  // 一次请求的往返时间
+#define STEP_MS            10
+
+struct Charge {
+  uint32_t ms;
+  uint32_t tokens;
+};
+
+// 429替身：账户配额为每分钟requests次、tokens个token（0为不限）
+struct QuotaServer {
+  uint32_t requestsPerMinute;
+  uint32_t tokensPerMinute;
+  std::deque<Charge> window;
+  uint32_t accepted = 0;
+  uint32_t rejected = 0;
+
+  // 接受时返回true；拒绝时*retryAfterS为窗口中最早的请求滑出所需的秒数
+  bool handle(uint32_t nowMs, uint32_t tokens, uint32_t* retryAfterS) {
+    while (!window.empty() && nowMs - window.front().ms >= 60000) window.pop_front();
+    uint32_t used = 0;
+    for (const Charge& c : window) used += c.tokens;
+    bool overRequests = requestsPerMinute && window.size() >= requestsPerMinute;
+    bool overTokens = tokensPerMinute && used + tokens > tokensPerMinute;
+    if (overRequests || overTokens) {
+      rejected++;
+      uint32_t waitMs = window.empty() ? 1000 : 60000 - (nowMs - window.front().ms);
+      *retryAfterS = (waitMs + 999) / 1000;
+      return false;
+    }
+    window.push_back({nowMs, tokens});
+    accepted++;
+    return true;
+  }
+};
+
+struct Scenario {
+  const char* name;
+  uint32_t limiterRequests;   // 客户端配置的限流，0为不限
+  uint32_t limiterTokens;
+  bool reportUsage;           // 响应带用量（非流式，或流式请求了include_usage）
+};
+
+struct Outcome {
+  uint32_t done = 0;
+  uint32_t failed = 0;
+  uint32_t throttled = 0;
+  uint32_t finishedMs = 0;
+  uint32_t estimate = 0;
+  uint64_t tokens = 0;
+};
+
+struct Worker {
+  uint32_t readyAt = 0;
+  uint32_t busyUntil = 0;     // 请求进行中
+  bool hasRequest = false;
+  uint8_t retry = 0;
+  uint32_t reserved = 0;
+  uint32_t tokens = 0;        // 本次请求的实际用量
+};
+
+static Outcome simulate(const Scenario& s, QuotaServer* server, uint32_t requests, int workers) {
+  RateLimiter limiter;
+  rateLimiterInit(&limiter, s.limiterRequests, s.limiterTokens, 0);
+  uint32_t estimate = 1200;   // DEFAULT_REQUEST_TOKENS
+  std::vector<Worker> pool(workers);
+  uint32_t pending = requests;
+  Outcome out;
+  srand(22);
+
+  uint32_t now = 0;
+  for (; now < 3600000 && out.done + out.failed < requests; now += STEP_MS) {
+    for (Worker& w : pool) {
+      if (w.busyUntil) {
+        if (now < w.busyUntil) continue;
+        // 请求完成：按实际用量校正（没有用量时按估计结算，估计不变）
+        w.busyUntil = 0;
+        uint32_t used = s.reportUsage ? w.tokens : w.reserved;
+        rateLimiterSettle(&limiter, now, w.reserved, used);
+        if (s.reportUsage) estimate = (estimate * 3 + used) / 4;
+        out.done++;
+        out.tokens += w.tokens;
+        w.hasRequest = false;
+      }
+      if (now < w.readyAt) continue;
+      if (!w.hasRequest) {
+        if (pending == 0) continue;
+        pending--;
+        w.hasRequest = true;
+        w.retry = 0;
+        w.tokens = 900 + rand() % 700;   // 实际用量900~1600，平均约1250
+      }
+
+      uint32_t wait = rateLimiterAcquire(&limiter, now, estimate);
+      if (wait) {
+        w.readyAt = now + (wait > 1000 ? 1000 : wait);   // QUOTA_POLL_MS
+        continue;
+      }
+      w.reserved = estimate;
+
+      uint32_t retryAfterS = 0;
+      if (server->handle(now, w.tokens, &retryAfterS)) {
+        w.busyUntil = now + SERVICE_MS;
+        continue;
+      }
+      // 429：被拒绝的请求没有消耗token，退回预扣后全部暂停
+      out.throttled++;
+      if (w.retry >= RETRY_MAX_ATTEMPTS) {
+        rateLimiterSettle(&limiter, now, w.reserved, 0);
+        out.failed++;
+        w.hasRequest = false;
+        continue;
+      }
+      uint32_t pause = retryBackoffMs(w.retry, retryAfterS * 1000, RETRY_BASE_MS, RETRY_MAX_MS, (uint32_t)rand());
+      rateLimiterSettle(&limiter, now, w.reserved, 0);
+      rateLimiterPause(&limiter, now, pause);
+      limiter.stats.retries++;
+      w.retry++;
+      w.readyAt = now + pause;
+    }
+  }
+  out.finishedMs = now;
+  out.estimate = estimate;
+  printf("%-33s %3u done, %u failed, %3u x 429, %u retries, %5.1f s, %.0f req/min, %.0f tokens/min, "
+         "estimate %u\n", s.name, out.done, out.failed, out.throttled, limiter.stats.retries, now / 1000.0,
+         out.done * 60000.0 / now, out.tokens * 60000.0 / now, estimate);
+  return out;
+}
+
+static void checkSimulations() {
+  // 请求数是瓶颈：每分钟30次，8个工作任务足以超出
+  const uint32_t requests = 120;
+  Outcome noLimit[2], atQuota[2], belowQuota[2];
+  {
+    QuotaServer server = {30, 0, {}};
+    noLimit[0] = simulate({"30 rpm quota, no limiter", 0, 0, true}, &server, requests, 8);
+  }
+  {
+    QuotaServer server = {30, 0, {}};
+    atQuota[0] = simulate({"30 rpm quota, limiter 30", 30, 0, true}, &server, requests, 8);
+  }
+  {
+    QuotaServer server = {30, 0, {}};
+    belowQuota[0] = simulate({"30 rpm quota, limiter 25", 25, 0, true}, &server, requests, 8);
+  }
+  CHECK(belowQuota[0].done * 60000.0 / belowQuota[0].finishedMs > 30 * 0.8);
+
+  // token数是瓶颈：每分钟25000个，约20次请求
+  {
+    QuotaServer server = {0, 25000, {}};
+    noLimit[1] = simulate({"25k tpm quota, no limiter", 0, 0, true}, &server, 60, 8);
+  }
+  {
+    QuotaServer server = {0, 25000, {}};
+    atQuota[1] = simulate({"25k tpm quota, limiter 25k", 0, 25000, true}, &server, 60, 8);
+  }
+  {
+    QuotaServer server = {0, 25000, {}};
+    belowQuota[1] = simulate({"25k tpm quota, limiter 20833", 0, 20833, true}, &server, 60, 8);
+  }
+  CHECK(belowQuota[1].tokens * 60000.0 / belowQuota[1].finishedMs > 25000 * 0.8);
+  CHECK(belowQuota[1].estimate > 1150 && belowQuota[1].estimate < 1450);  // 实际平均约1250
+
+  for (int i = 0; i < 2; i++) {
+    uint32_t total = i == 0 ? requests : 60;
+    CHECK(noLimit[i].throttled > 0);
+    CHECK_EQ(noLimit[i].done, total);
+    CHECK_EQ(atQuota[i].done, total);
+    CHECK(atQuota[i].throttled <= 8);
+    CHECK_EQ(belowQuota[i].done, total);
+    CHECK_EQ(belowQuota[i].throttled, 0);
+  }
+
+  // 没有用量（服务器忽略include_usage）：按估计结算，估计停在默认值；实际用量偏高时偶有429
+  QuotaServer server = {0, 25000, {}};
+  Outcome noUsage = simulate({"25k tpm, limiter 20833, no usage", 0, 20833, false}, &server, 60, 8);
+  CHECK_EQ(noUsage.estimate, 1200);
+  CHECK_EQ(noUsage.done, 60);
+  CHECK(noUsage.throttled <= 4);
+}
+
+static void checkUnits() {
+  RateLimiter l;
+  // 每分钟60次：桶容量10次，之后每秒1次
+  rateLimiterInit(&l, 60, 0, 0);
+  for (int i = 0; i < 10; i++) CHECK_EQ(rateLimiterAcquire(&l, 0, 100), 0);
+  CHECK_EQ(rateLimiterAcquire(&l, 0, 100), 1000);
+  CHECK_EQ(rateLimiterAcquire(&l, 1000, 100), 0);
+
+  // 暂停期间全部等待，更短的暂停不会缩短已有的暂停
+  rateLimiterPause(&l, 1000, 5000);
+  rateLimiterPause(&l, 1000, 2000);
+  CHECK_EQ(rateLimiterAcquire(&l, 2000, 100), 4000);
+  CHECK_EQ(l.stats.throttled, 2);
+
+  // 结算：退回全部预扣后可立即再次放行；用量超出时欠额按速率还清
+  rateLimiterInit(&l, 0, 6000, 0);  // 桶容量1000
+  CHECK_EQ(rateLimiterAcquire(&l, 0, 1000), 0);
+  CHECK(rateLimiterAcquire(&l, 0, 1000) > 0);
+  rateLimiterSettle(&l, 0, 1000, 0);
+  CHECK_EQ(rateLimiterAcquire(&l, 0, 1000), 0);
+  rateLimiterSettle(&l, 0, 1000, 1500);   // 欠500
+  CHECK_EQ(rateLimiterAcquire(&l, 0, 1000), 15000);  // 1500 x 60000 / 6000
+
+  // 退避：有Retry-After时在其上加抖动，否则不超过min(base * 2^attempt, max)
+  CHECK_EQ(retryBackoffMs(0, 3000, 1000, 30000, 1234), 3234);
+  for (uint8_t attempt = 0; attempt < 40; attempt++) {
+    uint32_t ceiling = attempt < 5 ? 1000u << attempt : 30000;
+    CHECK(retryBackoffMs(attempt, 0, 1000, 30000, 0xFFFFFFFFu) <= ceiling);
+  }
+}
+
+int main() {
+  checkUnits();
+  checkSimulations();
+  return hostTestResult("test_rate_limiter");
+}
@@ -0,0 +1,84 @@
+// 请求队列：优先级和先进先出顺序、队列满时拒绝、合并请求的优先级和截止时间、
+// 过期取出，以及超时任务用的requestQueueNextDeadline（含millis()回绕）。
+
+#include "host_test.h"
+#include "request_queue.h"
+
+static void checkOrder() {
+  RequestQueue q;
+  requestQueueInit(&q, 4);
+  uint32_t ids[5];
+  CHECK(requestQueuePush(&q, 0, 0, 0, &ids[0]) >= 0);
+  CHECK(requestQueuePush(&q, 2, 1, 0, &ids[1]) >= 0);
+  CHECK(requestQueuePush(&q, 0, 2, 0, &ids[2]) >= 0);
+  CHECK(requestQueuePush(&q, 2, 3, 0, &ids[3]) >= 0);
+  CHECK_EQ(requestQueuePush(&q, 9, 4, 0, &ids[4]), -1);
+  CHECK_EQ(q.stats.rejected, 1);
+
+  uint32_t expected[] = {ids[1], ids[3], ids[0], ids[2]};
+  for (uint32_t id : expected) {
+    int slot = requestQueuePop(&q, 10);
+    CHECK(slot >= 0 && q.slots[slot].id == id);
+    requestQueueFinish(&q, slot, 20);
+  }
+  CHECK_EQ(requestQueuePop(&q, 30), -1);
+  CHECK_EQ(q.stats.served, 4);
+  CHECK_EQ(q.stats.depth, 0);
+}
+
+static void checkJoinAndExpiry() {
+  RequestQueue q;
+  requestQueueInit(&q, 4);
+  uint32_t a, b;
+  int slotA = requestQueuePush(&q, 0, 1000, 500, &a);
+  requestQueuePush(&q, 1, 1000, 0, &b);
+
+  // 合并取较高的优先级和较晚的截止时间
+  uint32_t joined = requestQueueJoin(&q, slotA, 5, 1100, 1000);
+  CHECK(joined != 0 && joined != a && joined != b);
+  CHECK_EQ(q.slots[slotA].priority, 5);
+  CHECK_EQ(q.slots[slotA].deadlineMs, 2100);
+
+  uint32_t waitMs = 0;
+  CHECK(requestQueueNextDeadline(&q, 1500, &waitMs));
+  CHECK_EQ(waitMs, 600);
+  CHECK_EQ(requestQueuePopExpired(&q, 2099), -1);
+  CHECK_EQ(requestQueuePopExpired(&q, 2100), slotA);
+  CHECK_EQ(q.stats.expired, 1);
+  CHECK(!requestQueueNextDeadline(&q, 2100, &waitMs));  // 剩下的请求不限时
+
+  // 处理中的请求不算截止时间
+  uint32_t c;
+  int slotC = requestQueuePush(&q, 9, 3000, 100, &c);
+  CHECK_EQ(requestQueuePop(&q, 3000), slotC);
+  CHECK(!requestQueueNextDeadline(&q, 3000, &waitMs));
+  CHECK_EQ(requestQueuePopExpired(&q, 9000), -1);
+}
+
+static void checkDeadlineWrap() {
+  RequestQueue q;
+  requestQueueInit(&q, 4);
+  uint32_t id;
+  uint32_t now = 0xFFFFFF00u;
+  requestQueuePush(&q, 0, now, 1000, &id);
+  requestQueuePush(&q, 0, now, 300, &id);
+  uint32_t waitMs = 0;
+  CHECK(requestQueueNextDeadline(&q, now, &waitMs));
+  CHECK_EQ(waitMs, 300);
+  CHECK(requestQueueNextDeadline(&q, now + 400, &waitMs));
+  CHECK_EQ(waitMs, 0);  // 已过期
+  CHECK(requestQueuePopExpired(&q, now + 400) >= 0);
+  CHECK(requestQueueNextDeadline(&q, now + 400, &waitMs));
+  CHECK_EQ(waitMs, 600);
+
+  // 取消后不再计入
+  CHECK(requestQueueCancel(&q, q.slots[0].state == REQUEST_SLOT_QUEUED ? q.slots[0].id : q.slots[1].id) >= 0);
+  CHECK(!requestQueueNextDeadline(&q, now + 400, &waitMs));
+}
+
+int main() {
+  checkOrder();
+  checkJoinAndExpiry();
+  checkDeadlineWrap();
+  return hostTestResult("test_request_queue");
+}
@@ -0,0 +1,171 @@
+// 场景变化检测：用默认参数重放data/scene/下录制的缩略图序列，放行的帧号必须与文件中
+// "# expect"行一致；另有与设备上benchmarkSceneGate相同的合成序列。打印每帧耗时。
+// 序列格式见camera.cpp的recordSceneSequence，设备上录的文件可以作为参数直接重放：
+//   ./_gate_build/test_scene_gate capture.seq
+
+#include "host_test.h"
+#include "scene_gate.h"
+#include <stdlib.h>
+
+#define THUMB_PIXELS (SCENE_THUMB_WIDTH * SCENE_THUMB_HEIGHT)
+
+static const char* recordings[] = {
+  "static_flicker", "slow_drift", "object_enter_leave", "pan_then_hold",
+};
+
+struct SceneFrame {
+  uint32_t timestampMs;
+  uint8_t thumb[THUMB_PIXELS];
+};
+
+struct Sequence {
+  std::vector<SceneFrame> frames;
+  std::vector<int> expected;
+  bool hasExpected = false;
+};
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// 串口录下的文件可能夹杂其他日志行，只认"SCENESEQ"之后的"F"和"# expect"行
+static bool loadSequence(const std::string& path, Sequence* seq) {
+  std::vector<uint8_t> data;
+  if (!hostReadFile(path, &data)) return false;
+  std::string text(data.begin(), data.end());
+  size_t pos = text.find("SCENESEQ 32 24");
+  if (pos == std::string::npos) return false;
+  while (pos < text.size()) {
+    size_t end = text.find('\n', pos);
+    if (end == std::string::npos) end = text.size();
+    std::string line = text.substr(pos, end - pos);
+    pos = end + 1;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+
+    if (line.compare(0, 9, "# expect ") == 0) {
+      seq->hasExpected = true;
+      const char* p = line.c_str() + 9;
+      char* next;
+      for (long v = strtol(p, &next, 10); next != p; v = strtol(p, &next, 10)) {
+        seq->expected.push_back((int)v);
+        p = next;
+      }
+    } else if (line.compare(0, 2, "F ") == 0) {
+      SceneFrame frame;
+      char* hex;
+      frame.timestampMs = (uint32_t)strtoul(line.c_str() + 2, &hex, 10);
+      while (*hex == ' ') hex++;
+      if (strlen(hex) != THUMB_PIXELS * 2) continue;  // 截断的行（串口丢字节）跳过
+      bool ok = true;
+      for (int i = 0; i < THUMB_PIXELS && ok; i++) {
+        int hi = hexValue(hex[i * 2]), lo = hexValue(hex[i * 2 + 1]);
+        ok = hi >= 0 && lo >= 0;
+        frame.thumb[i] = (uint8_t)(hi << 4 | lo);
+      }
+      if (ok) seq->frames.push_back(frame);
+    }
+  }
+  return !seq->frames.empty();
+}
+
+static std::vector<int> replay(const Sequence& seq, SceneGate* gate, uint64_t* updateUs) {
+  SceneGateConfig config;
+  sceneGateDefaultConfig(&config);
+  sceneGateInit(gate, &config);
+  std::vector<int> triggers;
+  *updateUs = 0;
+  for (size_t i = 0; i < seq.frames.size(); i++) {
+    uint64_t start = hostMicros();
+    bool fire = sceneGateUpdate(gate, seq.frames[i].thumb, seq.frames[i].timestampMs);
+    *updateUs += hostMicros() - start;
+    if (fire) triggers.push_back((int)i);
+  }
+  return triggers;
+}
+
+static std::string join(const std::vector<int>& values) {
+  std::string s;
+  for (int v : values) s += (s.empty() ? "" : " ") + std::to_string(v);
+  return s;
+}
+
+static void runSequence(const std::string& name, const Sequence& seq) {
+  static SceneGate gate;
+  uint64_t updateUs;
+  std::vector<int> triggers = replay(seq, &gate, &updateUs);
+  printf("%-20s %3zu frames, triggers [%s], %lu unchanged, %lu cooling, %.2f us/frame\n", name.c_str(),
+         seq.frames.size(), join(triggers).c_str(), (unsigned long)gate.unchanged,
+         (unsigned long)gate.cooling, (double)updateUs / seq.frames.size());
+  if (seq.hasExpected && triggers != seq.expected) {
+    fprintf(stderr, "%s: expected triggers [%s]\n", name.c_str(), join(seq.expected).c_str());
+    hostFailures++;
+  }
+}
+
+// 与benchmarkSceneGate相同的合成序列：缓慢漂移、曝光闪烁、物体出现/冷却期内移动/消失
+static Sequence syntheticSequence() {
+  Sequence seq;
+  seq.hasExpected = true;
+  seq.expected = {0, 100, 115, 150};
+  uint32_t seed = 1;
+  for (int f = 0; f < 200; f++) {
+    SceneFrame frame;
+    frame.timestampMs = f * 200;
+    int bright = f < 20 ? 0 : (f < 60 ? f - 20 : 40);
+    if (f >= 80) bright += (f & 1) ? 8 : -8;
+    int objectX = f >= 150 ? -1 : (f >= 102 ? 20 : (f >= 100 ? 4 : -1));
+    for (int y = 0; y < SCENE_THUMB_HEIGHT; y++) {
+      for (int x = 0; x < SCENE_THUMB_WIDTH; x++) {
+        seed = seed * 1103515245 + 12345;
+        int v = 60 + x * 3 + y * 2 + bright + (int)((seed >> 16) % 9) - 4;
+        if (objectX >= 0 && x >= objectX && x < objectX + 8 && y >= 8 && y < 16) v = 180 + bright;
+        frame.thumb[y * SCENE_THUMB_WIDTH + x] = (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v);
+      }
+    }
+    seq.frames.push_back(frame);
+  }
+  return seq;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1) {
+    for (int i = 1; i < argc; i++) {
+      Sequence seq;
+      if (!loadSequence(argv[i], &seq)) {
+        fprintf(stderr, "%s: no SCENESEQ frames\n", argv[i]);
+        hostFailures++;
+        continue;
+      }
+      runSequence(argv[i], seq);
+    }
+    return hostTestResult("test_scene_gate");
+  }
+
+  runSequence("synthetic", syntheticSequence());
+  for (const char* name : recordings) {
+    Sequence seq;
+    std::string path = hostPath("data/scene/") + name + ".seq";
+    if (!loadSequence(path, &seq) || !seq.hasExpected) {
+      fprintf(stderr, "cannot load %s\n", path.c_str());
+      hostFailures++;
+      continue;
+    }
+    runSequence(name, seq);
+  }
+
+  // 同一帧得分为0，无背景时为100
+  static SceneGate gate;
+  SceneGateConfig config;
+  sceneGateDefaultConfig(&config);
+  sceneGateInit(&gate, &config);
+  uint8_t thumb[THUMB_PIXELS];
+  for (int i = 0; i < THUMB_PIXELS; i++) thumb[i] = (uint8_t)(i * 7);
+  CHECK_EQ(sceneGateScore(&gate, thumb), 100);
+  CHECK(sceneGateUpdate(&gate, thumb, 0));
+  CHECK_EQ(sceneGateScore(&gate, thumb), 0);
+  CHECK(!sceneGateUpdate(&gate, thumb, 10000));
+  return hostTestResult("test_scene_gate");
+}
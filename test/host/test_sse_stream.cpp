@@ -0,0 +1,260 @@
+// 流式响应：按DashScope兼容接口的格式构造分块传输的SSE响应（chat.completion.chunk事件、
+// 注释行、CRLF/CR换行、多行data、usage事件和[DONE]），在每个位置切成两段、以及按1~257字节
+// 等长切分输入ChunkDecoder + SseParser，事件和用chatDeltaParse拼出的回答都必须与原文一致。
+// 包括远大于旧的512字节文档的单个delta：按CHAT_DELTA_DOC_SIZE分配时完整解析，文档不够时
+// 返回NoMemory而不是丢字。超过SSE_EVENT_MAX的事件被丢弃并计数。打印解析吞吐量。
+
+#include "host_test.h"
+#include "sse_stream.h"
+#include "chat_response.h"
+#include <stdlib.h>
+
+struct Collected {
+  std::vector<std::string> events;
+};
+
+static void collect(const char* data, size_t length, void* ctx) {
+  Collected* c = (Collected*)ctx;
+  if (strlen(data) != length) hostFailures++;  // data必须以'\0'结尾且不含截断
+  c->events.push_back(std::string(data, length));
+}
+
+static std::string jsonEscape(const std::string& s) {
+  std::string out;
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (c == '\n') {
+      out += "\\n";
+    } else {
+      out += c;
+    }
+  }
+  return out;
+}
+
+struct StreamCase {
+  std::string answer;                 // 各delta拼起来的完整回答
+  std::vector<std::string> deltas;
+  std::string sse;                    // 事件流
+  std::string body;                   // 分块传输编码后的响应体
+  size_t dataEvents = 0;              // 带data的事件数（含[DONE]）
+};
+
+// 回答按给定长度切成delta，中文（3字节UTF-8）、引号、反斜杠和换行都会出现
+static StreamCase makeStream(const std::vector<size_t>& deltaLengths) {
+  static const char* pieces[] = {"图像中", "有一只", "猫", "\"引号\"", "\\", "\n", "ab", "c", " ", "。"};
+  StreamCase c;
+  srand(19);
+  for (size_t length : deltaLengths) {
+    std::string delta;
+    while (delta.size() < length) delta += pieces[rand() % 10];
+    c.deltas.push_back(delta);
+    c.answer += delta;
+  }
+
+  const char* head = "{\"id\":\"chatcmpl-19\",\"object\":\"chat.completion.chunk\",\"created\":1700000000,"
+                     "\"model\":\"qwen-vl-max\",\"choices\":[{\"index\":0,\"delta\":{";
+  c.sse = ": keep-alive\r\n\r\n";
+  for (size_t i = 0; i < c.deltas.size(); i++) {
+    std::string event = std::string(head) + (i == 0 ? "\"role\":\"assistant\"," : "") + "\"content\":\"" +
+                        jsonEscape(c.deltas[i]) + "\"},\"finish_reason\":null}]}";
+    // 交替使用LF、CRLF和CR换行；部分事件带id字段
+    const char* eol = i % 3 == 0 ? "\n" : i % 3 == 1 ? "\r\n" : "\r";
+    if (i % 4 == 1) c.sse += std::string("id: ") + std::to_string(i) + eol;
+    c.sse += "data: " + event + eol + eol;
+    c.dataEvents++;
+  }
+  c.sse += std::string("data: ") + head + "},\"finish_reason\":\"stop\"}]}\n\n";
+  // 多行data以'\n'连接后仍是合法JSON
+  c.sse += "data: {\"choices\":[],\n"
+           "data: \"usage\":{\"prompt_tokens\":1234,\"completion_tokens\":56,\"total_tokens\":1290}}\n\n";
+  c.sse += "data: [DONE]\n\n";
+  c.dataEvents += 3;
+
+  size_t sizes[] = {7, 1, 200, 33, 4096, 2};
+  for (size_t pos = 0, k = 0; pos < c.sse.size(); k++) {
+    size_t n = std::min(sizes[k % 6], c.sse.size() - pos);
+    char header[32];
+    snprintf(header, sizeof(header), k % 2 ? "%zX\r\n" : "%zx;ext=1\r\n", n);
+    c.body += header;
+    c.body.append(c.sse, pos, n);
+    c.body += "\r\n";
+    pos += n;
+  }
+  c.body += "0\r\nX-Trailer: 1\r\n\r\n";
+  return c;
+}
+
+struct Decoded {
+  std::string payload;
+  Collected events;
+  bool done = false;
+  bool error = false;
+  uint32_t dropped = 0;
+};
+
+// pieces为各段长度，总和等于响应体长度
+static void decode(const StreamCase& c, const std::vector<size_t>& pieces, Decoded* out, SseParser* parser) {
+  ChunkDecoder decoder;
+  chunkDecoderInit(&decoder);
+  sseParserInit(parser, collect, &out->events);
+  std::string body = c.body;
+  size_t pos = 0;
+  for (size_t n : pieces) {
+    size_t m = chunkDecoderFeed(&decoder, (uint8_t*)&body[pos], n);
+    out->payload.append(body, pos, m);
+    sseParserFeed(parser, &body[pos], m);
+    pos += n;
+  }
+  out->done = decoder.done;
+  out->error = decoder.error;
+  out->dropped = parser->dropped;
+}
+
+// 与ai_vision.cpp的onVisionEvent相同：逐事件解析并拼接回答
+static bool assemble(const std::vector<std::string>& events, JsonDocument& doc, std::string* answer,
+                     uint32_t* totalTokens, bool* sawDone) {
+  *sawDone = false;
+  *totalTokens = 0;
+  for (const std::string& e : events) {
+    if (e == "[DONE]") {
+      *sawDone = true;
+      continue;
+    }
+    ChatDelta delta;
+    if (chatDeltaParse(doc, e.data(), e.size(), &delta)) return false;
+    if (delta.content) *answer += delta.content;
+    if (delta.totalTokens) *totalTokens = delta.totalTokens;
+  }
+  return true;
+}
+
+static bool checkDecoded(const StreamCase& c, const Decoded& d, JsonDocument& doc) {
+  if (d.payload != c.sse || !d.done || d.error || d.dropped != 0 || d.events.events.size() != c.dataEvents) {
+    return false;
+  }
+  std::string answer;
+  uint32_t totalTokens;
+  bool sawDone;
+  return assemble(d.events.events, doc, &answer, &totalTokens, &sawDone) && answer == c.answer && sawDone &&
+         totalTokens == 1290;
+}
+
+static size_t longestEvent(const std::string& sse) {
+  size_t longest = 0;
+  for (size_t pos = sse.find("data: "); pos != std::string::npos; pos = sse.find("data: ", pos + 1)) {
+    longest = std::max(longest, sse.find_first_of("\r\n", pos) - pos - 6);
+  }
+  return longest;
+}
+
+static void checkEverySplit() {
+  // 第三个delta远超旧的512字节文档，最后一个事件接近SSE_EVENT_MAX
+  StreamCase c = makeStream({5, 40, 1500, 12, 1, 300, 1650});
+  DynamicJsonDocument doc(CHAT_DELTA_DOC_SIZE(SSE_EVENT_MAX));
+  static SseParser parser;
+
+  int failedSplits = 0;
+  for (size_t cut = 0; cut <= c.body.size(); cut++) {
+    Decoded d;
+    decode(c, {cut, c.body.size() - cut}, &d, &parser);
+    if (!checkDecoded(c, d, doc) && failedSplits++ < 5) fprintf(stderr, "split at %zu failed\n", cut);
+  }
+  for (size_t step = 1; step <= 257; step++) {
+    std::vector<size_t> pieces;
+    for (size_t pos = 0; pos < c.body.size(); pos += step) pieces.push_back(std::min(step, c.body.size() - pos));
+    Decoded d;
+    decode(c, pieces, &d, &parser);
+    if (!checkDecoded(c, d, doc) && failedSplits++ < 5) fprintf(stderr, "%zu-byte pieces failed\n", step);
+  }
+  CHECK_EQ(failedSplits, 0);
+  printf("%zu-byte body, %zu events, %zu-byte answer, longest event %zu bytes: %d failed splits\n",
+         c.body.size(), c.dataEvents, c.answer.size(), longestEvent(c.sse), failedSplits);
+}
+
+static void checkDocumentSize() {
+  StreamCase c = makeStream({1500});
+  std::string event = c.sse.substr(c.sse.find("data: ") + 6);
+  event = event.substr(0, event.find('\n'));
+  ChatDelta delta;
+
+  // 旧实现的512字节文档：必须报NoMemory，而不是返回截断或空的文字
+  DynamicJsonDocument small(512);
+  CHECK(chatDeltaParse(small, event.data(), event.size(), &delta) == DeserializationError::NoMemory);
+
+  DynamicJsonDocument doc(CHAT_DELTA_DOC_SIZE(event.size()));
+  CHECK(chatDeltaParse(doc, event.data(), event.size(), &delta) == DeserializationError::Ok);
+  CHECK(delta.content && c.deltas[0] == delta.content);
+  CHECK(delta.finishReason == NULL);
+
+  // 解析器能交出的最长事件：整个data都是content
+  std::string longest(SSE_EVENT_MAX - 1 - 40, 'x');
+  std::string json = "{\"choices\":[{\"delta\":{\"content\":\"" + longest + "\"}}]}";
+  CHECK(json.size() <= SSE_EVENT_MAX - 1);
+  DynamicJsonDocument maxDoc(CHAT_DELTA_DOC_SIZE(SSE_EVENT_MAX));
+  CHECK(chatDeltaParse(maxDoc, json.data(), json.size(), &delta) == DeserializationError::Ok);
+  CHECK(delta.content && longest == delta.content);
+
+  const char* usage = "{\"choices\":[],\"usage\":{\"prompt_tokens\":7,\"completion_tokens\":3,\"total_tokens\":10}}";
+  CHECK(chatDeltaParse(doc, usage, strlen(usage), &delta) == DeserializationError::Ok);
+  CHECK(delta.content == NULL);
+  CHECK_EQ(delta.promptTokens, 7);
+  CHECK_EQ(delta.completionTokens, 3);
+  CHECK_EQ(delta.totalTokens, 10);
+}
+
+static void checkOverflowAndErrors() {
+  static SseParser parser;
+  Collected c;
+  sseParserInit(&parser, collect, &c);
+  std::string text = "data: " + std::string(SSE_EVENT_MAX + 100, 'x') + "\n\ndata: ok\n\n";
+  sseParserFeed(&parser, text.data(), text.size());
+  CHECK_EQ(parser.dropped, 1);
+  CHECK(c.events.size() == 1 && c.events[0] == "ok");
+
+  // 没有结束分块时decoder.done保持false（连接中途断开）
+  StreamCase s = makeStream({10, 20});
+  Decoded d;
+  decode(s, {s.body.size() - 5, 0}, &d, &parser);
+  CHECK(!d.done);
+  CHECK(!d.error);
+
+  // 非十六进制的分块头
+  ChunkDecoder decoder;
+  chunkDecoderInit(&decoder);
+  char bad[] = "zz\r\nabc\r\n";
+  chunkDecoderFeed(&decoder, (uint8_t*)bad, strlen(bad));
+  CHECK(decoder.error);
+}
+
+static void benchmark() {
+  StreamCase c = makeStream(std::vector<size_t>(200, 24));
+  DynamicJsonDocument doc(CHAT_DELTA_DOC_SIZE(SSE_EVENT_MAX));
+  static SseParser parser;
+  const int runs = 200;
+  uint64_t start = hostMicros();
+  size_t answerBytes = 0;
+  for (int i = 0; i < runs; i++) {
+    Decoded d;
+    decode(c, std::vector<size_t>(1, c.body.size()), &d, &parser);
+    std::string answer;
+    uint32_t totalTokens;
+    bool sawDone;
+    assemble(d.events.events, doc, &answer, &totalTokens, &sawDone);
+    answerBytes += answer.size();
+  }
+  double us = (double)(hostMicros() - start) / runs;
+  printf("%zu-byte stream, %zu events: %.1f us (%.0f MB/s)\n", c.body.size(), c.dataEvents, us,
+         c.body.size() / us);
+  CHECK(answerBytes == c.answer.size() * runs);
+}
+
+int main() {
+  checkEverySplit();
+  checkDocumentSize();
+  checkOverflowAndErrors();
+  benchmark();
+  return hostTestResult("test_sse_stream");
+}
@@ -0,0 +1,283 @@
+// 客户端路径端到端：ai_vision、api_connection、vision_requests等固件源文件编译到Linux
+// （arduino/中的主机实现），对着mock_dashscope.py发送真实的HTTP请求：
+//   连接测试、JPEG上传（Base64校验）、图像URL、非流式和流式回答与canned回答一致；
+//   超过旧文档大小的单个delta、服务器不支持include_usage；
+//   流式和非流式响应中途断开时报错而不是返回半截回答；
+//   429后按Retry-After重试成功，401/400/500的错误文字；连接失败时退回预扣的配额；
+//   每个请求输出自己的请求体字节数和上行耗时，没有发出时为0；
+//   keep-alive复用连接、服务器关闭连接后重新握手；注入的延迟计入首字节阶段，限速计入下载；
+//   https（mock_dashscope.py --tls）：客户端和服务器两边的握手次数与复用率，不做会话恢复；
+//   异步工作任务：合并相同请求、回调全部成功。
+
+#include "host_test.h"
+#include "host_client.h"
+#include "api_connection.h"
+#include "api_latency.h"
+#include "vision_requests.h"
+#include <ArduinoJson.h>
+#include <atomic>
+
+static std::vector<uint8_t> jpeg;
+static std::string defaultAnswer = "图中有一个女孩和一只狗坐在海滩上，女孩正在和狗击掌。";
+
+static std::string answerFor(const char* key) {
+  std::vector<uint8_t> data;
+  hostReadFile(hostPath("data/chat/mock_answers.json"), &data);
+  DynamicJsonDocument doc(16384);
+  deserializeJson(doc, (const char*)data.data(), data.size());
+  return doc[key].as<std::string>();
+}
+
+static String ask(const char* question) {
+  return resolveImageJpeg(jpeg.data(), jpeg.size(), question, false);
+}
+
+struct Tokens {
+  std::string text;
+  int count = 0;
+};
+
+static void onToken(const char* token, void* ctx) {
+  Tokens* t = (Tokens*)ctx;
+  t->text += token;
+  t->count++;
+}
+
+static String askStream(const char* question, Tokens* tokens) {
+  return resolveImageJpegStream(jpeg.data(), jpeg.size(), question, onToken, tokens, false);
+}
+
+static ApiConnectionStats connectionStats() {
+  ApiConnectionStats stats;
+  getApiConnectionStats(&stats);
+  return stats;
+}
+
+static void checkAnswers() {
+  CHECK(testAPIConnection());
+  CHECK(ask("图中有什么？") == defaultAnswer.c_str());
+  CHECK(ask("图中有几个人？") == answerFor("有几个人").c_str());
+  CHECK(resolveImageFromURL("https://example.com/dog_and_girl.jpeg", "图中有什么？") == defaultAnswer.c_str());
+
+  // 非JPEG的图像被服务器拒绝
+  const uint8_t png[] = {0x89, 'P', 'N', 'G', 0, 0, 0, 0};
+  CHECK(resolveImageJpeg(png, sizeof(png), "图中有什么？", false) == "错误：请求格式错误(400)");
+
+  // 流式：每段回调拼起来就是回答
+  Tokens tokens;
+  String result = askStream("图中有什么？", &tokens);
+  CHECK(result == defaultAnswer.c_str());
+  CHECK(tokens.text == defaultAnswer);
+  CHECK(tokens.count > 3);
+
+  // 约3600字节的回答：非流式在CHAT_ANSWER_MAX以内；流式每段500个汉字（1500字节）
+  std::string detail = answerFor("详细描述");
+  CHECK(detail.size() > 3000);
+  CHECK(ask("请详细描述这张图") == detail.c_str());
+  Tokens large;
+  CHECK(askStream("请详细描述这张图 [mock:delta=500]", &large) == detail.c_str());
+  CHECK(large.count == 3);
+
+  // 服务器不发用量事件时回答照常返回
+  Tokens noUsage;
+  CHECK(askStream("图中有什么？[mock:no_usage]", &noUsage) == defaultAnswer.c_str());
+}
+
+static void checkFailures() {
+  // 中途断开：已收到的部分不能当作回答
+  Tokens partial;
+  CHECK(askStream("请详细描述这张图 [mock:truncate,delta=50]", &partial) == "错误：回答不完整");
+  CHECK(partial.count > 0);
+  CHECK(ask("请详细描述这张图 [mock:truncate]") == "错误：响应解析失败");
+  // 断开后的下一个请求重新连接
+  CHECK(ask("图中有什么？") == defaultAnswer.c_str());
+
+  // 429后按Retry-After（1秒）暂停再重试
+  uint32_t start = millis();
+  CHECK(ask("图中有什么？[mock:status=429,times=1,retry_after=1]") == defaultAnswer.c_str());
+  CHECK(millis() - start >= 1000);
+
+  CHECK(ask("图中有什么？[mock:status=500]") == "错误：API请求失败(500)");
+  CHECK(ask("图中有什么？[mock:status=503]") == "错误：API请求失败(503)");
+  CHECK(ask("图中有什么？[mock:status=401]") == "错误：API密钥错误(401)");
+  Tokens none;
+  CHECK(askStream("图中有什么？[mock:status=500]", &none) == "错误：API请求失败(500)");
+  CHECK(none.count == 0);
+}
+
+static void checkConnection(const std::string& url) {
+  // keep-alive：连续请求不再握手
+  ApiConnectionStats before = connectionStats();
+  for (int i = 0; i < 5; i++) CHECK(ask("图中有什么？") == defaultAnswer.c_str());
+  ApiConnectionStats after = connectionStats();
+  CHECK_EQ(after.handshakes - before.handshakes, 0);
+  CHECK_EQ(after.reused - before.reused, 5);
+
+  // 服务器响应后关闭连接：下一个请求重新握手
+  CHECK(ask("图中有什么？[mock:close]") == defaultAnswer.c_str());
+  CHECK(ask("图中有什么？") == defaultAnswer.c_str());
+  CHECK_EQ(connectionStats().handshakes - after.handshakes, 1);
+
+  // 请求体的字节数：Base64后的图像加上JSON外壳
+  size_t sentBytes = 0;
+  uint32_t sentMs = 1;
+  CHECK(resolveImageJpeg(jpeg.data(), jpeg.size(), "图中有什么？", false, &sentBytes, &sentMs) ==
+        defaultAnswer.c_str());
+  CHECK(sentBytes > (jpeg.size() + 2) / 3 * 4 && sentBytes < (jpeg.size() + 2) / 3 * 4 + 300);
+
+  // 连接失败（端口上没有服务器），预扣的配额被退回，没有上行数据
+  setVisionApiUrl("https://127.0.0.1:9/compatible-mode/v1/chat/completions");
+  CHECK(resolveImageJpeg(jpeg.data(), jpeg.size(), "图中有什么？", false, &sentBytes, &sentMs) ==
+        "错误：网络连接失败");
+  CHECK_EQ(sentBytes, 0);
+  CHECK_EQ(sentMs, 0);
+  setVisionApiUrl(url.c_str());
+  CHECK(ask("图中有什么？") == defaultAnswer.c_str());
+}
+
+// 从模拟服务器的统计行中取出"N TLS handshakes (M resumed)"
+static bool parseTlsSummary(const std::string& summary, int* handshakes, int* resumed) {
+  size_t at = summary.find(" TLS handshakes (");
+  if (at == std::string::npos) return false;
+  size_t start = summary.rfind(' ', at - 1) + 1;
+  *handshakes = atoi(summary.c_str() + start);
+  *resumed = atoi(summary.c_str() + at + strlen(" TLS handshakes ("));
+  return true;
+}
+
+static void checkTls(MockServer* tls, const std::string& tlsUrl) {
+  CHECK(tlsUrl.compare(0, 8, "https://") == 0);
+  setVisionApiUrl(tlsUrl.c_str());
+  ApiConnectionStats before = connectionStats();
+
+  // 10个请求（含流式）只握手一次，其余9个复用
+  Tokens tokens;
+  CHECK(askStream("图中有什么？", &tokens) == defaultAnswer.c_str());
+  CHECK(tokens.text == defaultAnswer);
+  for (int i = 0; i < 8; i++) CHECK(ask("图中有什么？") == defaultAnswer.c_str());
+  CHECK(ask("请详细描述这张图") == answerFor("详细描述").c_str());
+  ApiConnectionStats reused = connectionStats();
+  CHECK_EQ(reused.requests - before.requests, 10);
+  CHECK_EQ(reused.handshakes - before.handshakes, 1);
+  CHECK_EQ(reused.reused - before.reused, 9);
+
+  // 服务器关闭连接后重新完整握手
+  CHECK(ask("图中有什么？[mock:close]") == defaultAnswer.c_str());
+  CHECK(ask("图中有什么？") == defaultAnswer.c_str());
+  ApiConnectionStats after = connectionStats();
+  CHECK_EQ(after.handshakes - before.handshakes, 2);
+  CHECK_EQ(after.reused - before.reused, 10);
+  printf("https: %lu requests, %lu handshakes, reuse %lu%%\n",
+         (unsigned long)(after.requests - before.requests),
+         (unsigned long)(after.handshakes - before.handshakes),
+         (unsigned long)((after.reused - before.reused) * 100 / (after.requests - before.requests)));
+
+  // 服务器一侧：两次握手，都不是会话恢复（客户端不保存会话）
+  apiConnectionClose();
+  std::string summary = tls->stop();
+  printf("%s\n", summary.c_str());
+  int handshakes = -1, resumed = -1;
+  CHECK(parseTlsSummary(summary, &handshakes, &resumed));
+  CHECK_EQ(handshakes, 2);
+  CHECK_EQ(resumed, 0);
+}
+
+static void checkTiming(const std::string& slowUrl) {
+  // 注入的300毫秒延迟在首字节阶段
+  resetApiLatencyStats();
+  CHECK(ask("图中有什么？[mock:latency=300]") == defaultAnswer.c_str());
+  LatencyHistogram firstByte;
+  getApiLatencyHistogram(API_PHASE_FIRST_BYTE, &firstByte);
+  CHECK_EQ(firstByte.count, 1);
+  CHECK(firstByte.maxUs >= 300000);
+
+  // 64 kbps下行：约3.9KB的响应体至少要480毫秒
+  setVisionApiUrl(slowUrl.c_str());
+  resetApiLatencyStats();
+  uint32_t start = millis();
+  CHECK(ask("请详细描述这张图") == answerFor("详细描述").c_str());
+  uint32_t elapsed = millis() - start;
+  LatencyHistogram download;
+  getApiLatencyHistogram(API_PHASE_DOWNLOAD, &download);
+  CHECK(download.count == 1 && download.maxUs >= 400000);
+  printf("64 kbps: %lu ms, download %lu ms\n", (unsigned long)elapsed, (unsigned long)(download.maxUs / 1000));
+}
+
+struct AsyncResults {
+  std::atomic<int> done{0};
+  std::atomic<int> ok{0};
+  std::atomic<int> wrong{0};
+};
+
+static void onAsyncResult(const VisionRequestResult* result, void* ctx) {
+  AsyncResults* r = (AsyncResults*)ctx;
+  if (result->status == VISION_REQUEST_OK) {
+    r->ok++;
+    if (defaultAnswer != result->text) r->wrong++;
+  }
+  r->done++;
+}
+
+static void checkWorker() {
+  CHECK(startVisionRequestWorker(8));
+  AsyncResults results;
+  VisionRequest request;
+  visionRequestInit(&request);
+  request.image = jpeg.data();
+  request.imageLength = jpeg.size();
+  request.onDone = onAsyncResult;
+  request.ctx = &results;
+
+  // 第一个请求发送期间，同一图像的同一问题合并为一次发送
+  char questions[6][48];
+  int submitted = 0;
+  for (int i = 0; i < 6; i++) {
+    snprintf(questions[i], sizeof(questions[i]), "图中有什么？#%d [mock:latency=100]", i < 2 ? 0 : i);
+    request.question = questions[i];
+    if (submitVisionRequest(&request)) submitted++;
+  }
+  CHECK_EQ(submitted, 6);
+  uint32_t start = millis();
+  while (results.done < submitted && millis() - start < 20000) delay(10);
+  stopVisionRequestWorker();
+
+  RequestQueueStats stats;
+  getVisionRequestStats(&stats);
+  CHECK_EQ(results.ok.load(), 6);
+  CHECK_EQ(results.wrong.load(), 0);
+  CHECK_EQ(stats.coalesced, 1);
+  CHECK_EQ(stats.served, 5);
+}
+
+int main() {
+  if (!hostReadFile(hostPath("data/img_160x120_420.jpg"), &jpeg)) {
+    fprintf(stderr, "cannot read test image\n");
+    return 1;
+  }
+  apiConnectionInit();
+  initVisionRateLimit();
+  apiLatencyInit();
+
+  std::string answers = hostPath("data/chat/mock_answers.json");
+  MockServer mock, slow, tls;
+  std::string url = mock.start({"--answers-file", answers, "--token-interval-ms", "2"});
+  std::string slowUrl = slow.start({"--answers-file", answers, "--bandwidth-kbps", "64"});
+  std::string tlsUrl = tls.start({"--answers-file", answers, "--tls"});
+  if (url.empty() || slowUrl.empty() || tlsUrl.empty()) return 1;
+  setVisionApiUrl(url.c_str());
+
+  checkAnswers();
+  checkFailures();
+  checkConnection(url);
+  checkTls(&tls, tlsUrl);
+  setVisionApiUrl(url.c_str());
+  checkTiming(slowUrl);
+  setVisionApiUrl(url.c_str());
+  checkWorker();
+
+  apiConnectionClose();
+  printApiConnectionStats();
+  printVisionRateStats();
+  printf("%s\n%s\n", mock.stop().c_str(), slow.stop().c_str());
+  return hostTestResult("test_vision_client");
+}
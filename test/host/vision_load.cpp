@@ -0,0 +1,172 @@
+// 视觉接口负载生成器（主机上运行的main.cpp testVisionLoad）：按固定间隔经异步请求队列
+// （vision_requests，单个工作任务和一个长连接，与固件相同）提交请求，问题各不相同不会被合并，
+// 结束后输出吞吐量、端到端/排队/处理时间的分布（min/avg/p50/p90/p95/p99/max）、
+// 各阶段耗时（api_latency）以及连接、队列和限流统计。
+//
+//   vision_load [--url URL] [--requests N] [--interval-ms MS] [--timeout-ms MS] [--image FILE]
+//               [--question TEXT] [--stream] [--rate-limit RPM,TPM] [--verbose] [--mock "选项"]
+//
+// 没有--url时启动本地的mock_dashscope.py，--mock中的选项原样传给它，例如
+//   vision_load --requests 200 --interval-ms 20 --mock "--latency-ms 300 --jitter-ms 200 --error-rate 0.02"
+// --url可以是https地址（与固件一样不校验证书），--mock "--tls"时模拟服务器以https监听。
+// 有失败或超时的请求时返回1。
+
+#include "host_test.h"
+#include "host_client.h"
+#include "api_connection.h"
+#include "api_latency.h"
+#include "vision_requests.h"
+#include <atomic>
+#include <mutex>
+#include <sstream>
+
+struct LoadStats {
+  std::mutex lock;
+  std::atomic<int> finished{0};
+  int statusCounts[4] = {};       // 按VisionRequestStatus计数
+  LatencyHistogram total;         // 提交到收到结果（排队 + 处理）
+  LatencyHistogram wait;
+  LatencyHistogram service;
+};
+
+static void onLoadResult(const VisionRequestResult* result, void* ctx) {
+  LoadStats* stats = (LoadStats*)ctx;
+  {
+    std::lock_guard<std::mutex> guard(stats->lock);
+    stats->statusCounts[result->status]++;
+    if (result->status == VISION_REQUEST_OK || result->status == VISION_REQUEST_FAILED) {
+      latencyHistogramRecord(&stats->total, (result->waitMs + result->serviceMs) * 1000);
+      latencyHistogramRecord(&stats->wait, result->waitMs * 1000);
+      latencyHistogramRecord(&stats->service, result->serviceMs * 1000);
+    }
+  }
+  stats->finished++;
+}
+
+static void printDistribution(const char* name, const LatencyHistogram* h) {
+  if (h->count == 0) {
+    printf("  %-10s %6d\n", name, 0);
+    return;
+  }
+  const uint8_t percents[] = {50, 90, 95, 99};
+  printf("  %-10s %6lu %8.1f %8.1f", name, (unsigned long)h->count, h->minUs / 1000.0,
+         latencyHistogramAverage(h) / 1000.0);
+  for (uint8_t p : percents) printf(" %8.1f", latencyHistogramPercentile(h, p) / 1000.0);
+  printf(" %8.1f\n", h->maxUs / 1000.0);
+}
+
+#ifdef HOST_PYTHON
+static std::vector<std::string> splitArgs(const char* text) {
+  std::vector<std::string> args;
+  std::istringstream in(text);
+  std::string arg;
+  while (in >> arg) args.push_back(arg);
+  return args;
+}
+#endif
+
+static const char* option(int argc, char** argv, const char* name, const char* fallback) {
+  for (int i = 1; i + 1 < argc; i++) {
+    if (strcmp(argv[i], name) == 0) return argv[i + 1];
+  }
+  return fallback;
+}
+
+int main(int argc, char** argv) {
+  const char* url = option(argc, argv, "--url", NULL);
+  int requests = atoi(option(argc, argv, "--requests", "50"));
+  uint32_t intervalMs = (uint32_t)atol(option(argc, argv, "--interval-ms", "50"));
+  uint32_t timeoutMs = (uint32_t)atol(option(argc, argv, "--timeout-ms", "0"));
+  const char* imagePath = option(argc, argv, "--image", NULL);
+  const char* question = option(argc, argv, "--question", "负载测试 %d：图中有几个人？");
+  const char* rateLimit = option(argc, argv, "--rate-limit", "0,0");
+  bool stream = hostHasFlag(argc, argv, "--stream");
+  bool verbose = hostHasFlag(argc, argv, "--verbose");
+
+  std::vector<uint8_t> jpeg;
+  std::string image = imagePath ? imagePath : hostPath("data/img_640x480_420.jpg");
+  if (!hostReadFile(image, &jpeg)) {
+    fprintf(stderr, "cannot read %s\n", image.c_str());
+    return 2;
+  }
+
+  std::string apiUrl = url ? url : "";
+#ifdef HOST_PYTHON
+  MockServer mock;
+  if (!url) {
+    std::vector<std::string> args = splitArgs(option(argc, argv, "--mock", ""));
+    apiUrl = mock.start(args);
+    if (apiUrl.empty()) return 2;
+  }
+#endif
+  if (apiUrl.empty()) {
+    fprintf(stderr, "--url is required (Python was not found, the local mock server is unavailable)\n");
+    return 2;
+  }
+
+  apiConnectionInit();
+  initVisionRateLimit();
+  apiLatencyInit();
+  setVisionApiUrl(apiUrl.c_str());
+  setVisionStreaming(stream);
+  printf("=== Vision Load: %d requests every %lu ms to %s, %u-byte JPEG, %s ===\n", requests,
+         (unsigned long)intervalMs, apiUrl.c_str(), (unsigned)jpeg.size(), stream ? "streaming" : "non-streaming");
+  uint32_t rpm = 0, tpm = 0;
+  sscanf(rateLimit, "%u,%u", &rpm, &tpm);
+  setVisionRateLimit(rpm, tpm);
+
+  if (!verbose) hostSerialMute(true);
+  if (!startVisionRequestWorker(REQUEST_QUEUE_MAX)) return 2;
+
+  static LoadStats stats;
+  latencyHistogramReset(&stats.total);
+  latencyHistogramReset(&stats.wait);
+  latencyHistogramReset(&stats.service);
+  VisionRequest request;
+  visionRequestInit(&request);
+  request.image = jpeg.data();
+  request.imageLength = jpeg.size();
+  request.timeoutMs = timeoutMs;
+  request.onDone = onLoadResult;
+  request.ctx = &stats;
+
+  int submitted = 0;
+  int rejected = 0;
+  char text[VISION_REQUEST_QUESTION_MAX];
+  uint32_t start = millis();
+  for (int i = 0; i < requests; i++) {
+    snprintf(text, sizeof(text), question, i);
+    request.question = text;
+    if (submitVisionRequest(&request)) {
+      submitted++;
+    } else {
+      rejected++;  // 队列满
+    }
+    delay(intervalMs);
+  }
+  while (stats.finished < submitted && millis() - start < 600000) delay(10);
+  uint32_t elapsed = millis() - start;
+  stopVisionRequestWorker();
+  apiConnectionClose();
+  hostSerialMute(false);
+
+  int ok = stats.statusCounts[VISION_REQUEST_OK];
+  int failed = stats.statusCounts[VISION_REQUEST_FAILED];
+  int expired = stats.statusCounts[VISION_REQUEST_EXPIRED];
+  printf("%d requests in %lu ms: %d ok, %d failed, %d expired, %d rejected (queue full)\n", submitted,
+         (unsigned long)elapsed, ok, failed, expired, rejected);
+  printf("throughput %.2f requests/s (offered %.2f/s)\n", ok * 1000.0 / elapsed,
+         intervalMs ? 1000.0 / intervalMs : 0.0);
+  printf("latency (ms)  count      min      avg      p50      p90      p95      p99      max\n");
+  printDistribution("total", &stats.total);
+  printDistribution("queue", &stats.wait);
+  printDistribution("service", &stats.service);
+  printVisionRequestStats();
+  printVisionRateStats();
+  printApiConnectionStats();
+  printApiLatencyStats();
+#ifdef HOST_PYTHON
+  if (!url) printf("%s\n", mock.stop().c_str());
+#endif
+  return failed + expired > 0 || stats.finished < submitted ? 1 : 0;
+}